@@ -1,11 +1,18 @@
 #pragma once
 
+#include "SolarSystem/ECSWorld.hpp"
 #include "SolarSystem/Transform.hpp"
 #include "SolarSystem/Orbit.hpp"
 #include "SolarSystem/Window.hpp"
 #include "SolarSystem/Graphics.hpp"
 #include "SolarSystem/Renderer.hpp"
+#include "SolarSystem/FrameAllocator.hpp"
+#include "SolarSystem/MeshFile.hpp"
+#include "SolarSystem/SceneLoader.hpp"
+#include "SolarSystem/Hash.hpp"
+#include "SolarSystem/MemoryTracking.hpp"
 
+#include <array>
 #include <fstream>
 #include <iostream>
 #include <chrono>
@@ -13,35 +20,80 @@
 class App final
 {
 public:
-    App(int const width, int const height)
+    App(int const width, int const height, std::filesystem::path const& scenePath = "Scenes/SolarSystem.scene")
+        : ecs(SolarSystem::MakeSystemArgs<SolarSystem::WindowSystem>(width, height, L"Solar System"))
     {
-        ecs.AddSystem<SolarSystem::WindowSystem>(width, height, L"Solar System");
-        ecs.AddSystem<SolarSystem::GraphicsSystem>();
-        ecs.AddSystem<SolarSystem::ShaderReflectionSystem>();
-
-        ecs.AddSystem<SolarSystem::OrbitSystem>();
-        ecs.AddSystem<SolarSystem::RotationalAxisSystem>();
-        
-        ecs.AddSystem<SolarSystem::WorldSystem>();
-        ecs.AddSystem<SolarSystem::ScalingSystem>();
-        ecs.AddSystem<SolarSystem::RotationSystem>();
-        ecs.AddSystem<SolarSystem::TranslationSystem>();
-        
-        ecs.AddSystem<SolarSystem::ParentSystem>();
-        ecs.AddSystem<SolarSystem::CameraSystem>();
-        ecs.AddSystem<SolarSystem::RendererSystem>();
         ecs.Initialize();
 
-        IntializeResources();
+        // Tracked before any frame runs, replay logs store key states in tracking order
+        auto const ws = ecs.GetSystem<SolarSystem::WindowSystem>();
+        ws->TrackKeyInput(SolarSystem::VirtualKey::Z);
+        ws->TrackKeyInput(SolarSystem::VirtualKey::X);
+        ws->TrackKeyInput(SolarSystem::VirtualKey::F5);
+        ws->TrackKeyInput(SolarSystem::VirtualKey::F9);
+
+        IntializeResources(scenePath);
+        PrintResourceReport();
     }
 
 
     auto Run() -> void
+    {
+        RunFrames(nullptr, nullptr);
+    }
+
+    // Runs like Run and writes the time step, time multiplier and input of every frame to the log
+    auto Record(std::filesystem::path const& logPath) -> void
     {
         auto const ws = ecs.GetSystem<SolarSystem::WindowSystem>();
-        ws->TrackKeyInput(SolarSystem::VirtualKey::Z);
-        ws->TrackKeyInput(SolarSystem::VirtualKey::X);
-        ws->Show();
+        auto recorder = SolarSystem::ReplayRecorder(logPath, ws->GetTrackedKeys());
+
+        ws->SetReplayRecorder(&recorder);
+        RunFrames(&recorder, nullptr);
+        ws->SetReplayRecorder(nullptr);
+
+        recorder.Finish(HashSimulationState());
+        std::cout << "Recorded " << recorder.GetFrameCount() << " frames" << std::endl;
+    }
+
+    //
+    // Plays a log back as fast as possible without showing the window, returns whether the
+    // simulation ended in the recorded state. Frames still render to the hidden window as the
+    // scene's resources live on the device.
+    //
+    auto Replay(std::filesystem::path const& logPath) -> bool
+    {
+        auto const ws = ecs.GetSystem<SolarSystem::WindowSystem>();
+        auto player = SolarSystem::ReplayPlayer(logPath);
+
+        ws->SetReplayPlayer(&player);
+        auto const memoryBefore = GetMemoryStatistics();
+        auto const start = std::chrono::steady_clock::now();
+        RunFrames(nullptr, &player);
+        auto const end = std::chrono::steady_clock::now();
+        ws->SetReplayPlayer(nullptr);
+
+        using ms = std::chrono::duration<double, std::chrono::milliseconds::period>;
+        auto const elapsed = std::chrono::duration_cast<ms>(end - start).count();
+        std::cout << "Replayed " << player.GetFrameCount() << " frames in " << elapsed << " ms" << std::endl;
+        PrintFrameAllocatorReport();
+        PrintMemoryReport(memoryBefore, player.GetFrameCount());
+
+        auto const matches = HashSimulationState() == player.GetChecksum();
+        std::cout << (matches ? "Simulation matches the recording" : "Simulation diverged from the recording") << std::endl;
+        return matches;
+    }
+
+
+private:
+
+    auto RunFrames(SolarSystem::ReplayRecorder* const recorder, SolarSystem::ReplayPlayer* const player) -> void
+    {
+        auto const ws = ecs.GetSystem<SolarSystem::WindowSystem>();
+        if(player == nullptr)
+        {
+            ws->Show();
+        }
 
 
         auto deltaTime = 0.0f;
@@ -49,9 +101,10 @@ public:
         int timeMultiplier[] = { 0, 1, 10, 1'000, 10'000, 100'000, 1'000'000, 10'000'000 };
         int currentTimeMultiplier = 1;
 
-        while(ws->IsOpen())
+        while(player != nullptr ? player->NextFrame() : ws->IsOpen())
         {
             auto start = std::chrono::steady_clock::now();
+            SolarSystem::GetFrameAllocator().BeginFrame();
 
             if(ws->GetKeyDown(SolarSystem::VirtualKey::Z))
             {
@@ -68,8 +121,42 @@ public:
                 }
             }
 
+            // F5 saves the simulation and F9 rewinds to it, later saves are deltas against the first one
+            if(ws->GetKeyDown(SolarSystem::VirtualKey::F5))
+            {
+                if(savedBase.data.empty())
+                {
+                    savedBase = ecs.GetECS().SaveSnapshot();
+                    saved = SolarSystem::Snapshot();
+                }
+                else
+                {
+                    saved = ecs.GetECS().SaveSnapshot(&savedBase);
+                }
+            }
+            if(ws->GetKeyDown(SolarSystem::VirtualKey::F9) && !savedBase.data.empty())
+            {
+                ecs.GetECS().RestoreSnapshot(saved.data.empty() ? savedBase : saved, &savedBase);
+            }
+
+
+            auto multiplier = timeMultiplier[currentTimeMultiplier];
+            if(player != nullptr)
+            {
+                deltaTime = player->GetFrame().deltaTime;
+                multiplier = player->GetFrame().timeMultiplier;
+            }
+            if(recorder != nullptr)
+            {
+                recorder->BeginFrame(deltaTime, multiplier);
+            }
+
+            ecs.Update(deltaTime, deltaTime * multiplier / 86'400);
 
-            ecs.Update(deltaTime, deltaTime * timeMultiplier[currentTimeMultiplier] / 86'400);
+            if(recorder != nullptr)
+            {
+                recorder->EndFrame();
+            }
 
             auto end = std::chrono::steady_clock::now();
             using s = std::chrono::duration<float, std::chrono::seconds::period>;
@@ -77,446 +164,134 @@ public:
         }
     }
 
-
-private:
-
-    auto IntializeResources() -> void
+    // World matrices are the end result of every simulation system
+    auto HashSimulationState() -> uint64_t
     {
-        auto const rs = ecs.GetSystem<SolarSystem::RendererSystem>();
-        auto const gs = ecs.GetSystem<SolarSystem::GraphicsSystem>();
-
-        sphere = rs->CreateMesh(SolarSystem::Procedural::CreateSphere(128, 64));
-        vsDefault = gs->CreateVertexShader(LoadBytecode("Shaders/VertexShader.cso"));
-        psDefault = gs->CreatePixelShader(LoadBytecode("Shaders/Planet_ps.cso"));
-        
-        unlit = rs->CreateMaterial({
-            gs->CreateVertexShader(LoadBytecode("Shaders/Unlit_vs.cso")),
-            gs->CreatePixelShader(LoadBytecode("Shaders/Unlit_ps.cso")),
-            { { }, { }, { }, { } }
-        });
+        auto state = std::vector<char>();
+        auto writer = SolarSystem::SnapshotWriter(state);
+        ecs.GetSystem<SolarSystem::WorldSystem>()->SaveState(writer);
+        return SolarSystem::HashBytes(state);
+    }
 
+    auto IntializeResources(std::filesystem::path const& scenePath) -> void
+    {
+        sphere = CreateSphereLOD();
 
-        // SUN
-        auto const sun = AddSun(10.0f);
-
-        // MERCURY
-        AddPlanet(
-            sun,
-            60.0f,
-            88.0f,
-            0.7f,
-            58.0f,
-            2.0f,
-            L"Assets/mercury_albedo.dds",
-            DirectX::SimpleMath::Color(0.9f, 0.6f, 0.3f, 0.1f),
-            0.56f,
-            vsDefault,
-            psDefault,
-            { }
-        );
-
-        // VENUS
-        AddPlanet(
-            sun,
-            75.0f,
-            225.0f,
-            1.0f,
-            116.0f,
-            177.0f,
-            L"Assets/venus_albedo.dds",
-            DirectX::SimpleMath::Color(1.0f, 0.9f, 0.8f, 0.1f),
-            0.87f,
-            vsDefault,
-            psDefault,
-            { }
-        );
-
-        // EARTH
-        auto const earthPoint = AddAtmoPlanet(
-            sun, 
-            100.0f, 
-            365.0f, 
-            1.0f, 
-            1.0f, 
-            23.5f, 
-            L"Assets/earth_albedo.dds", 
-            DirectX::SimpleMath::Color(0.0f, 0.65f, 0.85f, 0.1f), 
-            0.23f,
-            6360.0f,
-            100.0f,
-            L"Assets/earth_transmittance.bin",
-            L"Assets/earth_rayleight.bin",
-            L"Assets/earth_mie.bin",
-            L"Assets/earth_irradiance.bin"
-        );
-        AddMoon(earthPoint);
-
-        // MARS
-        auto const marsPoint = AddAtmoPlanet(
-            sun,
-            115.0f,
-            687.0f,
-            0.75f,
-            1.1f,
-            25.0f,
-            L"Assets/mars_albedo.dds",
-            DirectX::SimpleMath::Color(0.9f, 0.25f, 0.12f, 0.1f),
-            0.76f,
-            6360.0f,
-            50.0f,
-            L"Assets/mars_transmittance.bin",
-            L"Assets/mars_rayleight.bin",
-            L"Assets/mars_mie.bin",
-            L"Assets/mars_irradiance.bin"
-        );
-    
-        // JUPITER
-        AddPlanet(
-            sun,
-            200.0f,
-            4330.0f,
-            6.0f,
-            0.4f,
-            3.0f,
-            L"Assets/jupiter_albedo.dds",
-            DirectX::SimpleMath::Color(0.67f, 0.35f, 0.11f, 0.1f),
-            0.2f,
-            vsDefault,
-            psDefault ,
-            { }
-        );
-
-        // SATURN
-        auto const vsSaturn = gs->CreateVertexShader(LoadBytecode("Shaders/Saturn_vs.cso"));
-        auto const psSaturn = gs->CreatePixelShader(LoadBytecode("Shaders/Saturn_ps.cso"));
-        auto const rings = ecs.GetSystem<SolarSystem::GraphicsSystem>()->LoadTexture2D(L"Assets/saturn_ring_albedo.dds");
-        auto const saturnPoint = AddPlanet(
-            sun,
-            300.0f,
-            10800.0f,
-            5.0f,
-            0.41f,
-            26.0f,
-            L"Assets/saturn_albedo.dds",
-            DirectX::SimpleMath::Color(0.47f, 0.25f, 0.35f, 0.1f),
-            0.8f,
-            vsSaturn,
-            psSaturn,
-            rings
-        );
-        AddSaturnRings(saturnPoint, rings);
-
-        // URANUS
-        AddPlanet(sun,
-            340.0f,
-            30600.0f,
-            2.0f,
-            0.8f,
-            97.0f,
-            L"Assets/uranus_albedo.dds",
-            DirectX::SimpleMath::Color(0.56f, 0.81f, 0.74f, 0.1f),
-            0.3f,
-            vsDefault,
-            psDefault,
-            { }
-        );
-
-        // NEPTUNE
-        AddPlanet(
-            sun,
-            375.0f,
-            65000.0f,
-            2.0f, 0.75f,
-            29.0f,
-            L"Assets/neptune_albedo.dds",
-            DirectX::SimpleMath::Color(0.11f, 0.36f, 0.63f, 0.1f),
-            0.5f,
-            vsDefault,
-            psDefault,
-            { }
-        );
+        auto loader = SolarSystem::SceneLoader(ecs.GetECS(), sphere);
+        loader.Instantiate(SolarSystem::LoadSceneFile(scenePath));
     }
 
 
-    SolarSystem::ResourceHandle<SolarSystem::Mesh> sphere;
-    
-    SolarSystem::ResourceHandle<SolarSystem::VertexShader> vsDefault;
-    SolarSystem::ResourceHandle<SolarSystem::PixelShader> psDefault;
+    SolarSystem::ResourceHandle<SolarSystem::MeshLOD> sphere;
 
-    SolarSystem::ResourceHandle<SolarSystem::Material> unlit;
+    SolarSystem::Snapshot savedBase;
+    SolarSystem::Snapshot saved;
 
 
-    auto AddSun(float const radius) -> SolarSystem::Entity
+    auto CreateSphereLOD() -> SolarSystem::ResourceHandle<SolarSystem::MeshLOD>
     {
-        auto const albedo = ecs.GetSystem<SolarSystem::GraphicsSystem>()->LoadTexture2D(L"Assets/sun_albedo.dds");
-        
-        auto const sunMat = ecs.GetSystem<SolarSystem::RendererSystem>()->CreateMaterial({
-            vsDefault,
-            ecs.GetSystem<SolarSystem::GraphicsSystem>()->CreatePixelShader(LoadBytecode("Shaders/Sun_ps.cso")),
-            { albedo, { }, { }, { } }
-        });
-
-        auto const sunOrbitPoint = ecs.CreateEntity();
-        ecs.GetSystem<SolarSystem::WorldSystem>()->AddComponent(sunOrbitPoint);
-
-        auto const sun = ecs.CreateEntity();
-        ecs.GetSystem<SolarSystem::WorldSystem>()->AddComponent(sun);
-        ecs.GetSystem<SolarSystem::ScalingSystem>()->AddComponent(sun).scaling = DirectX::SimpleMath::Vector3(radius, radius, radius);
-        ecs.GetSystem<SolarSystem::RotationSystem>()->AddComponent(sun);
-        ecs.GetSystem<SolarSystem::RotationalAxisSystem>()->AddComponent(sun).period = -25.0f;
-        ecs.GetSystem<SolarSystem::CameraSystem>()->AddComponent(sun) = { 300.0f, 500.0f };
-        ecs.GetSystem<SolarSystem::ParentSystem>()->AddComponent(sun).parent = sunOrbitPoint;
-        ecs.GetSystem<SolarSystem::RendererSystem>()->AddComponent(sun, sphere, sunMat);
+        auto const rs = ecs.GetSystem<SolarSystem::RendererSystem>();
 
-        return sunOrbitPoint;
-    }
+        auto constexpr levelCount = 8;
+        auto constexpr minLongitudeSides = 8;
+        auto constexpr maxLongitudeSides = 256;
+        auto constexpr maxEdgePixels = 8.0f;
 
-    auto AddPlanet(
-        SolarSystem::Entity const parent,
-        float const orbitRadius,
-        float const orbitPeriod,
-        float const radius,
-        float const period,
-        float const axisAngle,
-        wchar_t const* const texture,
-        DirectX::SimpleMath::Color const& color,
-        float const t,
-        SolarSystem::ResourceHandle<SolarSystem::VertexShader> const vertex,
-        SolarSystem::ResourceHandle<SolarSystem::PixelShader> const pixel,
-        SolarSystem::ResourceHandle<SolarSystem::ShaderResouceView> const srv)
-        -> SolarSystem::Entity
-    {
-        auto const albedo = ecs.GetSystem<SolarSystem::GraphicsSystem>()->LoadTexture2D(texture);
+        // Levels missing from the cache are generated concurrently, the renderer only takes them on this thread.
+        // Bodies are only drawn and picked by their bounding spheres, so the GPU copy is the only one kept.
+        auto levels = std::vector<SolarSystem::Mesh>(levelCount);
+        SolarSystem::GetJobSystem().ParallelFor(0, levelCount, 1, [&](size_t const levelBegin, size_t const levelEnd) {
+            for(auto i = static_cast<int>(levelBegin); i < static_cast<int>(levelEnd); ++i)
+            {
+                auto const longitudeSides = SolarSystem::Procedural::SphereLODLongitudeSides(i, levelCount, minLongitudeSides, maxLongitudeSides);
+                auto const fileName = L"Cache/sphere_" + std::to_wstring(longitudeSides) + L".mesh";
+                levels[i] = SolarSystem::LoadOrCreateMesh(fileName.c_str(), [&] {
+                    return SolarSystem::Procedural::CreateSphere(longitudeSides, (std::max)(longitudeSides / 2, 2));
+                });
+            }
+        });
 
-        auto const material = ecs.GetSystem<SolarSystem::RendererSystem>()->CreateMaterial({
-            vertex,
-            pixel,
-            { albedo, srv, { }, { } }
+        SolarSystem::MeshLOD lod;
+        for(auto i = 0; i < levelCount; ++i)
+        {
+            auto const longitudeSides = SolarSystem::Procedural::SphereLODLongitudeSides(i, levelCount, minLongitudeSides, maxLongitudeSides);
+            lod.levels.push_back({
+                rs->CreateMesh(std::move(levels[i]), SolarSystem::MeshRetention::Drop),
+                SolarSystem::SphereLODScreenRadius(longitudeSides, maxEdgePixels)
             });
+        }
+        lod.impostor = rs->CreateMesh(SolarSystem::Procedural::CreatePointImpostor(), SolarSystem::MeshRetention::Drop);
 
-        auto const circle = ecs.GetSystem<SolarSystem::RendererSystem>()->CreateMesh(SolarSystem::Procedural::Circle(
-            orbitRadius, 128, color
-        ));
-
-        auto const orbit = ecs.CreateEntity();
-        ecs.GetSystem<SolarSystem::WorldSystem>()->AddComponent(orbit);
-        ecs.GetSystem<SolarSystem::RotationSystem>()->AddComponent(orbit);
-        ecs.GetSystem<SolarSystem::ParentSystem>()->AddComponent(orbit).parent = parent;
-
-        auto const orbitPoint = ecs.CreateEntity();
-        ecs.GetSystem<SolarSystem::WorldSystem>()->AddComponent(orbitPoint);
-        ecs.GetSystem<SolarSystem::TranslationSystem>()->AddComponent(orbitPoint);
-        ecs.GetSystem<SolarSystem::RotationSystem>()->AddComponent(orbitPoint).rotation = DirectX::SimpleMath::Quaternion::CreateFromAxisAngle(
-            DirectX::SimpleMath::Vector3::Right,
-            DirectX::XMConvertToRadians(axisAngle)
-        );
-        ecs.GetSystem<SolarSystem::OrbitSystem>()->AddComponent(orbitPoint, orbitRadius, -orbitPeriod).t = t * orbitPeriod;
-        ecs.GetSystem<SolarSystem::ParentSystem>()->AddComponent(orbitPoint).parent = orbit;
-
-        auto const planet = ecs.CreateEntity();
-        ecs.GetSystem<SolarSystem::WorldSystem>()->AddComponent(planet);
-        ecs.GetSystem<SolarSystem::TranslationSystem>()->AddComponent(planet);
-        ecs.GetSystem<SolarSystem::ScalingSystem>()->AddComponent(planet).scaling = DirectX::SimpleMath::Vector3(radius, radius, radius);
-        ecs.GetSystem<SolarSystem::RotationSystem>()->AddComponent(planet);
-        ecs.GetSystem<SolarSystem::RotationalAxisSystem>()->AddComponent(planet).period = -period;
-        ecs.GetSystem<SolarSystem::CameraSystem>()->AddComponent(planet) = { radius * 3.0f, radius * 5.0f };
-        
-        ecs.GetSystem<SolarSystem::ParentSystem>()->AddComponent(planet).parent = orbitPoint;
-        ecs.GetSystem<SolarSystem::RendererSystem>()->AddComponent(planet, sphere, material);
-
-        auto const line = ecs.CreateEntity();
-        ecs.GetSystem<SolarSystem::WorldSystem>()->AddComponent(line);
-        ecs.GetSystem<SolarSystem::RotationSystem>()->AddComponent(line);
-        auto& z = ecs.GetSystem<SolarSystem::RotationalAxisSystem>()->AddComponent(line);
-        z.period = -orbitPeriod;
-        z.t = t * orbitPeriod;
-        ecs.GetSystem<SolarSystem::ParentSystem>()->AddComponent(line).parent = orbit;
-        ecs.GetSystem<SolarSystem::RendererSystem>()->AddComponent(line, circle, unlit, SolarSystem::RendererSystem::BlendMode::Alpha);
-
-        return orbitPoint;
+        return rs->CreateMeshLOD(std::move(lod));
     }
 
+    using MemoryReport = std::array<SolarSystem::MemoryStatistics, static_cast<size_t>(SolarSystem::MemoryTag::Count)>;
 
-    auto AddAtmoPlanet(
-        SolarSystem::Entity const parent,
-        float const orbitRadius,
-        float const orbitPeriod,
-        float const radius,
-        float const period,
-        float const axisAngle,
-        wchar_t const* const texture,
-        DirectX::SimpleMath::Color const& color,
-        float const t,
-        float const planetRadius,
-        float const atmoHeight,
-        wchar_t const* const transmittance,
-        wchar_t const* const rScattering,
-        wchar_t const* const mScattering,
-        wchar_t const* const irradiance
-    ) -> SolarSystem::Entity
+    static auto GetMemoryStatistics() -> MemoryReport
     {
-
-        auto mat = SolarSystem::Material();
-
-        mat.vertexShader = vsDefault;
-        mat.pixelShader = ecs.GetSystem<SolarSystem::GraphicsSystem>()->CreatePixelShader(LoadBytecode("Shaders/AtmoPlanet_ps.cso"));
-
-        mat.pixelShaderResourceViews[0] = ecs.GetSystem<SolarSystem::GraphicsSystem>()->LoadTexture2D(texture);
-        mat.pixelShaderResourceViews[1] = ecs.GetSystem<SolarSystem::GraphicsSystem>()->LoadTextureCustom(transmittance);
-        mat.pixelShaderResourceViews[2] = ecs.GetSystem<SolarSystem::GraphicsSystem>()->LoadTextureCustom(irradiance);
-        mat.pixelShaderResourceViews[3] = { };
-
-
-        auto const material = ecs.GetSystem<SolarSystem::RendererSystem>()->CreateMaterial(mat);
-
-        auto const circle = ecs.GetSystem<SolarSystem::RendererSystem>()->CreateMesh(SolarSystem::Procedural::Circle(
-            orbitRadius, 128, color
-        ));
-
-        auto const orbit = ecs.CreateEntity();
-        ecs.GetSystem<SolarSystem::WorldSystem>()->AddComponent(orbit);
-        ecs.GetSystem<SolarSystem::RotationSystem>()->AddComponent(orbit);
-        ecs.GetSystem<SolarSystem::ParentSystem>()->AddComponent(orbit).parent = parent;
-
-        auto const orbitPoint = ecs.CreateEntity();
-        ecs.GetSystem<SolarSystem::WorldSystem>()->AddComponent(orbitPoint);
-        ecs.GetSystem<SolarSystem::TranslationSystem>()->AddComponent(orbitPoint);
-        ecs.GetSystem<SolarSystem::RotationSystem>()->AddComponent(orbitPoint).rotation = DirectX::SimpleMath::Quaternion::CreateFromAxisAngle(
-            DirectX::SimpleMath::Vector3::Right,
-            DirectX::XMConvertToRadians(axisAngle)
-        );
-        ecs.GetSystem<SolarSystem::OrbitSystem>()->AddComponent(orbitPoint, orbitRadius, -orbitPeriod).t = t * orbitPeriod;
-        ecs.GetSystem<SolarSystem::ParentSystem>()->AddComponent(orbitPoint).parent = orbit;
-
-        auto const planet = ecs.CreateEntity();
-        ecs.GetSystem<SolarSystem::WorldSystem>()->AddComponent(planet);
-        ecs.GetSystem<SolarSystem::TranslationSystem>()->AddComponent(planet);
-        ecs.GetSystem<SolarSystem::ScalingSystem>()->AddComponent(planet).scaling = DirectX::SimpleMath::Vector3(radius, radius, radius);
-        ecs.GetSystem<SolarSystem::RotationSystem>()->AddComponent(planet);
-        ecs.GetSystem<SolarSystem::RotationalAxisSystem>()->AddComponent(planet).period = -period;
-        ecs.GetSystem<SolarSystem::CameraSystem>()->AddComponent(planet) = { radius * 3.0f, radius * 5.0f };
-
-        ecs.GetSystem<SolarSystem::ParentSystem>()->AddComponent(planet).parent = orbitPoint;
-        ecs.GetSystem<SolarSystem::RendererSystem>()->AddComponent(planet, sphere, material);
-
-        auto const line = ecs.CreateEntity();
-        ecs.GetSystem<SolarSystem::WorldSystem>()->AddComponent(line);
-        ecs.GetSystem<SolarSystem::RotationSystem>()->AddComponent(line);
-        auto& z = ecs.GetSystem<SolarSystem::RotationalAxisSystem>()->AddComponent(line);
-        z.period = -orbitPeriod;
-        z.t = t * orbitPeriod;
-        ecs.GetSystem<SolarSystem::ParentSystem>()->AddComponent(line).parent = orbit;
-        ecs.GetSystem<SolarSystem::RendererSystem>()->AddComponent(line, circle, unlit, SolarSystem::RendererSystem::BlendMode::Alpha);
-
-
-
-        
-        auto const raySRV = ecs.GetSystem<SolarSystem::GraphicsSystem>()->LoadTextureCustom(rScattering);
-        auto const mieSRV = ecs.GetSystem<SolarSystem::GraphicsSystem>()->LoadTextureCustom(mScattering);
-
-
-        auto const scMaterial = ecs.GetSystem<SolarSystem::RendererSystem>()->CreateMaterial({
-            vsDefault,
-            ecs.GetSystem<SolarSystem::GraphicsSystem>()->CreatePixelShader(LoadBytecode("Shaders/Atmos_ps.cso")),
-            { raySRV, mieSRV, { }, { } }
-        });
-
-        auto const atmo = ecs.CreateEntity();
-        ecs.GetSystem<SolarSystem::WorldSystem>()->AddComponent(atmo);
-
-        auto const atmoScale = (planetRadius + atmoHeight) / planetRadius;
-        ecs.GetSystem<SolarSystem::ScalingSystem>()->AddComponent(atmo).scaling = DirectX::SimpleMath::Vector3(atmoScale, atmoScale, atmoScale);
-
-        ecs.GetSystem<SolarSystem::ParentSystem>()->AddComponent(atmo).parent = planet;
-        ecs.GetSystem<SolarSystem::RendererSystem>()->AddComponent(atmo, sphere, scMaterial, SolarSystem::RendererSystem::BlendMode::Add);
-        
-        return orbitPoint;
+        MemoryReport report;
+        for(size_t i = 0; i < report.size(); ++i)
+        {
+            report[i] = SolarSystem::GetMemoryStatistics(static_cast<SolarSystem::MemoryTag>(i));
+        }
+        return report;
     }
 
-    auto AddSaturnRings(
-        SolarSystem::Entity const parent,
-        SolarSystem::ResourceHandle<SolarSystem::ShaderResouceView> const srv
-    ) -> void
+    // Live and peak bytes per tag, allocation rate over the frames run since before was taken
+    auto PrintMemoryReport(MemoryReport const& before, uint64_t const frameCount) -> void
     {
-        
-        auto const material = ecs.GetSystem<SolarSystem::RendererSystem>()->CreateMaterial({
-            ecs.GetSystem<SolarSystem::GraphicsSystem>()->CreateVertexShader(LoadBytecode("Shaders/Rings_vs.cso")),
-            ecs.GetSystem<SolarSystem::GraphicsSystem>()->CreatePixelShader(LoadBytecode("Shaders/Rings_ps.cso")),
-            { srv, { }, { }, { } }
-        });
-
-        auto const ring = ecs.GetSystem<SolarSystem::RendererSystem>()->CreateMesh(SolarSystem::Procedural::CreateRing(
-            128, 1.2f, 2.5f
-        ));
-
-        auto const rings = ecs.CreateEntity();
-        ecs.GetSystem<SolarSystem::WorldSystem>()->AddComponent(rings);
-        ecs.GetSystem<SolarSystem::ScalingSystem>()->AddComponent(rings).scaling = DirectX::SimpleMath::Vector3(5.0f, 5.0f, 5.0f);
-        ecs.GetSystem<SolarSystem::RotationSystem>()->AddComponent(rings);
-        ecs.GetSystem<SolarSystem::RotationalAxisSystem>()->AddComponent(rings).period = -0.35f;
-
-        ecs.GetSystem<SolarSystem::ParentSystem>()->AddComponent(rings).parent = parent;
-        ecs.GetSystem<SolarSystem::RendererSystem>()->AddComponent(rings, ring, material, SolarSystem::RendererSystem::BlendMode::Alpha);
-
+        auto const after = GetMemoryStatistics();
+        for(size_t i = 0; i < after.size(); ++i)
+        {
+            auto const allocations = after[i].allocationCount - before[i].allocationCount;
+            std::cout << SolarSystem::GetMemoryTagName(static_cast<SolarSystem::MemoryTag>(i)) << ": "
+                << after[i].liveBytes << " bytes live / " << after[i].peakBytes << " bytes peak, "
+                << (frameCount > 0 ? static_cast<double>(allocations) / frameCount : 0.0) << " allocations per frame" << std::endl;
+        }
     }
 
-    auto AddMoon(SolarSystem::Entity const parent) -> void
+    // Overflows mean the frame arenas were too small at some point, they grow so the next frames fit
+    auto PrintFrameAllocatorReport() -> void
     {
-        auto const albedo = ecs.GetSystem<SolarSystem::GraphicsSystem>()->LoadTexture2D(L"Assets/moon_albedo.dds");
-
-        auto const material = ecs.GetSystem<SolarSystem::RendererSystem>()->CreateMaterial({
-            vsDefault,
-            psDefault,
-            { albedo, { }, { }, { } }
-            });
-
-        auto const orbit = ecs.CreateEntity();
-        ecs.GetSystem<SolarSystem::WorldSystem>()->AddComponent(orbit);
-        ecs.GetSystem<SolarSystem::RotationSystem>()->AddComponent(orbit).rotation = DirectX::SimpleMath::Quaternion::CreateFromAxisAngle(
-            DirectX::SimpleMath::Vector3::Right,
-            DirectX::XMConvertToRadians(-30.0f)
-        );;
-        ecs.GetSystem<SolarSystem::ParentSystem>()->AddComponent(orbit).parent = parent;
-
-        auto const orbitPoint = ecs.CreateEntity();
-        ecs.GetSystem<SolarSystem::WorldSystem>()->AddComponent(orbitPoint);
-        ecs.GetSystem<SolarSystem::TranslationSystem>()->AddComponent(orbitPoint);
-        ecs.GetSystem<SolarSystem::RotationSystem>()->AddComponent(orbitPoint).rotation = DirectX::SimpleMath::Quaternion::CreateFromAxisAngle(
-            DirectX::SimpleMath::Vector3::Right,
-            DirectX::XMConvertToRadians(6.0f)
-        );
-        ecs.GetSystem<SolarSystem::OrbitSystem>()->AddComponent(orbitPoint, 3.0f, -27.0f);
-        ecs.GetSystem<SolarSystem::ParentSystem>()->AddComponent(orbitPoint).parent = orbit;
-
-        auto const planet = ecs.CreateEntity();
-        ecs.GetSystem<SolarSystem::WorldSystem>()->AddComponent(planet);
-        ecs.GetSystem<SolarSystem::TranslationSystem>()->AddComponent(planet);
-        ecs.GetSystem<SolarSystem::ScalingSystem>()->AddComponent(planet).scaling = DirectX::SimpleMath::Vector3(0.1f, 0.1f, 0.1f);
-        ecs.GetSystem<SolarSystem::RotationSystem>()->AddComponent(planet);
-        ecs.GetSystem<SolarSystem::RotationalAxisSystem>()->AddComponent(planet).period = -27.0f;
-
-        ecs.GetSystem<SolarSystem::ParentSystem>()->AddComponent(planet).parent = orbitPoint;
-        ecs.GetSystem<SolarSystem::RendererSystem>()->AddComponent(planet, sphere, material);
-
-
+        auto const statistics = SolarSystem::GetFrameAllocator().GetStatistics();
+        std::cout << "Frame arenas: " << statistics.peak << " bytes peak / " << statistics.capacity << " bytes capacity, "
+            << statistics.overflowCount << " overflows (" << statistics.overflowBytes << " bytes)" << std::endl;
     }
 
-    static auto LoadBytecode(std::string const& path) -> std::vector<char>
+    // Create calls against resources actually created, content hashing returns existing handles for the rest
+    auto PrintResourceReport() -> void
     {
-        auto fin = std::fstream(path, std::ios::in | std::ios::binary | std::ios::ate);
-        if(!fin)
-        {
-            throw std::exception("Failed to open file with given path");
-        }
+        auto const graphics = ecs.GetSystem<SolarSystem::GraphicsSystem>()->GetResourceStatistics();
+        auto const renderer = ecs.GetSystem<SolarSystem::RendererSystem>()->GetResourceStatistics();
+
+        auto const print = [](char const* const name, SolarSystem::ResourceCount const& count) {
+            std::cout << name << ": " << count.unique << " unique / " << count.requested << " requested" << std::endl;
+        };
+
+        print("Meshes", renderer.meshes);
+        print("Materials", renderer.materials);
+        print("Vertex shaders", graphics.vertexShaders);
+        print("Pixel shaders", graphics.pixelShaders);
+        print("Textures", graphics.textures);
+        std::cout << "Mesh data released after upload: " << renderer.releasedMeshBytes << " bytes" << std::endl;
+    }
 
-        size_t const size = fin.tellg();
-        auto bytecode = std::vector<char>(size);
-        fin.seekg(std::ios::beg);
-        fin.read(bytecode.data(), size);
+    // Update order is the order of the systems
+    SolarSystem::ECSWorld<
+        SolarSystem::WindowSystem,
+        SolarSystem::GraphicsSystem,
+        SolarSystem::ShaderReflectionSystem,
 
-        return bytecode;
-    }
+        SolarSystem::OrbitSystem,
+        SolarSystem::RotationalAxisSystem,
 
+        SolarSystem::WorldSystem,
+        SolarSystem::ScalingSystem,
+        SolarSystem::RotationSystem,
+        SolarSystem::TranslationSystem,
 
-    SolarSystem::ECS ecs;
+        SolarSystem::ParentSystem,
+        SolarSystem::CameraSystem,
+        SolarSystem::RendererSystem
+    > ecs;
 };
@@ -0,0 +1,815 @@
+#pragma once
+#include <vector>
+#include <queue>
+#include <algorithm>
+#include <limits>
+#include <cstdint>
+#include <cmath>
+#include <cfloat>
+
+namespace SolarSystem
+{
+    // Plain structures, the hierarchy has no dependency on Direct3D or DirectXMath
+
+    struct BVHSphere final
+    {
+        float x = 0.0f;
+        float y = 0.0f;
+        float z = 0.0f;
+        float radius = 0.0f;
+    };
+
+    // Direction is expected to be normalized
+    struct BVHRay final
+    {
+        float origin[3] = { };
+        float direction[3] = { 0.0f, 0.0f, 1.0f };
+    };
+
+    // Normalized plane, a point is inside when dot(normal, point) + d >= 0
+    struct BVHPlane final
+    {
+        float x = 0.0f;
+        float y = 0.0f;
+        float z = 0.0f;
+        float d = 0.0f;
+    };
+
+    struct BVHHit final
+    {
+        uint32_t index = (std::numeric_limits<uint32_t>::max)();
+        float distance = FLT_MAX;
+
+        auto IsHit() const -> bool
+        {
+            return index != (std::numeric_limits<uint32_t>::max)();
+        }
+    };
+
+    struct BVHStatistics final
+    {
+        size_t nodeCount = 0;
+        size_t rebuilds = 0;
+        size_t refits = 0;
+        float cost = 0.0f;
+        float builtCost = 0.0f;
+    };
+
+
+    //
+    // Dynamic bounding volume hierarchy over spheres.
+    // Spheres are updated in place and the tree is refitted every Update, it is rebuilt
+    // with a binned surface area heuristic when the count changes or the refitted cost
+    // grows past rebuildThreshold times the cost right after the last build.
+    //
+    class BoundingVolumeHierarchy final
+    {
+    public:
+        auto Resize(size_t const count) -> void
+        {
+            spheres.resize(count);
+        }
+
+        auto GetCount() const -> size_t
+        {
+            return spheres.size();
+        }
+
+        auto SetSphere(size_t const index, BVHSphere const& sphere) -> void
+        {
+            spheres[index] = sphere;
+        }
+
+        auto GetSphere(size_t const index) const -> BVHSphere const&
+        {
+            return spheres[index];
+        }
+
+        auto SetRebuildThreshold(float const threshold) -> void
+        {
+            rebuildThreshold = threshold;
+        }
+
+        auto Update() -> void
+        {
+            if(indices.size() != spheres.size() || nodes.empty())
+            {
+                Build();
+                return;
+            }
+
+            Refit();
+
+            if(statistics.cost > statistics.builtCost * rebuildThreshold)
+            {
+                Build();
+            }
+        }
+
+        auto Build() -> void
+        {
+            indices.resize(spheres.size());
+            for(size_t i = 0; i < indices.size(); ++i)
+            {
+                indices[i] = static_cast<uint32_t>(i);
+            }
+
+            centroids.resize(spheres.size());
+            for(size_t i = 0; i < spheres.size(); ++i)
+            {
+                centroids[i] = { spheres[i].x, spheres[i].y, spheres[i].z };
+            }
+
+            nodes.clear();
+            nodes.reserve(spheres.empty() ? 1 : 2 * spheres.size() / LEAF_SIZE + 1);
+
+            auto& root = nodes.emplace_back();
+            root.first = 0;
+            root.count = static_cast<uint32_t>(spheres.size());
+            ComputeBounds(root);
+
+            if(!spheres.empty())
+            {
+                Subdivide(0);
+            }
+
+            centroids.clear();
+            centroids.shrink_to_fit();
+
+            statistics.nodeCount = nodes.size();
+            statistics.rebuilds++;
+            statistics.cost = ComputeCost();
+            statistics.builtCost = statistics.cost;
+        }
+
+        auto Refit() -> void
+        {
+            // Children are always allocated after their parent
+            for(auto i = nodes.size(); i-- > 0;)
+            {
+                auto& node = nodes[i];
+
+                if(node.count > 0)
+                {
+                    ComputeBounds(node);
+                }
+                else
+                {
+                    auto const& left = nodes[node.first];
+                    auto const& right = nodes[node.first + 1];
+
+                    node.bounds = left.bounds;
+                    node.bounds.Grow(right.bounds);
+                }
+            }
+
+            statistics.refits++;
+            statistics.cost = ComputeCost();
+        }
+
+
+        // Nearest sphere hit by the ray within maxDistance, a ray starting inside a sphere hits it at distance 0
+        auto Raycast(BVHRay const& ray, float const maxDistance = FLT_MAX) const -> BVHHit
+        {
+            return Raycast(ray, [](uint32_t, float const distance) { return distance; }, maxDistance);
+        }
+
+        //
+        // Raycast against shapes the spheres only bound, such as bodies that moved since their sphere was set.
+        // refine(index, distance) gets the distance to a hit sphere and returns the distance to its shape,
+        // FLT_MAX for a miss. The shape has to lie within the sphere, so it is never nearer than the sphere.
+        //
+        template<typename Refine>
+        auto Raycast(BVHRay const& ray, Refine const& refine, float const maxDistance = FLT_MAX) const -> BVHHit
+        {
+            BVHHit hit;
+            hit.distance = maxDistance;
+
+            if(nodes.empty() || spheres.empty())
+            {
+                return { };
+            }
+
+            float inverseDirection[3];
+            for(auto i = 0; i < 3; ++i)
+            {
+                inverseDirection[i] = 1.0f / ray.direction[i];
+            }
+
+            uint32_t stack[STACK_SIZE];
+            auto stackSize = 0;
+            stack[stackSize++] = 0;
+
+            while(stackSize > 0)
+            {
+                auto const& node = nodes[stack[--stackSize]];
+
+                auto const entry = node.bounds.IntersectRay(ray.origin, inverseDirection);
+                if(entry == FLT_MAX || entry > hit.distance)
+                {
+                    continue;
+                }
+
+                if(node.count > 0)
+                {
+                    for(auto i = node.first; i < node.first + node.count; ++i)
+                    {
+                        auto distance = IntersectRaySphere(ray, spheres[indices[i]]);
+                        if(distance < hit.distance)
+                        {
+                            distance = refine(indices[i], distance);
+                        }
+                        if(distance < hit.distance)
+                        {
+                            hit.distance = distance;
+                            hit.index = indices[i];
+                        }
+                    }
+                    continue;
+                }
+
+                // Visit the nearer child first so the farther one is more likely to be rejected
+                auto nearChild = node.first;
+                auto farChild = node.first + 1;
+                if(nodes[nearChild].bounds.IntersectRay(ray.origin, inverseDirection) > nodes[farChild].bounds.IntersectRay(ray.origin, inverseDirection))
+                {
+                    std::swap(nearChild, farChild);
+                }
+
+                stack[stackSize++] = farChild;
+                stack[stackSize++] = nearChild;
+            }
+
+            if(!hit.IsHit())
+            {
+                return { };
+            }
+
+            return hit;
+        }
+
+        // Indices of spheres intersecting all planes
+        auto QueryFrustum(BVHPlane const (&planes)[6], std::vector<uint32_t>& result) const -> void
+        {
+            result.clear();
+
+            if(nodes.empty() || spheres.empty())
+            {
+                return;
+            }
+
+            struct Entry
+            {
+                uint32_t node;
+                uint32_t planeMask;
+            };
+
+            Entry stack[STACK_SIZE];
+            auto stackSize = 0;
+            stack[stackSize++] = { 0, 0x3F };
+
+            while(stackSize > 0)
+            {
+                auto const entry = stack[--stackSize];
+                auto const& node = nodes[entry.node];
+
+                // Planes the node is completely inside of do not need to be tested for its children
+                auto planeMask = entry.planeMask;
+                auto isOutside = false;
+                for(auto p = 0; p < 6 && !isOutside; ++p)
+                {
+                    if((planeMask & (1u << p)) == 0)
+                    {
+                        continue;
+                    }
+
+                    switch(node.bounds.ClassifyPlane(planes[p]))
+                    {
+                    case Classification::Outside:
+                        isOutside = true;
+                        break;
+                    case Classification::Inside:
+                        planeMask &= ~(1u << p);
+                        break;
+                    case Classification::Intersecting:
+                        break;
+                    }
+                }
+
+                if(isOutside)
+                {
+                    continue;
+                }
+
+                if(node.count > 0)
+                {
+                    for(auto i = node.first; i < node.first + node.count; ++i)
+                    {
+                        if(planeMask == 0 || IsSphereInside(spheres[indices[i]], planes, planeMask))
+                        {
+                            result.push_back(indices[i]);
+                        }
+                    }
+                    continue;
+                }
+
+                stack[stackSize++] = { node.first + 1, planeMask };
+                stack[stackSize++] = { node.first, planeMask };
+            }
+        }
+
+        // Indices of spheres overlapping the query sphere
+        auto QuerySphere(BVHSphere const& query, std::vector<uint32_t>& result) const -> void
+        {
+            result.clear();
+
+            if(nodes.empty() || spheres.empty())
+            {
+                return;
+            }
+
+            uint32_t stack[STACK_SIZE];
+            auto stackSize = 0;
+            stack[stackSize++] = 0;
+
+            while(stackSize > 0)
+            {
+                auto const& node = nodes[stack[--stackSize]];
+
+                if(node.bounds.DistanceSquared(query.x, query.y, query.z) > query.radius * query.radius)
+                {
+                    continue;
+                }
+
+                if(node.count > 0)
+                {
+                    for(auto i = node.first; i < node.first + node.count; ++i)
+                    {
+                        auto const& sphere = spheres[indices[i]];
+                        auto const dx = sphere.x - query.x;
+                        auto const dy = sphere.y - query.y;
+                        auto const dz = sphere.z - query.z;
+                        auto const radius = sphere.radius + query.radius;
+
+                        if(dx * dx + dy * dy + dz * dz <= radius * radius)
+                        {
+                            result.push_back(indices[i]);
+                        }
+                    }
+                    continue;
+                }
+
+                stack[stackSize++] = node.first + 1;
+                stack[stackSize++] = node.first;
+            }
+        }
+
+        // The k spheres with the nearest surface to the point, sorted by distance
+        auto QueryNearest(float const x, float const y, float const z, size_t const k, std::vector<BVHHit>& result) const -> void
+        {
+            result.clear();
+
+            if(nodes.empty() || spheres.empty() || k == 0)
+            {
+                return;
+            }
+
+            struct NodeEntry
+            {
+                float distanceSquared;
+                uint32_t node;
+
+                auto operator<(NodeEntry const& other) const -> bool
+                {
+                    return distanceSquared > other.distanceSquared;
+                }
+            };
+
+            auto const hitOrder = [](BVHHit const& a, BVHHit const& b) {
+                return a.distance < b.distance;
+            };
+
+            // Min-heap of nodes to visit, max-heap of the current best k
+            std::priority_queue<NodeEntry> open;
+            open.push({ nodes[0].bounds.DistanceSquared(x, y, z), 0 });
+
+            while(!open.empty())
+            {
+                auto const entry = open.top();
+                open.pop();
+
+                if(result.size() == k && entry.distanceSquared > result.front().distance * result.front().distance)
+                {
+                    break;
+                }
+
+                auto const& node = nodes[entry.node];
+
+                if(node.count > 0)
+                {
+                    for(auto i = node.first; i < node.first + node.count; ++i)
+                    {
+                        auto const& sphere = spheres[indices[i]];
+                        auto const dx = sphere.x - x;
+                        auto const dy = sphere.y - y;
+                        auto const dz = sphere.z - z;
+                        auto const distance = (std::max)(std::sqrt(dx * dx + dy * dy + dz * dz) - sphere.radius, 0.0f);
+
+                        if(result.size() < k)
+                        {
+                            result.push_back({ indices[i], distance });
+                            std::push_heap(result.begin(), result.end(), hitOrder);
+                        }
+                        else if(distance < result.front().distance)
+                        {
+                            std::pop_heap(result.begin(), result.end(), hitOrder);
+                            result.back() = { indices[i], distance };
+                            std::push_heap(result.begin(), result.end(), hitOrder);
+                        }
+                    }
+                    continue;
+                }
+
+                open.push({ nodes[node.first].bounds.DistanceSquared(x, y, z), node.first });
+                open.push({ nodes[node.first + 1].bounds.DistanceSquared(x, y, z), node.first + 1 });
+            }
+
+            std::sort_heap(result.begin(), result.end(), hitOrder);
+        }
+
+
+        // Distance along the ray to the sphere, 0 from inside it and FLT_MAX for a miss
+        static auto IntersectRaySphere(BVHRay const& ray, BVHSphere const& sphere) -> float
+        {
+            auto const ox = ray.origin[0] - sphere.x;
+            auto const oy = ray.origin[1] - sphere.y;
+            auto const oz = ray.origin[2] - sphere.z;
+
+            auto const b = ox * ray.direction[0] + oy * ray.direction[1] + oz * ray.direction[2];
+            auto const c = ox * ox + oy * oy + oz * oz - sphere.radius * sphere.radius;
+
+            // Origin inside the sphere
+            if(c <= 0.0f)
+            {
+                return 0.0f;
+            }
+
+            // Origin outside and pointing away
+            if(b > 0.0f)
+            {
+                return FLT_MAX;
+            }
+
+            auto const discriminant = b * b - c;
+            if(discriminant < 0.0f)
+            {
+                return FLT_MAX;
+            }
+
+            return -b - std::sqrt(discriminant);
+        }
+
+        auto GetStatistics() const -> BVHStatistics const&
+        {
+            return statistics;
+        }
+
+    private:
+        static constexpr uint32_t LEAF_SIZE = 4;
+        static constexpr int BIN_COUNT = 16;
+        static constexpr uint32_t MAX_DEPTH = 64;
+        static constexpr int STACK_SIZE = MAX_DEPTH + 2;
+
+        static constexpr float TRAVERSAL_COST = 1.0f;
+        static constexpr float INTERSECTION_COST = 1.0f;
+
+        enum class Classification
+        {
+            Outside,
+            Inside,
+            Intersecting
+        };
+
+        struct AABB final
+        {
+            float min[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+            float max[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+            auto Grow(BVHSphere const& sphere) -> void
+            {
+                float const center[3] = { sphere.x, sphere.y, sphere.z };
+                for(auto i = 0; i < 3; ++i)
+                {
+                    min[i] = (std::min)(min[i], center[i] - sphere.radius);
+                    max[i] = (std::max)(max[i], center[i] + sphere.radius);
+                }
+            }
+
+            auto Grow(AABB const& other) -> void
+            {
+                for(auto i = 0; i < 3; ++i)
+                {
+                    min[i] = (std::min)(min[i], other.min[i]);
+                    max[i] = (std::max)(max[i], other.max[i]);
+                }
+            }
+
+            auto Area() const -> float
+            {
+                auto const x = max[0] - min[0];
+                auto const y = max[1] - min[1];
+                auto const z = max[2] - min[2];
+
+                if(x < 0.0f || y < 0.0f || z < 0.0f)
+                {
+                    return 0.0f;
+                }
+
+                return 2.0f * (x * y + y * z + z * x);
+            }
+
+            // Entry distance along the ray, FLT_MAX when missed
+            auto IntersectRay(float const (&origin)[3], float const (&inverseDirection)[3]) const -> float
+            {
+                auto tMin = 0.0f;
+                auto tMax = FLT_MAX;
+
+                for(auto i = 0; i < 3; ++i)
+                {
+                    auto t1 = (min[i] - origin[i]) * inverseDirection[i];
+                    auto t2 = (max[i] - origin[i]) * inverseDirection[i];
+
+                    // 0 * inf for rays parallel to a slab face
+                    if(t1 != t1) t1 = -FLT_MAX;
+                    if(t2 != t2) t2 = FLT_MAX;
+
+                    tMin = (std::max)(tMin, (std::min)(t1, t2));
+                    tMax = (std::min)(tMax, (std::max)(t1, t2));
+                }
+
+                return tMin <= tMax ? tMin : FLT_MAX;
+            }
+
+            auto DistanceSquared(float const x, float const y, float const z) const -> float
+            {
+                float const point[3] = { x, y, z };
+                auto distance = 0.0f;
+
+                for(auto i = 0; i < 3; ++i)
+                {
+                    auto const d = (std::max)({ min[i] - point[i], 0.0f, point[i] - max[i] });
+                    distance += d * d;
+                }
+
+                return distance;
+            }
+
+            auto ClassifyPlane(BVHPlane const& plane) const -> Classification
+            {
+                // Corners farthest along and against the plane normal
+                auto const px = plane.x >= 0.0f ? max[0] : min[0];
+                auto const py = plane.y >= 0.0f ? max[1] : min[1];
+                auto const pz = plane.z >= 0.0f ? max[2] : min[2];
+                auto const nx = plane.x >= 0.0f ? min[0] : max[0];
+                auto const ny = plane.y >= 0.0f ? min[1] : max[1];
+                auto const nz = plane.z >= 0.0f ? min[2] : max[2];
+
+                if(plane.x * px + plane.y * py + plane.z * pz + plane.d < 0.0f)
+                {
+                    return Classification::Outside;
+                }
+
+                if(plane.x * nx + plane.y * ny + plane.z * nz + plane.d >= 0.0f)
+                {
+                    return Classification::Inside;
+                }
+
+                return Classification::Intersecting;
+            }
+        };
+
+        // Leaf when count > 0, otherwise children are at first and first + 1
+        struct Node final
+        {
+            AABB bounds;
+            uint32_t first = 0;
+            uint32_t count = 0;
+        };
+
+        struct Centroid final
+        {
+            float value[3];
+        };
+
+        std::vector<BVHSphere> spheres;
+        std::vector<uint32_t> indices;
+        std::vector<Node> nodes;
+        std::vector<Centroid> centroids;
+
+        float rebuildThreshold = 1.5f;
+        BVHStatistics statistics;
+
+        auto ComputeBounds(Node& node) -> void
+        {
+            node.bounds = { };
+            for(auto i = node.first; i < node.first + node.count; ++i)
+            {
+                node.bounds.Grow(spheres[indices[i]]);
+            }
+        }
+
+        auto ComputeCost() const -> float
+        {
+            if(nodes.empty())
+            {
+                return 0.0f;
+            }
+
+            auto const rootArea = nodes[0].bounds.Area();
+            if(rootArea <= 0.0f)
+            {
+                return 0.0f;
+            }
+
+            auto cost = 0.0f;
+            for(auto const& node : nodes)
+            {
+                auto const area = node.bounds.Area() / rootArea;
+                cost += node.count > 0 ? area * node.count * INTERSECTION_COST : area * TRAVERSAL_COST;
+            }
+
+            return cost;
+        }
+
+        auto Subdivide(uint32_t const nodeIndex) -> void
+        {
+            struct Bin
+            {
+                AABB bounds;
+                uint32_t count = 0;
+            };
+
+            struct Pending
+            {
+                uint32_t node;
+                uint32_t depth;
+            };
+
+            // Iterative to keep the call depth bounded for degenerate inputs,
+            // the depth limit also bounds the traversal stacks of the queries
+            std::vector<Pending> pending;
+            pending.push_back({ nodeIndex, 0 });
+
+            while(!pending.empty())
+            {
+                auto const current = pending.back().node;
+                auto const depth = pending.back().depth;
+                pending.pop_back();
+
+                auto const first = nodes[current].first;
+                auto const count = nodes[current].count;
+
+                if(count <= LEAF_SIZE || depth >= MAX_DEPTH)
+                {
+                    continue;
+                }
+
+                // Bin along the axis with the largest centroid extent
+                float centroidMin[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+                float centroidMax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+                for(auto i = first; i < first + count; ++i)
+                {
+                    auto const& c = centroids[indices[i]].value;
+                    for(auto a = 0; a < 3; ++a)
+                    {
+                        centroidMin[a] = (std::min)(centroidMin[a], c[a]);
+                        centroidMax[a] = (std::max)(centroidMax[a], c[a]);
+                    }
+                }
+
+                auto axis = 0;
+                for(auto a = 1; a < 3; ++a)
+                {
+                    if(centroidMax[a] - centroidMin[a] > centroidMax[axis] - centroidMin[axis])
+                    {
+                        axis = a;
+                    }
+                }
+
+                auto const extent = centroidMax[axis] - centroidMin[axis];
+                if(extent <= 0.0f)
+                {
+                    // All centroids coincide, a split would not separate anything
+                    continue;
+                }
+
+                Bin bins[BIN_COUNT];
+                auto const scale = BIN_COUNT / extent;
+                auto const binOf = [&](uint32_t const index) {
+                    auto const bin = static_cast<int>((centroids[index].value[axis] - centroidMin[axis]) * scale);
+                    return (std::min)(bin, BIN_COUNT - 1);
+                };
+
+                for(auto i = first; i < first + count; ++i)
+                {
+                    auto& bin = bins[binOf(indices[i])];
+                    bin.count++;
+                    bin.bounds.Grow(spheres[indices[i]]);
+                }
+
+                // Sweep from both sides to evaluate every split plane between bins
+                float leftArea[BIN_COUNT - 1];
+                uint32_t leftCount[BIN_COUNT - 1];
+                AABB leftBounds;
+                uint32_t leftSum = 0;
+                for(auto i = 0; i < BIN_COUNT - 1; ++i)
+                {
+                    leftSum += bins[i].count;
+                    leftCount[i] = leftSum;
+                    leftBounds.Grow(bins[i].bounds);
+                    leftArea[i] = leftBounds.Area();
+                }
+
+                auto bestCost = FLT_MAX;
+                auto bestSplit = -1;
+                AABB rightBounds;
+                uint32_t rightSum = 0;
+                for(auto i = BIN_COUNT - 1; i > 0; --i)
+                {
+                    rightSum += bins[i].count;
+                    rightBounds.Grow(bins[i].bounds);
+
+                    if(leftCount[i - 1] == 0 || rightSum == 0)
+                    {
+                        continue;
+                    }
+
+                    auto const cost = leftArea[i - 1] * leftCount[i - 1] + rightBounds.Area() * rightSum;
+                    if(cost < bestCost)
+                    {
+                        bestCost = cost;
+                        bestSplit = i;
+                    }
+                }
+
+                auto const parentArea = nodes[current].bounds.Area();
+                auto const leafCost = count * INTERSECTION_COST;
+                auto const splitCost = TRAVERSAL_COST + (parentArea > 0.0f ? bestCost / parentArea : 0.0f) * INTERSECTION_COST;
+
+                if(bestSplit < 0 || (splitCost >= leafCost && count <= 4 * LEAF_SIZE))
+                {
+                    continue;
+                }
+
+                auto const middle = std::partition(indices.begin() + first, indices.begin() + first + count, [&](uint32_t const index) {
+                    return binOf(index) < bestSplit;
+                });
+                auto const leftSize = static_cast<uint32_t>(middle - (indices.begin() + first));
+
+                auto const leftIndex = static_cast<uint32_t>(nodes.size());
+
+                // Child bounds are the union of the bins on each side of the split
+                Node left;
+                left.first = first;
+                left.count = leftSize;
+
+                Node right;
+                right.first = first + leftSize;
+                right.count = count - leftSize;
+
+                for(auto i = 0; i < BIN_COUNT; ++i)
+                {
+                    (i < bestSplit ? left : right).bounds.Grow(bins[i].bounds);
+                }
+
+                nodes.push_back(left);
+                nodes.push_back(right);
+
+                nodes[current].first = leftIndex;
+                nodes[current].count = 0;
+
+                pending.push_back({ leftIndex, depth + 1 });
+                pending.push_back({ leftIndex + 1, depth + 1 });
+            }
+        }
+
+        static auto IsSphereInside(BVHSphere const& sphere, BVHPlane const (&planes)[6], uint32_t const planeMask) -> bool
+        {
+            for(auto p = 0; p < 6; ++p)
+            {
+                if((planeMask & (1u << p)) == 0)
+                {
+                    continue;
+                }
+
+                auto const& plane = planes[p];
+                if(plane.x * sphere.x + plane.y * sphere.y + plane.z * sphere.z + plane.d < -sphere.radius)
+                {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+    };
+}
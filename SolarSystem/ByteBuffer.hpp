@@ -0,0 +1,84 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <cstring>
+#include <cstddef>
+
+namespace SolarSystem
+{
+    //
+    // Bytes either owned by the buffer or borrowed from a shared storage such as a memory mapped file.
+    // The storage stays alive while any buffer borrows from it. Borrowed bytes are read only,
+    // the first mutable access copies them into an owned allocation.
+    //
+    class ByteBuffer final
+    {
+    public:
+        ByteBuffer() = default;
+
+        ByteBuffer(std::shared_ptr<void const> storage, char const* const data, size_t const size)
+            : storage(std::move(storage)), borrowed(data), borrowedSize(size) { }
+
+
+        auto data() -> char*
+        {
+            Own();
+            return owned.data();
+        }
+
+        auto data() const -> char const*
+        {
+            return storage ? borrowed : owned.data();
+        }
+
+        auto size() const -> size_t
+        {
+            return storage ? borrowedSize : owned.size();
+        }
+
+        auto empty() const -> bool
+        {
+            return size() == 0;
+        }
+
+        auto resize(size_t const size) -> void
+        {
+            Own();
+            owned.resize(size);
+        }
+
+        auto IsBorrowed() const -> bool
+        {
+            return storage != nullptr;
+        }
+
+
+        friend auto operator==(ByteBuffer const& left, ByteBuffer const& right) -> bool
+        {
+            return left.size() == right.size() && (left.size() == 0 || std::memcmp(left.data(), right.data(), left.size()) == 0);
+        }
+
+        friend auto operator!=(ByteBuffer const& left, ByteBuffer const& right) -> bool
+        {
+            return !(left == right);
+        }
+
+    private:
+        auto Own() -> void
+        {
+            if(storage)
+            {
+                owned.assign(borrowed, borrowed + borrowedSize);
+                storage.reset();
+                borrowed = nullptr;
+                borrowedSize = 0;
+            }
+        }
+
+        std::vector<char> owned;
+
+        std::shared_ptr<void const> storage;
+        char const* borrowed = nullptr;
+        size_t borrowedSize = 0;
+    };
+}
@@ -2,11 +2,45 @@
 #include "ECS.hpp"
 #include "Window.hpp"
 #include "Transform.hpp"
+#include "Picking.hpp"
 #include <d3d11.h>
 #include <SimpleMath.h>
+#include <cmath>
 
 namespace SolarSystem
 {
+    enum class ProjectionMode
+    {
+        // D3D convention, depth 0 at nearZ and 1 at farZ, cleared to 1 and tested with less
+        Standard,
+        // Depth 1 at nearZ and 0 at infinity, cleared to 0 and tested with greater equal
+        ReverseZInfinite
+    };
+
+    // Left handed perspective with an infinite far plane mapping nearZ to depth 1, row vector convention
+    auto inline CreateReverseZInfinitePerspective(float const fov, float const aspectRatio, float const nearZ) -> DirectX::SimpleMath::Matrix
+    {
+        auto const yScale = 1.0f / std::tan(fov * 0.5f);
+        auto const xScale = yScale / aspectRatio;
+
+        return {
+            xScale, 0.0f, 0.0f, 0.0f,
+            0.0f, yScale, 0.0f, 0.0f,
+            0.0f, 0.0f, 0.0f, 1.0f,
+            0.0f, 0.0f, nearZ, 0.0f
+        };
+    }
+
+    // View space distance between a depth and the next representable 32-bit float depth value
+    auto inline DepthResolution(DirectX::SimpleMath::Matrix const& projection, float const viewDepth) -> float
+    {
+        // depth = _33 + _43 / z for both projections
+        auto const depth = projection._33 + projection._43 / viewDepth;
+        auto const next = std::nextafter(depth, projection._43 > 0.0f ? 0.0f : 2.0f);
+
+        return std::abs(projection._43 / (next - projection._33) - viewDepth);
+    }
+
     struct CameraTargetComponent
     {
         float minDistance = 1.0f;
@@ -27,15 +61,53 @@ namespace SolarSystem
 
             windowSystem->TrackKeyInput(VirtualKey::Q);
             windowSystem->TrackKeyInput(VirtualKey::E);
+            windowSystem->TrackKeyInput(VirtualKey::LeftMouse);
             
-            SetPerspectiveProjection(fov, nearZ, farZ);
+            UpdateProjection();
+        }
+
+        // Keeps the focus on the same target, or the nearest one before it when the target is destroyed
+        auto RemoveEntities(Entity const* const entities, size_t const count) -> void override
+        {
+            if(components.GetComponentCount() == 0)
+            {
+                return;
+            }
+
+            auto const focusEntity = components.GetEntityFromComponent(currentComponentFocus);
+            auto const removedBefore = std::count_if(entities, entities + count, [&](Entity const entity) {
+                return components.HasComponent(entity) && components.GetComponentIndex(entity) < currentComponentFocus;
+            });
+
+            components.RemoveComponents(entities, count);
+            pickingModule.Invalidate();
+
+            if(components.HasComponent(focusEntity))
+            {
+                currentComponentFocus = components.GetComponentIndex(focusEntity);
+            }
+            else
+            {
+                currentComponentFocus -= (std::min)(currentComponentFocus, static_cast<size_t>(removedBefore));
+                currentComponentFocus = (std::min)(currentComponentFocus, (std::max)(components.GetComponentCount(), size_t(1)) - 1);
+                isLerping = true;
+            }
+        }
+
+        // The view itself is not part of the world state, only the focus is kept within the restored targets
+        auto LoadState(SnapshotReader& reader) -> void override
+        {
+            components.Load(reader);
+            pickingModule.Invalidate();
+            currentComponentFocus = (std::min)(currentComponentFocus, (std::max)(components.GetComponentCount(), size_t(1)) - 1);
+            isLerping = true;
         }
 
         auto Update(float const deltaTime, float const) -> void override
         {
             if(windowSystem->IsSizeChanged())
             {
-                SetPerspectiveProjection(fov, nearZ, farZ);
+                UpdateProjection();
             }
 
             distance += windowSystem->GetAxis(zoomAxis) * zoomSpeed * deltaTime;
@@ -63,16 +135,33 @@ namespace SolarSystem
                 isLerping = true;
             }
 
+            auto isPicked = false;
+            if(windowSystem->GetKeyDown(VirtualKey::LeftMouse))
+            {
+                // Picks against the view that is currently on screen
+                auto const picked = PickComponent(
+                    static_cast<float>(windowSystem->GetCursorX()),
+                    static_cast<float>(windowSystem->GetCursorY())
+                );
+
+                if(picked)
+                {
+                    currentComponentFocus = *picked;
+                    isLerping = true;
+                    isPicked = true;
+                }
+            }
+
             if(windowSystem->GetAxis(zoomAxis) != 0.0f)
             {
                 isLerping = false;
             }
 
             auto const focusEntity = components.GetEntityFromComponent(currentComponentFocus);
-            auto const focusPosition = worldSystem->GetComponent(focusEntity).world.Translation();
+            auto const focusPosition = worldSystem->GetComponent(focusEntity).position;
 
 
-            if(windowSystem->GetKeyDown(VirtualKey::E) || windowSystem->GetKeyDown(VirtualKey::Q))
+            if(windowSystem->GetKeyDown(VirtualKey::E) || windowSystem->GetKeyDown(VirtualKey::Q) || isPicked)
             {
                 distance = components.GetComponent(focusEntity).maxDistance;
                 verticalAngle = 0.3f;
@@ -85,18 +174,32 @@ namespace SolarSystem
                 distance = Lerp(distance, newDistance, t);
             }
             
-            position = DirectX::SimpleMath::Vector3(
+            auto const offset = DirectX::SimpleMath::Vector3(
                 std::sin(horizontalAngle) * std::cos(verticalAngle) * distance,
                 std::sin(verticalAngle) * distance,
                 std::cos(horizontalAngle) * std::cos(verticalAngle) * distance
-            ) + focusPosition;
+            );
+
+            worldPosition = Vector3d(offset) + focusPosition;
+            position = worldPosition.ToVector3();
 
             viewMatrix = DirectX::SimpleMath::Matrix(DirectX::XMMatrixLookAtLH(
                 position,
-                focusPosition,
+                focusPosition.ToVector3(),
+                DirectX::SimpleMath::Vector3::Up
+            ));
+
+            // Camera at the origin, world positions are rebased with GetWorldPosition before rendering
+            relativeViewMatrix = DirectX::SimpleMath::Matrix(DirectX::XMMatrixLookAtLH(
+                DirectX::SimpleMath::Vector3::Zero,
+                -offset,
                 DirectX::SimpleMath::Vector3::Up
             ));
 
+            // A slice of the bodies a frame, so a click only has to test the bodies along its ray
+            pickingModule.Refresh(components.GetComponentCount(), [this](size_t const index, Entity& entity, BVHSphere& sphere) {
+                GetPickingBody(index, entity, sphere);
+            });
         }
 
         auto GetPosition() const -> DirectX::SimpleMath::Vector3 const&
@@ -104,11 +207,29 @@ namespace SolarSystem
             return position;
         }
 
+        auto GetWorldPosition() const -> Vector3d const&
+        {
+            return worldPosition;
+        }
+
+        // Nearest camera target under the pixel, bodies are spheres scaled by their world matrix
+        auto Pick(float const screenX, float const screenY) -> std::optional<Entity>
+        {
+            auto const picked = PickComponent(screenX, screenY);
+            if(!picked)
+            {
+                return std::nullopt;
+            }
+
+            return pickingModule.GetEntity(*picked);
+        }
+
         auto SetPerspectiveProjection(float const fov, float const nearZ, float const farZ) -> void
         {
             this->fov = fov;
             this->nearZ = nearZ;
             this->farZ = farZ;
+            projectionMode = ProjectionMode::Standard;
 
 
             DirectX::XMMatrixPerspectiveFovLH(fov, windowSystem->GetAspectRatio(), nearZ, farZ);
@@ -121,6 +242,26 @@ namespace SolarSystem
             projectionMatrix = DirectX::SimpleMath::Matrix(DirectX::XMMatrixPerspectiveFovLH(fov, windowSystem->GetAspectRatio(), nearZ, farZ));
         }
 
+        auto SetReverseZInfiniteProjection(float const fov, float const nearZ) -> void
+        {
+            this->fov = fov;
+            this->nearZ = nearZ;
+            projectionMode = ProjectionMode::ReverseZInfinite;
+
+            projectionMatrix = CreateReverseZInfinitePerspective(fov, windowSystem->GetAspectRatio(), nearZ);
+        }
+
+        auto GetProjectionMode() const -> ProjectionMode
+        {
+            return projectionMode;
+        }
+
+        // Depth of the far plane, the value the depth buffer is cleared to
+        auto GetFarDepth() const -> float
+        {
+            return projectionMode == ProjectionMode::ReverseZInfinite ? 0.0f : 1.0f;
+        }
+
         auto GetProjectionMatrix() const -> DirectX::SimpleMath::Matrix const&
         {
             return projectionMatrix;
@@ -131,6 +272,11 @@ namespace SolarSystem
             return viewMatrix;
         }
 
+        auto GetRelativeViewMatrix() const -> DirectX::SimpleMath::Matrix const&
+        {
+            return relativeViewMatrix;
+        }
+
     private:
         
         WindowSystem* windowSystem = nullptr;
@@ -139,10 +285,13 @@ namespace SolarSystem
         float fov = DirectX::XM_PI / 3.0f;
         float nearZ = 0.1f;
         float farZ = 1000.0f;
+        ProjectionMode projectionMode = ProjectionMode::ReverseZInfinite;
     
         DirectX::SimpleMath::Matrix viewMatrix;
+        DirectX::SimpleMath::Matrix relativeViewMatrix;
         DirectX::SimpleMath::Matrix projectionMatrix;
         DirectX::SimpleMath::Vector3 position;
+        Vector3d worldPosition;
 
         size_t zoomAxis = (std::numeric_limits<size_t>::max)();
         float zoomSpeed = 10.0f;
@@ -160,6 +309,68 @@ namespace SolarSystem
         
         bool isLerping = true;
 
+        PickingModule pickingModule;
+
+        // World space sphere of a camera target, scaled by its world matrix
+        auto GetPickingBody(size_t const index, Entity& entity, BVHSphere& sphere) const -> void
+        {
+            entity = components.GetEntityFromComponent(index);
+            auto const& worldMatrix = worldSystem->GetComponent(entity);
+            auto const& world = worldMatrix.world;
+
+            auto const scale = (std::max)({
+                DirectX::SimpleMath::Vector3(world._11, world._12, world._13).LengthSquared(),
+                DirectX::SimpleMath::Vector3(world._21, world._22, world._23).LengthSquared(),
+                DirectX::SimpleMath::Vector3(world._31, world._32, world._33).LengthSquared()
+            });
+
+            auto const center = worldMatrix.position.ToVector3();
+            sphere = { center.x, center.y, center.z, std::sqrt(scale) };
+        }
+
+        // Only the ray is moved into world space, the hierarchy is kept up to date by Update
+        auto PickComponent(float const screenX, float const screenY) -> std::optional<size_t>
+        {
+            auto const getBody = [this](size_t const index, Entity& entity, BVHSphere& sphere) {
+                GetPickingBody(index, entity, sphere);
+            };
+
+            // Until the sweeps have measured the bodies' motion the spheres may not cover them
+            if(!pickingModule.HasMotionBounds())
+            {
+                pickingModule.Gather(components.GetComponentCount(), getBody);
+            }
+
+            auto ray = ScreenPointToRay(
+                screenX,
+                screenY,
+                static_cast<float>(windowSystem->GetWidth()),
+                static_cast<float>(windowSystem->GetHeight()),
+                relativeViewMatrix,
+                projectionMatrix
+            );
+
+            auto const origin = worldPosition.ToVector3();
+            ray.origin[0] += origin.x;
+            ray.origin[1] += origin.y;
+            ray.origin[2] += origin.z;
+
+            return pickingModule.Pick(ray, getBody);
+        }
+
+        auto UpdateProjection() -> void
+        {
+            switch(projectionMode)
+            {
+            case ProjectionMode::Standard:
+                SetPerspectiveProjection(fov, nearZ, farZ);
+                break;
+            case ProjectionMode::ReverseZInfinite:
+                SetReverseZInfiniteProjection(fov, nearZ);
+                break;
+            }
+        }
+
         static auto Lerp(float const a, float const b, float const t) -> float
         {
             return a + t * (b - a);
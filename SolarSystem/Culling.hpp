@@ -0,0 +1,202 @@
+#pragma once
+#include "Mesh.hpp"
+
+#include <d3d11.h>
+#include <SimpleMath.h>
+#include <vector>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cfloat>
+
+namespace SolarSystem
+{
+    struct CullingStatistics final
+    {
+        size_t tested = 0;
+        size_t visible = 0;
+        size_t culled = 0;
+    };
+
+
+    auto inline TransformBoundingSphere(BoundingSphere const& sphere, DirectX::SimpleMath::Matrix const& world) -> BoundingSphere
+    {
+        auto const scaleX = DirectX::SimpleMath::Vector3(world._11, world._12, world._13).LengthSquared();
+        auto const scaleY = DirectX::SimpleMath::Vector3(world._21, world._22, world._23).LengthSquared();
+        auto const scaleZ = DirectX::SimpleMath::Vector3(world._31, world._32, world._33).LengthSquared();
+
+        BoundingSphere result;
+        result.center = DirectX::SimpleMath::Vector3::Transform(sphere.center, world);
+        result.radius = sphere.radius * std::sqrt((std::max)({ scaleX, scaleY, scaleZ }));
+
+        return result;
+    }
+
+
+    //
+    // Tests world space bounding spheres against the view frustum.
+    // Spheres are stored in blocks of 8 (SoA) so every iteration of the culling loop
+    // tests 8 spheres against all 6 planes using two 4-wide vectors per component.
+    //
+    class CullingModule final
+    {
+    public:
+        auto SetFrustum(DirectX::SimpleMath::Matrix const& viewProjection) -> void
+        {
+            auto const& m = viewProjection;
+
+            // Gribb-Hartmann plane extraction for row vectors (clip = v * M)
+            DirectX::SimpleMath::Vector4 const c1 = { m._11, m._21, m._31, m._41 };
+            DirectX::SimpleMath::Vector4 const c2 = { m._12, m._22, m._32, m._42 };
+            DirectX::SimpleMath::Vector4 const c3 = { m._13, m._23, m._33, m._43 };
+            DirectX::SimpleMath::Vector4 const c4 = { m._14, m._24, m._34, m._44 };
+
+            planes[0] = NormalizePlane(Add(c4, c1));      // left
+            planes[1] = NormalizePlane(Subtract(c4, c1)); // right
+            planes[2] = NormalizePlane(Add(c4, c2));      // bottom
+            planes[3] = NormalizePlane(Subtract(c4, c2)); // top
+            planes[4] = NormalizePlane(c3);               // near
+            planes[5] = NormalizePlane(Subtract(c4, c3)); // far
+        }
+
+        auto Resize(size_t const count) -> void
+        {
+            sphereCount = count;
+            blocks.resize((count + BLOCK_SIZE - 1) / BLOCK_SIZE);
+        }
+
+        auto SetSphere(size_t const index, BoundingSphere const& sphere) -> void
+        {
+            assert(index < sphereCount);
+
+            auto& block = blocks[index / BLOCK_SIZE];
+            auto const lane = index % BLOCK_SIZE;
+
+            block.x[lane] = sphere.center.x;
+            block.y[lane] = sphere.center.y;
+            block.z[lane] = sphere.center.z;
+            block.radius[lane] = sphere.radius;
+        }
+
+        auto Cull() -> void
+        {
+            visible.clear();
+
+            DirectX::XMVECTOR planeX[6];
+            DirectX::XMVECTOR planeY[6];
+            DirectX::XMVECTOR planeZ[6];
+            DirectX::XMVECTOR planeW[6];
+
+            for(auto i = 0; i < 6; ++i)
+            {
+                planeX[i] = DirectX::XMVectorReplicate(planes[i].x);
+                planeY[i] = DirectX::XMVectorReplicate(planes[i].y);
+                planeZ[i] = DirectX::XMVectorReplicate(planes[i].z);
+                planeW[i] = DirectX::XMVectorReplicate(planes[i].w);
+            }
+
+            for(size_t b = 0; b < blocks.size(); ++b)
+            {
+                auto const& block = blocks[b];
+
+                DirectX::XMVECTOR inside[2];
+                for(auto half = 0; half < 2; ++half)
+                {
+                    auto const x = DirectX::XMLoadFloat4A(reinterpret_cast<DirectX::XMFLOAT4A const*>(block.x + half * 4));
+                    auto const y = DirectX::XMLoadFloat4A(reinterpret_cast<DirectX::XMFLOAT4A const*>(block.y + half * 4));
+                    auto const z = DirectX::XMLoadFloat4A(reinterpret_cast<DirectX::XMFLOAT4A const*>(block.z + half * 4));
+                    auto const negativeRadius = DirectX::XMVectorNegate(
+                        DirectX::XMLoadFloat4A(reinterpret_cast<DirectX::XMFLOAT4A const*>(block.radius + half * 4))
+                    );
+
+                    auto mask = DirectX::XMVectorTrueInt();
+                    for(auto i = 0; i < 6; ++i)
+                    {
+                        auto distance = DirectX::XMVectorMultiplyAdd(x, planeX[i], planeW[i]);
+                        distance = DirectX::XMVectorMultiplyAdd(y, planeY[i], distance);
+                        distance = DirectX::XMVectorMultiplyAdd(z, planeZ[i], distance);
+
+                        mask = DirectX::XMVectorAndInt(mask, DirectX::XMVectorGreaterOrEqual(distance, negativeRadius));
+                    }
+
+                    inside[half] = mask;
+                }
+
+                DirectX::XMUINT4 masks[2];
+                DirectX::XMStoreUInt4(&masks[0], inside[0]);
+                DirectX::XMStoreUInt4(&masks[1], inside[1]);
+
+                uint32_t const lanes[BLOCK_SIZE] = {
+                    masks[0].x, masks[0].y, masks[0].z, masks[0].w,
+                    masks[1].x, masks[1].y, masks[1].z, masks[1].w
+                };
+
+                auto const first = b * BLOCK_SIZE;
+                auto const last = (std::min)(first + BLOCK_SIZE, sphereCount);
+                for(auto i = first; i < last; ++i)
+                {
+                    if(lanes[i - first] != 0)
+                    {
+                        visible.push_back(i);
+                    }
+                }
+            }
+
+            statistics.tested = sphereCount;
+            statistics.visible = visible.size();
+            statistics.culled = sphereCount - visible.size();
+        }
+
+        auto GetVisible() const -> std::vector<size_t> const&
+        {
+            return visible;
+        }
+
+        auto GetStatistics() const -> CullingStatistics const&
+        {
+            return statistics;
+        }
+
+    private:
+        static constexpr size_t BLOCK_SIZE = 8;
+
+        struct alignas(16) SphereBlock final
+        {
+            float x[BLOCK_SIZE] = { };
+            float y[BLOCK_SIZE] = { };
+            float z[BLOCK_SIZE] = { };
+            float radius[BLOCK_SIZE] = { };
+        };
+
+        std::vector<SphereBlock> blocks;
+        size_t sphereCount = 0;
+
+        DirectX::SimpleMath::Vector4 planes[6];
+
+        std::vector<size_t> visible;
+        CullingStatistics statistics;
+
+        static auto Add(DirectX::SimpleMath::Vector4 const& a, DirectX::SimpleMath::Vector4 const& b) -> DirectX::SimpleMath::Vector4
+        {
+            return { a.x + b.x, a.y + b.y, a.z + b.z, a.w + b.w };
+        }
+
+        static auto Subtract(DirectX::SimpleMath::Vector4 const& a, DirectX::SimpleMath::Vector4 const& b) -> DirectX::SimpleMath::Vector4
+        {
+            return { a.x - b.x, a.y - b.y, a.z - b.z, a.w - b.w };
+        }
+
+        static auto NormalizePlane(DirectX::SimpleMath::Vector4 const& plane) -> DirectX::SimpleMath::Vector4
+        {
+            auto const length = std::sqrt(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+
+            // Degenerate plane (e.g. infinite far plane), accept everything
+            if(length < FLT_EPSILON)
+            {
+                return { 0.0f, 0.0f, 0.0f, 1.0f };
+            }
+
+            return { plane.x / length, plane.y / length, plane.z / length, plane.w / length };
+        }
+    };
+}
@@ -3,6 +3,11 @@
 #include <memory>
 #include <cassert>
 #include <algorithm>
+#include <limits>
+#include <utility>
+#include <type_traits>
+#include "Snapshot.hpp"
+#include "MemoryTracking.hpp"
 
 namespace SolarSystem
 {
@@ -13,6 +18,7 @@ namespace SolarSystem
 
 
     class ECS;
+    class CommandBuffer;
 
     class ECSContext final
     {
@@ -23,6 +29,8 @@ namespace SolarSystem
         template <typename T>
         auto GetSystem()->T*;
 
+        auto SubmitCommandBuffer(CommandBuffer& commandBuffer) -> void;
+
     private:
         ECS& ecs;
     };
@@ -57,6 +65,26 @@ namespace SolarSystem
         virtual auto Terminate() -> void
         { }
 
+        // Drops whatever the system keeps for the given entities, called when they are destroyed
+        virtual auto RemoveEntities(Entity const* entities, size_t count) -> void
+        { }
+
+        // Snapshot support, systems keeping state outside of their component holder override all four
+        virtual auto SaveState(SnapshotWriter& writer) const -> void
+        { }
+
+        virtual auto LoadState(SnapshotReader& reader) -> void
+        { }
+
+        // Conservative, any mutable access counts as a change
+        virtual auto IsStateChanged() const -> bool
+        {
+            return false;
+        }
+
+        virtual auto ClearStateChanged() -> void
+        { }
+
 
         auto GetSystemIndex() const -> system_index_type
         {
@@ -108,30 +136,128 @@ namespace SolarSystem
         template <typename... CtorArgs>
         auto AddComponent(Entity entity, CtorArgs ... args) -> Component &
         {
+            if(entity.id >= entityToComponent.size())
+            {
+                entityToComponent.resize((std::max)(entity.id + 1, entityToComponent.size() * 2), NO_MAPPING);
+            }
             assert(entityToComponent[entity.id] == NO_MAPPING);
 
+            changed = true;
             auto & component = entityComponents.emplace_back(entity, std::forward<CtorArgs>(args)...).component;
             entityToComponent[entity.id] = entityComponents.size() - 1;
 
             return component;
         }
 
+        // Appends count components with one reservation, entities[i] gets components[i]
+        auto AddComponents(Entity const* const entities, Component const* const components, size_t const count) -> void
+        {
+            auto const first = PrepareBatch(entities, count);
+            for(size_t i = 0; i < count; ++i)
+            {
+                entityComponents.emplace_back(entities[i], components[i]);
+                entityToComponent[entities[i].id] = first + i;
+            }
+        }
+
+        // Appends a copy of component to each of count entities
+        auto AddComponents(Entity const* const entities, size_t const count, Component const& component = Component()) -> void
+        {
+            auto const first = PrepareBatch(entities, count);
+            for(size_t i = 0; i < count; ++i)
+            {
+                entityComponents.emplace_back(entities[i], component);
+                entityToComponent[entities[i].id] = first + i;
+            }
+        }
+
+        // Removes the components of those entities that have one. The remaining components keep their
+        // order, which systems such as ParentSystem rely on, so this is one pass over all components.
+        auto RemoveComponents(Entity const* const entities, size_t const count) -> void
+        {
+            auto removed = false;
+            for(size_t i = 0; i < count; ++i)
+            {
+                if(HasComponent(entities[i]))
+                {
+                    entityToComponent[entities[i].id] = NO_MAPPING;
+                    removed = true;
+                }
+            }
+
+            if(!removed)
+            {
+                return;
+            }
+            changed = true;
+
+            size_type kept = 0;
+            for(size_type i = 0; i < entityComponents.size(); ++i)
+            {
+                auto const id = entityComponents[i].entity.id;
+                if(entityToComponent[id] == NO_MAPPING)
+                {
+                    continue;
+                }
+
+                if(kept != i)
+                {
+                    entityComponents[kept] = std::move(entityComponents[i]);
+                }
+                entityToComponent[id] = kept++;
+            }
+            entityComponents.erase(entityComponents.begin() + kept, entityComponents.end());
+        }
+
+        auto RemoveComponent(Entity const entity) -> void
+        {
+            RemoveComponents(&entity, 1);
+        }
+
+        auto HasComponent(Entity const entity) const -> bool
+        {
+            return entity.id < entityToComponent.size() && entityToComponent[entity.id] != NO_MAPPING;
+        }
+
         auto GetComponent(Entity entity) -> Component &
         {
-            assert(entityToComponent[entity.id] != NO_MAPPING);
+            assert(entity.id < entityToComponent.size() && entityToComponent[entity.id] != NO_MAPPING);
+            changed = true;
+            return entityComponents[entityToComponent[entity.id]].component;
+        }
+
+        auto GetComponent(Entity entity) const -> Component const&
+        {
+            assert(entity.id < entityToComponent.size() && entityToComponent[entity.id] != NO_MAPPING);
             return entityComponents[entityToComponent[entity.id]].component;
         }
 
         template <typename Func>
         auto Each(Func && function) -> void
         {
+            changed = true;
             for(auto& entityComponent : entityComponents)
             {
                 function(entityComponent.entity, entityComponent.component);
             }
         }
 
+        template <typename Func>
+        auto Each(Func && function) const -> void
+        {
+            for(auto const& entityComponent : entityComponents)
+            {
+                function(entityComponent.entity, entityComponent.component);
+            }
+        }
+
         auto operator[](size_t index) -> Component&
+        {
+            changed = true;
+            return entityComponents[index].component;
+        }
+
+        auto operator[](size_t index) const -> Component const&
         {
             return entityComponents[index].component;
         }
@@ -148,38 +274,141 @@ namespace SolarSystem
 
         auto GetComponentIndex(Entity entity) -> size_t
         {
-            assert(entityToComponent[entity.id] != NO_MAPPING);
+            assert(entity.id < entityToComponent.size() && entityToComponent[entity.id] != NO_MAPPING);
             return entityToComponent[entity.id];
         }
 
         auto SwapComponents(size_t a, size_t b) -> void
         {
+            changed = true;
             std::swap(entityComponents[a], entityComponents[b]);
         }
 
+        // Makes room for componentCount components in total on entities with ids below entityCount
+        auto Reserve(size_t const componentCount, size_t const entityCount) -> void
+        {
+            entityComponents.reserve(componentCount);
+            if(entityCount > entityToComponent.size())
+            {
+                entityToComponent.resize(entityCount, NO_MAPPING);
+            }
+        }
+
+        // Like Reserve but at least doubles the dense array when it has to grow, so many small batches stay linear
+        auto Grow(size_t const componentCount, size_t const entityCount) -> void
+        {
+            if(componentCount > entityComponents.capacity())
+            {
+                Reserve((std::max)(componentCount, 2 * entityComponents.capacity()), entityCount);
+            }
+            else
+            {
+                Reserve(componentCount, entityCount);
+            }
+        }
+
+
+        // Set by every mutable access since the last ClearChanged, including ones that did not change anything
+        auto IsChanged() const -> bool
+        {
+            return changed;
+        }
+
+        auto ClearChanged() -> void
+        {
+            changed = false;
+        }
+
+        // Dense array and entity mapping, trivially copyable components are copied as one block
+        auto Save(SnapshotWriter& writer) const -> void
+        {
+            writer.WriteValue(static_cast<uint64_t>(entityComponents.size()));
+            if constexpr(std::is_trivially_copyable_v<EntityComponent>)
+            {
+                writer.Write(entityComponents.data(), entityComponents.size() * sizeof(EntityComponent));
+            }
+            else
+            {
+                for(auto const& entityComponent : entityComponents)
+                {
+                    writer.WriteValue(entityComponent.entity);
+                    SerializeComponent(writer, entityComponent.component);
+                }
+            }
+
+            writer.WriteValue(static_cast<uint64_t>(entityToComponent.size()));
+            writer.Write(entityToComponent.data(), entityToComponent.size() * sizeof(size_type));
+        }
+
+        auto Load(SnapshotReader& reader) -> void
+        {
+            auto const componentCount = static_cast<size_t>(reader.ReadValue<uint64_t>());
+            if constexpr(std::is_trivially_copyable_v<EntityComponent>)
+            {
+                entityComponents.resize(componentCount);
+                reader.Read(entityComponents.data(), componentCount * sizeof(EntityComponent));
+            }
+            else
+            {
+                entityComponents.clear();
+                entityComponents.reserve(componentCount);
+                for(size_t i = 0; i < componentCount; ++i)
+                {
+                    auto& entityComponent = entityComponents.emplace_back(reader.ReadValue<Entity>());
+                    DeserializeComponent(reader, entityComponent.component);
+                }
+            }
+
+            entityToComponent.resize(static_cast<size_t>(reader.ReadValue<uint64_t>()));
+            reader.Read(entityToComponent.data(), entityToComponent.size() * sizeof(size_type));
+            changed = true;
+        }
+
     private:
+        // Grows both vectors once for a batch and returns the index of its first component
+        auto PrepareBatch(Entity const* const entities, size_t const count) -> size_t
+        {
+            size_t entityCount = 0;
+            for(size_t i = 0; i < count; ++i)
+            {
+                assert(entities[i].id >= entityToComponent.size() || entityToComponent[entities[i].id] == NO_MAPPING);
+                entityCount = (std::max)(entityCount, entities[i].id + 1);
+            }
+
+            Grow(entityComponents.size() + count, entityCount);
+            changed = true;
+            return entityComponents.size();
+        }
+
         struct EntityComponent final
         {
             Entity entity;
             Component component;
 
+            // Only used to make room for components read from a snapshot
+            EntityComponent() = default;
+
             template <typename ... CtorArgs>
             explicit EntityComponent(Entity const entity, CtorArgs ... args)
                 : entity(entity), component(std::forward<CtorArgs>(args)...)
             { }
         };
 
-        std::vector<EntityComponent> entityComponents;
+        std::vector<EntityComponent, TaggedAllocator<EntityComponent, MemoryTag::Components>> entityComponents;
         using size_type = decltype(entityComponents)::template size_type;
 
         static constexpr size_type NO_MAPPING = (std::numeric_limits<size_type>::max)();
-        std::vector<size_type> entityToComponent;
+        std::vector<size_type, TaggedAllocator<size_type, MemoryTag::Components>> entityToComponent;
+
+        bool changed = true;
     };
 
     template <typename System, typename Component>
     class ECSSystem<System, Component> : public ECSSystem<System>
     {
     public:
+        using component_type = Component;
+
         template <typename... CtorArgs>
         auto AddComponent(Entity entity, CtorArgs ... args) -> Component &
         {
@@ -191,33 +420,127 @@ namespace SolarSystem
             return components.GetComponent(entity);
         }
 
+        auto GetComponent(Entity entity) const -> Component const&
+        {
+            return components.GetComponent(entity);
+        }
+
+        auto AddComponents(Entity const* const entities, Component const* const components, size_t const count) -> void
+        {
+            this->components.AddComponents(entities, components, count);
+        }
+
+        auto AddComponents(Entity const* const entities, size_t const count, Component const& component = Component()) -> void
+        {
+            components.AddComponents(entities, count, component);
+        }
+
+        auto RemoveComponent(Entity entity) -> void
+        {
+            components.RemoveComponent(entity);
+        }
+
+        auto RemoveComponents(Entity const* const entities, size_t const count) -> void
+        {
+            components.RemoveComponents(entities, count);
+        }
+
+        auto HasComponent(Entity entity) const -> bool
+        {
+            return components.HasComponent(entity);
+        }
+
+        auto RemoveEntities(Entity const* const entities, size_t const count) -> void override
+        {
+            components.RemoveComponents(entities, count);
+        }
+
+        auto SaveState(SnapshotWriter& writer) const -> void override
+        {
+            components.Save(writer);
+        }
+
+        auto LoadState(SnapshotReader& reader) -> void override
+        {
+            components.Load(reader);
+        }
+
+        auto IsStateChanged() const -> bool override
+        {
+            return components.IsChanged();
+        }
+
+        auto ClearStateChanged() -> void override
+        {
+            components.ClearChanged();
+        }
+
         template <typename Func>
         auto Each(Func&& function) -> void
         {
             components.Each(std::forward<Func>(function));
         }
 
+        template <typename Func>
+        auto Each(Func&& function) const -> void
+        {
+            components.Each(std::forward<Func>(function));
+        }
+
+        auto GetComponentCount() -> size_t
+        {
+            return components.GetComponentCount();
+        }
+
+        auto Reserve(size_t const componentCount, size_t const entityCount) -> void
+        {
+            components.Reserve(componentCount, entityCount);
+        }
+
     protected:
         ComponentHolder<Component> components;
     };
 
 
+    // Prefabs and command buffers copy components recorded against placeholder entities. Components
+    // that refer to other entities overload this to rewrite those references with remap(entity).
+    template <typename Component, typename Remap>
+    auto RemapEntityReferences(Component&, Remap const&) -> void
+    { }
+
+    // Batched insertion used by prefabs and command buffers, systems taking several component types overload it
+    template <typename System, typename Component>
+    auto AddComponentBatch(System& system, Entity const* const entities, Component const* const components, size_t const count) -> void
+    {
+        system.AddComponents(entities, components, count);
+    }
+
+
     class ECS final
     {
     public:
         template <typename T, typename ... CtorArgs>
         auto AddSystem(CtorArgs ... args) -> T*
+        {
+            auto& system = ownedSystems.emplace_back(std::make_unique<T>(std::forward<CtorArgs>(args)...));
+            return AttachSystem(*static_cast<T*>(system.get()));
+        }
+
+        // Registers a system owned elsewhere, such as by ECSWorld, it has to outlive the ECS
+        template <typename T>
+        auto AttachSystem(T& system) -> T*
         {
             auto systemIndex = T::GetSystemIndex();
             if(systems.size() < systemIndex + 1)
             {
-                systems.resize(systemIndex + 1);
+                systems.resize(systemIndex + 1, nullptr);
             }
-            systems[systemIndex] = std::make_unique<T>(std::forward<CtorArgs>(args)...);
+            assert(systems[systemIndex] == nullptr);
+            systems[systemIndex] = &system;
             systems[systemIndex]->SetContext(&context);
 
             systemsUpdateOrder.push_back(systemIndex);
-            return reinterpret_cast<T*>(systems[systemIndex].get());
+            return &system;
         }
 
 
@@ -227,7 +550,7 @@ namespace SolarSystem
             auto systemIndex = T::GetSystemIndex();
             assert(systemIndex < systems.size());
 
-            auto system = systems[systemIndex].get();
+            auto system = systems[systemIndex];
             assert(system->GetSystemIndex() == systemIndex);
 
             return reinterpret_cast<T*>(system);
@@ -242,11 +565,13 @@ namespace SolarSystem
             }
         }
 
+        // Command buffers submitted by a system are played back right after its update
         auto Update(float const deltaTime, float const deltaTime2) -> void
         {
             for(auto systemIndex : systemsUpdateOrder)
             {
                 systems[systemIndex]->Update(deltaTime, deltaTime2);
+                PlaybackCommandBuffers();
             }
         }
 
@@ -265,18 +590,497 @@ namespace SolarSystem
             return Entity{ nextEntityIndex++ };
         }
 
+        // Creates count entities with consecutive ids
+        auto CreateEntities(size_t const count) -> std::vector<Entity>
+        {
+            std::vector<Entity> entities(count);
+            CreateEntities(entities.data(), count);
+            return entities;
+        }
+
+        auto CreateEntities(Entity* const entities, size_t const count) -> void
+        {
+            for(size_t i = 0; i < count; ++i)
+            {
+                entities[i] = Entity{ nextEntityIndex++ };
+            }
+        }
+
+        // Removes the entities from every system. Ids are not reused and children are not destroyed
+        // with their parents, entities whose parent is destroyed have to be destroyed as well.
+        auto DestroyEntities(Entity const* const entities, size_t const count) -> void
+        {
+            for(auto const& system : systems)
+            {
+                if(system)
+                {
+                    system->RemoveEntities(entities, count);
+                }
+            }
+        }
+
+        auto DestroyEntity(Entity const entity) -> void
+        {
+            DestroyEntities(&entity, 1);
+        }
+
+
+        // Queues a command buffer for playback at the next sync point, buffers play back in submission order
+        auto SubmitCommandBuffer(CommandBuffer& commandBuffer) -> void
+        {
+            submittedCommandBuffers.push_back(&commandBuffer);
+        }
+
+        auto PlaybackCommandBuffers() -> void;
+
+        // Number of entities created so far, every entity id is below it
+        auto GetEntityCount() const -> size_t
+        {
+            return nextEntityIndex;
+        }
+
+
+        //
+        // Captures the state of every system and the entity counter. With a base the snapshot is a
+        // delta, systems not changed since the base was taken only refer to its record and restoring
+        // the delta needs the same base. Bases are always full snapshots, so chains never form.
+        //
+        auto SaveSnapshot(Snapshot const* const base = nullptr) -> Snapshot;
+
+        // Restores a snapshot taken from this ECS with the same systems, systems already in the
+        // captured state are skipped. Throws when the snapshot does not match the systems.
+        auto RestoreSnapshot(Snapshot const& snapshot, Snapshot const* base = nullptr) -> void;
+
     private:
-        std::vector<std::unique_ptr<SystemBase>> systems;
+        std::vector<std::unique_ptr<SystemBase>> ownedSystems;
+        std::vector<SystemBase*> systems;
         using size_type = decltype(systems)::size_type;
         std::vector<size_type> systemsUpdateOrder;
         ECSContext context{ *this };
         size_t nextEntityIndex = 0;
+        std::vector<CommandBuffer*> submittedCommandBuffers;
+
+        // Stamp of the state each system was last saved or restored with, 0 before either
+        std::vector<uint64_t> stateStamps;
+        uint64_t nextStateStamp = 1;
     };
 
 
+    //
+    // Structural changes recorded while systems iterate and applied later at a sync point, as
+    // adding or removing components while another system iterates could reallocate under it.
+    // A buffer is not thread safe, parallel work records into one buffer per chunk and submits
+    // them in chunk order. Buffers play back in submission order and every system sees its
+    // commands in recording order, so the result does not depend on which thread ran which chunk.
+    //
+    class CommandBuffer final
+    {
+    public:
+        // Entities created by the buffer get their ids at playback, placeholders are only valid in this buffer
+        auto CreateEntity() -> Entity
+        {
+            auto const entity = Entity{ DEFERRED_ENTITY | createdCount++ };
+            commands.push_back({ CommandType::Create, entity, 0 });
+            return entity;
+        }
+
+        auto DestroyEntity(Entity const entity) -> void
+        {
+            commands.push_back({ CommandType::Destroy, entity, 0 });
+        }
+
+        template <typename System, typename Component = typename System::component_type>
+        auto AddComponent(Entity const entity, Component const& component = Component()) -> void
+        {
+            auto const stream = GetStream<System, Component>();
+            static_cast<Stream<System, Component>&>(*streams[stream]).components.push_back(component);
+            commands.push_back({ CommandType::Add, entity, stream });
+        }
+
+        template <typename System>
+        auto RemoveComponent(Entity const entity) -> void
+        {
+            commands.push_back({ CommandType::Remove, entity, GetStream<System, typename System::component_type>() });
+        }
+
+        auto IsEmpty() const -> bool
+        {
+            return commands.empty();
+        }
+
+
+        //
+        // Applies the commands and clears the buffer. Adds between two removals are applied with one
+        // batch per stream, each in recording order, and runs of the same removal as one batch.
+        // Creates need no work here, their entities are all made up front.
+        //
+        auto Playback(ECS& ecs) -> void
+        {
+            created.resize(createdCount);
+            ecs.CreateEntities(created.data(), createdCount);
+            auto const resolve = Resolve{ created.data() };
+
+            streamPositions.assign(streams.size(), 0);
+            streamBatches.resize(streams.size());
+
+            for(size_t i = 0; i < commands.size();)
+            {
+                auto const& command = commands[i];
+                if(command.type == CommandType::Create)
+                {
+                    i++;
+                    continue;
+                }
+
+                if(command.type == CommandType::Add)
+                {
+                    auto end = i;
+                    for(; end < commands.size() && (commands[end].type == CommandType::Add || commands[end].type == CommandType::Create); ++end)
+                    {
+                        if(commands[end].type == CommandType::Add)
+                        {
+                            streamBatches[commands[end].stream].push_back(resolve(commands[end].entity));
+                        }
+                    }
+
+                    for(size_t stream = 0; stream < streams.size(); ++stream)
+                    {
+                        auto& streamBatch = streamBatches[stream];
+                        if(!streamBatch.empty())
+                        {
+                            streams[stream]->Add(ecs, streamBatch.data(), streamPositions[stream], streamBatch.size(), resolve);
+                            streamPositions[stream] += streamBatch.size();
+                            streamBatch.clear();
+                        }
+                    }
+
+                    i = end;
+                    continue;
+                }
+
+                batch.clear();
+                auto end = i;
+                for(; end < commands.size() && (commands[end].type == CommandType::Create ||
+                    (commands[end].type == command.type && commands[end].stream == command.stream)); ++end)
+                {
+                    if(commands[end].type != CommandType::Create)
+                    {
+                        batch.push_back(resolve(commands[end].entity));
+                    }
+                }
+
+                if(command.type == CommandType::Destroy)
+                {
+                    ecs.DestroyEntities(batch.data(), batch.size());
+                }
+                else
+                {
+                    streams[command.stream]->Remove(ecs, batch.data(), batch.size());
+                }
+
+                i = end;
+            }
+
+            Clear();
+        }
+
+        auto Clear() -> void
+        {
+            commands.clear();
+            createdCount = 0;
+            for(auto const& stream : streams)
+            {
+                stream->Clear();
+            }
+
+            created.clear();
+            streamPositions.clear();
+            batch.clear();
+            for(auto& streamBatch : streamBatches)
+            {
+                streamBatch.clear();
+            }
+        }
+
+    private:
+        static constexpr size_t DEFERRED_ENTITY = (std::numeric_limits<size_t>::max)() / 2 + 1;
+
+        enum class CommandType
+        {
+            Create,
+            Destroy,
+            Add,
+            Remove
+        };
+
+        struct Command final
+        {
+            CommandType type;
+            Entity entity;
+            size_t stream;
+        };
+
+        // Maps placeholders to the entities created at playback and leaves other entities as they are
+        struct Resolve final
+        {
+            Entity const* created;
+
+            auto operator()(Entity const entity) const -> Entity
+            {
+                return (entity.id & DEFERRED_ENTITY) != 0 ? created[entity.id & ~DEFERRED_ENTITY] : entity;
+            }
+        };
+
+        class StreamBase
+        {
+        public:
+            virtual ~StreamBase() = default;
+
+            virtual auto Add(ECS& ecs, Entity const* entities, size_t first, size_t count, Resolve const& resolve) -> void = 0;
+            virtual auto Remove(ECS& ecs, Entity const* entities, size_t count) -> void = 0;
+            virtual auto Clear() -> void = 0;
+
+            void const* typeId = nullptr;
+        };
+
+        template <typename System, typename Component>
+        class Stream final : public StreamBase
+        {
+        public:
+            auto Add(ECS& ecs, Entity const* const entities, size_t const first, size_t const count, Resolve const& resolve) -> void override
+            {
+                for(auto i = first; i < first + count; ++i)
+                {
+                    RemapEntityReferences(components[i], resolve);
+                }
+                AddComponentBatch(*ecs.GetSystem<System>(), entities, components.data() + first, count);
+            }
+
+            auto Remove(ECS& ecs, Entity const* const entities, size_t const count) -> void override
+            {
+                ecs.GetSystem<System>()->RemoveComponents(entities, count);
+            }
+
+            auto Clear() -> void override
+            {
+                components.clear();
+            }
+
+            std::vector<Component> components;
+        };
+
+        template <typename System, typename Component>
+        static auto GetStreamTypeId() -> void const*
+        {
+            static char const id = 0;
+            return &id;
+        }
+
+        template <typename System, typename Component>
+        auto GetStream() -> size_t
+        {
+            auto const typeId = GetStreamTypeId<System, Component>();
+            for(size_t i = 0; i < streams.size(); ++i)
+            {
+                if(streams[i]->typeId == typeId)
+                {
+                    return i;
+                }
+            }
+
+            streams.push_back(std::make_unique<Stream<System, Component>>());
+            streams.back()->typeId = typeId;
+            return streams.size() - 1;
+        }
+
+        std::vector<Command> commands;
+        size_t createdCount = 0;
+        // Recorded components per system and component type, kept across playbacks to reuse their memory
+        std::vector<std::unique_ptr<StreamBase>> streams;
+
+        // Playback scratch, only cleared so a buffer played back every frame stops allocating
+        std::vector<Entity> created;
+        std::vector<size_t> streamPositions;
+        std::vector<Entity> batch;
+        std::vector<std::vector<Entity>> streamBatches;
+    };
+
+
+    auto inline ECS::PlaybackCommandBuffers() -> void
+    {
+        for(size_t i = 0; i < submittedCommandBuffers.size(); ++i)
+        {
+            submittedCommandBuffers[i]->Playback(*this);
+        }
+        submittedCommandBuffers.clear();
+    }
+
+
     template <typename T>
     auto ECSContext::GetSystem() -> T*
     {
         return ecs.GetSystem<T>();
     }
+
+    auto inline ECSContext::SubmitCommandBuffer(CommandBuffer& commandBuffer) -> void
+    {
+        ecs.SubmitCommandBuffer(commandBuffer);
+    }
+
+
+    namespace Detail
+    {
+        constexpr uint32_t SNAPSHOT_MAGIC = 0x50414E53; // "SNAP"
+        constexpr uint32_t SNAPSHOT_VERSION = 1;
+
+        struct SnapshotHeader final
+        {
+            uint32_t magic;
+            uint32_t version;
+            uint64_t entityCount;
+            uint32_t systemCount;
+            uint32_t isDelta;
+        };
+
+        struct SnapshotRecord final
+        {
+            uint32_t systemIndex;
+            // Set when the payload is in the base snapshot under the same stamp
+            uint32_t inBase;
+            uint64_t stamp;
+            uint64_t size;
+        };
+
+        // Finds the record of a system in a full snapshot, returns the reader positioned at its payload
+        auto inline FindSnapshotRecord(Snapshot const& snapshot, uint32_t const systemIndex, SnapshotRecord& record) -> SnapshotReader
+        {
+            auto reader = SnapshotReader(snapshot.data.data(), snapshot.data.data() + snapshot.data.size());
+            auto const header = reader.ReadValue<SnapshotHeader>();
+            if(header.magic != SNAPSHOT_MAGIC || header.version != SNAPSHOT_VERSION)
+            {
+                throw std::exception("Snapshot has an unknown format");
+            }
+
+            for(uint32_t i = 0; i < header.systemCount; ++i)
+            {
+                record = reader.ReadValue<SnapshotRecord>();
+                if(record.systemIndex == systemIndex)
+                {
+                    return reader;
+                }
+                reader.Skip(static_cast<size_t>(record.inBase ? 0 : record.size));
+            }
+            throw std::exception("Snapshot base has no record for a system");
+        }
+    }
+
+
+    auto inline ECS::SaveSnapshot(Snapshot const* const base) -> Snapshot
+    {
+        Snapshot snapshot;
+        auto writer = SnapshotWriter(snapshot.data);
+
+        uint32_t systemCount = 0;
+        for(auto const& system : systems)
+        {
+            systemCount += system ? 1 : 0;
+        }
+        writer.WriteValue(Detail::SnapshotHeader{ Detail::SNAPSHOT_MAGIC, Detail::SNAPSHOT_VERSION, nextEntityIndex, systemCount, base != nullptr });
+
+        stateStamps.resize(systems.size(), 0);
+        for(uint32_t systemIndex = 0; systemIndex < systems.size(); ++systemIndex)
+        {
+            auto const& system = systems[systemIndex];
+            if(!system)
+            {
+                continue;
+            }
+
+            // A fresh stamp whenever the state may differ from the one last stamped
+            auto& stamp = stateStamps[systemIndex];
+            if(stamp == 0 || system->IsStateChanged())
+            {
+                stamp = nextStateStamp++;
+                system->ClearStateChanged();
+            }
+
+            auto record = Detail::SnapshotRecord{ systemIndex, 0, stamp, 0 };
+            if(base != nullptr)
+            {
+                Detail::SnapshotRecord baseRecord;
+                Detail::FindSnapshotRecord(*base, systemIndex, baseRecord);
+                record.inBase = baseRecord.stamp == stamp && !baseRecord.inBase;
+            }
+
+            auto const recordOffset = writer.GetSize();
+            writer.WriteValue(record);
+            if(!record.inBase)
+            {
+                system->SaveState(writer);
+                record.size = writer.GetSize() - recordOffset - sizeof record;
+                writer.WriteValueAt(recordOffset, record);
+            }
+        }
+
+        return snapshot;
+    }
+
+    auto inline ECS::RestoreSnapshot(Snapshot const& snapshot, Snapshot const* const base) -> void
+    {
+        auto reader = SnapshotReader(snapshot.data.data(), snapshot.data.data() + snapshot.data.size());
+        auto const header = reader.ReadValue<Detail::SnapshotHeader>();
+        if(header.magic != Detail::SNAPSHOT_MAGIC || header.version != Detail::SNAPSHOT_VERSION)
+        {
+            throw std::exception("Snapshot has an unknown format");
+        }
+        if(header.isDelta && base == nullptr)
+        {
+            throw std::exception("Delta snapshot restored without its base");
+        }
+
+        stateStamps.resize(systems.size(), 0);
+        for(uint32_t i = 0; i < header.systemCount; ++i)
+        {
+            auto const record = reader.ReadValue<Detail::SnapshotRecord>();
+            if(record.systemIndex >= systems.size() || !systems[record.systemIndex])
+            {
+                throw std::exception("Snapshot has a record for a missing system");
+            }
+
+            auto const payloadSize = static_cast<size_t>(record.inBase ? 0 : record.size);
+            auto& system = systems[record.systemIndex];
+            auto& stamp = stateStamps[record.systemIndex];
+            if(stamp == record.stamp && !system->IsStateChanged())
+            {
+                reader.Skip(payloadSize);
+                continue;
+            }
+
+            if(record.inBase)
+            {
+                Detail::SnapshotRecord baseRecord;
+                auto baseReader = Detail::FindSnapshotRecord(*base, record.systemIndex, baseRecord);
+                if(baseRecord.stamp != record.stamp || baseRecord.inBase)
+                {
+                    throw std::exception("Snapshot base does not match the delta");
+                }
+                system->LoadState(baseReader);
+            }
+            else
+            {
+                auto payload = SnapshotReader(reader.GetCursor(), reader.GetCursor() + payloadSize);
+                reader.Skip(payloadSize);
+                system->LoadState(payload);
+                if(!payload.IsAtEnd())
+                {
+                    throw std::exception("Snapshot record was not fully read");
+                }
+            }
+
+            stamp = record.stamp;
+            system->ClearStateChanged();
+        }
+
+        nextEntityIndex = static_cast<size_t>(header.entityCount);
+    }
 }
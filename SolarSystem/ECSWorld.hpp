@@ -0,0 +1,121 @@
+#pragma once
+#include "ECS.hpp"
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace SolarSystem
+{
+    // Constructor arguments for one system of an ECSWorld, systems without any are default constructed
+    template <typename System, typename... Args>
+    struct SystemArgs final
+    {
+        using system_type = System;
+        std::tuple<Args...> args;
+    };
+
+    template <typename System, typename... Args>
+    auto MakeSystemArgs(Args&&... args) -> SystemArgs<System, std::decay_t<Args>...>
+    {
+        return { std::tuple<std::decay_t<Args>...>(std::forward<Args>(args)...) };
+    }
+
+
+    namespace Detail
+    {
+        // Holds a system by value, systems can be neither copied nor moved so it is built in place from its arguments
+        template <typename System>
+        class SystemSlot
+        {
+        protected:
+            template <typename ArgsTuple>
+            explicit SystemSlot(ArgsTuple&& args): system(std::make_from_tuple<System>(std::forward<ArgsTuple>(args)))
+            { }
+
+            System system;
+        };
+
+        template <typename System>
+        auto FindSystemArgs() -> std::tuple<>
+        {
+            return { };
+        }
+
+        template <typename System, typename First, typename... Rest>
+        auto FindSystemArgs(First& first, Rest&... rest) -> decltype(auto)
+        {
+            if constexpr(std::is_same_v<typename First::system_type, System>)
+            {
+                return std::move(first.args);
+            }
+            else
+            {
+                return FindSystemArgs<System>(rest...);
+            }
+        }
+    }
+
+
+    //
+    // ECS with a set of systems known at compile time. Systems are members of the world, GetSystem
+    // is a direct reference and Update calls every system's Update non-virtually in the order of
+    // Systems. The systems are also attached to an ECS owned by the world, which keeps the entities
+    // and serves everything that takes an ECS, such as systems' context lookups, the scene loader,
+    // prefabs, command buffers and snapshots.
+    //
+    template <typename... Systems>
+    class ECSWorld final : private Detail::SystemSlot<Systems>...
+    {
+    public:
+        // Takes SystemArgs for the systems whose constructors need arguments, in any order
+        template <typename... Args>
+        explicit ECSWorld(Args... args): Detail::SystemSlot<Systems>(Detail::FindSystemArgs<Systems>(args...))...
+        {
+            (ecs.AttachSystem(Detail::SystemSlot<Systems>::system), ...);
+        }
+
+        ECSWorld(ECSWorld const&) = delete;
+        auto operator=(ECSWorld const&) -> ECSWorld& = delete;
+
+
+        template <typename T>
+        auto GetSystem() -> T*
+        {
+            static_assert((std::is_same_v<T, Systems> || ...), "System is not part of the world");
+            return &this->Detail::SystemSlot<T>::system;
+        }
+
+        auto GetECS() -> ECS&
+        {
+            return ecs;
+        }
+
+
+        auto Initialize() -> void
+        {
+            ecs.Initialize();
+        }
+
+        // Command buffers submitted by a system are played back right after its update, as in ECS::Update
+        auto Update(float const deltaTime, float const deltaTime2) -> void
+        {
+            (UpdateSystem(Detail::SystemSlot<Systems>::system, deltaTime, deltaTime2), ...);
+        }
+
+        auto Terminate() -> void
+        {
+            ecs.Terminate();
+        }
+
+    private:
+        // Systems are final, so the call through the concrete type is not virtual
+        template <typename System>
+        auto UpdateSystem(System& system, float const deltaTime, float const deltaTime2) -> void
+        {
+            system.System::Update(deltaTime, deltaTime2);
+            ecs.PlaybackCommandBuffers();
+        }
+
+        ECS ecs;
+    };
+}
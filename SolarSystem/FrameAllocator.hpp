@@ -0,0 +1,196 @@
+#pragma once
+#include "MemoryTracking.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <type_traits>
+#include <vector>
+
+namespace SolarSystem
+{
+    //
+    // Bump allocator for data that lives until the arena is reset, deallocation does nothing.
+    // Allocations that do not fit go to the upstream resource and are released on reset, which
+    // also grows the block to the most that was allocated since the previous reset.
+    //
+    class FrameArena final : public std::pmr::memory_resource
+    {
+    public:
+        struct Statistics final
+        {
+            size_t capacity = 0;
+            // Bytes allocated since the last reset including alignment padding and overflow
+            size_t used = 0;
+            size_t peak = 0;
+            // Totals since creation
+            size_t overflowCount = 0;
+            size_t overflowBytes = 0;
+            size_t growCount = 0;
+        };
+
+        explicit FrameArena(size_t const capacity, std::pmr::memory_resource* const upstream = std::pmr::new_delete_resource())
+            : upstream(upstream)
+        {
+            Allocate(capacity);
+        }
+
+        FrameArena(FrameArena const&) = delete;
+        auto operator=(FrameArena const&) -> FrameArena& = delete;
+
+        ~FrameArena() override
+        {
+            ReleaseOverflow();
+            upstream->deallocate(block, statistics.capacity, BLOCK_ALIGNMENT);
+        }
+
+        // Invalidates everything allocated from the arena
+        auto Reset() -> void
+        {
+            auto const overflowed = !overflow.empty();
+            ReleaseOverflow();
+
+            if(overflowed)
+            {
+                auto const capacity = (std::max)(statistics.capacity * 2, statistics.used + statistics.used / 4);
+                upstream->deallocate(block, statistics.capacity, BLOCK_ALIGNMENT);
+                Allocate(capacity);
+                statistics.growCount++;
+            }
+
+            offset = 0;
+            statistics.used = 0;
+        }
+
+        auto GetStatistics() const -> Statistics const&
+        {
+            return statistics;
+        }
+
+    private:
+        static constexpr size_t BLOCK_ALIGNMENT = alignof(std::max_align_t);
+
+        struct Overflow final
+        {
+            void* pointer;
+            size_t bytes;
+            size_t alignment;
+        };
+
+        auto do_allocate(size_t const bytes, size_t const alignment) -> void* override
+        {
+            auto const address = reinterpret_cast<uintptr_t>(block) + offset;
+            auto const aligned = (address + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1);
+            auto const end = aligned + bytes - reinterpret_cast<uintptr_t>(block);
+
+            if(end <= statistics.capacity)
+            {
+                statistics.used += end - offset;
+                statistics.peak = (std::max)(statistics.peak, statistics.used);
+                offset = end;
+                return reinterpret_cast<void*>(aligned);
+            }
+
+            auto const memoryTag = MemoryTagScope(MemoryTag::Frame);
+            auto const pointer = upstream->allocate(bytes, alignment);
+            overflow.push_back({ pointer, bytes, alignment });
+
+            statistics.used += bytes;
+            statistics.peak = (std::max)(statistics.peak, statistics.used);
+            statistics.overflowCount++;
+            statistics.overflowBytes += bytes;
+            return pointer;
+        }
+
+        auto do_deallocate(void*, size_t, size_t) -> void override
+        { }
+
+        auto do_is_equal(std::pmr::memory_resource const& other) const noexcept -> bool override
+        {
+            return this == &other;
+        }
+
+        auto Allocate(size_t const capacity) -> void
+        {
+            auto const memoryTag = MemoryTagScope(MemoryTag::Frame);
+            block = upstream->allocate(capacity, BLOCK_ALIGNMENT);
+            statistics.capacity = capacity;
+        }
+
+        auto ReleaseOverflow() -> void
+        {
+            for(auto const& allocation : overflow)
+            {
+                upstream->deallocate(allocation.pointer, allocation.bytes, allocation.alignment);
+            }
+            overflow.clear();
+        }
+
+        std::pmr::memory_resource* upstream;
+        void* block = nullptr;
+        size_t offset = 0;
+        std::vector<Overflow> overflow;
+        Statistics statistics;
+    };
+
+
+    //
+    // Two arenas used on alternating frames. Data allocated during a frame stays valid through the
+    // next one, so work pipelined a frame behind can still read it. Only used from the main thread.
+    //
+    class FrameAllocator final
+    {
+    public:
+        explicit FrameAllocator(size_t const capacityPerFrame = 256 * 1024)
+            : arenas{ FrameArena(capacityPerFrame), FrameArena(capacityPerFrame) }
+        { }
+
+        // Called once at the start of every frame, resets the arena used two frames ago
+        auto BeginFrame() -> void
+        {
+            current ^= 1;
+            arenas[current].Reset();
+        }
+
+        // For std::pmr containers, std::pmr::vector<T>(GetResource())
+        auto GetResource() -> std::pmr::memory_resource*
+        {
+            return &arenas[current];
+        }
+
+        // Uninitialized storage for count objects, nothing is destroyed on reset
+        template<typename T>
+        auto Allocate(size_t const count) -> T*
+        {
+            static_assert(std::is_trivially_destructible_v<T>, "Frame memory is released without running destructors");
+            return static_cast<T*>(arenas[current].allocate(count * sizeof(T), alignof(T)));
+        }
+
+        // Both arenas combined, used is the current frame's
+        auto GetStatistics() const -> FrameArena::Statistics
+        {
+            auto const& a = arenas[current].GetStatistics();
+            auto const& b = arenas[current ^ 1].GetStatistics();
+
+            auto statistics = a;
+            statistics.capacity += b.capacity;
+            statistics.peak = (std::max)(a.peak, b.peak);
+            statistics.overflowCount += b.overflowCount;
+            statistics.overflowBytes += b.overflowBytes;
+            statistics.growCount += b.growCount;
+            return statistics;
+        }
+
+    private:
+        FrameArena arenas[2];
+        size_t current = 0;
+    };
+
+
+    // Shared by everything running on the main thread, the app starts each frame on it
+    auto inline GetFrameAllocator() -> FrameAllocator&
+    {
+        static FrameAllocator frameAllocator;
+        return frameAllocator;
+    }
+}
@@ -2,8 +2,10 @@
 #include "ECS.hpp"
 #include "IUnknownUniquePtr.hpp"
 #include "ResourceHandle.hpp"
+#include "Hash.hpp"
 #include <d3d11_4.h>
 #include <dxgi1_6.h>
+#include <algorithm>
 #include <fstream>
 #include <DDSTextureLoader.h>
 
@@ -43,6 +45,7 @@ namespace SolarSystem
     struct SamplerState final { };
     struct RasterizerState final { };
     struct BlendState final { };
+    struct DepthStencilState final { };
 
     class GraphicsSystem final : public ECSSystem<GraphicsSystem>
     {
@@ -376,7 +379,7 @@ namespace SolarSystem
 
         auto BindIndexBuffer(ResourceHandle<Buffer> const indexBuffer, DXGI_FORMAT const format) -> void
         {
-            if(boundIndexBuffer == indexBuffer)
+            if(boundIndexBuffer == indexBuffer && boundIndexFormat == format)
             {
                 return;
             }
@@ -391,6 +394,7 @@ namespace SolarSystem
             }
 
             boundIndexBuffer = indexBuffer;
+            boundIndexFormat = format;
             deviceContext->IASetIndexBuffer(buffer, format, offset);
         }
 
@@ -398,12 +402,22 @@ namespace SolarSystem
 
         auto CreateVertexShader(std::vector<char> bytecode) -> ResourceHandle<VertexShader>
         {
+            auto const hash = HashBytes(bytecode);
+            auto const existing = vertexShaderHashes.Find(hash, [&](size_t const i) {
+                return vertexShaders[i].bytecode == bytecode;
+            });
+            if(existing)
+            {
+                return ResourceHandle<VertexShader>(*existing);
+            }
+
             auto& rvs = vertexShaders.emplace_back();
             rvs.bytecode = std::move(bytecode);
 
             ThrowIfFailed(device->CreateVertexShader(rvs.bytecode.data(), rvs.bytecode.size(), nullptr, rvs.vertexShader.ResetAndGetAddress()),
                 "Failed to create vertex shader");
 
+            vertexShaderHashes.Insert(hash, vertexShaders.size() - 1);
             return ResourceHandle<VertexShader>(vertexShaders.size() - 1);
         }
 
@@ -466,12 +480,22 @@ namespace SolarSystem
 
         auto CreatePixelShader(std::vector<char> bytecode) -> ResourceHandle<PixelShader>
         {
+            auto const hash = HashBytes(bytecode);
+            auto const existing = pixelShaderHashes.Find(hash, [&](size_t const i) {
+                return pixelShaders[i].bytecode == bytecode;
+            });
+            if(existing)
+            {
+                return ResourceHandle<PixelShader>(*existing);
+            }
+
             auto& rps = pixelShaders.emplace_back();
             rps.bytecode = std::move(bytecode);
 
             ThrowIfFailed(device->CreatePixelShader(rps.bytecode.data(), rps.bytecode.size(), nullptr, rps.pixelShader.ResetAndGetAddress()),
                 "Failed to create vertex shader");
 
+            pixelShaderHashes.Insert(hash, pixelShaders.size() - 1);
             return ResourceHandle<PixelShader>(pixelShaders.size() - 1);
         }
 
@@ -520,11 +544,13 @@ namespace SolarSystem
 
 
 
-        auto CreateInputLayout(std::vector<D3D11_INPUT_ELEMENT_DESC> inputElemets, ResourceHandle<VertexShader> const vertexShader) -> ResourceHandle<InputLayout>
+        // Elements are only copied for a new layout, so they can be in transient memory
+        auto CreateInputLayout(D3D11_INPUT_ELEMENT_DESC const* const inputElemets, size_t const count, ResourceHandle<VertexShader> const vertexShader) -> ResourceHandle<InputLayout>
         {
             for(size_t i = 0; i < inputLayouts.size(); ++i)
             {
-                if(inputLayouts[i].inputElemets == inputElemets)
+                auto const& existing = inputLayouts[i].inputElemets;
+                if(std::equal(existing.begin(), existing.end(), inputElemets, inputElemets + count))
                 {
                     return ResourceHandle<InputLayout>(i);
                 }
@@ -532,7 +558,7 @@ namespace SolarSystem
 
             auto& rvs = GetVertexShader(vertexShader);
             auto& ril = inputLayouts.emplace_back();
-            ril.inputElemets = std::move(inputElemets);
+            ril.inputElemets.assign(inputElemets, inputElemets + count);
 
 
             ThrowIfFailed(device->CreateInputLayout(
@@ -723,6 +749,29 @@ namespace SolarSystem
             }
         }
 
+        auto CreateDepthStencilState(D3D11_DEPTH_STENCIL_DESC const& desc) -> ResourceHandle<DepthStencilState>
+        {
+            auto& rdss = depthStencilStates.emplace_back();
+
+            ThrowIfFailed(device->CreateDepthStencilState(&desc, rdss.depthStencilState.ResetAndGetAddress()),
+                "Failed to create depth stencil state");
+
+            return ResourceHandle<DepthStencilState>(depthStencilStates.size() - 1);
+        }
+
+        auto SetDepthStencilState(ResourceHandle<DepthStencilState> const depthStencilState) -> void
+        {
+            if(!depthStencilState.IsNull())
+            {
+                auto& rdss = GetDepthStencilState(depthStencilState);
+                deviceContext->OMSetDepthStencilState(rdss.depthStencilState.Get(), 0);
+            }
+            else
+            {
+                deviceContext->OMSetDepthStencilState(nullptr, 0);
+            }
+        }
+
         auto BindVertexConstantBuffers(ResourceHandle<Buffer> const (&constantBuffers)[4]) -> void
         {
             auto i = 0;
@@ -800,13 +849,27 @@ namespace SolarSystem
 
         auto LoadTexture2D(wchar_t const* const fileName) -> ResourceHandle<ShaderResouceView>
         {
-            
+            // Textures with identical bytes share one view. The contents are not kept after creation,
+            // so on a hash hit the earlier file is read again and compared byte for byte.
+            auto const data = ReadTextureFile(fileName);
+
+            auto const hash = HashBytes(data);
+            auto const existing = textureHashes.Find(hash, [&](size_t const i) {
+                auto const& loadedTexture = loadedTextures[i];
+                return loadedTexture.byteSize == data.size() && ReadTextureFile(loadedTexture.fileName.c_str()) == data;
+            });
+            if(existing)
+            {
+                return loadedTextures[*existing].shaderResourceView;
+            }
+
             ID3D11Resource* resource;
             ID3D11ShaderResourceView* shaderResourceView;
 
-            ThrowIfFailed(DirectX::CreateDDSTextureFromFile(
+            ThrowIfFailed(DirectX::CreateDDSTextureFromMemory(
                 device.Get(),
-                fileName,
+                reinterpret_cast<uint8_t const*>(data.data()),
+                data.size(),
                 &resource,
                 &shaderResourceView), 
                 "Failed to load texture"
@@ -827,8 +890,11 @@ namespace SolarSystem
             auto& rsrv = shaderResourceViews.emplace_back();
             *rsrv.shaderResourceView.ResetAndGetAddress() = shaderResourceView;
 
+            auto const handle = ResourceHandle<ShaderResouceView>(shaderResourceViews.size() - 1);
+            loadedTextures.push_back({ handle, fileName, data.size() });
+            textureHashes.Insert(hash, loadedTextures.size() - 1);
 
-            return ResourceHandle<ShaderResouceView>(shaderResourceViews.size() - 1);
+            return handle;
         }
 
         auto LoadTextureCustom(wchar_t const* const fileName) -> ResourceHandle<ShaderResouceView>
@@ -933,6 +999,30 @@ namespace SolarSystem
             deviceContext->Draw(vertexCount, 0);
         }
 
+
+        auto DrawInstanced(UINT const vertexCount, UINT const instanceCount, UINT const startInstance = 0) -> void
+        {
+            deviceContext->DrawInstanced(vertexCount, instanceCount, 0, startInstance);
+        }
+
+        auto DrawIndexedInstanced(UINT const indexCount, UINT const instanceCount, UINT const startInstance = 0) -> void
+        {
+            deviceContext->DrawIndexedInstanced(indexCount, instanceCount, 0, 0, startInstance);
+        }
+
+
+        struct ResourceStatistics final
+        {
+            ResourceCount vertexShaders;
+            ResourceCount pixelShaders;
+            ResourceCount textures;
+        };
+
+        auto GetResourceStatistics() const -> ResourceStatistics
+        {
+            return { vertexShaderHashes.GetCount(), pixelShaderHashes.GetCount(), textureHashes.GetCount() };
+        }
+
     private:
 
         static auto ThrowIfFailed(HRESULT const hr, char const* const message) -> void
@@ -951,6 +1041,7 @@ namespace SolarSystem
 
         ResourceHandle<Buffer> boundVertexBuffers[4] = { };
         ResourceHandle<Buffer> boundIndexBuffer;
+        DXGI_FORMAT boundIndexFormat = DXGI_FORMAT_UNKNOWN;
         ResourceHandle<InputLayout> boundInputLayout;
         D3D11_PRIMITIVE_TOPOLOGY boundPrimitiveTopology = D3D11_PRIMITIVE_TOPOLOGY_UNDEFINED;
 
@@ -1002,13 +1093,16 @@ namespace SolarSystem
         }
 
 
+        template<typename T>
+        using GraphicsVector = std::vector<T, TaggedAllocator<T, MemoryTag::Graphics>>;
+
         struct RSwapChain final
         {
             HANDLE waitable = nullptr;
             //ResourceHandle<Texture2D> backBuffer;
             IUnknownUniquePtr<IDXGISwapChain2> swapChain;
         };
-        std::vector<RSwapChain> swapChains;
+        GraphicsVector<RSwapChain> swapChains;
 
         auto GetSwapChain(ResourceHandle<SwapChain> const swapChain) -> RSwapChain&
         {
@@ -1040,7 +1134,7 @@ namespace SolarSystem
 
             }
         };
-        std::vector<RRenderTargetView> renderTargetViews;
+        GraphicsVector<RRenderTargetView> renderTargetViews;
 
         auto GetRenderTargetView(ResourceHandle<RenderTargetView> const renderTargetView) -> RRenderTargetView&
         {
@@ -1053,7 +1147,7 @@ namespace SolarSystem
         {
             IUnknownUniquePtr<ID3D11DepthStencilView> depthStencilView;
         };
-        std::vector<RDepthStencilView> depthStencilViews;
+        GraphicsVector<RDepthStencilView> depthStencilViews;
 
         auto GetDepthStencilView(ResourceHandle<DepthStencilView> const depthStencilView) -> RDepthStencilView&
         {
@@ -1065,7 +1159,7 @@ namespace SolarSystem
         {
             IUnknownUniquePtr<ID3D11Buffer> buffer;
         };
-        std::vector<RBuffer> buffers;
+        GraphicsVector<RBuffer> buffers;
 
         auto GetBuffer(ResourceHandle<Buffer> const buffer) -> RBuffer&
         {
@@ -1080,7 +1174,7 @@ namespace SolarSystem
             std::vector<char> bytecode;
             IUnknownUniquePtr<ID3D11VertexShader> vertexShader;
         };
-        std::vector<RVertexShader> vertexShaders;
+        GraphicsVector<RVertexShader> vertexShaders;
 
         auto GetVertexShader(ResourceHandle<VertexShader> const vertexShader) -> RVertexShader&
         {
@@ -1095,7 +1189,7 @@ namespace SolarSystem
             std::vector<char> bytecode;
             IUnknownUniquePtr<ID3D11PixelShader> pixelShader;
         };
-        std::vector<RPixelShader> pixelShaders;
+        GraphicsVector<RPixelShader> pixelShaders;
 
         auto GetPixelShader(ResourceHandle<PixelShader> const pixelShader) -> RPixelShader&
         {
@@ -1104,13 +1198,41 @@ namespace SolarSystem
         }
 
 
+        ContentHashTable vertexShaderHashes;
+        ContentHashTable pixelShaderHashes;
+
+        struct LoadedTexture final
+        {
+            ResourceHandle<ShaderResouceView> shaderResourceView;
+            std::wstring fileName;
+            size_t byteSize = 0;
+        };
+        std::vector<LoadedTexture> loadedTextures;
+        ContentHashTable textureHashes;
+
+        static auto ReadTextureFile(wchar_t const* const fileName) -> std::vector<char>
+        {
+            auto fin = std::ifstream(fileName, std::ios::in | std::ios::binary | std::ios::ate);
+            if(!fin)
+            {
+                throw std::exception("Failed to open resource");
+            }
+
+            auto data = std::vector<char>(static_cast<size_t>(fin.tellg()));
+            fin.seekg(0, std::ios::beg);
+            fin.read(data.data(), data.size());
+
+            return data;
+        }
+
+
 
         struct RInputLayout final
         {
             std::vector<D3D11_INPUT_ELEMENT_DESC> inputElemets;
             IUnknownUniquePtr<ID3D11InputLayout> inputLayout;
         };
-        std::vector<RInputLayout> inputLayouts;
+        GraphicsVector<RInputLayout> inputLayouts;
 
         auto GetInputLayout(ResourceHandle<InputLayout> inputLayout) -> RInputLayout&
         {
@@ -1144,7 +1266,7 @@ namespace SolarSystem
                 
             }
         }; 
-        std::vector<RShaderResourceView> shaderResourceViews;
+        GraphicsVector<RShaderResourceView> shaderResourceViews;
 
         auto GetShaderResourceView(ResourceHandle<ShaderResouceView> shaderResourceView) -> RShaderResourceView&
         {
@@ -1158,7 +1280,7 @@ namespace SolarSystem
         {
             IUnknownUniquePtr<ID3D11SamplerState> samplerState;
         };
-        std::vector<RSamplerState> samplerStates;
+        GraphicsVector<RSamplerState> samplerStates;
 
         auto GetSamplerState(ResourceHandle<SamplerState> samplerState) -> RSamplerState&
         {
@@ -1172,7 +1294,7 @@ namespace SolarSystem
         {
             IUnknownUniquePtr<ID3D11RasterizerState> rasterizerState;
         };
-        std::vector<RRasterizerState> rasterizerStates;
+        GraphicsVector<RRasterizerState> rasterizerStates;
 
         auto GetRasterizerState(ResourceHandle<RasterizerState> rasterizerState) -> RRasterizerState&
         {
@@ -1185,31 +1307,104 @@ namespace SolarSystem
         {
             IUnknownUniquePtr<ID3D11BlendState> blendState;
         };
-        std::vector<RBlendState> blendStates;
+        GraphicsVector<RBlendState> blendStates;
 
         auto GetBlendState(ResourceHandle<BlendState> const blendState) -> RBlendState&
         {
             assert(blendState.GetValue() < blendStates.size());
             return blendStates[blendState.GetValue()];
         }
+
+
+        struct RDepthStencilState final
+        {
+            IUnknownUniquePtr<ID3D11DepthStencilState> depthStencilState;
+        };
+        GraphicsVector<RDepthStencilState> depthStencilStates;
+
+        auto GetDepthStencilState(ResourceHandle<DepthStencilState> const depthStencilState) -> RDepthStencilState&
+        {
+            assert(depthStencilState.GetValue() < depthStencilStates.size());
+            return depthStencilStates[depthStencilState.GetValue()];
+        }
     };
 
 
+    // Bytes per element of the index formats and the vertex formats meshes use
     auto inline GetDXGIFormatSize(DXGI_FORMAT const format) -> int
     {
         switch(format)
         {
+        case DXGI_FORMAT_R32G32B32A32_FLOAT:
+            return 16;
+        case DXGI_FORMAT_R32G32B32_FLOAT:
+            return 12;
+        case DXGI_FORMAT_R32G32_FLOAT:
+        case DXGI_FORMAT_R16G16B16A16_SNORM:
+            return 8;
         case DXGI_FORMAT_R32_UINT:
+        case DXGI_FORMAT_R32_FLOAT:
+        case DXGI_FORMAT_R16G16_SNORM:
+        case DXGI_FORMAT_R16G16_FLOAT:
             return 4;
         case DXGI_FORMAT_R16_UINT:
+        case DXGI_FORMAT_R8G8_SNORM:
             return 2;
         default:
             return 0;
         }
     }
 
+    // Number of components the input assembler expands a vertex format to, zero for non-float formats
+    auto inline GetDXGIFormatFloatComponentCount(DXGI_FORMAT const format) -> int
+    {
+        switch(format)
+        {
+        case DXGI_FORMAT_R32_FLOAT:
+        case DXGI_FORMAT_R16_FLOAT:
+        case DXGI_FORMAT_R16_SNORM:
+        case DXGI_FORMAT_R16_UNORM:
+            return 1;
+        case DXGI_FORMAT_R32G32_FLOAT:
+        case DXGI_FORMAT_R16G16_FLOAT:
+        case DXGI_FORMAT_R16G16_SNORM:
+        case DXGI_FORMAT_R16G16_UNORM:
+        case DXGI_FORMAT_R8G8_SNORM:
+        case DXGI_FORMAT_R8G8_UNORM:
+            return 2;
+        case DXGI_FORMAT_R32G32B32_FLOAT:
+            return 3;
+        case DXGI_FORMAT_R32G32B32A32_FLOAT:
+        case DXGI_FORMAT_R16G16B16A16_FLOAT:
+        case DXGI_FORMAT_R16G16B16A16_SNORM:
+        case DXGI_FORMAT_R16G16B16A16_UNORM:
+        case DXGI_FORMAT_R8G8B8A8_SNORM:
+        case DXGI_FORMAT_R8G8B8A8_UNORM:
+            return 4;
+        default:
+            return 0;
+        }
+    }
+
+    //
+    // Whether a vertex element can feed a vertex shader input of the reflected format.
+    // Float, half and normalized formats all arrive as floats, extra components are ignored.
+    //
+    auto inline IsInputFormatCompatible(DXGI_FORMAT const elementFormat, DXGI_FORMAT const inputFormat) -> bool
+    {
+        if(elementFormat == inputFormat)
+        {
+            return true;
+        }
+
+        auto const inputComponents = GetDXGIFormatFloatComponentCount(inputFormat);
+        return inputComponents > 0 && GetDXGIFormatFloatComponentCount(elementFormat) >= inputComponents;
+    }
+
     auto LoadBytecode(std::string const& path) -> std::vector<char>
     {
+        auto const memoryTag = MemoryTagScope(MemoryTag::Graphics);
+
         auto fin = std::fstream(path, std::ios::in | std::ios::binary | std::ios::ate);
         if(!fin)
         {
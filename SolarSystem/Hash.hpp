@@ -0,0 +1,129 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <optional>
+
+namespace SolarSystem
+{
+    constexpr uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull;
+    constexpr uint64_t FNV_PRIME = 1099511628211ull;
+    constexpr uint64_t MIX_MULTIPLIER = 0x9E3779B97F4A7C15ull;
+
+    // 64-bit FNV-1a, pass a previous result as the seed to hash several ranges as one
+    auto inline HashBytes(void const* const data, size_t const size, uint64_t const seed = FNV_OFFSET_BASIS) -> uint64_t
+    {
+        auto hash = seed;
+        auto const bytes = static_cast<unsigned char const*>(data);
+
+        for(size_t i = 0; i < size; ++i)
+        {
+            hash ^= bytes[i];
+            hash *= FNV_PRIME;
+        }
+
+        return hash;
+    }
+
+    //
+    // 64-bit multiply-xorshift over 8 byte words. Unrelated to FNV-1a, so together they form a digest
+    // strong enough to recognize content that is no longer around to compare. Seeds chain like HashBytes.
+    //
+    auto inline MixBytes(void const* const data, size_t const size, uint64_t const seed = MIX_MULTIPLIER) -> uint64_t
+    {
+        auto const bytes = static_cast<unsigned char const*>(data);
+        auto hash = seed ^ (size * MIX_MULTIPLIER);
+        auto const mix = [&](uint64_t const word) {
+            hash = (hash ^ word) * MIX_MULTIPLIER;
+            hash ^= hash >> 32;
+        };
+
+        auto i = size_t(0);
+        for(; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t))
+        {
+            auto word = uint64_t(0);
+            std::memcpy(&word, bytes + i, sizeof word);
+            mix(word);
+        }
+        if(i < size)
+        {
+            auto word = uint64_t(0);
+            std::memcpy(&word, bytes + i, size - i);
+            mix(word);
+        }
+
+        hash ^= hash >> 29;
+        hash *= 0xBF58476D1CE4E5B9ull;
+        return hash ^ (hash >> 32);
+    }
+
+    auto inline HashBytes(std::vector<char> const& data, uint64_t const seed = FNV_OFFSET_BASIS) -> uint64_t
+    {
+        return HashBytes(data.data(), data.size(), seed);
+    }
+
+    auto inline HashBytes(std::string const& data, uint64_t const seed = FNV_OFFSET_BASIS) -> uint64_t
+    {
+        return HashBytes(data.data(), data.size(), seed);
+    }
+
+    // Only for types without padding, every byte takes part in the hash
+    template<typename T>
+    auto inline HashValue(T const& value, uint64_t const seed = FNV_OFFSET_BASIS) -> uint64_t
+    {
+        return HashBytes(&value, sizeof value, seed);
+    }
+
+
+    struct ResourceCount final
+    {
+        // Create calls
+        size_t requested = 0;
+        // Resources actually created, the rest returned an existing handle
+        size_t unique = 0;
+    };
+
+
+    //
+    // Maps content hashes to resource indices. Hash collisions are resolved by the caller's
+    // equality check, so two resources are only shared when their content is identical.
+    //
+    class ContentHashTable final
+    {
+    public:
+        template<typename Equal>
+        auto Find(uint64_t const hash, Equal const& equal) -> std::optional<size_t>
+        {
+            count.requested++;
+
+            auto const range = table.equal_range(hash);
+            for(auto it = range.first; it != range.second; ++it)
+            {
+                if(equal(it->second))
+                {
+                    return it->second;
+                }
+            }
+
+            return std::nullopt;
+        }
+
+        auto Insert(uint64_t const hash, size_t const index) -> void
+        {
+            count.unique++;
+            table.emplace(hash, index);
+        }
+
+        auto GetCount() const -> ResourceCount const&
+        {
+            return count;
+        }
+
+    private:
+        std::unordered_multimap<uint64_t, size_t> table;
+        ResourceCount count;
+    };
+}
@@ -0,0 +1,192 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace SolarSystem
+{
+    //
+    // Fixed pool of worker threads running ParallelFor ranges. The calling thread works on its own
+    // range too, so a ParallelFor nested inside another one always makes progress.
+    //
+    class JobSystem final
+    {
+    public:
+        explicit JobSystem(unsigned const workerCount = (std::max)(std::thread::hardware_concurrency(), 2u) - 1)
+        {
+            for(unsigned i = 0; i < workerCount; ++i)
+            {
+                workers.emplace_back([this] { WorkerLoop(); });
+            }
+        }
+
+        JobSystem(JobSystem const&) = delete;
+        auto operator=(JobSystem const&) -> JobSystem& = delete;
+
+        ~JobSystem()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stop = true;
+            }
+            workAvailable.notify_all();
+
+            for(auto& worker : workers)
+            {
+                worker.join();
+            }
+        }
+
+
+        //
+        // Calls function(chunkBegin, chunkEnd) over [begin, end) split into chunks of grainSize elements
+        // and returns once every chunk has run. Chunks run in any order and on any thread, so the
+        // function must only write to the elements of its own chunk. The first exception thrown by
+        // a chunk is rethrown here after the remaining chunks are done.
+        //
+        template<typename Function>
+        auto ParallelFor(size_t const begin, size_t const end, size_t const grainSize, Function const& function) -> void
+        {
+            if(begin >= end)
+            {
+                return;
+            }
+
+            auto const grain = (std::max)(grainSize, size_t(1));
+            auto const chunkCount = (end - begin + grain - 1) / grain;
+
+            if(chunkCount == 1 || workers.empty())
+            {
+                function(begin, end);
+                return;
+            }
+
+            auto const batch = std::make_shared<Batch>();
+            batch->function = [&function](size_t const chunkBegin, size_t const chunkEnd) { function(chunkBegin, chunkEnd); };
+            batch->begin = begin;
+            batch->end = end;
+            batch->grainSize = grain;
+            batch->chunkCount = chunkCount;
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                batches.push_back(batch);
+            }
+            workAvailable.notify_all();
+
+            RunChunks(*batch);
+
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                batchFinished.wait(lock, [&] { return batch->finishedChunks == batch->chunkCount; });
+            }
+
+            if(batch->exception)
+            {
+                std::rethrow_exception(batch->exception);
+            }
+        }
+
+        auto GetWorkerCount() const -> size_t
+        {
+            return workers.size();
+        }
+
+    private:
+        struct Batch final
+        {
+            std::function<void(size_t, size_t)> function;
+            size_t begin = 0;
+            size_t end = 0;
+            size_t grainSize = 0;
+            size_t chunkCount = 0;
+
+            std::atomic<size_t> nextChunk{ 0 };
+            std::atomic<size_t> finishedChunks{ 0 };
+
+            std::mutex exceptionMutex;
+            std::exception_ptr exception;
+        };
+
+        auto RunChunks(Batch& batch) -> void
+        {
+            for(auto chunk = batch.nextChunk++; chunk < batch.chunkCount; chunk = batch.nextChunk++)
+            {
+                auto const chunkBegin = batch.begin + chunk * batch.grainSize;
+                auto const chunkEnd = (std::min)(chunkBegin + batch.grainSize, batch.end);
+
+                try
+                {
+                    batch.function(chunkBegin, chunkEnd);
+                }
+                catch(...)
+                {
+                    std::lock_guard<std::mutex> lock(batch.exceptionMutex);
+                    if(!batch.exception)
+                    {
+                        batch.exception = std::current_exception();
+                    }
+                }
+
+                if(++batch.finishedChunks == batch.chunkCount)
+                {
+                    // Taking the lock orders the notification after the waiting thread's check
+                    std::lock_guard<std::mutex> lock(mutex);
+                    batchFinished.notify_all();
+                }
+            }
+        }
+
+        auto WorkerLoop() -> void
+        {
+            while(true)
+            {
+                std::shared_ptr<Batch> batch;
+
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    workAvailable.wait(lock, [&] {
+                        // Batches with every chunk taken no longer need workers
+                        while(!batches.empty() && batches.front()->nextChunk >= batches.front()->chunkCount)
+                        {
+                            batches.pop_front();
+                        }
+                        return stop || !batches.empty();
+                    });
+
+                    if(batches.empty())
+                    {
+                        return;
+                    }
+
+                    batch = batches.front();
+                }
+
+                RunChunks(*batch);
+            }
+        }
+
+        std::vector<std::thread> workers;
+
+        std::mutex mutex;
+        std::condition_variable workAvailable;
+        std::condition_variable batchFinished;
+        std::deque<std::shared_ptr<Batch>> batches;
+        bool stop = false;
+    };
+
+
+    // Shared pool for work outside of any system, such as procedural mesh generation
+    auto inline GetJobSystem() -> JobSystem&
+    {
+        static JobSystem jobSystem;
+        return jobSystem;
+    }
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include "ResourceHandle.hpp"
+#include "Culling.hpp"
+
+#include <SimpleMath.h>
+#include <vector>
+#include <cmath>
+#include <cfloat>
+
+namespace SolarSystem
+{
+    struct MeshLODLevel final
+    {
+        ResourceHandle<Mesh> mesh;
+        // Largest projected radius in pixels this level is used for
+        float maxScreenRadius = FLT_MAX;
+    };
+
+    struct MeshLOD final
+    {
+        // Ordered from the coarsest to the finest level
+        std::vector<MeshLODLevel> levels;
+
+        // Drawn instead of the coarsest level when the body is smaller than impostorScreenRadius
+        ResourceHandle<Mesh> impostor;
+        float impostorScreenRadius = 0.5f;
+
+        // Fraction of a threshold the radius has to drop below before switching to a coarser level
+        float hysteresis = 0.85f;
+    };
+
+    struct LODStatistics final
+    {
+        size_t triangles = 0;
+        size_t impostors = 0;
+    };
+
+
+    // Screen space radius in pixels of a world space sphere
+    auto inline ProjectedScreenRadius(
+        BoundingSphere const& sphere,
+        DirectX::SimpleMath::Vector3 const& cameraPosition,
+        DirectX::SimpleMath::Matrix const& projection,
+        float const viewportHeight
+    ) -> float
+    {
+        auto const distanceSquared = DirectX::SimpleMath::Vector3::DistanceSquared(sphere.center, cameraPosition);
+        auto const radiusSquared = sphere.radius * sphere.radius;
+
+        // Camera inside the sphere
+        if(distanceSquared <= radiusSquared)
+        {
+            return FLT_MAX;
+        }
+
+        return sphere.radius * projection._22 * 0.5f * viewportHeight / std::sqrt(distanceSquared - radiusSquared);
+    }
+
+    // Longest screen radius at which a sphere with the given number of longitude sides keeps its edges under maxEdgePixels
+    auto inline SphereLODScreenRadius(int const longitudeSides, float const maxEdgePixels) -> float
+    {
+        return longitudeSides * maxEdgePixels / DirectX::XM_2PI;
+    }
+
+    // Returns the index of the chosen level, -1 for the impostor
+    auto inline SelectLODLevel(MeshLOD const& lod, float const screenRadius, int const currentLevel) -> int
+    {
+        auto const threshold = [&](int const level, float const max) {
+            return level < currentLevel ? max * lod.hysteresis : max;
+        };
+
+        if(!lod.impostor.IsNull() && screenRadius <= threshold(-1, lod.impostorScreenRadius))
+        {
+            return -1;
+        }
+
+        for(auto i = 0; i < static_cast<int>(lod.levels.size()) - 1; ++i)
+        {
+            if(screenRadius <= threshold(i, lod.levels[i].maxScreenRadius))
+            {
+                return i;
+            }
+        }
+
+        return static_cast<int>(lod.levels.size()) - 1;
+    }
+}
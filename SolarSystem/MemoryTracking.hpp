@@ -0,0 +1,198 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+namespace SolarSystem
+{
+    enum class MemoryTag : uint8_t
+    {
+        Other,
+        Components,
+        Graphics,
+        Meshes,
+        Scene,
+        Frame,
+        Count
+    };
+
+    auto inline GetMemoryTagName(MemoryTag const tag) -> char const*
+    {
+        switch(tag)
+        {
+        case MemoryTag::Components: return "Components";
+        case MemoryTag::Graphics: return "Graphics";
+        case MemoryTag::Meshes: return "Meshes";
+        case MemoryTag::Scene: return "Scene";
+        case MemoryTag::Frame: return "Frame";
+        default: return "Other";
+        }
+    }
+
+    struct MemoryStatistics final
+    {
+        size_t liveBytes = 0;
+        size_t peakBytes = 0;
+        // Totals since the start of the program
+        size_t allocationCount = 0;
+        size_t allocatedBytes = 0;
+    };
+
+
+    namespace Detail
+    {
+        struct MemoryCounters final
+        {
+            std::atomic<size_t> liveBytes{ 0 };
+            std::atomic<size_t> peakBytes{ 0 };
+            std::atomic<size_t> allocationCount{ 0 };
+            std::atomic<size_t> allocatedBytes{ 0 };
+        };
+
+        // Constant initialized, allocations made before main are counted as well
+        inline MemoryCounters memoryCounters[static_cast<size_t>(MemoryTag::Count)];
+        inline thread_local MemoryTag currentMemoryTag = MemoryTag::Other;
+
+        // Stored right before every tracked allocation
+        struct alignas(16) AllocationHeader final
+        {
+            void* block;
+            size_t size;
+            MemoryTag tag;
+        };
+    }
+
+
+    // Allocations made on this thread while the scope lives are charged to its tag, the innermost scope wins
+    class MemoryTagScope final
+    {
+    public:
+        explicit MemoryTagScope(MemoryTag const tag): previous(Detail::currentMemoryTag)
+        {
+            Detail::currentMemoryTag = tag;
+        }
+
+        ~MemoryTagScope()
+        {
+            Detail::currentMemoryTag = previous;
+        }
+
+        MemoryTagScope(MemoryTagScope const&) = delete;
+        auto operator=(MemoryTagScope const&) -> MemoryTagScope& = delete;
+
+    private:
+        MemoryTag previous;
+    };
+
+    auto inline GetCurrentMemoryTag() -> MemoryTag
+    {
+        return Detail::currentMemoryTag;
+    }
+
+
+    //
+    // Allocation with a header that remembers its size and tag, so freeing it is charged to the
+    // tag it was allocated with. Used by the global operator new in main.cpp and by TaggedAllocator.
+    // Returns null when out of memory.
+    //
+    auto inline TrackedAllocate(size_t const size, size_t const alignment, MemoryTag const tag) -> void*
+    {
+        using Header = Detail::AllocationHeader;
+        auto const extra = alignment > alignof(Header) ? alignment : 0;
+
+        auto const block = std::malloc(size + sizeof(Header) + extra);
+        if(block == nullptr)
+        {
+            return nullptr;
+        }
+
+        auto const address = reinterpret_cast<uintptr_t>(block) + sizeof(Header);
+        auto const pointer = extra > 0 ? (address + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1) : address;
+        new(reinterpret_cast<Header*>(pointer) - 1) Header{ block, size, tag };
+
+        auto& counters = Detail::memoryCounters[static_cast<size_t>(tag)];
+        auto const live = counters.liveBytes.fetch_add(size, std::memory_order_relaxed) + size;
+        auto peak = counters.peakBytes.load(std::memory_order_relaxed);
+        while(live > peak && !counters.peakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+        { }
+        counters.allocationCount.fetch_add(1, std::memory_order_relaxed);
+        counters.allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+
+        return reinterpret_cast<void*>(pointer);
+    }
+
+    auto inline TrackedDeallocate(void* const pointer) -> void
+    {
+        if(pointer == nullptr)
+        {
+            return;
+        }
+
+        // Through the address, the header is outside the object the compiler sees pointer point to
+        auto const header = reinterpret_cast<Detail::AllocationHeader*>(reinterpret_cast<uintptr_t>(pointer) - sizeof(Detail::AllocationHeader));
+        Detail::memoryCounters[static_cast<size_t>(header->tag)].liveBytes.fetch_sub(header->size, std::memory_order_relaxed);
+        std::free(header->block);
+    }
+
+
+    auto inline GetMemoryStatistics(MemoryTag const tag) -> MemoryStatistics
+    {
+        auto const& counters = Detail::memoryCounters[static_cast<size_t>(tag)];
+
+        MemoryStatistics statistics;
+        statistics.liveBytes = counters.liveBytes.load(std::memory_order_relaxed);
+        statistics.peakBytes = counters.peakBytes.load(std::memory_order_relaxed);
+        statistics.allocationCount = counters.allocationCount.load(std::memory_order_relaxed);
+        statistics.allocatedBytes = counters.allocatedBytes.load(std::memory_order_relaxed);
+        return statistics;
+    }
+
+
+    // Standard allocator charging a container to a fixed tag wherever it grows, not final as containers derive from their allocator
+    template<typename T, MemoryTag Tag>
+    class TaggedAllocator
+    {
+    public:
+        using value_type = T;
+
+        template<typename U>
+        struct rebind
+        {
+            using other = TaggedAllocator<U, Tag>;
+        };
+
+        TaggedAllocator() = default;
+
+        template<typename U>
+        TaggedAllocator(TaggedAllocator<U, Tag> const&)
+        { }
+
+        auto allocate(size_t const count) -> T*
+        {
+            if(auto const pointer = TrackedAllocate(count * sizeof(T), alignof(T), Tag))
+            {
+                return static_cast<T*>(pointer);
+            }
+            throw std::bad_alloc();
+        }
+
+        auto deallocate(T* const pointer, size_t) -> void
+        {
+            TrackedDeallocate(pointer);
+        }
+
+        template<typename U>
+        auto operator==(TaggedAllocator<U, Tag> const&) const -> bool
+        {
+            return true;
+        }
+
+        template<typename U>
+        auto operator!=(TaggedAllocator<U, Tag> const&) const -> bool
+        {
+            return false;
+        }
+    };
+}
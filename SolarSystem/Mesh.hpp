@@ -3,6 +3,20 @@
 #include <d3d11.h>
 #include <SimpleMath.h>
 #include <string>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+#include <unordered_map>
+
+#include "ByteBuffer.hpp"
+#include "Hash.hpp"
+#include "JobSystem.hpp"
+#include "MeshOptimizer.hpp"
+#include "VertexPacking.hpp"
 
 
 namespace SolarSystem
@@ -12,6 +26,7 @@ namespace SolarSystem
         std::string semanticName;
         DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
         int offset = 0;
+        int semanticIndex = 0;
     };
 
     struct VertexBuffer final
@@ -19,14 +34,16 @@ namespace SolarSystem
         std::vector<VertexElement> vertexElements;
         int vertexByteSize = 0;
         int vertexCount = 0;
-        std::vector<char> data;
+        ByteBuffer data;
+        // Non-zero for per-instance data, the renderer supplies these buffers at draw time
+        int instanceStepRate = 0;
     };
 
     struct IndexBuffer final
     {
         DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
         int indexCount = 0;
-        std::vector<char> data;
+        ByteBuffer data;
     };
 
 
@@ -35,11 +52,697 @@ namespace SolarSystem
         std::vector<VertexBuffer> vertexBuffers;
         IndexBuffer indexBuffer;
         D3D11_PRIMITIVE_TOPOLOGY topology = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+
+        // SNORM positions are stored as (position - positionOffset) / positionScale,
+        // the renderer folds the inverse into the world matrix
+        float positionScale = 1.0f;
+        DirectX::SimpleMath::Vector3 positionOffset = DirectX::SimpleMath::Vector3::Zero;
+
+        // Set by OptimizeMesh, which then leaves the mesh unchanged, so cached meshes keep borrowing their data
+        bool optimized = false;
+    };
+
+
+    // Reads one element of one vertex as the vertex shader would see it, missing components are zero
+    auto inline ReadVertexElement(VertexBuffer const& vertexBuffer, VertexElement const& vertexElement, int const vertex)
+        -> DirectX::SimpleMath::Vector4
+    {
+        auto const source = vertexBuffer.data.data() + vertex * vertexBuffer.vertexByteSize + vertexElement.offset;
+        float values[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+        auto const read = [&](auto const unpack, auto const sample, int const count) {
+            for(auto i = 0; i < count; ++i)
+            {
+                auto value = sample;
+                std::memcpy(&value, source + i * sizeof value, sizeof value);
+                values[i] = unpack(value);
+            }
+        };
+
+        auto const identity = [](float const value) { return value; };
+
+        switch(vertexElement.format)
+        {
+        case DXGI_FORMAT_R32G32B32A32_FLOAT:
+            read(identity, 0.0f, 4);
+            break;
+        case DXGI_FORMAT_R32G32B32_FLOAT:
+            read(identity, 0.0f, 3);
+            break;
+        case DXGI_FORMAT_R32G32_FLOAT:
+            read(identity, 0.0f, 2);
+            break;
+        case DXGI_FORMAT_R16G16B16A16_SNORM:
+            read(VertexPacking::UnpackSnorm16, int16_t(), 4);
+            break;
+        case DXGI_FORMAT_R16G16_SNORM:
+            read(VertexPacking::UnpackSnorm16, int16_t(), 2);
+            break;
+        case DXGI_FORMAT_R8G8_SNORM:
+            read(VertexPacking::UnpackSnorm8, int8_t(), 2);
+            break;
+        case DXGI_FORMAT_R16G16_FLOAT:
+            read(VertexPacking::UnpackHalf, uint16_t(), 2);
+            break;
+        default:
+            throw std::exception("Unsupported vertex element format");
+        }
+
+        return { values[0], values[1], values[2], values[3] };
+    }
+
+
+    // Layout and data of a mesh through hashBytes(data, size, seed), which chains like HashBytes
+    template<typename HashRange>
+    auto inline HashMeshWith(Mesh const& mesh, uint64_t const seed, HashRange const& hashBytes) -> uint64_t
+    {
+        auto const hashValue = [&](auto const& value, uint64_t const hash) {
+            return hashBytes(&value, sizeof value, hash);
+        };
+
+        auto hash = hashValue(mesh.topology, seed);
+        hash = hashValue(mesh.positionScale, hash);
+        hash = hashValue(mesh.positionOffset, hash);
+
+        for(auto const& vertexBuffer : mesh.vertexBuffers)
+        {
+            for(auto const& vertexElement : vertexBuffer.vertexElements)
+            {
+                hash = hashBytes(vertexElement.semanticName.data(), vertexElement.semanticName.size(), hash);
+                hash = hashValue(vertexElement.format, hash);
+                hash = hashValue(vertexElement.offset, hash);
+                hash = hashValue(vertexElement.semanticIndex, hash);
+            }
+
+            hash = hashValue(vertexBuffer.instanceStepRate, hash);
+            hash = hashValue(vertexBuffer.vertexByteSize, hash);
+            hash = hashValue(vertexBuffer.vertexCount, hash);
+            hash = hashBytes(vertexBuffer.data.data(), vertexBuffer.data.size(), hash);
+        }
+
+        hash = hashValue(mesh.indexBuffer.format, hash);
+        hash = hashValue(mesh.indexBuffer.indexCount, hash);
+        return hashBytes(mesh.indexBuffer.data.data(), mesh.indexBuffer.data.size(), hash);
+    }
+
+    auto inline HashMesh(Mesh const& mesh) -> uint64_t
+    {
+        return HashMeshWith(mesh, FNV_OFFSET_BASIS, [](void const* const data, size_t const size, uint64_t const seed) {
+            return HashBytes(data, size, seed);
+        });
+    }
+
+    //
+    // Identifies a mesh's content after its data was released: HashMesh, an independent hash of the
+    // same layout and data, and the data sizes. Equal digests are taken as equal meshes.
+    //
+    struct MeshDigest final
+    {
+        uint64_t hash = 0;
+        uint64_t check = 0;
+        size_t vertexBytes = 0;
+        size_t indexBytes = 0;
+    };
+
+    auto inline operator==(MeshDigest const& l, MeshDigest const& r) -> bool
+    {
+        return l.hash == r.hash && l.check == r.check && l.vertexBytes == r.vertexBytes && l.indexBytes == r.indexBytes;
+    }
+
+    auto inline DigestMesh(Mesh const& mesh) -> MeshDigest
+    {
+        auto digest = MeshDigest();
+        digest.hash = HashMesh(mesh);
+        digest.check = HashMeshWith(mesh, MIX_MULTIPLIER, [](void const* const data, size_t const size, uint64_t const seed) {
+            return MixBytes(data, size, seed);
+        });
+
+        for(auto const& vertexBuffer : mesh.vertexBuffers)
+        {
+            digest.vertexBytes += vertexBuffer.data.size();
+        }
+        digest.indexBytes = mesh.indexBuffer.data.size();
+        return digest;
+    }
+
+    // Same elements, stride and counts, the data is not compared
+    auto inline IsSameVertexLayout(VertexBuffer const& l, VertexBuffer const& r) -> bool
+    {
+        if(l.vertexByteSize != r.vertexByteSize || l.vertexCount != r.vertexCount || l.instanceStepRate != r.instanceStepRate
+            || l.vertexElements.size() != r.vertexElements.size())
+        {
+            return false;
+        }
+
+        for(size_t j = 0; j < l.vertexElements.size(); ++j)
+        {
+            if(l.vertexElements[j].semanticName != r.vertexElements[j].semanticName
+                || l.vertexElements[j].format != r.vertexElements[j].format
+                || l.vertexElements[j].offset != r.vertexElements[j].offset
+                || l.vertexElements[j].semanticIndex != r.vertexElements[j].semanticIndex)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    auto inline IsSameMesh(Mesh const& left, Mesh const& right) -> bool
+    {
+        if(left.topology != right.topology
+            || left.positionScale != right.positionScale
+            || left.positionOffset != right.positionOffset
+            || left.vertexBuffers.size() != right.vertexBuffers.size()
+            || left.indexBuffer.format != right.indexBuffer.format
+            || left.indexBuffer.indexCount != right.indexBuffer.indexCount
+            || left.indexBuffer.data != right.indexBuffer.data)
+        {
+            return false;
+        }
+
+        for(size_t i = 0; i < left.vertexBuffers.size(); ++i)
+        {
+            if(!IsSameVertexLayout(left.vertexBuffers[i], right.vertexBuffers[i]) || left.vertexBuffers[i].data != right.vertexBuffers[i].data)
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+
+    struct BoundingSphere final
+    {
+        DirectX::SimpleMath::Vector3 center = DirectX::SimpleMath::Vector3::Zero;
+        float radius = 0.0f;
+    };
+
+    auto inline ComputeBoundingSphere(Mesh const& mesh) -> BoundingSphere
+    {
+        for(auto const& vertexBuffer : mesh.vertexBuffers)
+        {
+            for(auto const& vertexElement : vertexBuffer.vertexElements)
+            {
+                if(vertexElement.semanticName != "POSITION"
+                    || (vertexElement.format != DXGI_FORMAT_R32G32B32_FLOAT && vertexElement.format != DXGI_FORMAT_R16G16B16A16_SNORM))
+                {
+                    continue;
+                }
+
+                auto const position = [&](int const i) {
+                    auto const p = ReadVertexElement(vertexBuffer, vertexElement, i);
+                    return DirectX::SimpleMath::Vector3(p.x, p.y, p.z) * mesh.positionScale + mesh.positionOffset;
+                };
+
+                if(vertexBuffer.vertexCount == 0)
+                {
+                    return { };
+                }
+
+                auto min = position(0);
+                auto max = min;
+                for(auto i = 1; i < vertexBuffer.vertexCount; ++i)
+                {
+                    auto const p = position(i);
+                    min = DirectX::SimpleMath::Vector3::Min(min, p);
+                    max = DirectX::SimpleMath::Vector3::Max(max, p);
+                }
+
+                BoundingSphere sphere;
+                sphere.center = (min + max) * 0.5f;
+                for(auto i = 0; i < vertexBuffer.vertexCount; ++i)
+                {
+                    sphere.radius = (std::max)(sphere.radius, DirectX::SimpleMath::Vector3::Distance(sphere.center, position(i)));
+                }
+
+                return sphere;
+            }
+        }
+
+        return { };
+    }
+
+
+    //
+    // Picks 16-bit indices when every vertex is addressable with them, from indices of either width.
+    // The strip cut value of the source width maps to the cut value of the destination width,
+    // 0xFFFF is never a vertex index when 16 bits are chosen.
+    //
+    template<typename Index>
+    auto inline CreateIndexBuffer(std::vector<Index> const& indices, size_t const vertexCount) -> IndexBuffer
+    {
+        static_assert(std::is_same_v<Index, uint16_t> || std::is_same_v<Index, uint32_t>, "Index must be uint16_t or uint32_t");
+
+        auto const write = [&](auto destinationType) {
+            using Destination = decltype(destinationType);
+
+            IndexBuffer ib;
+            ib.format = std::is_same_v<Destination, uint16_t> ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+            ib.indexCount = static_cast<int>(indices.size());
+            ib.data.resize(indices.size() * sizeof(Destination));
+
+            auto const data = reinterpret_cast<Destination*>(ib.data.data());
+            for(size_t i = 0; i < indices.size(); ++i)
+            {
+                data[i] = indices[i] == (std::numeric_limits<Index>::max)()
+                    ? (std::numeric_limits<Destination>::max)()
+                    : static_cast<Destination>(indices[i]);
+            }
+
+            return ib;
+        };
+
+        if(vertexCount <= (std::numeric_limits<uint16_t>::max)())
+        {
+            return write(uint16_t());
+        }
+
+        return write(uint32_t());
+    }
+
+
+    auto inline ReadIndices(IndexBuffer const& indexBuffer) -> std::vector<uint32_t>
+    {
+        std::vector<uint32_t> indices(indexBuffer.indexCount);
+
+        if(indexBuffer.format == DXGI_FORMAT_R16_UINT)
+        {
+            auto const data = reinterpret_cast<uint16_t const*>(indexBuffer.data.data());
+            std::copy(data, data + indices.size(), indices.begin());
+        }
+        else
+        {
+            std::memcpy(indices.data(), indexBuffer.data.data(), indices.size() * sizeof(uint32_t));
+        }
+
+        return indices;
+    }
+
+
+    // Converts 32-bit indices in place when the vertex count allows 16 bits
+    auto inline CompactIndexBuffer(IndexBuffer& indexBuffer, size_t const vertexCount) -> void
+    {
+        if(indexBuffer.format != DXGI_FORMAT_R32_UINT || vertexCount > (std::numeric_limits<uint16_t>::max)())
+        {
+            return;
+        }
+
+        indexBuffer = CreateIndexBuffer(ReadIndices(indexBuffer), vertexCount);
+    }
+
+
+    struct MeshOptimizationStatistics final
+    {
+        MeshOptimizer::VertexCacheStatistics before;
+        MeshOptimizer::VertexCacheStatistics after;
     };
 
+    //
+    // Reorders an indexed triangle list for the post-transform vertex cache, then for overdraw,
+    // and finally renumbers the vertices of every per-vertex buffer in order of first use.
+    // Meshes of other topologies or without an index buffer are left unchanged.
+    // vertexRemap receives the new index of every old vertex, it stays empty when vertices keep their order.
+    //
+    auto inline OptimizeMesh(Mesh& mesh, std::vector<uint32_t>* const vertexRemap = nullptr) -> MeshOptimizationStatistics
+    {
+        MeshOptimizationStatistics statistics;
+
+        if(mesh.optimized)
+        {
+            return statistics;
+        }
+        mesh.optimized = true;
+
+        if(mesh.topology != D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST || mesh.indexBuffer.indexCount == 0 || mesh.vertexBuffers.empty())
+        {
+            return statistics;
+        }
+
+        auto const vertexCount = static_cast<size_t>(mesh.vertexBuffers[0].vertexCount);
+        auto indices = ReadIndices(mesh.indexBuffer);
+        statistics.before = MeshOptimizer::AnalyzeVertexCache(indices, vertexCount);
+
+        MeshOptimizer::OptimizeVertexCache(indices, vertexCount);
+
+        for(auto const& vertexBuffer : mesh.vertexBuffers)
+        {
+            if(vertexBuffer.instanceStepRate > 0)
+            {
+                continue;
+            }
+
+            for(auto const& vertexElement : vertexBuffer.vertexElements)
+            {
+                if(vertexElement.semanticName == "POSITION" && vertexElement.format == DXGI_FORMAT_R32G32B32_FLOAT)
+                {
+                    MeshOptimizer::OptimizeOverdraw(
+                        indices,
+                        reinterpret_cast<float const*>(vertexBuffer.data.data() + vertexElement.offset),
+                        vertexBuffer.vertexByteSize,
+                        vertexCount
+                    );
+                }
+            }
+        }
+
+        auto const remap = MeshOptimizer::OptimizeVertexFetch(indices, vertexCount);
+        // Per-instance buffers are not indexed by the index buffer and keep their order
+        for(auto& vertexBuffer : mesh.vertexBuffers)
+        {
+            if(vertexBuffer.instanceStepRate == 0)
+            {
+                MeshOptimizer::RemapVertices(vertexBuffer.data, vertexBuffer.vertexByteSize, remap);
+            }
+        }
+
+        mesh.indexBuffer = CreateIndexBuffer(indices, vertexCount);
+        statistics.after = MeshOptimizer::AnalyzeVertexCache(indices, vertexCount);
+
+        if(vertexRemap != nullptr)
+        {
+            *vertexRemap = remap;
+        }
+
+        return statistics;
+    }
+
+    //
+    // Whether optimized is what OptimizeMesh and CompactIndexBuffer made of source, given the vertex remap
+    // OptimizeMesh reported. Vertices are compared through the remap and triangles regardless of their order,
+    // so a duplicate of an optimized mesh is recognized without optimizing it again.
+    //
+    auto inline IsSameOptimizedMesh(Mesh const& source, Mesh const& optimized, std::vector<uint32_t> const& vertexRemap) -> bool
+    {
+        if(source.topology != optimized.topology
+            || source.positionScale != optimized.positionScale
+            || source.positionOffset != optimized.positionOffset
+            || source.vertexBuffers.size() != optimized.vertexBuffers.size()
+            || source.indexBuffer.indexCount != optimized.indexBuffer.indexCount)
+        {
+            return false;
+        }
+
+        for(size_t i = 0; i < source.vertexBuffers.size(); ++i)
+        {
+            auto const& s = source.vertexBuffers[i];
+            auto const& o = optimized.vertexBuffers[i];
+
+            if(!IsSameVertexLayout(s, o) || s.data.size() != o.data.size())
+            {
+                return false;
+            }
+
+            if(vertexRemap.empty() || s.data.size() == 0 || s.instanceStepRate > 0)
+            {
+                if(s.data != o.data)
+                {
+                    return false;
+                }
+                continue;
+            }
+
+            auto const stride = static_cast<size_t>(s.vertexByteSize);
+            if(s.data.size() < vertexRemap.size() * stride)
+            {
+                return false;
+            }
+            for(size_t v = 0; v < vertexRemap.size(); ++v)
+            {
+                if(std::memcmp(s.data.data() + v * stride, o.data.data() + vertexRemap[v] * stride, stride) != 0)
+                {
+                    return false;
+                }
+            }
+        }
+
+        auto sourceIndices = ReadIndices(source.indexBuffer);
+        auto optimizedIndices = ReadIndices(optimized.indexBuffer);
+        if(!vertexRemap.empty())
+        {
+            for(auto& index : sourceIndices)
+            {
+                index = index < vertexRemap.size() ? vertexRemap[index] : (std::numeric_limits<uint32_t>::max)();
+            }
+        }
+
+        if(sourceIndices == optimizedIndices)
+        {
+            return true;
+        }
+        if(source.topology != D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST)
+        {
+            return false;
+        }
+
+        // Triangles rotated to start at their smallest index keep their winding, then sorted
+        auto const sortTriangles = [](std::vector<uint32_t>& indices) {
+            using Triangle = std::array<uint32_t, 3>;
+            auto triangles = std::vector<Triangle>(indices.size() / 3);
+            for(size_t t = 0; t < triangles.size(); ++t)
+            {
+                auto& triangle = triangles[t];
+                triangle = { indices[t * 3], indices[t * 3 + 1], indices[t * 3 + 2] };
+                std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+            }
+            std::sort(triangles.begin(), triangles.end());
+            return triangles;
+        };
+
+        return sortTriangles(sourceIndices) == sortTriangles(optimizedIndices);
+    }
+
+
+    enum class NormalPacking
+    {
+        // Octahedral normals in R16G16_SNORM
+        Snorm16,
+        // Octahedral normals in R8G8_SNORM, the stride is still padded to four bytes
+        Snorm8
+    };
+
+    //
+    // Converts a mesh with float POSITION, NORMAL and UV elements into a single packed vertex buffer:
+    // R16G16B16A16_SNORM positions normalized to the mesh bounds, R16G16_FLOAT UVs and octahedral normals.
+    // Vertex order and indices are unchanged.
+    //
+    auto inline PackMesh(Mesh const& mesh, NormalPacking const normalPacking = NormalPacking::Snorm16) -> Mesh
+    {
+        if(mesh.vertexBuffers.size() != 1)
+        {
+            throw std::exception("Only meshes with a single vertex buffer can be packed");
+        }
+
+        auto const& source = mesh.vertexBuffers[0];
+
+        VertexElement const* position = nullptr;
+        VertexElement const* normal = nullptr;
+        VertexElement const* uv = nullptr;
+        for(auto const& vertexElement : source.vertexElements)
+        {
+            if(vertexElement.semanticName == "POSITION" && vertexElement.format == DXGI_FORMAT_R32G32B32_FLOAT)
+            {
+                position = &vertexElement;
+            }
+            else if(vertexElement.semanticName == "NORMAL" && vertexElement.format == DXGI_FORMAT_R32G32B32_FLOAT)
+            {
+                normal = &vertexElement;
+            }
+            else if(vertexElement.semanticName == "UV" && vertexElement.format == DXGI_FORMAT_R32G32_FLOAT)
+            {
+                uv = &vertexElement;
+            }
+            else
+            {
+                throw std::exception("Vertex element cannot be packed");
+            }
+        }
+
+        if(position == nullptr)
+        {
+            throw std::exception("Mesh has no float positions to pack");
+        }
+
+        auto const readPosition = [&](int const i) {
+            auto const p = ReadVertexElement(source, *position, i);
+            return DirectX::SimpleMath::Vector3(p.x, p.y, p.z);
+        };
+
+        Mesh packed;
+        packed.indexBuffer = mesh.indexBuffer;
+        packed.topology = mesh.topology;
+
+        // Uniform scale so the dequantization does not skew normals
+        if(source.vertexCount > 0)
+        {
+            auto min = readPosition(0);
+            auto max = min;
+            for(auto i = 1; i < source.vertexCount; ++i)
+            {
+                min = DirectX::SimpleMath::Vector3::Min(min, readPosition(i));
+                max = DirectX::SimpleMath::Vector3::Max(max, readPosition(i));
+            }
+
+            auto const extent = (max - min) * 0.5f;
+            packed.positionOffset = (min + max) * 0.5f;
+            packed.positionScale = (std::max)({ extent.x, extent.y, extent.z });
+            if(packed.positionScale <= 0.0f)
+            {
+                packed.positionScale = 1.0f;
+            }
+        }
+
+        auto& vb = packed.vertexBuffers.emplace_back();
+        vb.vertexCount = source.vertexCount;
+        vb.vertexElements.push_back({ "POSITION", DXGI_FORMAT_R16G16B16A16_SNORM, 0 });
+        auto offset = 8;
+
+        if(uv != nullptr)
+        {
+            vb.vertexElements.push_back({ "UV", DXGI_FORMAT_R16G16_FLOAT, offset });
+            offset += 4;
+        }
+
+        if(normal != nullptr)
+        {
+            if(normalPacking == NormalPacking::Snorm16)
+            {
+                vb.vertexElements.push_back({ "NORMAL", DXGI_FORMAT_R16G16_SNORM, offset });
+                offset += 4;
+            }
+            else
+            {
+                vb.vertexElements.push_back({ "NORMAL", DXGI_FORMAT_R8G8_SNORM, offset });
+                offset += 2;
+            }
+        }
+
+        vb.vertexByteSize = (offset + 3) & ~3;
+        vb.data.resize(static_cast<size_t>(vb.vertexByteSize) * vb.vertexCount);
+
+        for(auto i = 0; i < vb.vertexCount; ++i)
+        {
+            auto const destination = vb.data.data() + i * vb.vertexByteSize;
+
+            auto const p = (readPosition(i) - packed.positionOffset) / packed.positionScale;
+            int16_t const packedPosition[4] = {
+                VertexPacking::PackSnorm16(p.x),
+                VertexPacking::PackSnorm16(p.y),
+                VertexPacking::PackSnorm16(p.z),
+                VertexPacking::PackSnorm16(1.0f)
+            };
+            std::memcpy(destination, packedPosition, sizeof packedPosition);
+
+            for(auto const& vertexElement : vb.vertexElements)
+            {
+                if(vertexElement.semanticName == "UV")
+                {
+                    auto const u = ReadVertexElement(source, *uv, i);
+                    uint16_t const packedUV[2] = { VertexPacking::PackHalf(u.x), VertexPacking::PackHalf(u.y) };
+                    std::memcpy(destination + vertexElement.offset, packedUV, sizeof packedUV);
+                }
+                else if(vertexElement.semanticName == "NORMAL")
+                {
+                    auto const n = ReadVertexElement(source, *normal, i);
+                    auto const encoded = VertexPacking::EncodeOctahedral({ n.x, n.y, n.z });
+
+                    if(vertexElement.format == DXGI_FORMAT_R16G16_SNORM)
+                    {
+                        int16_t const packedNormal[2] = { VertexPacking::PackSnorm16(encoded.x), VertexPacking::PackSnorm16(encoded.y) };
+                        std::memcpy(destination + vertexElement.offset, packedNormal, sizeof packedNormal);
+                    }
+                    else
+                    {
+                        int8_t const packedNormal[2] = { VertexPacking::PackSnorm8(encoded.x), VertexPacking::PackSnorm8(encoded.y) };
+                        std::memcpy(destination + vertexElement.offset, packedNormal, sizeof packedNormal);
+                    }
+                }
+            }
+        }
+
+        return packed;
+    }
+
+
+    struct VertexPackingError final
+    {
+        float maxPositionError = 0.0f;
+        // Radians
+        float maxNormalError = 0.0f;
+        float maxUVError = 0.0f;
+    };
+
+    // Decodes a mesh returned by PackMesh and compares it against the original vertex by vertex
+    auto inline MeasurePackingError(Mesh const& original, Mesh const& packed) -> VertexPackingError
+    {
+        VertexPackingError error;
+
+        auto const& source = original.vertexBuffers[0];
+        auto const& destination = packed.vertexBuffers[0];
+
+        auto const find = [](VertexBuffer const& vertexBuffer, char const* const semanticName) -> VertexElement const* {
+            for(auto const& vertexElement : vertexBuffer.vertexElements)
+            {
+                if(vertexElement.semanticName == semanticName)
+                {
+                    return &vertexElement;
+                }
+            }
+            return nullptr;
+        };
+
+        auto const sourcePosition = find(source, "POSITION");
+        auto const sourceNormal = find(source, "NORMAL");
+        auto const sourceUV = find(source, "UV");
+        auto const packedPosition = find(destination, "POSITION");
+        auto const packedNormal = find(destination, "NORMAL");
+        auto const packedUV = find(destination, "UV");
+
+        for(auto i = 0; i < source.vertexCount; ++i)
+        {
+            auto const a = ReadVertexElement(source, *sourcePosition, i);
+            auto const b = ReadVertexElement(destination, *packedPosition, i);
+            auto const decoded = DirectX::SimpleMath::Vector3(b.x, b.y, b.z) * packed.positionScale + packed.positionOffset;
+            error.maxPositionError = (std::max)(error.maxPositionError,
+                DirectX::SimpleMath::Vector3::Distance(DirectX::SimpleMath::Vector3(a.x, a.y, a.z), decoded));
+
+            if(sourceNormal != nullptr && packedNormal != nullptr)
+            {
+                auto n = ReadVertexElement(source, *sourceNormal, i);
+                auto expected = DirectX::SimpleMath::Vector3(n.x, n.y, n.z);
+                expected.Normalize();
+
+                auto const e = ReadVertexElement(destination, *packedNormal, i);
+                auto const actual = VertexPacking::DecodeOctahedral({ e.x, e.y });
+
+                // acos of a float dot product cannot resolve angles below about 3e-4 radians
+                error.maxNormalError = (std::max)(error.maxNormalError, std::atan2(expected.Cross(actual).Length(), expected.Dot(actual)));
+            }
+
+            if(sourceUV != nullptr && packedUV != nullptr)
+            {
+                auto const u = ReadVertexElement(source, *sourceUV, i);
+                auto const v = ReadVertexElement(destination, *packedUV, i);
+                error.maxUVError = (std::max)({ error.maxUVError, std::abs(u.x - v.x), std::abs(u.y - v.y) });
+            }
+        }
+
+        return error;
+    }
+
 
     namespace Procedural
     {
+        // Vertices or indices a generator job should produce at least, smaller meshes are generated on the calling thread.
+        // Generators split their work across the job system they are given, the output does not depend on it.
+        constexpr size_t GENERATOR_GRAIN_SIZE = 4096;
+
+        // Rows or segments per job so a job covers about GENERATOR_GRAIN_SIZE elements
+        auto inline GeneratorGrain(size_t const elementsPerItem) -> size_t
+        {
+            return (std::max)(GENERATOR_GRAIN_SIZE / (std::max)(elementsPerItem, size_t(1)), size_t(1));
+        }
 
         struct PNUVertex final
         {
@@ -48,7 +751,7 @@ namespace SolarSystem
             DirectX::SimpleMath::Vector2 uv;
         };
 
-        auto inline CreateSphere(int const longitudeSides, int const latitudeSides) -> Mesh
+        auto inline CreateSphere(int const longitudeSides, int const latitudeSides, JobSystem& jobSystem = GetJobSystem()) -> Mesh
         {
             auto vertices = std::vector<PNUVertex>((longitudeSides + 1) * (latitudeSides - 1) + longitudeSides * 2);
             auto indices = std::vector<uint32_t>(longitudeSides * 6 * (latitudeSides - 1));
@@ -71,26 +774,42 @@ namespace SolarSystem
                 );
             }
 
-            // Middle vertices
-            for(auto i = 1; i < latitudeSides; i++)
+            // Middle vertices, trig is tabulated per row and column with the same angles as a per vertex evaluation
+            auto sinPhi = std::vector<float>(longitudeSides + 1);
+            auto cosPhi = std::vector<float>(longitudeSides + 1);
+            for(auto j = 0; j < longitudeSides + 1; j++)
             {
-                auto const theta = DirectX::XM_PI / latitudeSides * i;
-                for(auto j = 0; j < longitudeSides + 1; j++)
+                auto const phi = 2.0f * DirectX::XM_PI / longitudeSides * j;
+                sinPhi[j] = std::sin(phi);
+                cosPhi[j] = std::cos(phi);
+            }
+
+            auto const middleOffset = nextVertex;
+            jobSystem.ParallelFor(1, latitudeSides, GeneratorGrain(longitudeSides + 1), [&](size_t const rowBegin, size_t const rowEnd) {
+                for(auto i = static_cast<int>(rowBegin); i < static_cast<int>(rowEnd); i++)
                 {
-                    auto const phi = 2.0f * DirectX::XM_PI / longitudeSides * j;
-                    auto& vertex = vertices[nextVertex++];
-                    vertex.position = DirectX::SimpleMath::Vector3(
-                        std::sin(theta) * std::cos(phi),
-                        std::cos(theta),
-                        std::sin(theta) * std::sin(phi)
-                    );
-                    vertex.normal = vertex.position;
-                    vertex.uv = DirectX::SimpleMath::Vector2(
-                        deltaU * j,
-                        deltaV * i
-                    );
+                    auto const theta = DirectX::XM_PI / latitudeSides * i;
+                    auto const sinTheta = std::sin(theta);
+                    auto const cosTheta = std::cos(theta);
+
+                    auto row = middleOffset + static_cast<size_t>(i - 1) * (longitudeSides + 1);
+                    for(auto j = 0; j < longitudeSides + 1; j++)
+                    {
+                        auto& vertex = vertices[row++];
+                        vertex.position = DirectX::SimpleMath::Vector3(
+                            sinTheta * cosPhi[j],
+                            cosTheta,
+                            sinTheta * sinPhi[j]
+                        );
+                        vertex.normal = vertex.position;
+                        vertex.uv = DirectX::SimpleMath::Vector2(
+                            deltaU * j,
+                            deltaV * i
+                        );
+                    }
                 }
-            }
+            });
+            nextVertex += static_cast<size_t>(latitudeSides - 1) * (longitudeSides + 1);
 
             // Bottom vertices
             for(auto i = 0; i < longitudeSides; ++i)
@@ -116,19 +835,24 @@ namespace SolarSystem
 
             //Middle
             auto offset = longitudeSides;
-            for(auto i = 0; i < latitudeSides - 2; i++)
-            {
-                for(auto j = 0; j < longitudeSides; j++)
+            auto const middleIndexOffset = nextIndex;
+            jobSystem.ParallelFor(0, (std::max)(latitudeSides - 2, 0), GeneratorGrain(longitudeSides * 6), [&](size_t const rowBegin, size_t const rowEnd) {
+                for(auto i = static_cast<int>(rowBegin); i < static_cast<int>(rowEnd); i++)
                 {
-                    indices[nextIndex++] = offset + (longitudeSides + 1) * i + j;
-                    indices[nextIndex++] = offset + (longitudeSides + 1) * i + j + 1;
-                    indices[nextIndex++] = offset + (longitudeSides + 1) * (i + 1) + j;
-
-                    indices[nextIndex++] = offset + (longitudeSides + 1) * i + j + 1;
-                    indices[nextIndex++] = offset + (longitudeSides + 1) * (i + 1) + j + 1;
-                    indices[nextIndex++] = offset + (longitudeSides + 1) * (i + 1) + j;
+                    auto index = middleIndexOffset + static_cast<size_t>(i) * longitudeSides * 6;
+                    for(auto j = 0; j < longitudeSides; j++)
+                    {
+                        indices[index++] = offset + (longitudeSides + 1) * i + j;
+                        indices[index++] = offset + (longitudeSides + 1) * i + j + 1;
+                        indices[index++] = offset + (longitudeSides + 1) * (i + 1) + j;
+
+                        indices[index++] = offset + (longitudeSides + 1) * i + j + 1;
+                        indices[index++] = offset + (longitudeSides + 1) * (i + 1) + j + 1;
+                        indices[index++] = offset + (longitudeSides + 1) * (i + 1) + j;
+                    }
                 }
-            }
+            });
+            nextIndex += (std::max)(latitudeSides - 2, 0) * longitudeSides * 6;
 
             //Bottom
             offset = longitudeSides + (longitudeSides + 1) * (latitudeSides - 2);
@@ -150,21 +874,336 @@ namespace SolarSystem
             vb.data.resize(vertices.size() * sizeof(PNUVertex));
             std::memcpy(vb.data.data(), vertices.data(), vb.data.size());
 
-            IndexBuffer ib;
-            ib.format = DXGI_FORMAT_R32_UINT;
-            ib.indexCount = static_cast<int>(indices.size());
-            ib.data.resize(indices.size() * sizeof(uint32_t));
-            std::memcpy(ib.data.data(), indices.data(), ib.data.size());
+            Mesh mesh;
+            mesh.vertexBuffers.push_back(std::move(vb));
+            mesh.indexBuffer = CreateIndexBuffer(indices, vertices.size());
+            mesh.topology = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 
+            return mesh;
+        }
+
+        // Longitude sides of a level in a chain spaced geometrically between min and max, coarsest first
+        auto inline SphereLODLongitudeSides(int const level, int const levelCount, int const minLongitudeSides, int const maxLongitudeSides) -> int
+        {
+            auto const t = levelCount > 1 ? static_cast<float>(level) / (levelCount - 1) : 1.0f;
+            return static_cast<int>(std::round(
+                minLongitudeSides * std::pow(static_cast<float>(maxLongitudeSides) / minLongitudeSides, t)
+            ));
+        }
+
+        auto inline CreateSphereLODChain(
+            int const levelCount,
+            int const minLongitudeSides,
+            int const maxLongitudeSides,
+            JobSystem& jobSystem = GetJobSystem()
+        ) -> std::vector<Mesh>
+        {
+            auto levels = std::vector<Mesh>(levelCount);
+
+            // Levels are generated concurrently, each one splits its rows across the same pool
+            jobSystem.ParallelFor(0, levelCount, 1, [&](size_t const levelBegin, size_t const levelEnd) {
+                for(auto i = static_cast<int>(levelBegin); i < static_cast<int>(levelEnd); ++i)
+                {
+                    auto const longitudeSides = SphereLODLongitudeSides(i, levelCount, minLongitudeSides, maxLongitudeSides);
+                    levels[i] = CreateSphere(longitudeSides, (std::max)(longitudeSides / 2, 2), jobSystem);
+                }
+            });
+
+            return levels;
+        }
+
+        // Single point with the sphere vertex layout, drawn in place of bodies smaller than a pixel
+        auto inline CreatePointImpostor() -> Mesh
+        {
+            auto vertices = std::vector<PNUVertex>(1);
+            vertices[0].position = DirectX::SimpleMath::Vector3::Zero;
+            vertices[0].normal = DirectX::SimpleMath::Vector3::Up;
+            vertices[0].uv = DirectX::SimpleMath::Vector2(0.5f, 0.5f);
+
+            VertexBuffer vb;
+            vb.vertexByteSize = sizeof(PNUVertex);
+            vb.vertexCount = static_cast<int>(vertices.size());
+            vb.vertexElements.push_back({ "POSITION", DXGI_FORMAT_R32G32B32_FLOAT, 0 });
+            vb.vertexElements.push_back({ "NORMAL", DXGI_FORMAT_R32G32B32_FLOAT, sizeof PNUVertex::position });
+            vb.vertexElements.push_back({ "UV", DXGI_FORMAT_R32G32_FLOAT, sizeof PNUVertex::position + sizeof PNUVertex::normal });
+            vb.data.resize(vertices.size() * sizeof(PNUVertex));
+            std::memcpy(vb.data.data(), vertices.data(), vb.data.size());
 
             Mesh mesh;
             mesh.vertexBuffers.push_back(std::move(vb));
-            mesh.indexBuffer = std::move(ib);
+            mesh.topology = D3D11_PRIMITIVE_TOPOLOGY_POINTLIST;
+
+            return mesh;
+        }
+
+        //
+        // Turns a closed unit sphere with shared vertices into a mesh with the same layout and UV mapping as CreateSphere.
+        // Vertices are only duplicated where the mapping requires it, along the u = 0 seam and at the poles,
+        // and the triangles are reordered for the post-transform vertex cache.
+        //
+        auto inline CreateSphereFromSharedVertices(
+            std::vector<DirectX::SimpleMath::Vector3> const& positions,
+            std::vector<uint32_t> indices
+        ) -> Mesh
+        {
+            auto vertices = std::vector<PNUVertex>(positions.size());
+            for(size_t i = 0; i < positions.size(); ++i)
+            {
+                auto const& p = positions[i];
+
+                auto phi = std::atan2(p.z, p.x);
+                if(phi < 0.0f)
+                {
+                    phi += DirectX::XM_2PI;
+                }
+
+                vertices[i].position = p;
+                vertices[i].normal = p;
+                vertices[i].uv = DirectX::SimpleMath::Vector2(
+                    phi / DirectX::XM_2PI,
+                    std::acos(std::clamp(p.y, -1.0f, 1.0f)) / DirectX::XM_PI
+                );
+            }
+
+            auto const isPole = [&](uint32_t const index) {
+                return std::abs(vertices[index].position.y) > 1.0f - 1e-6f;
+            };
+
+            std::unordered_map<uint32_t, uint32_t> seamDuplicates;
+
+            for(size_t t = 0; t < indices.size(); t += 3)
+            {
+                auto const a = vertices[indices[t]].position;
+                auto const b = vertices[indices[t + 1]].position;
+                auto const c = vertices[indices[t + 2]].position;
+
+                // Clockwise when seen from outside, as in CreateSphere
+                if((b - a).Cross(c - a).Dot(a + b + c) < 0.0f)
+                {
+                    std::swap(indices[t + 1], indices[t + 2]);
+                }
+
+                // Triangles spanning the seam get copies of their low u vertices shifted by one
+                auto minU = 1.0f;
+                auto maxU = 0.0f;
+                for(auto k = 0; k < 3; ++k)
+                {
+                    if(isPole(indices[t + k])) continue;
+
+                    minU = (std::min)(minU, vertices[indices[t + k]].uv.x);
+                    maxU = (std::max)(maxU, vertices[indices[t + k]].uv.x);
+                }
+
+                if(maxU - minU > 0.5f)
+                {
+                    for(auto k = 0; k < 3; ++k)
+                    {
+                        auto& index = indices[t + k];
+                        if(isPole(index) || vertices[index].uv.x >= 0.5f) continue;
+
+                        auto const it = seamDuplicates.find(index);
+                        if(it != seamDuplicates.end())
+                        {
+                            index = it->second;
+                            continue;
+                        }
+
+                        auto duplicate = vertices[index];
+                        duplicate.uv.x += 1.0f;
+                        vertices.push_back(duplicate);
+
+                        auto const duplicateIndex = static_cast<uint32_t>(vertices.size() - 1);
+                        seamDuplicates[index] = duplicateIndex;
+                        index = duplicateIndex;
+                    }
+                }
+
+                // Pole vertices take the u of the opposite edge for every triangle
+                for(auto k = 0; k < 3; ++k)
+                {
+                    auto& index = indices[t + k];
+                    if(!isPole(index)) continue;
+
+                    auto const& other1 = vertices[indices[t + (k + 1) % 3]];
+                    auto const& other2 = vertices[indices[t + (k + 2) % 3]];
+
+                    auto duplicate = vertices[index];
+                    duplicate.uv.x = (other1.uv.x + other2.uv.x) * 0.5f;
+                    vertices.push_back(duplicate);
+
+                    index = static_cast<uint32_t>(vertices.size() - 1);
+                }
+            }
+
+            VertexBuffer vb;
+            vb.vertexByteSize = sizeof(PNUVertex);
+            vb.vertexCount = static_cast<int>(vertices.size());
+            vb.vertexElements.push_back({ "POSITION", DXGI_FORMAT_R32G32B32_FLOAT, 0 });
+            vb.vertexElements.push_back({ "NORMAL", DXGI_FORMAT_R32G32B32_FLOAT, sizeof PNUVertex::position });
+            vb.vertexElements.push_back({ "UV", DXGI_FORMAT_R32G32_FLOAT, sizeof PNUVertex::position + sizeof PNUVertex::normal });
+            vb.data.resize(vertices.size() * sizeof(PNUVertex));
+            std::memcpy(vb.data.data(), vertices.data(), vb.data.size());
+
+            Mesh mesh;
+            mesh.vertexBuffers.push_back(std::move(vb));
+            mesh.indexBuffer = CreateIndexBuffer(indices, vertices.size());
             mesh.topology = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+            OptimizeMesh(mesh);
 
             return mesh;
         }
 
+        // Subdivided icosahedron, 20 * 4^subdivisions triangles of nearly equal size
+        auto inline CreateIcosphere(int const subdivisions) -> Mesh
+        {
+            auto const t = (1.0f + std::sqrt(5.0f)) / 2.0f;
+
+            std::vector<DirectX::SimpleMath::Vector3> positions = {
+                { -1.0f, t, 0.0f }, { 1.0f, t, 0.0f }, { -1.0f, -t, 0.0f }, { 1.0f, -t, 0.0f },
+                { 0.0f, -1.0f, t }, { 0.0f, 1.0f, t }, { 0.0f, -1.0f, -t }, { 0.0f, 1.0f, -t },
+                { t, 0.0f, -1.0f }, { t, 0.0f, 1.0f }, { -t, 0.0f, -1.0f }, { -t, 0.0f, 1.0f }
+            };
+            for(auto& position : positions)
+            {
+                position.Normalize();
+            }
+
+            std::vector<uint32_t> indices = {
+                0, 11, 5,  0, 5, 1,  0, 1, 7,  0, 7, 10,  0, 10, 11,
+                1, 5, 9,  5, 11, 4,  11, 10, 2,  10, 7, 6,  7, 1, 8,
+                3, 9, 4,  3, 4, 2,  3, 2, 6,  3, 6, 8,  3, 8, 9,
+                4, 9, 5,  2, 4, 11,  6, 2, 10,  8, 6, 7,  9, 8, 1
+            };
+
+            for(auto s = 0; s < subdivisions; ++s)
+            {
+                // Edge midpoints are shared between the two triangles of the edge
+                std::unordered_map<uint64_t, uint32_t> midpoints;
+                auto const midpoint = [&](uint32_t const a, uint32_t const b) {
+                    auto const key = (static_cast<uint64_t>((std::min)(a, b)) << 32) | (std::max)(a, b);
+
+                    auto const it = midpoints.find(key);
+                    if(it != midpoints.end())
+                    {
+                        return it->second;
+                    }
+
+                    auto position = positions[a] + positions[b];
+                    position.Normalize();
+                    positions.push_back(position);
+
+                    auto const index = static_cast<uint32_t>(positions.size() - 1);
+                    midpoints.emplace(key, index);
+                    return index;
+                };
+
+                std::vector<uint32_t> subdivided;
+                subdivided.reserve(indices.size() * 4);
+
+                for(size_t i = 0; i < indices.size(); i += 3)
+                {
+                    auto const a = indices[i];
+                    auto const b = indices[i + 1];
+                    auto const c = indices[i + 2];
+                    auto const ab = midpoint(a, b);
+                    auto const bc = midpoint(b, c);
+                    auto const ca = midpoint(c, a);
+
+                    subdivided.insert(subdivided.end(), {
+                        a, ab, ca,
+                        b, bc, ab,
+                        c, ca, bc,
+                        ab, bc, ca
+                    });
+                }
+
+                indices = std::move(subdivided);
+            }
+
+            return CreateSphereFromSharedVertices(positions, std::move(indices));
+        }
+
+        // Cube with resolution x resolution quads per face projected onto the sphere
+        auto inline CreateCubeSphere(int const resolution) -> Mesh
+        {
+            struct Face
+            {
+                DirectX::SimpleMath::Vector3 normal;
+                DirectX::SimpleMath::Vector3 tangent;
+                DirectX::SimpleMath::Vector3 bitangent;
+            };
+
+            Face const faces[] = {
+                { {  1.0f,  0.0f,  0.0f }, { 0.0f, 0.0f, 1.0f }, { 0.0f, 1.0f, 0.0f } },
+                { { -1.0f,  0.0f,  0.0f }, { 0.0f, 0.0f, 1.0f }, { 0.0f, 1.0f, 0.0f } },
+                { {  0.0f,  1.0f,  0.0f }, { 1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 1.0f } },
+                { {  0.0f, -1.0f,  0.0f }, { 1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 1.0f } },
+                { {  0.0f,  0.0f,  1.0f }, { 1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f } },
+                { {  0.0f,  0.0f, -1.0f }, { 1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f } }
+            };
+
+            std::vector<DirectX::SimpleMath::Vector3> positions;
+            std::vector<uint32_t> indices;
+            indices.reserve(resolution * resolution * 6 * 6);
+
+            // Vertices on the cube edges are shared by lattice coordinate
+            std::unordered_map<uint64_t, uint32_t> lattice;
+            auto const vertex = [&](Face const& face, int const a, int const b) {
+                auto const cube = face.normal
+                    + face.tangent * (2.0f * a / resolution - 1.0f)
+                    + face.bitangent * (2.0f * b / resolution - 1.0f);
+
+                auto const coordinate = [&](float const value) {
+                    return static_cast<uint64_t>(std::lround((value + 1.0f) * 0.5f * resolution));
+                };
+                auto const stride = static_cast<uint64_t>(resolution) + 1;
+                auto const key = (coordinate(cube.x) * stride + coordinate(cube.y)) * stride + coordinate(cube.z);
+
+                auto const it = lattice.find(key);
+                if(it != lattice.end())
+                {
+                    return it->second;
+                }
+
+                // Spherified cube mapping, spreads the vertices more evenly than normalizing
+                auto const x2 = cube.x * cube.x;
+                auto const y2 = cube.y * cube.y;
+                auto const z2 = cube.z * cube.z;
+                auto position = DirectX::SimpleMath::Vector3(
+                    cube.x * std::sqrt(1.0f - y2 / 2.0f - z2 / 2.0f + y2 * z2 / 3.0f),
+                    cube.y * std::sqrt(1.0f - z2 / 2.0f - x2 / 2.0f + z2 * x2 / 3.0f),
+                    cube.z * std::sqrt(1.0f - x2 / 2.0f - y2 / 2.0f + x2 * y2 / 3.0f)
+                );
+                position.Normalize();
+                positions.push_back(position);
+
+                auto const index = static_cast<uint32_t>(positions.size() - 1);
+                lattice.emplace(key, index);
+                return index;
+            };
+
+            for(auto const& face : faces)
+            {
+                for(auto b = 0; b < resolution; ++b)
+                {
+                    for(auto a = 0; a < resolution; ++a)
+                    {
+                        auto const v00 = vertex(face, a, b);
+                        auto const v10 = vertex(face, a + 1, b);
+                        auto const v01 = vertex(face, a, b + 1);
+                        auto const v11 = vertex(face, a + 1, b + 1);
+
+                        indices.insert(indices.end(), {
+                            v00, v01, v10,
+                            v10, v01, v11
+                        });
+                    }
+                }
+            }
+
+            return CreateSphereFromSharedVertices(positions, std::move(indices));
+        }
+
 
         struct PUVertex final
         {
@@ -172,47 +1211,58 @@ namespace SolarSystem
             DirectX::SimpleMath::Vector2 uv;
         };
         
-        auto inline CreateRing(int const sides, float const innerRadius, float const outerRadius)
+        auto inline CreateRing(int const sides, float const innerRadius, float const outerRadius, JobSystem& jobSystem = GetJobSystem())
         {
             auto vertices = std::vector<PUVertex>(sides * 4);
             auto indices = std::vector<uint32_t>(sides * 6 * 2);
 
-            // vertices
-            for(auto i = 0; i < sides; i++)
-            {
-                auto angle1 = DirectX::XM_PI * 2.0f / sides * i;
-                auto angle2 = DirectX::XM_PI * 2.0f / sides * (i + 1);
+            // Both ends of a side share the tabulated trig of their angle
+            auto sinAngle = std::vector<float>(sides + 1);
+            auto cosAngle = std::vector<float>(sides + 1);
+            jobSystem.ParallelFor(0, sides + 1, GENERATOR_GRAIN_SIZE, [&](size_t const angleBegin, size_t const angleEnd) {
+                for(auto i = static_cast<int>(angleBegin); i < static_cast<int>(angleEnd); i++)
+                {
+                    auto const angle = DirectX::XM_PI * 2.0f / sides * i;
+                    sinAngle[i] = std::sin(angle);
+                    cosAngle[i] = std::cos(angle);
+                }
+            });
 
-                auto const offset = i * 4;
+            // vertices
+            jobSystem.ParallelFor(0, sides, GeneratorGrain(4), [&](size_t const sideBegin, size_t const sideEnd) {
+                for(auto i = static_cast<int>(sideBegin); i < static_cast<int>(sideEnd); i++)
+                {
+                    auto const offset = i * 4;
 
-                vertices[offset].position = DirectX::SimpleMath::Vector3(
-                    std::cos(angle1) * innerRadius,
-                    0.0f,
-                    std::sin(angle1) * innerRadius
-                );
-                vertices[offset].uv = DirectX::SimpleMath::Vector2(0.0f, 0.0f);
+                    vertices[offset].position = DirectX::SimpleMath::Vector3(
+                        cosAngle[i] * innerRadius,
+                        0.0f,
+                        sinAngle[i] * innerRadius
+                    );
+                    vertices[offset].uv = DirectX::SimpleMath::Vector2(0.0f, 0.0f);
 
-                vertices[offset + 1].position = DirectX::SimpleMath::Vector3(
-                    std::cos(angle2) * innerRadius,
-                    0.0f,
-                    std::sin(angle2) * innerRadius
-                );
-                vertices[offset + 1].uv = DirectX::SimpleMath::Vector2(0.0f, 1.0f);
+                    vertices[offset + 1].position = DirectX::SimpleMath::Vector3(
+                        cosAngle[i + 1] * innerRadius,
+                        0.0f,
+                        sinAngle[i + 1] * innerRadius
+                    );
+                    vertices[offset + 1].uv = DirectX::SimpleMath::Vector2(0.0f, 1.0f);
 
-                vertices[offset + 2].position = DirectX::SimpleMath::Vector3(
-                    std::cos(angle2) * outerRadius,
-                    0.0f,
-                    std::sin(angle2) * outerRadius
-                );
-                vertices[offset + 2].uv = DirectX::SimpleMath::Vector2(1.0f, 1.0f);
+                    vertices[offset + 2].position = DirectX::SimpleMath::Vector3(
+                        cosAngle[i + 1] * outerRadius,
+                        0.0f,
+                        sinAngle[i + 1] * outerRadius
+                    );
+                    vertices[offset + 2].uv = DirectX::SimpleMath::Vector2(1.0f, 1.0f);
 
-                vertices[offset + 3].position = DirectX::SimpleMath::Vector3(
-                    std::cos(angle1) * outerRadius,
-                    0.0f,
-                    std::sin(angle1) * outerRadius
-                );
-                vertices[offset + 3].uv = DirectX::SimpleMath::Vector2(1.0f, 0.0f);
-            }
+                    vertices[offset + 3].position = DirectX::SimpleMath::Vector3(
+                        cosAngle[i] * outerRadius,
+                        0.0f,
+                        sinAngle[i] * outerRadius
+                    );
+                    vertices[offset + 3].uv = DirectX::SimpleMath::Vector2(1.0f, 0.0f);
+                }
+            });
 
             // triangles
             for(auto i = 0; i < sides; i++)
@@ -245,16 +1295,9 @@ namespace SolarSystem
             vb.data.resize(vertices.size() * sizeof(PUVertex));
             std::memcpy(vb.data.data(), vertices.data(), vb.data.size());
 
-            IndexBuffer ib;
-            ib.format = DXGI_FORMAT_R32_UINT;
-            ib.indexCount = static_cast<int>(indices.size());
-            ib.data.resize(indices.size() * sizeof(uint32_t));
-            std::memcpy(ib.data.data(), indices.data(), ib.data.size());
-
-
             Mesh mesh;
             mesh.vertexBuffers.push_back(std::move(vb));
-            mesh.indexBuffer = std::move(ib);
+            mesh.indexBuffer = CreateIndexBuffer(indices, vertices.size());
             mesh.topology = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 
             return mesh;
@@ -294,37 +1337,39 @@ namespace SolarSystem
             DirectX::SimpleMath::Color color;
         };
 
-        auto inline Circle(float const radius, int const segments, DirectX::SimpleMath::Color const color) -> Mesh
+        auto inline Circle(float const radius, int const segments, DirectX::SimpleMath::Color const color, JobSystem& jobSystem = GetJobSystem()) -> Mesh
         {
             auto const half = segments / 2;
             auto vertices = std::vector<PCVertex>(2 * (half + 1));
 
 
             auto const max = DirectX::XM_PI * 0.9f;
-            for(auto i = 0; i < half + 1; ++i)
-            {
-
-                auto const t = (DirectX::XM_PI - max) + max / static_cast<float>(half) * i;
-                vertices[i].position.z = std::cos(t) * radius;
-                vertices[i].position.x = std::sin(t) * radius;
+            auto const offset = half + 1;
 
-                auto const x = (t - DirectX::XM_PI + max) / DirectX::XM_PI;
-                vertices[i].color = color;
-                vertices[i].color.w = color.w * std::powf(x, 0.5f);
-            }
+            // Both halves of the trail split into the same segment ranges
+            jobSystem.ParallelFor(0, half + 1, GeneratorGrain(2), [&](size_t const segmentBegin, size_t const segmentEnd) {
+                for(auto i = static_cast<int>(segmentBegin); i < static_cast<int>(segmentEnd); ++i)
+                {
+                    auto const t = (DirectX::XM_PI - max) + max / static_cast<float>(half) * i;
+                    vertices[i].position.z = std::cos(t) * radius;
+                    vertices[i].position.x = std::sin(t) * radius;
 
-            auto const offset = half + 1;
-            for(auto i = 0; i < half + 1; ++i)
-            {
+                    auto const x = (t - DirectX::XM_PI + max) / DirectX::XM_PI;
+                    vertices[i].color = color;
+                    vertices[i].color.w = color.w * std::powf(x, 0.5f);
+                }
 
-                auto const t = DirectX::XM_PI + max / static_cast<float>(half) * i;
-                vertices[i + offset].position.z = std::cos(t) * radius;
-                vertices[i + offset].position.x = std::sin(t) * radius;
+                for(auto i = static_cast<int>(segmentBegin); i < static_cast<int>(segmentEnd); ++i)
+                {
+                    auto const t = DirectX::XM_PI + max / static_cast<float>(half) * i;
+                    vertices[i + offset].position.z = std::cos(t) * radius;
+                    vertices[i + offset].position.x = std::sin(t) * radius;
 
-                auto const x = (t - DirectX::XM_PI) / max;
-                vertices[i + offset].color = color;
-                vertices[i + offset].color.w = color.w * std::powf(1 - x, 0.5f);
-            }
+                    auto const x = (t - DirectX::XM_PI) / max;
+                    vertices[i + offset].color = color;
+                    vertices[i + offset].color.w = color.w * std::powf(1 - x, 0.5f);
+                }
+            });
             
             //auto const offset = half + 1;
 
@@ -350,6 +1395,51 @@ namespace SolarSystem
             std::memcpy(vb.data.data(), vertices.data(), vb.data.size());
 
             
+            Mesh mesh;
+            mesh.vertexBuffers.push_back(std::move(vb));
+            mesh.topology = D3D11_PRIMITIVE_TOPOLOGY_LINESTRIP;
+
+            return mesh;
+        }
+
+        struct OrbitLineVertex final
+        {
+            // True anomaly relative to the body, Orbit_vs.hlsl places the vertex on the instance's ellipse
+            float anomaly;
+            // Linear fade ramp, raised to the instance's fade power
+            float fade;
+        };
+
+        // Unit orbit path with the same trail shape as Circle, the ellipse, body position and color come from instance data
+        auto inline OrbitLine(int const segments) -> Mesh
+        {
+            auto const half = segments / 2;
+            auto vertices = std::vector<OrbitLineVertex>(2 * (half + 1));
+
+            auto const max = DirectX::XM_PI * 0.9f;
+            for(auto i = 0; i < half + 1; ++i)
+            {
+                auto const t = (DirectX::XM_PI - max) + max / static_cast<float>(half) * i;
+                vertices[i].anomaly = t;
+                vertices[i].fade = (t - DirectX::XM_PI + max) / DirectX::XM_PI;
+            }
+
+            auto const offset = half + 1;
+            for(auto i = 0; i < half + 1; ++i)
+            {
+                auto const t = DirectX::XM_PI + max / static_cast<float>(half) * i;
+                vertices[i + offset].anomaly = t;
+                vertices[i + offset].fade = 1.0f - (t - DirectX::XM_PI) / max;
+            }
+
+            VertexBuffer vb;
+            vb.vertexByteSize = sizeof(OrbitLineVertex);
+            vb.vertexCount = static_cast<int>(vertices.size());
+            vb.vertexElements.push_back({ "ANOMALY", DXGI_FORMAT_R32_FLOAT, 0 });
+            vb.vertexElements.push_back({ "FADE", DXGI_FORMAT_R32_FLOAT, sizeof OrbitLineVertex::anomaly });
+            vb.data.resize(vertices.size() * sizeof(OrbitLineVertex));
+            std::memcpy(vb.data.data(), vertices.data(), vb.data.size());
+
             Mesh mesh;
             mesh.vertexBuffers.push_back(std::move(vb));
             mesh.topology = D3D11_PRIMITIVE_TOPOLOGY_LINESTRIP;
@@ -0,0 +1,419 @@
+#pragma once
+#include "Graphics.hpp"
+#include "Mesh.hpp"
+#include "MemoryTracking.hpp"
+#include <Windows.h>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+
+namespace SolarSystem
+{
+    //
+    // Binary mesh container, laid out so a memory mapped file can back the mesh without copies:
+    //
+    //   MeshFileHeader
+    //   MeshFileVertexBuffer     x vertexBufferCount
+    //   MeshFileVertexElement    x elementCount of every vertex buffer, in buffer order
+    //   vertex data of every buffer, then index data, each blob aligned to MESH_FILE_ALIGNMENT
+    //
+    // Offsets are from the start of the file. Any change to the layout bumps MESH_FILE_VERSION,
+    // files of another version are rejected by LoadMeshFile and regenerated by LoadOrCreateMesh.
+    //
+    constexpr uint32_t MESH_FILE_MAGIC = 0x464D5353; // "SSMF"
+    constexpr uint32_t MESH_FILE_VERSION = 1;
+    constexpr uint64_t MESH_FILE_ALIGNMENT = 16;
+
+    constexpr uint32_t MESH_FILE_FLAG_OPTIMIZED = 1;
+
+    struct MeshFileHeader final
+    {
+        uint32_t magic = MESH_FILE_MAGIC;
+        uint32_t version = MESH_FILE_VERSION;
+        uint32_t topology = 0;
+        uint32_t flags = 0;
+
+        float positionScale = 1.0f;
+        float positionOffset[3] = { };
+
+        uint32_t vertexBufferCount = 0;
+        uint32_t indexFormat = 0;
+        uint32_t indexCount = 0;
+        uint32_t reserved = 0;
+
+        uint64_t indexDataOffset = 0;
+        uint64_t indexDataSize = 0;
+    };
+
+    struct MeshFileVertexBuffer final
+    {
+        uint32_t vertexByteSize = 0;
+        uint32_t vertexCount = 0;
+        uint32_t instanceStepRate = 0;
+        uint32_t elementCount = 0;
+
+        uint64_t dataOffset = 0;
+        uint64_t dataSize = 0;
+    };
+
+    struct MeshFileVertexElement final
+    {
+        char semanticName[32] = { };
+        uint32_t format = 0;
+        int32_t offset = 0;
+        int32_t semanticIndex = 0;
+        uint32_t reserved = 0;
+    };
+
+
+    // Read only mapping of a whole file, unmapped when the last reference goes away
+    class MappedFile final
+    {
+    public:
+        static auto Open(wchar_t const* const fileName) -> std::shared_ptr<MappedFile const>
+        {
+            auto file = std::shared_ptr<MappedFile>(new MappedFile());
+
+            file->fileHandle = CreateFileW(fileName, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+            if(file->fileHandle == INVALID_HANDLE_VALUE)
+            {
+                throw std::exception("Failed to open mesh file");
+            }
+
+            LARGE_INTEGER size;
+            if(!GetFileSizeEx(file->fileHandle, &size))
+            {
+                throw std::exception("Failed to get mesh file size");
+            }
+            file->size = static_cast<size_t>(size.QuadPart);
+
+            // Empty files cannot be mapped
+            if(file->size == 0)
+            {
+                return file;
+            }
+
+            file->mappingHandle = CreateFileMappingW(file->fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if(file->mappingHandle == nullptr)
+            {
+                throw std::exception("Failed to map mesh file");
+            }
+
+            file->data = static_cast<char const*>(MapViewOfFile(file->mappingHandle, FILE_MAP_READ, 0, 0, 0));
+            if(file->data == nullptr)
+            {
+                throw std::exception("Failed to map mesh file");
+            }
+
+            return file;
+        }
+
+        MappedFile(MappedFile const&) = delete;
+        auto operator=(MappedFile const&) -> MappedFile& = delete;
+
+        ~MappedFile()
+        {
+            if(data != nullptr)
+            {
+                UnmapViewOfFile(data);
+            }
+
+            if(mappingHandle != nullptr)
+            {
+                CloseHandle(mappingHandle);
+            }
+
+            if(fileHandle != INVALID_HANDLE_VALUE)
+            {
+                CloseHandle(fileHandle);
+            }
+        }
+
+
+        auto GetData() const -> char const*
+        {
+            return data;
+        }
+
+        auto GetSize() const -> size_t
+        {
+            return size;
+        }
+
+    private:
+        MappedFile() = default;
+
+        HANDLE fileHandle = INVALID_HANDLE_VALUE;
+        HANDLE mappingHandle = nullptr;
+        char const* data = nullptr;
+        size_t size = 0;
+    };
+
+
+    auto inline WriteMeshFile(wchar_t const* const fileName, Mesh const& mesh) -> void
+    {
+        auto const align = [](uint64_t const offset) {
+            return (offset + MESH_FILE_ALIGNMENT - 1) & ~(MESH_FILE_ALIGNMENT - 1);
+        };
+
+        MeshFileHeader header;
+        header.topology = static_cast<uint32_t>(mesh.topology);
+        header.flags = mesh.optimized ? MESH_FILE_FLAG_OPTIMIZED : 0;
+        header.positionScale = mesh.positionScale;
+        header.positionOffset[0] = mesh.positionOffset.x;
+        header.positionOffset[1] = mesh.positionOffset.y;
+        header.positionOffset[2] = mesh.positionOffset.z;
+        header.vertexBufferCount = static_cast<uint32_t>(mesh.vertexBuffers.size());
+        header.indexFormat = static_cast<uint32_t>(mesh.indexBuffer.format);
+        header.indexCount = static_cast<uint32_t>(mesh.indexBuffer.indexCount);
+
+        std::vector<MeshFileVertexBuffer> vertexBuffers(mesh.vertexBuffers.size());
+        std::vector<MeshFileVertexElement> vertexElements;
+
+        for(size_t i = 0; i < mesh.vertexBuffers.size(); ++i)
+        {
+            auto const& source = mesh.vertexBuffers[i];
+            vertexBuffers[i].vertexByteSize = static_cast<uint32_t>(source.vertexByteSize);
+            vertexBuffers[i].vertexCount = static_cast<uint32_t>(source.vertexCount);
+            vertexBuffers[i].instanceStepRate = static_cast<uint32_t>(source.instanceStepRate);
+            vertexBuffers[i].elementCount = static_cast<uint32_t>(source.vertexElements.size());
+            vertexBuffers[i].dataSize = source.data.size();
+
+            for(auto const& vertexElement : source.vertexElements)
+            {
+                auto& element = vertexElements.emplace_back();
+                if(vertexElement.semanticName.size() >= sizeof element.semanticName)
+                {
+                    throw std::exception("Semantic name too long for mesh file");
+                }
+
+                std::memcpy(element.semanticName, vertexElement.semanticName.data(), vertexElement.semanticName.size());
+                element.format = static_cast<uint32_t>(vertexElement.format);
+                element.offset = vertexElement.offset;
+                element.semanticIndex = vertexElement.semanticIndex;
+            }
+        }
+
+        auto offset = sizeof header
+            + vertexBuffers.size() * sizeof(MeshFileVertexBuffer)
+            + vertexElements.size() * sizeof(MeshFileVertexElement);
+
+        for(auto& vertexBuffer : vertexBuffers)
+        {
+            vertexBuffer.dataOffset = align(offset);
+            offset = vertexBuffer.dataOffset + vertexBuffer.dataSize;
+        }
+
+        header.indexDataOffset = align(offset);
+        header.indexDataSize = mesh.indexBuffer.data.size();
+
+
+        std::filesystem::path const path(fileName);
+        if(path.has_parent_path())
+        {
+            std::filesystem::create_directories(path.parent_path());
+        }
+
+        // Written next to the target and renamed over it, a failed write never leaves a partial mesh file behind
+        auto temporaryPath = path;
+        temporaryPath += L".tmp";
+
+        auto fout = std::ofstream(temporaryPath, std::ios::out | std::ios::binary | std::ios::trunc);
+        if(!fout)
+        {
+            throw std::exception("Failed to create mesh file");
+        }
+
+        uint64_t written = 0;
+        auto const write = [&](void const* const data, uint64_t const size) {
+            fout.write(static_cast<char const*>(data), static_cast<std::streamsize>(size));
+            written += size;
+        };
+
+        auto const pad = [&](uint64_t const target) {
+            char const zeros[MESH_FILE_ALIGNMENT] = { };
+            write(zeros, target - written);
+        };
+
+        write(&header, sizeof header);
+        write(vertexBuffers.data(), vertexBuffers.size() * sizeof(MeshFileVertexBuffer));
+        write(vertexElements.data(), vertexElements.size() * sizeof(MeshFileVertexElement));
+
+        for(size_t i = 0; i < vertexBuffers.size(); ++i)
+        {
+            pad(vertexBuffers[i].dataOffset);
+            write(mesh.vertexBuffers[i].data.data(), vertexBuffers[i].dataSize);
+        }
+
+        pad(header.indexDataOffset);
+        write(mesh.indexBuffer.data.data(), header.indexDataSize);
+        fout.close();
+
+        std::error_code error;
+        if(!fout)
+        {
+            std::filesystem::remove(temporaryPath, error);
+            throw std::exception("Failed to write mesh file");
+        }
+
+        std::filesystem::rename(temporaryPath, path, error);
+        if(error)
+        {
+            std::filesystem::remove(temporaryPath, error);
+            throw std::exception("Failed to replace mesh file");
+        }
+    }
+
+
+    //
+    // Maps a mesh file and returns a mesh whose vertex and index data borrow the mapped bytes,
+    // the mapping is released with the last buffer referring to it.
+    //
+    auto inline LoadMeshFile(wchar_t const* const fileName) -> Mesh
+    {
+        auto const file = MappedFile::Open(fileName);
+        auto const data = file->GetData();
+        auto const size = static_cast<uint64_t>(file->GetSize());
+
+        auto const check = [&](uint64_t const offset, uint64_t const byteSize) {
+            if(offset > size || byteSize > size - offset)
+            {
+                throw std::exception("Mesh file is truncated");
+            }
+        };
+
+        check(0, sizeof(MeshFileHeader));
+        MeshFileHeader header;
+        std::memcpy(&header, data, sizeof header);
+
+        if(header.magic != MESH_FILE_MAGIC)
+        {
+            throw std::exception("Not a mesh file");
+        }
+
+        if(header.version != MESH_FILE_VERSION)
+        {
+            throw std::exception("Unsupported mesh file version");
+        }
+
+        Mesh mesh;
+        mesh.topology = static_cast<D3D11_PRIMITIVE_TOPOLOGY>(header.topology);
+        mesh.optimized = (header.flags & MESH_FILE_FLAG_OPTIMIZED) != 0;
+        mesh.positionScale = header.positionScale;
+        mesh.positionOffset = DirectX::SimpleMath::Vector3(header.positionOffset[0], header.positionOffset[1], header.positionOffset[2]);
+
+        auto const vertexBuffersOffset = static_cast<uint64_t>(sizeof header);
+        check(vertexBuffersOffset, header.vertexBufferCount * sizeof(MeshFileVertexBuffer));
+        auto elementsOffset = vertexBuffersOffset + header.vertexBufferCount * sizeof(MeshFileVertexBuffer);
+
+        for(uint32_t i = 0; i < header.vertexBufferCount; ++i)
+        {
+            MeshFileVertexBuffer source;
+            std::memcpy(&source, data + vertexBuffersOffset + i * sizeof source, sizeof source);
+
+            check(elementsOffset, source.elementCount * sizeof(MeshFileVertexElement));
+            check(source.dataOffset, source.dataSize);
+            if(source.dataSize != static_cast<uint64_t>(source.vertexByteSize) * source.vertexCount)
+            {
+                throw std::exception("Mesh file vertex data size mismatch");
+            }
+            if(source.vertexByteSize > static_cast<uint32_t>((std::numeric_limits<int>::max)())
+                || source.vertexCount > static_cast<uint32_t>((std::numeric_limits<int>::max)()))
+            {
+                throw std::exception("Mesh file vertex buffer too large");
+            }
+
+            auto& vertexBuffer = mesh.vertexBuffers.emplace_back();
+            vertexBuffer.vertexByteSize = static_cast<int>(source.vertexByteSize);
+            vertexBuffer.vertexCount = static_cast<int>(source.vertexCount);
+            vertexBuffer.instanceStepRate = static_cast<int>(source.instanceStepRate);
+            vertexBuffer.data = ByteBuffer(file, data + source.dataOffset, static_cast<size_t>(source.dataSize));
+
+            for(uint32_t j = 0; j < source.elementCount; ++j)
+            {
+                MeshFileVertexElement element;
+                std::memcpy(&element, data + elementsOffset, sizeof element);
+                elementsOffset += sizeof element;
+
+                element.semanticName[sizeof element.semanticName - 1] = '\0';
+
+                // Every element has to lie inside the vertex, or reading a vertex runs past the mapping
+                auto const elementSize = GetDXGIFormatSize(static_cast<DXGI_FORMAT>(element.format));
+                if(elementSize == 0 || element.offset < 0
+                    || static_cast<uint64_t>(element.offset) + elementSize > source.vertexByteSize)
+                {
+                    throw std::exception("Mesh file vertex element out of bounds");
+                }
+
+                vertexBuffer.vertexElements.push_back({
+                    element.semanticName,
+                    static_cast<DXGI_FORMAT>(element.format),
+                    element.offset,
+                    element.semanticIndex
+                    });
+            }
+        }
+
+        check(header.indexDataOffset, header.indexDataSize);
+        if(header.indexCount > 0 && header.indexFormat != DXGI_FORMAT_R16_UINT && header.indexFormat != DXGI_FORMAT_R32_UINT)
+        {
+            throw std::exception("Mesh file index format unsupported");
+        }
+        if(header.indexCount > static_cast<uint32_t>((std::numeric_limits<int>::max)())
+            || header.indexDataSize != static_cast<uint64_t>(header.indexCount) * GetDXGIFormatSize(static_cast<DXGI_FORMAT>(header.indexFormat)))
+        {
+            throw std::exception("Mesh file index data size mismatch");
+        }
+        mesh.indexBuffer.format = static_cast<DXGI_FORMAT>(header.indexFormat);
+        mesh.indexBuffer.indexCount = static_cast<int>(header.indexCount);
+        if(header.indexDataSize > 0)
+        {
+            mesh.indexBuffer.data = ByteBuffer(file, data + header.indexDataOffset, static_cast<size_t>(header.indexDataSize));
+        }
+
+        return mesh;
+    }
+
+
+    //
+    // Loads a cached mesh, or runs the generator, optimizes the result and writes it to the cache.
+    // The file name has to change with the generator parameters, the cache does not track them.
+    // Cache files that fail to load, such as files of an older version or corrupt ones, are regenerated.
+    // Failing to write the cache is not an error.
+    //
+    template<typename Generator>
+    auto LoadOrCreateMesh(wchar_t const* const fileName, Generator const& generator) -> Mesh
+    {
+        auto const memoryTag = MemoryTagScope(MemoryTag::Meshes);
+
+        if(std::filesystem::exists(fileName))
+        {
+            try
+            {
+                return LoadMeshFile(fileName);
+            }
+            catch(std::exception const&)
+            {
+            }
+        }
+
+        Mesh mesh = generator();
+        OptimizeMesh(mesh);
+        if(!mesh.vertexBuffers.empty())
+        {
+            CompactIndexBuffer(mesh.indexBuffer, mesh.vertexBuffers[0].vertexCount);
+        }
+
+        // The cache is best effort, a mesh that cannot be written is still used and generated again next time
+        try
+        {
+            WriteMeshFile(fileName, mesh);
+        }
+        catch(std::exception const&)
+        {
+        }
+
+        return mesh;
+    }
+}
@@ -0,0 +1,440 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <utility>
+
+namespace SolarSystem
+{
+    namespace MeshOptimizer
+    {
+        struct VertexCacheStatistics final
+        {
+            // Average cache miss ratio, transformed vertices per triangle (0.5 is the ideal for a closed mesh)
+            float acmr = 0.0f;
+            // Average transform to vertex ratio, transformed vertices per unique vertex (1.0 is the ideal)
+            float atvr = 0.0f;
+            size_t transformedVertices = 0;
+        };
+
+        // Simulates a FIFO post-transform cache over an indexed triangle list
+        auto inline AnalyzeVertexCache(std::vector<uint32_t> const& indices, size_t const vertexCount, size_t const cacheSize = 16)
+            -> VertexCacheStatistics
+        {
+            VertexCacheStatistics statistics;
+            if(indices.empty() || vertexCount == 0)
+            {
+                return statistics;
+            }
+
+            // Timestamp of the moment each vertex entered the cache
+            std::vector<size_t> cacheTime(vertexCount, 0);
+            size_t time = cacheSize + 1;
+
+            for(auto const index : indices)
+            {
+                if(time - cacheTime[index] > cacheSize)
+                {
+                    cacheTime[index] = time++;
+                    statistics.transformedVertices++;
+                }
+            }
+
+            statistics.acmr = static_cast<float>(statistics.transformedVertices) / (indices.size() / 3);
+            statistics.atvr = static_cast<float>(statistics.transformedVertices) / vertexCount;
+
+            return statistics;
+        }
+
+
+        //
+        // Reorders triangles for post-transform vertex cache locality.
+        // Tom Forsyth's linear-speed vertex cache optimisation: triangles are scored by the
+        // cache position and remaining valence of their vertices and emitted greedily.
+        //
+        auto inline OptimizeVertexCache(std::vector<uint32_t>& indices, size_t const vertexCount) -> void
+        {
+            constexpr auto CACHE_SIZE = 32;
+            constexpr auto CACHE_DECAY_POWER = 1.5f;
+            constexpr auto LAST_TRIANGLE_SCORE = 0.75f;
+            constexpr auto VALENCE_BOOST_SCALE = 2.0f;
+            constexpr auto VALENCE_BOOST_POWER = 0.5f;
+
+            auto const triangleCount = indices.size() / 3;
+            if(triangleCount == 0 || vertexCount == 0)
+            {
+                return;
+            }
+
+            auto const vertexScore = [&](int const cachePosition, uint32_t const remaining) {
+                if(remaining == 0)
+                {
+                    return -1.0f;
+                }
+
+                auto score = 0.0f;
+                if(cachePosition >= 0)
+                {
+                    if(cachePosition < 3)
+                    {
+                        score = LAST_TRIANGLE_SCORE;
+                    }
+                    else
+                    {
+                        auto const scaler = 1.0f / (CACHE_SIZE - 3);
+                        score = std::pow(1.0f - (cachePosition - 3) * scaler, CACHE_DECAY_POWER);
+                    }
+                }
+
+                return score + VALENCE_BOOST_SCALE * std::pow(static_cast<float>(remaining), -VALENCE_BOOST_POWER);
+            };
+
+            // Vertex to triangle adjacency
+            std::vector<uint32_t> adjacencyOffset(vertexCount + 1, 0);
+            for(auto const index : indices)
+            {
+                adjacencyOffset[index + 1]++;
+            }
+            for(size_t i = 0; i < vertexCount; ++i)
+            {
+                adjacencyOffset[i + 1] += adjacencyOffset[i];
+            }
+
+            std::vector<uint32_t> adjacency(indices.size());
+            {
+                auto fill = adjacencyOffset;
+                for(size_t i = 0; i < indices.size(); ++i)
+                {
+                    adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+                }
+            }
+
+            std::vector<uint32_t> remaining(vertexCount);
+            std::vector<int> cachePosition(vertexCount, -1);
+            std::vector<float> score(vertexCount);
+            for(size_t i = 0; i < vertexCount; ++i)
+            {
+                remaining[i] = adjacencyOffset[i + 1] - adjacencyOffset[i];
+                score[i] = vertexScore(-1, remaining[i]);
+            }
+
+            std::vector<bool> emitted(triangleCount, false);
+            std::vector<float> triangleScore(triangleCount);
+            for(size_t t = 0; t < triangleCount; ++t)
+            {
+                triangleScore[t] = score[indices[t * 3]] + score[indices[t * 3 + 1]] + score[indices[t * 3 + 2]];
+            }
+
+            std::vector<uint32_t> result;
+            result.reserve(indices.size());
+
+            // Three extra slots for the vertices pushed out of the cache while inserting a triangle
+            uint32_t cache[CACHE_SIZE + 3];
+            auto cacheCount = 0;
+
+            size_t nextScan = 0;
+            auto bestTriangle = static_cast<size_t>(0);
+
+            for(size_t emittedCount = 0; emittedCount < triangleCount; ++emittedCount)
+            {
+                if(emitted[bestTriangle])
+                {
+                    // Nothing adjacent to the cache, fall back to the first remaining triangle in input order
+                    while(nextScan < triangleCount && emitted[nextScan])
+                    {
+                        ++nextScan;
+                    }
+                    bestTriangle = nextScan;
+                }
+
+                auto const triangle = bestTriangle;
+                emitted[triangle] = true;
+
+                uint32_t newCache[CACHE_SIZE + 3];
+                auto newCacheCount = 0;
+
+                for(auto k = 0; k < 3; ++k)
+                {
+                    auto const vertex = indices[triangle * 3 + k];
+                    result.push_back(vertex);
+                    newCache[newCacheCount++] = vertex;
+
+                    // Remove the triangle from the vertex adjacency
+                    auto const begin = adjacency.begin() + adjacencyOffset[vertex];
+                    auto const end = begin + remaining[vertex];
+                    auto const it = std::find(begin, end, static_cast<uint32_t>(triangle));
+                    std::iter_swap(it, end - 1);
+                    remaining[vertex]--;
+                }
+
+                for(auto i = 0; i < cacheCount; ++i)
+                {
+                    auto const vertex = cache[i];
+                    if(vertex != newCache[0] && vertex != newCache[1] && vertex != newCache[2])
+                    {
+                        newCache[newCacheCount++] = vertex;
+                    }
+                }
+
+                // Vertices that fell out of the cache lose their position score
+                for(auto i = CACHE_SIZE; i < newCacheCount; ++i)
+                {
+                    cachePosition[newCache[i]] = -1;
+                }
+
+                cacheCount = (std::min)(newCacheCount, CACHE_SIZE);
+                std::copy(newCache, newCache + newCacheCount, cache);
+
+                auto bestScore = -1.0f;
+                for(auto i = 0; i < newCacheCount; ++i)
+                {
+                    auto const vertex = cache[i];
+                    cachePosition[vertex] = i < CACHE_SIZE ? i : -1;
+
+                    auto const newScore = vertexScore(cachePosition[vertex], remaining[vertex]);
+                    auto const delta = newScore - score[vertex];
+                    score[vertex] = newScore;
+
+                    for(auto a = adjacencyOffset[vertex]; a < adjacencyOffset[vertex] + remaining[vertex]; ++a)
+                    {
+                        auto const t = adjacency[a];
+                        triangleScore[t] += delta;
+
+                        if(triangleScore[t] > bestScore)
+                        {
+                            bestScore = triangleScore[t];
+                            bestTriangle = t;
+                        }
+                    }
+                }
+
+                if(bestScore < 0.0f)
+                {
+                    bestTriangle = triangle;
+                }
+            }
+
+            indices = std::move(result);
+        }
+
+
+        //
+        // Reorders clusters of a cache optimized triangle list so that triangles likely to occlude are drawn first.
+        // Sander et al. "Fast triangle reordering for vertex locality and reduced overdraw": the list is cut where the
+        // cache restarts or where the local miss ratio stays within threshold of the cluster's, and clusters facing
+        // away from the mesh center are sorted to the front.
+        //
+        auto inline OptimizeOverdraw(
+            std::vector<uint32_t>& indices,
+            float const* positions,
+            size_t const positionStride,
+            size_t const vertexCount,
+            float const threshold = 1.05f
+        ) -> void
+        {
+            constexpr size_t CACHE_SIZE = 16;
+
+            auto const triangleCount = indices.size() / 3;
+            if(triangleCount < 2 || vertexCount == 0)
+            {
+                return;
+            }
+
+            auto const position = [&](uint32_t const index) {
+                return reinterpret_cast<float const*>(reinterpret_cast<char const*>(positions) + index * positionStride);
+            };
+
+            std::vector<size_t> cacheTime(vertexCount, 0);
+            size_t time = CACHE_SIZE + 1;
+
+            auto const triangleMisses = [&](size_t const triangle) {
+                auto misses = 0;
+                for(auto k = 0; k < 3; ++k)
+                {
+                    auto const index = indices[triangle * 3 + k];
+                    if(time - cacheTime[index] > CACHE_SIZE)
+                    {
+                        cacheTime[index] = time++;
+                        misses++;
+                    }
+                }
+                return misses;
+            };
+
+            auto const resetCache = [&]() {
+                time += CACHE_SIZE + 1;
+            };
+
+            // Hard boundaries where every vertex of a triangle misses
+            std::vector<size_t> hardBoundaries;
+            for(size_t t = 0; t < triangleCount; ++t)
+            {
+                if(triangleMisses(t) == 3 || t == 0)
+                {
+                    hardBoundaries.push_back(t);
+                }
+            }
+            hardBoundaries.push_back(triangleCount);
+
+            // Soft boundaries inside each hard cluster
+            std::vector<size_t> boundaries;
+            for(size_t h = 0; h + 1 < hardBoundaries.size(); ++h)
+            {
+                auto const begin = hardBoundaries[h];
+                auto const end = hardBoundaries[h + 1];
+
+                resetCache();
+                auto clusterMisses = 0;
+                for(auto t = begin; t < end; ++t)
+                {
+                    clusterMisses += triangleMisses(t);
+                }
+                auto const clusterRatio = static_cast<float>(clusterMisses) / (end - begin);
+
+                resetCache();
+                auto start = begin;
+                auto misses = 0;
+                boundaries.push_back(begin);
+                for(auto t = begin; t < end; ++t)
+                {
+                    misses += triangleMisses(t);
+
+                    if(t + 1 < end && static_cast<float>(misses) / (t - start + 1) <= clusterRatio * threshold)
+                    {
+                        boundaries.push_back(t + 1);
+                        start = t + 1;
+                        misses = 0;
+                        resetCache();
+                    }
+                }
+            }
+            boundaries.push_back(triangleCount);
+
+            float meshCenter[3] = { 0.0f, 0.0f, 0.0f };
+            for(size_t i = 0; i < vertexCount; ++i)
+            {
+                for(auto c = 0; c < 3; ++c)
+                {
+                    meshCenter[c] += position(static_cast<uint32_t>(i))[c] / vertexCount;
+                }
+            }
+
+            struct Cluster final
+            {
+                size_t begin;
+                size_t end;
+                float sortKey;
+            };
+
+            std::vector<Cluster> clusters;
+            clusters.reserve(boundaries.size() - 1);
+
+            for(size_t b = 0; b + 1 < boundaries.size(); ++b)
+            {
+                float center[3] = { 0.0f, 0.0f, 0.0f };
+                float normal[3] = { 0.0f, 0.0f, 0.0f };
+                auto area = 0.0f;
+
+                for(auto t = boundaries[b]; t < boundaries[b + 1]; ++t)
+                {
+                    auto const p0 = position(indices[t * 3]);
+                    auto const p1 = position(indices[t * 3 + 1]);
+                    auto const p2 = position(indices[t * 3 + 2]);
+
+                    float const e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+                    float const e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+                    float const n[3] = {
+                        e1[1] * e2[2] - e1[2] * e2[1],
+                        e1[2] * e2[0] - e1[0] * e2[2],
+                        e1[0] * e2[1] - e1[1] * e2[0]
+                    };
+                    auto const triangleArea = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+                    for(auto c = 0; c < 3; ++c)
+                    {
+                        center[c] += (p0[c] + p1[c] + p2[c]) / 3.0f * triangleArea;
+                        normal[c] += n[c];
+                    }
+                    area += triangleArea;
+                }
+
+                auto sortKey = 0.0f;
+                auto const normalLength = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+                if(area > 0.0f && normalLength > 0.0f)
+                {
+                    for(auto c = 0; c < 3; ++c)
+                    {
+                        sortKey += (center[c] / area - meshCenter[c]) * normal[c] / normalLength;
+                    }
+                }
+
+                clusters.push_back({ boundaries[b], boundaries[b + 1], sortKey });
+            }
+
+            std::stable_sort(clusters.begin(), clusters.end(), [](Cluster const& a, Cluster const& b) {
+                return a.sortKey > b.sortKey;
+            });
+
+            std::vector<uint32_t> result;
+            result.reserve(indices.size());
+            for(auto const& cluster : clusters)
+            {
+                result.insert(result.end(), indices.begin() + cluster.begin * 3, indices.begin() + cluster.end * 3);
+            }
+
+            indices = std::move(result);
+        }
+
+
+        // Renumbers vertices in order of first use, returns the old to new vertex remap
+        auto inline OptimizeVertexFetch(std::vector<uint32_t>& indices, size_t const vertexCount) -> std::vector<uint32_t>
+        {
+            constexpr auto UNUSED = (std::numeric_limits<uint32_t>::max)();
+
+            std::vector<uint32_t> remap(vertexCount, UNUSED);
+            uint32_t next = 0;
+
+            for(auto& index : indices)
+            {
+                if(remap[index] == UNUSED)
+                {
+                    remap[index] = next++;
+                }
+                index = remap[index];
+            }
+
+            // Unreferenced vertices keep their relative order at the end
+            for(auto& r : remap)
+            {
+                if(r == UNUSED)
+                {
+                    r = next++;
+                }
+            }
+
+            return remap;
+        }
+
+        // Bytes is any resizable byte container holding one vertex per remap entry, the source is only read through its const interface
+        template<typename Bytes>
+        auto RemapVertices(Bytes& data, size_t const vertexByteSize, std::vector<uint32_t> const& remap) -> void
+        {
+            assert(data.size() == remap.size() * vertexByteSize);
+
+            auto const source = std::as_const(data).data();
+
+            Bytes result;
+            result.resize(data.size());
+            for(size_t i = 0; i < remap.size(); ++i)
+            {
+                std::memcpy(result.data() + remap[i] * vertexByteSize, source + i * vertexByteSize, vertexByteSize);
+            }
+
+            data = std::move(result);
+        }
+    }
+}
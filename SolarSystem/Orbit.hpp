@@ -5,16 +5,21 @@
 
 namespace SolarSystem
 {
+    // Keplerian orbit around the parent with the focus at its origin and periapsis along +z
     struct OrbitComponent final
     {
-        float radius = 1.0f;
-        float period = 1.0f;
-        float t = 0.0f;
+        double semiMajorAxis = 1.0;
+        double eccentricity = 0.0;
+        double period = 1.0;
+        double t = 0.0;
+        // True anomaly of the current position, written by OrbitSystem
+        double anomaly = 0.0;
 
         OrbitComponent() = default;
-        OrbitComponent(float const radius, float const period)
+        OrbitComponent(double const semiMajorAxis, double const period, double const eccentricity = 0.0)
             :
-            radius(radius),
+            semiMajorAxis(semiMajorAxis),
+            eccentricity(eccentricity),
             period(period)
         { }
     };
@@ -24,6 +29,9 @@ namespace SolarSystem
     {
         TranslationSystem* translationSystem = nullptr;
 
+        // Orbits are evaluated in double so positions hold up at real distances
+        static constexpr double TWO_PI = 6.283185307179586476925;
+
     public:
         auto Initialize() -> void override
         {
@@ -35,12 +43,35 @@ namespace SolarSystem
             components.Each([this, deltaTime](Entity const entity, OrbitComponent & orbit) {
                 auto& translation = translationSystem->GetComponent(entity);
 
-                auto const angle = orbit.t * DirectX::XM_2PI / orbit.period;
-                translation.translation.x = std::sin(angle) * orbit.radius;
-                translation.translation.z = std::cos(angle) * orbit.radius;
+                // Kept within a turn so the anomaly stays precise as float instance data, circles skip Kepler's equation
+                auto const meanAnomaly = std::remainder(orbit.t * TWO_PI / orbit.period, TWO_PI);
+                orbit.anomaly = orbit.eccentricity > 0.0 ? TrueAnomaly(meanAnomaly, orbit.eccentricity) : meanAnomaly;
+
+                auto const e = orbit.eccentricity;
+                auto const r = orbit.semiMajorAxis * (1.0 - e * e) / (1.0 + e * std::cos(orbit.anomaly));
+                translation.translation.x = std::sin(orbit.anomaly) * r;
+                translation.translation.z = std::cos(orbit.anomaly) * r;
                 orbit.t += deltaTime;
             });
         }
+
+        // Solves Kepler's equation M = E - e sin E with Newton's method, for eccentricities below 1
+        static auto TrueAnomaly(double const meanAnomaly, double const eccentricity) -> double
+        {
+            auto const m = std::remainder(meanAnomaly, TWO_PI);
+            auto eccentricAnomaly = eccentricity < 0.8 ? m : std::copysign(TWO_PI / 2.0, m);
+            for(auto i = 0; i < 16; ++i)
+            {
+                auto const step = (eccentricAnomaly - eccentricity * std::sin(eccentricAnomaly) - m) / (1.0 - eccentricity * std::cos(eccentricAnomaly));
+                eccentricAnomaly -= step;
+                if(std::abs(step) < 1e-12)
+                {
+                    break;
+                }
+            }
+
+            return 2.0 * std::atan2(std::sqrt(1.0 + eccentricity) * std::sin(eccentricAnomaly / 2.0), std::sqrt(1.0 - eccentricity) * std::cos(eccentricAnomaly / 2.0));
+        }
     };
 
 
@@ -0,0 +1,93 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+namespace SolarSystem
+{
+    //
+    // Orbit paths are sampled uniformly in true anomaly, as Orbit_vs.hlsl does, which places
+    // vertices densest around periapsis. The largest chord error of such a sampling sits on the
+    // segments centered on periapsis or apoapsis, where the ellipse curvature peaks.
+    //
+    namespace OrbitTessellation
+    {
+        constexpr auto TWO_PI = 6.28318530717958647692f;
+
+        struct Settings final
+        {
+            // Largest allowed distance between the path and its chords, in pixels
+            float maxErrorPixels = 0.5f;
+            int minSegments = 16;
+            int maxSegments = 4096;
+        };
+
+        struct Statistics final
+        {
+            size_t lines = 0;
+            size_t vertices = 0;
+            size_t drawCalls = 0;
+        };
+
+
+        // Distance from the focus at the given true anomaly
+        auto inline OrbitRadius(float const semiMajorAxis, float const eccentricity, float const trueAnomaly) -> float
+        {
+            return semiMajorAxis * (1.0f - eccentricity * eccentricity) / (1.0f + eccentricity * std::cos(trueAnomaly));
+        }
+
+        // Largest distance between the path and its chords for segments spanning segmentAngle of true anomaly
+        auto inline ChordErrorBound(float const semiMajorAxis, float const eccentricity, float const segmentAngle) -> float
+        {
+            auto const halfAngle = segmentAngle * 0.5f;
+            auto const cosHalf = std::cos(halfAngle);
+
+            // Symmetric segments around periapsis and apoapsis, the chord is perpendicular to the major axis
+            auto const periapsis = OrbitRadius(semiMajorAxis, eccentricity, 0.0f)
+                - OrbitRadius(semiMajorAxis, eccentricity, halfAngle) * cosHalf;
+            auto const apoapsis = OrbitRadius(semiMajorAxis, eccentricity, TWO_PI * 0.5f)
+                - OrbitRadius(semiMajorAxis, eccentricity, TWO_PI * 0.5f - halfAngle) * cosHalf;
+
+            return (std::max)(periapsis, apoapsis);
+        }
+
+        //
+        // Smallest power of two segment count, within the settings' range, whose chord error projects below
+        // maxErrorPixels. pixelsPerUnit is the projected size of one world unit at the nearest point of the path.
+        //
+        auto inline RequiredSegments(float const semiMajorAxis, float const eccentricity, float const pixelsPerUnit, Settings const& settings = { })
+            -> int
+        {
+            auto segments = settings.minSegments;
+            while(segments < settings.maxSegments
+                && ChordErrorBound(semiMajorAxis, eccentricity, TWO_PI / segments) * pixelsPerUnit > settings.maxErrorPixels)
+            {
+                segments *= 2;
+            }
+
+            return (std::min)(segments, settings.maxSegments);
+        }
+
+        //
+        // Projected size of one world unit at the nearest point of an orbit path whose focus is focusDistance
+        // away from the camera. projectionScale is the _22 element of the projection matrix.
+        // Every point of the path lies between periapsis and apoapsis distance from the focus, so none is nearer
+        // to the camera than focusDistance - apoapsis outside the orbit or periapsis - focusDistance inside it.
+        //
+        auto inline PixelsPerUnit(
+            float const focusDistance,
+            float const semiMajorAxis,
+            float const eccentricity,
+            float const projectionScale,
+            float const viewportHeight,
+            float const minDistance = 1e-3f
+        ) -> float
+        {
+            auto const periapsis = semiMajorAxis * (1.0f - eccentricity);
+            auto const apoapsis = semiMajorAxis * (1.0f + eccentricity);
+            auto const distance = (std::max)({ focusDistance - apoapsis, periapsis - focusDistance, minDistance });
+
+            return projectionScale * viewportHeight * 0.5f / distance;
+        }
+    }
+}
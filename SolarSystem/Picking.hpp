@@ -0,0 +1,224 @@
+#pragma once
+#include "ECS.hpp"
+#include "BoundingVolumeHierarchy.hpp"
+
+#include <SimpleMath.h>
+#include <vector>
+#include <optional>
+#include <algorithm>
+#include <cmath>
+
+namespace SolarSystem
+{
+    // World space ray through a pixel of the viewport, independent of the depth range of the projection
+    auto inline ScreenPointToRay(
+        float const x,
+        float const y,
+        float const width,
+        float const height,
+        DirectX::SimpleMath::Matrix const& view,
+        DirectX::SimpleMath::Matrix const& projection
+    ) -> BVHRay
+    {
+        auto const ndcX = 2.0f * x / width - 1.0f;
+        auto const ndcY = 1.0f - 2.0f * y / height;
+
+        auto const inverseView = view.Invert();
+        auto direction = DirectX::SimpleMath::Vector3::TransformNormal(
+            DirectX::SimpleMath::Vector3(ndcX / projection._11, ndcY / projection._22, 1.0f),
+            inverseView
+        );
+        direction.Normalize();
+
+        auto const origin = inverseView.Translation();
+
+        BVHRay ray;
+        ray.origin[0] = origin.x;
+        ray.origin[1] = origin.y;
+        ray.origin[2] = origin.z;
+        ray.direction[0] = direction.x;
+        ray.direction[1] = direction.y;
+        ray.direction[2] = direction.z;
+
+        return ray;
+    }
+
+
+    //
+    // Pickable bodies as spheres in a bounding volume hierarchy.
+    // Does not depend on the window or the graphics device so it can be driven headlessly.
+    //
+    // Static bodies are set with SetBody and Update. Moving bodies are tracked with Gather and a Refresh
+    // every frame instead, so a pick never has to visit every body. getBody(index, entity, sphere) writes
+    // the entity and the current sphere of a body for both of them and for the moving Pick.
+    //
+    class PickingModule final
+    {
+    public:
+        // Frames, and so calls to Refresh, one sweep over all bodies is spread across
+        static constexpr size_t REFRESH_FRAMES = 16;
+
+        auto Resize(size_t const count) -> void
+        {
+            entities.resize(count);
+            bvh.Resize(count);
+        }
+
+        auto SetBody(size_t const index, Entity const entity, DirectX::SimpleMath::Vector3 const& center, float const radius) -> void
+        {
+            entities[index] = entity;
+            bvh.SetSphere(index, { center.x, center.y, center.z, radius });
+        }
+
+        auto Update() -> void
+        {
+            bvh.Update();
+        }
+
+        // Index of the nearest body hit by the ray, as passed to SetBody
+        auto Pick(BVHRay const& ray) const -> std::optional<size_t>
+        {
+            return ToIndex(bvh.Raycast(ray));
+        }
+
+
+        //
+        // Sets every body to its current sphere and updates the hierarchy, for picks before there are motion bounds.
+        // The sweeps carry on unless the count changed, then tracking starts over from these samples.
+        //
+        template<typename GetBody>
+        auto Gather(size_t const count, GetBody const& getBody) -> void
+        {
+            auto const isTracking = isGathered && count == entities.size();
+            Resize(count);
+            samples.resize(count);
+            pending.resize(count);
+
+            for(size_t i = 0; i < count; ++i)
+            {
+                auto sphere = BVHSphere();
+                getBody(i, entities[i], sphere);
+                bvh.SetSphere(i, sphere);
+
+                if(!isTracking)
+                {
+                    samples[i] = sphere;
+                    pending[i] = sphere;
+                }
+            }
+            bvh.Update();
+
+            if(!isTracking)
+            {
+                sweepPosition = 0;
+                sweepCount = 0;
+                isGathered = true;
+            }
+        }
+
+        //
+        // Samples the next slice of bodies, called once a frame. The samples are applied and the hierarchy
+        // refitted when a sweep completes, so a sphere is in use until two sweeps after it was sampled.
+        // Each sphere is grown by MOTION_MARGIN times how far its body moved since the sweep before,
+        // which keeps smoothly moving bodies inside it. The first sweep after gathering measures the motion
+        // over less than a sweep, so the bounds hold from the second one. A changed count gathers again.
+        //
+        template<typename GetBody>
+        auto Refresh(size_t const count, GetBody const& getBody) -> void
+        {
+            if(!isGathered || count != entities.size())
+            {
+                Gather(count, getBody);
+                return;
+            }
+
+            auto const end = (std::min)(count, sweepPosition + (count + REFRESH_FRAMES - 1) / REFRESH_FRAMES);
+            for(auto i = sweepPosition; i < end; ++i)
+            {
+                auto sample = BVHSphere();
+                getBody(i, entities[i], sample);
+
+                auto const& previous = samples[i];
+                auto const dx = sample.x - previous.x;
+                auto const dy = sample.y - previous.y;
+                auto const dz = sample.z - previous.z;
+                auto const moved = std::sqrt(dx * dx + dy * dy + dz * dz) + std::abs(sample.radius - previous.radius);
+
+                pending[i] = { sample.x, sample.y, sample.z, sample.radius + MOTION_MARGIN * moved };
+                samples[i] = sample;
+            }
+            sweepPosition = end;
+
+            if(sweepPosition == count)
+            {
+                for(size_t i = 0; i < count; ++i)
+                {
+                    bvh.SetSphere(i, pending[i]);
+                }
+                bvh.Update();
+
+                sweepPosition = 0;
+                sweepCount++;
+            }
+        }
+
+        // After bodies were added, removed or reordered the next Refresh gathers them all
+        auto Invalidate() -> void
+        {
+            isGathered = false;
+        }
+
+        // Whether the spheres bound the bodies' current positions, a pick without them has to Gather first
+        auto HasMotionBounds() const -> bool
+        {
+            return isGathered && sweepCount >= 2;
+        }
+
+        // Nearest body hit by the ray, tested at its current position within the spheres the ray hits
+        template<typename GetBody>
+        auto Pick(BVHRay const& ray, GetBody const& getBody) const -> std::optional<size_t>
+        {
+            return ToIndex(bvh.Raycast(ray, [&](uint32_t const index, float) {
+                auto entity = Entity();
+                auto sphere = BVHSphere();
+                getBody(index, entity, sphere);
+                return BoundingVolumeHierarchy::IntersectRaySphere(ray, sphere);
+            }));
+        }
+
+
+        auto GetEntity(size_t const index) const -> Entity
+        {
+            return entities[index];
+        }
+
+        auto GetStatistics() const -> BVHStatistics const&
+        {
+            return bvh.GetStatistics();
+        }
+
+    private:
+        // Covers two sweeps of motion with room for bodies speeding up
+        static constexpr float MOTION_MARGIN = 3.0f;
+
+        static auto ToIndex(BVHHit const& hit) -> std::optional<size_t>
+        {
+            if(!hit.IsHit())
+            {
+                return std::nullopt;
+            }
+
+            return hit.index;
+        }
+
+        std::vector<Entity> entities;
+        BoundingVolumeHierarchy bvh;
+
+        // Last sample of every body and the grown spheres waiting for the end of the sweep
+        std::vector<BVHSphere> samples;
+        std::vector<BVHSphere> pending;
+        size_t sweepPosition = 0;
+        size_t sweepCount = 0;
+        bool isGathered = false;
+    };
+}
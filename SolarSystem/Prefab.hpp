@@ -0,0 +1,239 @@
+#pragma once
+#include "ECS.hpp"
+#include "Transform.hpp"
+#include "Renderer.hpp"
+#include <cassert>
+#include <limits>
+#include <memory>
+#include <vector>
+
+namespace SolarSystem
+{
+    //
+    // An entity subgraph recorded once and instantiated many times. Prefab entities are local ids
+    // from CreateEntity, ParentComponents between them are remapped to the new entities of each
+    // instance and ParentComponents pointing at PARENT get the parent given for the instance.
+    // Parents have to be recorded before their children, the same as when adding to the ECS.
+    //
+    class Prefab final
+    {
+    public:
+        static constexpr Entity PARENT = Entity{ (std::numeric_limits<size_t>::max)() };
+
+        // One copy of a prefab while it is being instantiated
+        class Instance final
+        {
+        public:
+            Instance(Prefab const& prefab, Entity const* const entities, size_t const index)
+                : prefab(prefab), entities(entities), index(index)
+            { }
+
+            // Component about to be added to the copy of a prefab entity
+            template<typename System, typename Component = typename System::component_type>
+            auto Get(Entity const entity) const -> Component&
+            {
+                auto const track = prefab.FindTrack<System, Component>();
+                assert(track != nullptr);
+                return track->GetStaged(index, entity);
+            }
+
+            // Entity created for a prefab entity
+            auto GetEntity(Entity const entity) const -> Entity
+            {
+                return entities[entity.id];
+            }
+
+            auto GetIndex() const -> size_t
+            {
+                return index;
+            }
+
+        private:
+            Prefab const& prefab;
+            Entity const* entities;
+            size_t index;
+        };
+
+
+        auto CreateEntity() -> Entity
+        {
+            return Entity{ entityCount++ };
+        }
+
+        auto GetEntityCount() const -> size_t
+        {
+            return entityCount;
+        }
+
+        // Component defaults to the component type of the system, RendererSystem also takes OrbitLine
+        template<typename System, typename Component = typename System::component_type>
+        auto AddComponent(Entity const entity, Component const& component = Component()) -> void
+        {
+            assert(entity.id < entityCount);
+            GetTrack<System, Component>().Add(entity, component);
+        }
+
+
+        //
+        // Creates count copies with one batched insertion per component type. parents[i] replaces
+        // PARENT in copy i and can be null when nothing refers to PARENT. override(instance) runs
+        // for every copy before insertion and can change its components through instance.Get.
+        // Returns the new entities, copy i's entity e at i * GetEntityCount() + e.id.
+        //
+        template<typename Override>
+        auto Instantiate(ECS& ecs, size_t const count, Entity const* const parents, Override const& override) -> std::vector<Entity>
+        {
+            auto entities = ecs.CreateEntities(count * entityCount);
+
+            for(auto const& track : tracks)
+            {
+                track->Stage(entities.data(), entityCount, count, parents);
+            }
+
+            for(size_t i = 0; i < count; ++i)
+            {
+                auto instance = Instance(*this, entities.data() + i * entityCount, i);
+                override(instance);
+            }
+
+            for(auto const& track : tracks)
+            {
+                track->Insert(ecs);
+            }
+
+            return entities;
+        }
+
+        auto Instantiate(ECS& ecs, size_t const count, Entity const* const parents = nullptr) -> std::vector<Entity>
+        {
+            return Instantiate(ecs, count, parents, [](Instance&) { });
+        }
+
+    private:
+        class TrackBase
+        {
+        public:
+            virtual ~TrackBase() = default;
+
+            virtual auto Stage(Entity const* entities, size_t entityCount, size_t instanceCount, Entity const* parents) -> void = 0;
+            virtual auto Insert(ECS& ecs) -> void = 0;
+
+            auto GetTypeId() const -> void const*
+            {
+                return typeId;
+            }
+
+        protected:
+            explicit TrackBase(void const* const typeId): typeId(typeId)
+            { }
+
+        private:
+            void const* typeId;
+        };
+
+        template<typename System, typename Component>
+        class Track final : public TrackBase
+        {
+        public:
+            Track(): TrackBase(GetTrackTypeId<System, Component>())
+            { }
+
+            auto Add(Entity const entity, Component const& component) -> void
+            {
+                if(positions.size() <= entity.id)
+                {
+                    positions.resize(entity.id + 1, NO_POSITION);
+                }
+                assert(positions[entity.id] == NO_POSITION);
+
+                positions[entity.id] = locals.size();
+                locals.push_back(entity);
+                components.push_back(component);
+            }
+
+            auto Stage(Entity const* const entities, size_t const entityCount, size_t const instanceCount, Entity const* const parents) -> void override
+            {
+                auto const perInstance = components.size();
+                stagedEntities.resize(instanceCount * perInstance);
+                stagedComponents.resize(instanceCount * perInstance);
+
+                for(size_t i = 0; i < instanceCount; ++i)
+                {
+                    auto const instanceEntities = entities + i * entityCount;
+                    auto const parent = parents != nullptr ? parents[i] : PARENT;
+                    auto const first = i * perInstance;
+                    auto const remap = [=](Entity const entity) {
+                        return entity.id == PARENT.id ? parent : instanceEntities[entity.id];
+                    };
+
+                    std::copy(components.begin(), components.end(), stagedComponents.begin() + first);
+                    for(size_t j = 0; j < perInstance; ++j)
+                    {
+                        stagedEntities[first + j] = instanceEntities[locals[j].id];
+                        RemapEntityReferences(stagedComponents[first + j], remap);
+                    }
+                }
+            }
+
+            auto Insert(ECS& ecs) -> void override
+            {
+                AddComponentBatch(*ecs.GetSystem<System>(), stagedEntities.data(), stagedComponents.data(), stagedEntities.size());
+
+                stagedEntities.clear();
+                stagedComponents.clear();
+            }
+
+            auto GetStaged(size_t const instance, Entity const entity) -> Component&
+            {
+                assert(entity.id < positions.size() && positions[entity.id] != NO_POSITION);
+                return stagedComponents[instance * components.size() + positions[entity.id]];
+            }
+
+        private:
+            static constexpr size_t NO_POSITION = (std::numeric_limits<size_t>::max)();
+
+            std::vector<Entity> locals;
+            std::vector<Component> components;
+            // Index into locals and components for each prefab entity with this component
+            std::vector<size_t> positions;
+
+            std::vector<Entity> stagedEntities;
+            std::vector<Component> stagedComponents;
+        };
+
+        template<typename System, typename Component>
+        static auto GetTrackTypeId() -> void const*
+        {
+            static char const id = 0;
+            return &id;
+        }
+
+        template<typename System, typename Component>
+        auto FindTrack() const -> Track<System, Component>*
+        {
+            auto const typeId = GetTrackTypeId<System, Component>();
+            for(auto const& track : tracks)
+            {
+                if(track->GetTypeId() == typeId)
+                {
+                    return static_cast<Track<System, Component>*>(track.get());
+                }
+            }
+            return nullptr;
+        }
+
+        template<typename System, typename Component>
+        auto GetTrack() -> Track<System, Component>&
+        {
+            auto track = FindTrack<System, Component>();
+            if(track == nullptr)
+            {
+                track = static_cast<Track<System, Component>*>(tracks.emplace_back(std::make_unique<Track<System, Component>>()).get());
+            }
+            return *track;
+        }
+
+        size_t entityCount = 0;
+        std::vector<std::unique_ptr<TrackBase>> tracks;
+    };
+}
@@ -7,6 +7,10 @@
 #include "Transform.hpp"
 #include "Camera.hpp"
 #include "BloomModule.hpp"
+#include "Culling.hpp"
+#include "LevelOfDetail.hpp"
+#include "OrbitTessellation.hpp"
+#include "Orbit.hpp"
 
 namespace SolarSystem
 {
@@ -34,6 +38,38 @@ namespace SolarSystem
         ResourceHandle<ShaderResouceView> pixelSRV[4] = { };
     };
 
+    //
+    // Keplerian orbit path drawn in the plane of an entity with the focus at its origin, orbit lines of the
+    // same tessellation share one instanced draw. The trail follows the anomaly of the body's OrbitComponent.
+    //
+    struct OrbitLine final
+    {
+        DirectX::SimpleMath::Color color;
+        float semiMajorAxis = 1.0f;
+        float eccentricity = 0.0f;
+        // Exponent applied to the trail fade
+        float fadePower = 0.5f;
+        // Entity whose OrbitComponent moves the body along the path
+        Entity body;
+    };
+
+    template <typename Remap>
+    auto RemapEntityReferences(OrbitLine& line, Remap const& remap) -> void
+    {
+        line.body = remap(line.body);
+    }
+
+    // What CreateMesh keeps of a mesh's vertex and index data once it is uploaded
+    enum class MeshRetention
+    {
+        // Everything, identical meshes created later are compared against the data itself
+        Keep,
+        // Only the layout and counts needed to draw, the data lives on the GPU alone and duplicates are found by digest
+        Drop,
+        // Positions and indices for CPU queries such as bounds or ray tests
+        KeepForQueries
+    };
+
     class RendererSystem final : public ECSSystem<RendererSystem>
     {
     public:
@@ -44,6 +80,7 @@ namespace SolarSystem
             shaderReflectionSystem = context->GetSystem<ShaderReflectionSystem>();
             worldSystem = context->GetSystem<WorldSystem>();
             cameraSystem = context->GetSystem<CameraSystem>();
+            orbitSystem = context->GetSystem<OrbitSystem>();
 
             width = windowSystem->GetWidth();
             height = windowSystem->GetHeight();
@@ -188,7 +225,7 @@ namespace SolarSystem
                 }, nullptr);
 
 
-            auto const quadMesh = CreateMesh(Procedural::FullscreenQuad());
+            auto const quadMesh = CreateMesh(Procedural::FullscreenQuad(), MeshRetention::Drop);
 
 
 
@@ -295,6 +332,51 @@ namespace SolarSystem
             blendDesc.RenderTarget[0].SrcBlendAlpha = D3D11_BLEND_ONE;
 
             addBlendState = graphicsSystem->CreateBlendState(blendDesc);
+
+
+            D3D11_DEPTH_STENCIL_DESC depthDesc;
+            depthDesc.DepthEnable = true;
+            depthDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ALL;
+            depthDesc.DepthFunc = D3D11_COMPARISON_LESS;
+            depthDesc.StencilEnable = false;
+            depthDesc.StencilReadMask = D3D11_DEFAULT_STENCIL_READ_MASK;
+            depthDesc.StencilWriteMask = D3D11_DEFAULT_STENCIL_WRITE_MASK;
+            depthDesc.FrontFace = { D3D11_STENCIL_OP_KEEP, D3D11_STENCIL_OP_KEEP, D3D11_STENCIL_OP_KEEP, D3D11_COMPARISON_ALWAYS };
+            depthDesc.BackFace = depthDesc.FrontFace;
+
+            standardDepthState = graphicsSystem->CreateDepthStencilState(depthDesc);
+
+            depthDesc.DepthFunc = D3D11_COMPARISON_GREATER_EQUAL;
+            reverseZDepthState = graphicsSystem->CreateDepthStencilState(depthDesc);
+
+
+            // One unit orbit mesh per power of two segment count, all with the same instance layout
+            for(auto level = 0; level < ORBIT_LINE_LEVELS; ++level)
+            {
+                auto orbitLineMesh = Procedural::OrbitLine(ORBIT_LINE_MIN_SEGMENTS << level);
+
+                auto& instances = orbitLineMesh.vertexBuffers.emplace_back();
+                instances.instanceStepRate = 1;
+                instances.vertexByteSize = sizeof(OrbitLineInstance);
+                for(auto i = 0; i < 4; ++i)
+                {
+                    instances.vertexElements.push_back({ "INSTANCE_WORLD", DXGI_FORMAT_R32G32B32A32_FLOAT, i * 16, i });
+                }
+                instances.vertexElements.push_back({ "COLOR", DXGI_FORMAT_R32G32B32A32_FLOAT, offsetof(OrbitLineInstance, color) });
+                instances.vertexElements.push_back({ "ORBIT", DXGI_FORMAT_R32G32B32A32_FLOAT, offsetof(OrbitLineInstance, orbit) });
+
+                orbitLines.meshes[level] = CreateMesh(std::move(orbitLineMesh), MeshRetention::Drop);
+            }
+
+            orbitLines.tessellation.minSegments = ORBIT_LINE_MIN_SEGMENTS;
+            orbitLines.tessellation.maxSegments = ORBIT_LINE_MIN_SEGMENTS << (ORBIT_LINE_LEVELS - 1);
+
+            orbitLines.material = CreateMaterial({
+                graphicsSystem->CreateVertexShader(LoadBytecode("Shaders/Orbit_vs.cso")),
+                graphicsSystem->CreatePixelShader(LoadBytecode("Shaders/Unlit_ps.cso")),
+                { { }, { }, { }, { } }
+                });
+            orbitLines.inputLayout = CreateInputLayout(orbitLines.meshes[0], orbitLines.material);
         }
 
 
@@ -306,7 +388,9 @@ namespace SolarSystem
             //ResizeIfNeeded();
 
             graphicsSystem->ClearRenderTargetView(msRTV, { 0.0f, 0.0f, 0.0f, 1.0f });
-            graphicsSystem->ClearDepthStencilView(msDSV, 1.0f);
+            auto const isReverseZ = cameraSystem->GetProjectionMode() == ProjectionMode::ReverseZInfinite;
+            graphicsSystem->ClearDepthStencilView(msDSV, cameraSystem->GetFarDepth());
+            graphicsSystem->SetDepthStencilState(isReverseZ ? reverseZDepthState : standardDepthState);
             graphicsSystem->SetRasterizerState(msRasterizer);
             graphicsSystem->SetRenderTargets(msRTV, msDSV);
             graphicsSystem->SetViewport({ 0.0f, 0.0f, static_cast<float>(width), static_cast<float>(height), 0.0f, 1.0f });
@@ -317,26 +401,34 @@ namespace SolarSystem
             //	this->DrawEntity(entity, rendererComponent);
             //});
 
-            for(size_t i = 0; i < replaceComponents.size(); ++i)
+            CullComponents();
+
+            // Drawing only reads components, a mutable access would mark the holder changed for snapshots every frame
+            auto const& drawnComponents = std::as_const(components);
+
+            for(size_t i = 0; i < replaceQueue.size(); ++i)
             {
-                DrawEntity(components.GetEntityFromComponent(replaceComponents[i]), components[replaceComponents[i]]);
+                DrawEntity(components.GetEntityFromComponent(replaceQueue[i]), drawnComponents[replaceQueue[i]]);
             }
 
             graphicsSystem->SetBlendState(addBlendState);
 
-            for(size_t i = 0; i < addComponents.size(); ++i)
+            for(size_t i = 0; i < addQueue.size(); ++i)
             {
-                DrawEntity(components.GetEntityFromComponent(addComponents[i]), components[addComponents[i]]);
+                DrawEntity(components.GetEntityFromComponent(addQueue[i]), drawnComponents[addQueue[i]]);
             }
 
             graphicsSystem->SetBlendState(alphaBlendState);
 
-            for(size_t i = 0; i < alphaComponents.size(); ++i)
+            DrawOrbitLines();
+
+            for(size_t i = 0; i < alphaQueue.size(); ++i)
             {
-                DrawEntity(components.GetEntityFromComponent(alphaComponents[i]), components[alphaComponents[i]]);
+                DrawEntity(components.GetEntityFromComponent(alphaQueue[i]), drawnComponents[alphaQueue[i]]);
             }
 
             graphicsSystem->SetBlendState({ });
+            graphicsSystem->SetDepthStencilState({ });
 
             // Resolving multisampling
             graphicsSystem->ResolveMultisampling(hdrRenderTargetMS, hdrRenderTarget, DXGI_FORMAT_R16G16B16A16_FLOAT);
@@ -364,15 +456,57 @@ namespace SolarSystem
 
 
 
-        auto CreateMesh(Mesh mesh) -> ResourceHandle<Mesh>
+        auto CreateMesh(Mesh mesh, MeshRetention const retention = MeshRetention::Keep) -> ResourceHandle<Mesh>
         {
+            auto const memoryTag = MemoryTagScope(MemoryTag::Meshes);
+
+            // Meshes with identical content share the buffers of the first one, compared exactly when it kept its data
+            // and by digest otherwise. It has to keep at least what the new mesh asks for.
+            // The lookup is by the mesh as given, so only the first of several duplicates is optimized.
+            auto const digest = DigestMesh(mesh);
+            auto const existing = meshHashes.Find(digest.hash, [&](size_t const i) {
+                auto const& rm = meshes[i];
+                if(rm.retention == MeshRetention::Keep)
+                {
+                    return IsSameOptimizedMesh(mesh, rm.mesh, rm.vertexRemap);
+                }
+                return (rm.retention == retention || retention == MeshRetention::Drop) && rm.digest == digest;
+            });
+            if(existing)
+            {
+                return ResourceHandle<Mesh>(*existing);
+            }
+
+            auto vertexRemap = std::vector<uint32_t>();
+            auto const optimization = OptimizeMesh(mesh, &vertexRemap);
+            if(!mesh.vertexBuffers.empty())
+            {
+                CompactIndexBuffer(mesh.indexBuffer, mesh.vertexBuffers[0].vertexCount);
+            }
+
             auto& rm = meshes.emplace_back();
             rm.mesh = std::move(mesh);
+            rm.retention = retention;
+            rm.digest = digest;
+            rm.optimization = optimization;
+            if(retention == MeshRetention::Keep)
+            {
+                rm.vertexRemap = std::move(vertexRemap);
+            }
+            rm.bounds = ComputeBoundingSphere(rm.mesh);
 
             assert(rm.mesh.vertexBuffers.size() < 4);
             for(size_t i = 0; i < rm.mesh.vertexBuffers.size(); ++i)
             {
-                auto& buffer = rm.mesh.vertexBuffers[i];
+                // Read through const so buffers borrowing a mapped mesh file are uploaded without a copy
+                auto const& buffer = rm.mesh.vertexBuffers[i];
+                rm.vertexSizes[i] = buffer.vertexByteSize;
+
+                // Per-instance buffers only describe the layout
+                if(buffer.instanceStepRate > 0)
+                {
+                    continue;
+                }
 
                 auto data = D3D11_SUBRESOURCE_DATA{ buffer.data.data(), 0, 0 };
 
@@ -384,17 +518,15 @@ namespace SolarSystem
                     0,
                     0
                     }, &data);
-
-                rm.vertexSizes[i] = rm.mesh.vertexBuffers[i].vertexByteSize;
             }
 
-            if(rm.mesh.indexBuffer.indexCount > 0)
+            auto const& indexBuffer = rm.mesh.indexBuffer;
+            if(indexBuffer.indexCount > 0)
             {
-
-                auto data = D3D11_SUBRESOURCE_DATA{ rm.mesh.indexBuffer.data.data(), 0, 0 };
+                auto data = D3D11_SUBRESOURCE_DATA{ indexBuffer.data.data(), 0, 0 };
 
                 rm.indexBuffer = graphicsSystem->CreateBuffer({
-                    static_cast<UINT>(rm.mesh.indexBuffer.indexCount * GetDXGIFormatSize(rm.mesh.indexBuffer.format)),
+                    static_cast<UINT>(indexBuffer.indexCount * GetDXGIFormatSize(indexBuffer.format)),
                     D3D11_USAGE_IMMUTABLE,
                     D3D11_BIND_INDEX_BUFFER,
                     0,
@@ -403,10 +535,28 @@ namespace SolarSystem
                     }, &data);
             }
 
+            if(retention != MeshRetention::Keep)
+            {
+                ReleaseMeshData(rm);
+            }
+
+            meshHashes.Insert(digest.hash, meshes.size() - 1);
             return ResourceHandle<Mesh>(meshes.size() - 1);
         }
 
 
+        auto CreateMeshLOD(MeshLOD meshLOD) -> ResourceHandle<MeshLOD>
+        {
+            assert(!meshLOD.levels.empty());
+
+            auto& rml = meshLODs.emplace_back();
+            rml.lod = std::move(meshLOD);
+            rml.bounds = GetMesh(rml.lod.levels.back().mesh).bounds;
+
+            return ResourceHandle<MeshLOD>(meshLODs.size() - 1);
+        }
+
+
         auto CreateMeshProvider(ResourceHandle<Mesh> const mesh, ResourceHandle<VertexShader> const vertexShader)
             -> ResourceHandle<MeshProvider>
         {
@@ -490,6 +640,22 @@ namespace SolarSystem
 
         auto CreateMaterial(Material const& material) -> ResourceHandle<Material>
         {
+            // Handles are plain indices, so the descriptor is hashed as is
+            auto const hash = HashValue(material);
+            auto const existing = materialHashes.Find(hash, [&](size_t const i) {
+                auto const& m = materials[i].material;
+                return m.vertexShader == material.vertexShader
+                    && m.pixelShader == material.pixelShader
+                    && std::equal(std::begin(m.pixelShaderResourceViews), std::end(m.pixelShaderResourceViews), std::begin(material.pixelShaderResourceViews))
+                    && m.pixelBuffer == material.pixelBuffer;
+            });
+            if(existing)
+            {
+                return ResourceHandle<Material>(*existing);
+            }
+
+            materialHashes.Insert(hash, materials.size());
+
             auto& rm = materials.emplace_back();
             rm.material = material;
 
@@ -519,22 +685,9 @@ namespace SolarSystem
             component.mesh = mesh;
             component.material = material;
             component.inputLayout = CreateInputLayout(mesh, material);
+            component.blendMode = blendMode;
 
             components.AddComponent(entity, component);
-            auto const index = components.GetComponentIndex(entity);
-
-            switch(blendMode)
-            {
-            case BlendMode::Replace:
-                replaceComponents.push_back(index);
-                break;
-            case BlendMode::Add:
-                addComponents.push_back(index);
-                break;
-            case BlendMode::Alpha:
-                alphaComponents.push_back(index);
-                break;
-            }
 
             /*if(blendMode == BlendMode::Add)
             {
@@ -563,94 +716,283 @@ namespace SolarSystem
         }
 
 
-    private:
+        // All levels of the chain have to share the vertex layout of the finest level
+        auto AddComponent(
+            Entity const entity,
+            ResourceHandle<MeshLOD> const meshLOD,
+            ResourceHandle<Material> const material,
+            BlendMode const blendMode = BlendMode::Replace
+        ) -> void
+        {
+            auto const& rml = GetMeshLOD(meshLOD);
 
-        std::vector<size_t> alphaComponents;
-        std::vector<size_t> addComponents;
-        std::vector<size_t> replaceComponents;
-        //size_t firstAlphaComponent = 0;
-        //size_t firstAddComponent = 0;
+            RendererComponent component;
+            component.mesh = rml.lod.levels.back().mesh;
+            component.material = material;
+            component.inputLayout = CreateInputLayout(component.mesh, material);
+            component.blendMode = blendMode;
+            component.meshLOD = meshLOD;
+            component.lodLevel = static_cast<int>(rml.lod.levels.size()) - 1;
 
-        auto CreateInputLayout(ResourceHandle<Mesh> const mesh, ResourceHandle<Material> const material) -> ResourceHandle<InputLayout>
+            components.AddComponent(entity, component);
+        }
+
+
+        // Mesh or mesh LOD chain drawn for an entity, used to add components in batches
+        struct Renderable final
         {
-            auto& rMesh = GetMesh(mesh);
-            auto& rMat = GetMaterial(material);
+            ResourceHandle<Mesh> mesh;
+            ResourceHandle<MeshLOD> meshLOD;
+            ResourceHandle<Material> material;
+            BlendMode blendMode = BlendMode::Replace;
+        };
 
-            std::vector<D3D11_INPUT_ELEMENT_DESC> inputElements;
+        using component_type = Renderable;
 
-            for(auto& inputParameter : rMat.vertexShaderReflection.inputParameters)
+        // Runs of renderables with the same mesh and material share one input layout lookup
+        auto AddComponents(Entity const* const entities, Renderable const* const renderables, size_t const count) -> void
+        {
+            components.Grow(components.GetComponentCount() + count, 0);
+
+            RendererComponent component;
+            for(size_t i = 0; i < count; ++i)
             {
-                auto isSupplied = false;
+                auto const& renderable = renderables[i];
+                auto const sameLayout = i > 0
+                    && renderable.mesh == renderables[i - 1].mesh
+                    && renderable.meshLOD == renderables[i - 1].meshLOD
+                    && renderable.material == renderables[i - 1].material;
 
-                for(auto j = 0; j < rMesh.mesh.vertexBuffers.size(); ++j)
+                if(!sameLayout)
                 {
-                    auto& vertexBuffer = rMesh.mesh.vertexBuffers[j];
-
-                    for(auto& vertexElement : vertexBuffer.vertexElements)
+                    component = RendererComponent();
+                    component.material = renderable.material;
+                    if(renderable.meshLOD.IsNull())
                     {
-                        if(vertexElement.format == inputParameter.format
-                            && vertexElement.semanticName == inputParameter.semanticName)
-                        {
-                            D3D11_INPUT_ELEMENT_DESC desc;
-                            desc.Format = vertexElement.format;
-                            desc.SemanticName = vertexElement.semanticName.c_str();
-                            desc.AlignedByteOffset = vertexElement.offset;
-                            desc.SemanticIndex = 0;
-                            desc.InputSlot = j;
-                            desc.InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
-                            desc.InstanceDataStepRate = 0;
-
-                            inputElements.push_back(desc);
-                            isSupplied = true;
-                            break;
-                        }
+                        component.mesh = renderable.mesh;
                     }
-
-                    if(isSupplied) break;
+                    else
+                    {
+                        auto const& rml = GetMeshLOD(renderable.meshLOD);
+                        component.mesh = rml.lod.levels.back().mesh;
+                        component.meshLOD = renderable.meshLOD;
+                        component.lodLevel = static_cast<int>(rml.lod.levels.size()) - 1;
+                    }
+                    component.inputLayout = CreateInputLayout(component.mesh, component.material);
                 }
 
-                if(!isSupplied)
+                component.blendMode = renderable.blendMode;
+                components.AddComponent(entities[i], component);
+            }
+        }
+
+
+        auto AddOrbitLine(Entity const entity, OrbitLine const& orbitLine) -> void
+        {
+            orbitLines.entities.push_back(entity);
+            orbitLines.lines.push_back(orbitLine);
+            orbitLines.changed = true;
+        }
+
+        auto AddOrbitLines(Entity const* const entities, OrbitLine const* const lines, size_t const count) -> void
+        {
+            orbitLines.entities.insert(orbitLines.entities.end(), entities, entities + count);
+            orbitLines.lines.insert(orbitLines.lines.end(), lines, lines + count);
+            orbitLines.changed = true;
+        }
+
+        auto RemoveComponents(Entity const* const entities, size_t const count) -> void
+        {
+            components.RemoveComponents(entities, count);
+        }
+
+        auto RemoveEntities(Entity const* const entities, size_t const count) -> void override
+        {
+            components.RemoveComponents(entities, count);
+
+            // Orbit lines are few, a sorted copy of the removed ids is enough to filter them
+            std::vector<size_t> removed(count);
+            std::transform(entities, entities + count, removed.begin(), [](Entity const entity) { return entity.id; });
+            std::sort(removed.begin(), removed.end());
+
+            size_t kept = 0;
+            for(size_t i = 0; i < orbitLines.entities.size(); ++i)
+            {
+                if(!std::binary_search(removed.begin(), removed.end(), orbitLines.entities[i].id))
                 {
-                    throw std::exception("Vertex shader input is not supplied by mesh vertex buffers");
+                    orbitLines.entities[kept] = orbitLines.entities[i];
+                    orbitLines.lines[kept] = orbitLines.lines[i];
+                    kept++;
                 }
             }
+            orbitLines.changed |= kept != orbitLines.entities.size();
+            orbitLines.entities.resize(kept);
+            orbitLines.lines.resize(kept);
+        }
 
-            return graphicsSystem->CreateInputLayout(std::move(inputElements), rMat.material.vertexShader);
+        // Resources are not part of the snapshot, handles stay valid as resources live as long as the renderer
+        auto SaveState(SnapshotWriter& writer) const -> void override
+        {
+            components.Save(writer);
+            writer.WriteValue(static_cast<uint64_t>(orbitLines.entities.size()));
+            writer.Write(orbitLines.entities.data(), orbitLines.entities.size() * sizeof(Entity));
+            writer.Write(orbitLines.lines.data(), orbitLines.lines.size() * sizeof(OrbitLine));
         }
 
+        auto LoadState(SnapshotReader& reader) -> void override
+        {
+            components.Load(reader);
+            auto const orbitLineCount = static_cast<size_t>(reader.ReadValue<uint64_t>());
+            orbitLines.entities.resize(orbitLineCount);
+            orbitLines.lines.resize(orbitLineCount);
+            reader.Read(orbitLines.entities.data(), orbitLineCount * sizeof(Entity));
+            reader.Read(orbitLines.lines.data(), orbitLineCount * sizeof(OrbitLine));
+            orbitLines.changed = true;
+        }
 
-        auto CreateInputLayout(ResourceHandle<Mesh> const mesh, ResourceHandle<VertexShader> const vertexShader) -> ResourceHandle<InputLayout>
+        auto IsStateChanged() const -> bool override
+        {
+            return components.IsChanged() || orbitLines.changed;
+        }
+
+        auto ClearStateChanged() -> void override
+        {
+            components.ClearChanged();
+            orbitLines.changed = false;
+        }
+
+        // Makes room for bulk creation, counts are totals including what was added before
+        auto Reserve(size_t const componentCount, size_t const orbitLineCount, size_t const entityCount) -> void
+        {
+            components.Reserve(componentCount, entityCount);
+            orbitLines.entities.reserve(orbitLineCount);
+            orbitLines.lines.reserve(orbitLineCount);
+        }
+
+        auto GetComponentCount() -> size_t
+        {
+            return components.GetComponentCount();
+        }
+
+        auto GetOrbitLineCount() const -> size_t
+        {
+            return orbitLines.lines.size();
+        }
+
+        // Largest projected distance between an orbit path and its line segments
+        auto SetOrbitLineMaxError(float const maxErrorPixels) -> void
+        {
+            orbitLines.tessellation.maxErrorPixels = maxErrorPixels;
+        }
+
+
+        auto GetCullingStatistics() const -> CullingStatistics const&
+        {
+            return cullingModule.GetStatistics();
+        }
+
+        auto GetLODStatistics() const -> LODStatistics const&
+        {
+            return lodStatistics;
+        }
+
+        auto GetOrbitLineStatistics() const -> OrbitTessellation::Statistics const&
+        {
+            return orbitLines.statistics;
+        }
+
+        struct ResourceStatistics final
+        {
+            ResourceCount meshes;
+            ResourceCount materials;
+            // Vertex and index data released after upload by meshes not created with MeshRetention::Keep
+            size_t releasedMeshBytes = 0;
+        };
+
+        auto GetResourceStatistics() const -> ResourceStatistics
+        {
+            return { meshHashes.GetCount(), materialHashes.GetCount(), releasedMeshBytes };
+        }
+
+        // CPU side data of a mesh, null when it was created with MeshRetention::Drop.
+        // Meshes kept for queries have a single vertex buffer holding only their positions.
+        auto GetMeshData(ResourceHandle<Mesh> const mesh) -> Mesh const*
+        {
+            auto const& rm = GetMesh(mesh);
+            switch(rm.retention)
+            {
+            case MeshRetention::Keep: return &rm.mesh;
+            case MeshRetention::KeepForQueries: return &rm.queryMesh;
+            default: return nullptr;
+            }
+        }
+
+        auto GetMeshOptimizationStatistics(ResourceHandle<Mesh> const mesh) -> MeshOptimizationStatistics const&
         {
-            auto& rMesh = GetMesh(mesh);
+            return GetMesh(mesh).optimization;
+        }
+
+
+    private:
 
+        // Visible components of the current frame, grouped by blend mode in component order
+        std::vector<size_t> alphaQueue;
+        std::vector<size_t> addQueue;
+        std::vector<size_t> replaceQueue;
+        //size_t firstAlphaComponent = 0;
+        //size_t firstAddComponent = 0;
+
+        auto CreateInputLayout(ResourceHandle<Mesh> const mesh, ResourceHandle<Material> const material) -> ResourceHandle<InputLayout>
+        {
+            auto& rMat = GetMaterial(material);
+            return CreateInputLayout(GetMesh(mesh).mesh, rMat.vertexShaderReflection, rMat.material.vertexShader);
+        }
+
+
+        auto CreateInputLayout(ResourceHandle<Mesh> const mesh, ResourceHandle<VertexShader> const vertexShader) -> ResourceHandle<InputLayout>
+        {
             auto const bytecode = graphicsSystem->GetVertexShaderBytecode(vertexShader);
             auto const& reflection = shaderReflectionSystem->Reflect(bytecode.first, bytecode.second);
 
-            std::vector<D3D11_INPUT_ELEMENT_DESC> inputElements;
+            return CreateInputLayout(GetMesh(mesh).mesh, reflection, vertexShader);
+        }
+
+
+        auto CreateInputLayout(Mesh const& mesh, ShaderReflection const& reflection, ResourceHandle<VertexShader> const vertexShader)
+            -> ResourceHandle<InputLayout>
+        {
+            // A shader cannot have more inputs than the input assembler, so the elements fit on the stack
+            D3D11_INPUT_ELEMENT_DESC inputElements[D3D11_IA_VERTEX_INPUT_STRUCTURE_ELEMENT_COUNT];
+            size_t inputElementCount = 0;
 
             for(auto& inputParameter : reflection.inputParameters)
             {
                 auto isSupplied = false;
 
-                for(auto j = 0; j < rMesh.mesh.vertexBuffers.size(); ++j)
+                for(auto j = 0; j < mesh.vertexBuffers.size(); ++j)
                 {
-                    auto& vertexBuffer = rMesh.mesh.vertexBuffers[j];
+                    auto const& vertexBuffer = mesh.vertexBuffers[j];
 
-                    for(auto& vertexElement : vertexBuffer.vertexElements)
+                    for(auto const& vertexElement : vertexBuffer.vertexElements)
                     {
-                        if(vertexElement.format == inputParameter.format
-                            && vertexElement.semanticName == inputParameter.semanticName)
+                        if(IsInputFormatCompatible(vertexElement.format, inputParameter.format)
+                            && vertexElement.semanticName == inputParameter.semanticName
+                            && vertexElement.semanticIndex == inputParameter.semanticIndex)
                         {
-                            D3D11_INPUT_ELEMENT_DESC desc;
+                            if(inputElementCount == std::size(inputElements))
+                            {
+                                throw std::exception("Vertex shader has too many inputs");
+                            }
+
+                            auto& desc = inputElements[inputElementCount++];
                             desc.Format = vertexElement.format;
                             desc.SemanticName = vertexElement.semanticName.c_str();
                             desc.AlignedByteOffset = vertexElement.offset;
-                            desc.SemanticIndex = 0;
+                            desc.SemanticIndex = vertexElement.semanticIndex;
                             desc.InputSlot = j;
-                            desc.InputSlotClass = D3D11_INPUT_PER_VERTEX_DATA;
-                            desc.InstanceDataStepRate = 0;
+                            desc.InputSlotClass = vertexBuffer.instanceStepRate > 0 ? D3D11_INPUT_PER_INSTANCE_DATA : D3D11_INPUT_PER_VERTEX_DATA;
+                            desc.InstanceDataStepRate = vertexBuffer.instanceStepRate;
 
-                            inputElements.push_back(desc);
                             isSupplied = true;
                             break;
                         }
@@ -665,13 +1007,14 @@ namespace SolarSystem
                 }
             }
 
-            return graphicsSystem->CreateInputLayout(std::move(inputElements), vertexShader);
+            return graphicsSystem->CreateInputLayout(inputElements, inputElementCount, vertexShader);
         }
 
         WindowSystem* windowSystem = nullptr;
         GraphicsSystem* graphicsSystem = nullptr;
         WorldSystem* worldSystem = nullptr;
         CameraSystem* cameraSystem = nullptr;
+        OrbitSystem const* orbitSystem = nullptr;
         int width = 0;
         int height = 0;
 
@@ -715,6 +1058,9 @@ namespace SolarSystem
 
         ResourceHandle<BlendState> alphaBlendState;
         ResourceHandle<BlendState> addBlendState;
+
+        ResourceHandle<DepthStencilState> standardDepthState;
+        ResourceHandle<DepthStencilState> reverseZDepthState;
         enum class DrawType
         {
             Vertex,
@@ -725,13 +1071,24 @@ namespace SolarSystem
 
         struct RMesh final
         {
+            // Vertex and index data are empty unless retention is Keep, the rest is what drawing reads
             Mesh mesh;
+            MeshRetention retention = MeshRetention::Keep;
+            Mesh queryMesh;
 
             ResourceHandle<Buffer> vertexBuffers[4] = { };
             UINT vertexSizes[4] = { };
             ResourceHandle<Buffer> indexBuffer;
+            BoundingSphere bounds;
+            MeshOptimizationStatistics optimization;
+            // From OptimizeMesh, lets later duplicates be compared in the form they are passed in
+            std::vector<uint32_t> vertexRemap;
+            // Of the mesh as passed in, what duplicates are compared against once the data is released
+            MeshDigest digest;
         };
-        std::vector<RMesh> meshes;
+        std::vector<RMesh, TaggedAllocator<RMesh, MemoryTag::Meshes>> meshes;
+        ContentHashTable meshHashes;
+        size_t releasedMeshBytes = 0;
 
         auto GetMesh(ResourceHandle<Mesh> const mesh) -> RMesh&
         {
@@ -739,6 +1096,90 @@ namespace SolarSystem
             return meshes[mesh.GetValue()];
         }
 
+        // Vertex elements stay, input layouts created later point at their semantic names
+        auto ReleaseMeshData(RMesh& rm) -> void
+        {
+            auto released = rm.mesh.indexBuffer.data.size();
+            for(auto const& vertexBuffer : rm.mesh.vertexBuffers)
+            {
+                released += vertexBuffer.data.size();
+            }
+
+            if(rm.retention == MeshRetention::KeepForQueries)
+            {
+                rm.queryMesh = CreateQueryMesh(rm.mesh);
+                released -= rm.queryMesh.indexBuffer.data.size();
+                for(auto const& vertexBuffer : rm.queryMesh.vertexBuffers)
+                {
+                    released -= vertexBuffer.data.size();
+                }
+            }
+
+            for(auto& vertexBuffer : rm.mesh.vertexBuffers)
+            {
+                vertexBuffer.data = ByteBuffer();
+            }
+            rm.mesh.indexBuffer.data = ByteBuffer();
+            releasedMeshBytes += released;
+        }
+
+        // Copy of the mesh with its positions packed into one vertex buffer in their stored format
+        static auto CreateQueryMesh(Mesh const& mesh) -> Mesh
+        {
+            Mesh queryMesh;
+            queryMesh.indexBuffer = mesh.indexBuffer;
+            queryMesh.topology = mesh.topology;
+            queryMesh.positionScale = mesh.positionScale;
+            queryMesh.positionOffset = mesh.positionOffset;
+            queryMesh.optimized = mesh.optimized;
+
+            for(auto const& vertexBuffer : mesh.vertexBuffers)
+            {
+                auto const position = std::find_if(vertexBuffer.vertexElements.begin(), vertexBuffer.vertexElements.end(), [](VertexElement const& element) {
+                    return element.semanticName == "POSITION" && element.semanticIndex == 0;
+                });
+                if(vertexBuffer.instanceStepRate > 0 || position == vertexBuffer.vertexElements.end())
+                {
+                    continue;
+                }
+
+                auto const size = GetDXGIFormatSize(position->format);
+                if(size == 0)
+                {
+                    throw std::exception("Unsupported position format");
+                }
+
+                auto& positions = queryMesh.vertexBuffers.emplace_back();
+                positions.vertexElements.push_back({ position->semanticName, position->format, 0, 0 });
+                positions.vertexByteSize = size;
+                positions.vertexCount = vertexBuffer.vertexCount;
+                positions.data.resize(static_cast<size_t>(size) * vertexBuffer.vertexCount);
+
+                auto const source = vertexBuffer.data.data() + position->offset;
+                for(auto i = 0; i < vertexBuffer.vertexCount; ++i)
+                {
+                    std::memcpy(positions.data.data() + i * size, source + i * vertexBuffer.vertexByteSize, size);
+                }
+                break;
+            }
+
+            return queryMesh;
+        }
+
+
+        struct RMeshLOD final
+        {
+            MeshLOD lod;
+            BoundingSphere bounds;
+        };
+        std::vector<RMeshLOD, TaggedAllocator<RMeshLOD, MemoryTag::Meshes>> meshLODs;
+
+        auto GetMeshLOD(ResourceHandle<MeshLOD> const meshLOD) -> RMeshLOD&
+        {
+            assert(meshLOD.GetValue() < meshLODs.size());
+            return meshLODs[meshLOD.GetValue()];
+        }
+
 
 
         struct RMaterial final
@@ -747,6 +1188,7 @@ namespace SolarSystem
             ShaderReflection vertexShaderReflection;
         };
         std::vector<RMaterial> materials;
+        ContentHashTable materialHashes;
 
 
         struct RMeshProvider final
@@ -775,9 +1217,51 @@ namespace SolarSystem
             ResourceHandle<Mesh> mesh;
             ResourceHandle<InputLayout> inputLayout;
             ResourceHandle<Material> material;
+            BlendMode blendMode = BlendMode::Replace;
+            ResourceHandle<MeshLOD> meshLOD;
+            int lodLevel = 0;
         };
         ComponentHolder<RendererComponent> components;
 
+        CullingModule cullingModule;
+        std::vector<BoundingSphere> worldBounds;
+        LODStatistics lodStatistics;
+
+
+        // Orbit meshes from 16 to 4096 segments
+        static constexpr auto ORBIT_LINE_MIN_SEGMENTS = 16;
+        static constexpr auto ORBIT_LINE_LEVELS = 9;
+
+        struct OrbitLineInstance final
+        {
+            // Camera relative world matrix of the orbit plane
+            DirectX::SimpleMath::Matrix world;
+            DirectX::SimpleMath::Color color;
+            // Semi-major axis, eccentricity, fade power, true anomaly of the body
+            DirectX::SimpleMath::Vector4 orbit;
+        };
+
+        struct OrbitLines final
+        {
+            std::vector<Entity> entities;
+            std::vector<OrbitLine> lines;
+            bool changed = true;
+
+            ResourceHandle<Mesh> meshes[ORBIT_LINE_LEVELS];
+            ResourceHandle<Material> material;
+            ResourceHandle<InputLayout> inputLayout;
+
+            OrbitTessellation::Settings tessellation;
+            OrbitTessellation::Statistics statistics;
+
+            // Tessellation level of every line, instances are sorted by it
+            std::vector<int> levels;
+            std::vector<OrbitLineInstance> unsorted;
+            std::vector<OrbitLineInstance> instances;
+            ResourceHandle<Buffer> instanceBuffer;
+            size_t instanceCapacity = 0;
+        } orbitLines;
+
 
         RendererComponent toneMappingPostprocess;
 
@@ -804,23 +1288,237 @@ namespace SolarSystem
             DirectX::SimpleMath::Vector4 threshold;
         };
 
+        auto CullComponents() -> void
+        {
+            auto const componentCount = components.GetComponentCount();
+
+            // Everything is rendered relative to the camera, see DrawEntity
+            cullingModule.SetFrustum(cameraSystem->GetRelativeViewMatrix() * cameraSystem->GetProjectionMatrix());
+            cullingModule.Resize(componentCount);
+            worldBounds.resize(componentCount);
+
+            for(size_t i = 0; i < componentCount; ++i)
+            {
+                auto const& component = std::as_const(components)[i];
+                auto const& bounds = component.meshLOD.IsNull() ? GetMesh(component.mesh).bounds : GetMeshLOD(component.meshLOD).bounds;
+                auto const& worldMatrix = worldSystem->GetComponent(components.GetEntityFromComponent(i));
+
+                worldBounds[i] = TransformBoundingSphere(bounds, worldMatrix.GetRelativeWorld(cameraSystem->GetWorldPosition()));
+                cullingModule.SetSphere(i, worldBounds[i]);
+            }
+
+            cullingModule.Cull();
+            SelectLODLevels();
+
+            replaceQueue.clear();
+            addQueue.clear();
+            alphaQueue.clear();
+
+            for(auto const index : cullingModule.GetVisible())
+            {
+                switch(std::as_const(components)[index].blendMode)
+                {
+                case BlendMode::Replace:
+                    replaceQueue.push_back(index);
+                    break;
+                case BlendMode::Add:
+                    addQueue.push_back(index);
+                    break;
+                case BlendMode::Alpha:
+                    alphaQueue.push_back(index);
+                    break;
+                }
+            }
+        }
+
+        auto SelectLODLevels() -> void
+        {
+            lodStatistics = { };
+
+            for(auto const index : cullingModule.GetVisible())
+            {
+                auto const& component = std::as_const(components)[index];
+
+                if(!component.meshLOD.IsNull())
+                {
+                    auto const& lod = GetMeshLOD(component.meshLOD).lod;
+                    auto const screenRadius = ProjectedScreenRadius(
+                        worldBounds[index],
+                        DirectX::SimpleMath::Vector3::Zero,
+                        cameraSystem->GetProjectionMatrix(),
+                        static_cast<float>(height)
+                    );
+
+                    // Written only when the level changes, so a still camera leaves the components unchanged
+                    auto const lodLevel = SelectLODLevel(lod, screenRadius, component.lodLevel);
+                    if(lodLevel != component.lodLevel)
+                    {
+                        auto& changedComponent = components[index];
+                        changedComponent.lodLevel = lodLevel;
+                        changedComponent.mesh = lodLevel < 0 ? lod.impostor : lod.levels[lodLevel].mesh;
+                    }
+                }
+
+                auto const& mesh = GetMesh(component.mesh).mesh;
+                if(mesh.topology == D3D11_PRIMITIVE_TOPOLOGY_POINTLIST)
+                {
+                    lodStatistics.impostors++;
+                }
+                else if(mesh.topology == D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST)
+                {
+                    auto const count = mesh.indexBuffer.indexCount > 0 ? mesh.indexBuffer.indexCount : mesh.vertexBuffers[0].vertexCount;
+                    lodStatistics.triangles += count / 3;
+                }
+            }
+        }
+
+        auto DrawOrbitLines() -> void
+        {
+            orbitLines.statistics = { };
+
+            if(orbitLines.entities.empty())
+            {
+                return;
+            }
+
+            auto const& projection = cameraSystem->GetProjectionMatrix();
+            auto const count = orbitLines.entities.size();
+
+            // Segment count of every line from the chord error projected at the nearest point of its path
+            size_t levelCounts[ORBIT_LINE_LEVELS] = { };
+            orbitLines.levels.resize(count);
+            orbitLines.unsorted.resize(count);
+
+            for(size_t i = 0; i < count; ++i)
+            {
+                auto const& line = orbitLines.lines[i];
+                auto const world = worldSystem->GetComponent(orbitLines.entities[i]).GetRelativeWorld(cameraSystem->GetWorldPosition());
+
+                auto& instance = orbitLines.unsorted[i];
+                instance.world = world;
+                instance.color = line.color;
+                // A line without an orbiting body draws its trail from periapsis
+                auto const anomaly = orbitSystem->HasComponent(line.body) ? static_cast<float>(orbitSystem->GetComponent(line.body).anomaly) : 0.0f;
+                instance.orbit = DirectX::SimpleMath::Vector4(line.semiMajorAxis, line.eccentricity, line.fadePower, anomaly);
+
+                auto const scale = (std::max)({ world.Right().Length(), world.Up().Length(), world.Backward().Length() });
+                auto const semiMajorAxis = line.semiMajorAxis * scale;
+                auto const pixelsPerUnit = OrbitTessellation::PixelsPerUnit(
+                    world.Translation().Length(), semiMajorAxis, line.eccentricity, projection._22, static_cast<float>(height));
+                auto const segments = OrbitTessellation::RequiredSegments(semiMajorAxis, line.eccentricity, pixelsPerUnit, orbitLines.tessellation);
+
+                auto level = 0;
+                while((ORBIT_LINE_MIN_SEGMENTS << level) < segments)
+                {
+                    level++;
+                }
+
+                orbitLines.levels[i] = level;
+                levelCounts[level]++;
+            }
+
+            size_t levelOffsets[ORBIT_LINE_LEVELS] = { };
+            for(auto level = 1; level < ORBIT_LINE_LEVELS; ++level)
+            {
+                levelOffsets[level] = levelOffsets[level - 1] + levelCounts[level - 1];
+            }
+
+            auto& instances = orbitLines.instances;
+            instances.resize(count);
+
+            size_t levelInserts[ORBIT_LINE_LEVELS];
+            std::copy(std::begin(levelOffsets), std::end(levelOffsets), std::begin(levelInserts));
+            for(size_t i = 0; i < count; ++i)
+            {
+                instances[levelInserts[orbitLines.levels[i]]++] = orbitLines.unsorted[i];
+            }
+
+            if(count > orbitLines.instanceCapacity)
+            {
+                orbitLines.instanceCapacity = (std::max)(count, orbitLines.instanceCapacity * 2);
+                orbitLines.instanceBuffer = graphicsSystem->CreateBuffer({
+                    static_cast<UINT>(orbitLines.instanceCapacity * sizeof(OrbitLineInstance)),
+                    D3D11_USAGE_DYNAMIC,
+                    D3D11_BIND_VERTEX_BUFFER,
+                    D3D11_CPU_ACCESS_WRITE,
+                    0,
+                    0
+                    }, nullptr);
+
+                for(auto const mesh : orbitLines.meshes)
+                {
+                    GetMesh(mesh).vertexBuffers[1] = orbitLines.instanceBuffer;
+                }
+            }
+
+            graphicsSystem->WriteBuffer(orbitLines.instanceBuffer, instances.data(), count * sizeof(OrbitLineInstance));
+
+            // Instances carry their own world matrix
+            PerObjectVertexCBuffer vcb;
+            vcb.wvp = cameraSystem->GetRelativeViewMatrix() * projection;
+            vcb.world = DirectX::SimpleMath::Matrix::Identity;
+
+            graphicsSystem->WriteBuffer(perObjectVertexCBuffer, &vcb, sizeof vcb);
+            graphicsSystem->BindVertexConstantBuffers({ perObjectVertexCBuffer, { }, { }, { } });
+
+            auto& mat = GetMaterial(orbitLines.material);
+
+            graphicsSystem->BindInputLayout(orbitLines.inputLayout);
+            graphicsSystem->BindPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_LINESTRIP);
+
+            graphicsSystem->BindVertexShader(mat.material.vertexShader);
+
+            graphicsSystem->BindPixelShader(mat.material.pixelShader);
+            graphicsSystem->BindPixelShaderResourceViews(mat.material.pixelShaderResourceViews);
+            graphicsSystem->BindPixelConstantBuffer(mat.material.pixelBuffer);
+
+            // One instanced draw per tessellation level in use
+            for(auto level = 0; level < ORBIT_LINE_LEVELS; ++level)
+            {
+                if(levelCounts[level] == 0)
+                {
+                    continue;
+                }
+
+                auto& rm = GetMesh(orbitLines.meshes[level]);
+                auto const vertexCount = rm.mesh.vertexBuffers[0].vertexCount;
+
+                graphicsSystem->BindVertexBuffers(rm.vertexBuffers, rm.vertexSizes);
+                graphicsSystem->DrawInstanced(vertexCount, static_cast<UINT>(levelCounts[level]), static_cast<UINT>(levelOffsets[level]));
+
+                orbitLines.statistics.drawCalls++;
+                orbitLines.statistics.vertices += vertexCount * levelCounts[level];
+            }
+
+            orbitLines.statistics.lines = count;
+        }
+
+
         auto DrawEntity(Entity const entity, RendererComponent const& component) -> void
         {
             auto& worldMatrix = worldSystem->GetComponent(entity);
 
+            auto const& mesh = GetMesh(component.mesh).mesh;
+
+            // Translation is rebased to the camera in double, only the result goes to float.
+            // Packed meshes are dequantized by the same matrix.
+            auto const world = DirectX::SimpleMath::Matrix::CreateScale(mesh.positionScale)
+                * DirectX::SimpleMath::Matrix::CreateTranslation(mesh.positionOffset)
+                * worldMatrix.GetRelativeWorld(cameraSystem->GetWorldPosition());
+
             PerObjectVertexCBuffer vcb;
-            vcb.wvp = worldMatrix.world * cameraSystem->GetViewMatrix() * cameraSystem->GetProjectionMatrix();
-            vcb.world = worldMatrix.world;
+            vcb.wvp = world * cameraSystem->GetRelativeViewMatrix() * cameraSystem->GetProjectionMatrix();
+            vcb.world = world;
 
             graphicsSystem->WriteBuffer(perObjectVertexCBuffer, &vcb, sizeof vcb);
             graphicsSystem->BindVertexConstantBuffers({ perObjectVertexCBuffer, { }, { }, { } });
 
             PerObjectPixelCBuffer pcv;
-            auto lightDir = worldMatrix.world.Translation();
+            // The sun sits at the absolute origin
+            auto lightDir = worldMatrix.position.ToVector3();
             lightDir.Normalize();
             pcv.lightDir = DirectX::SimpleMath::Vector4(lightDir.x, lightDir.y, lightDir.z, 0.0f);
-            auto const& cameraPos = cameraSystem->GetPosition();
-            pcv.cameraPos = DirectX::SimpleMath::Vector4(cameraPos.x, cameraPos.y, cameraPos.z, 1.0f);
+            pcv.cameraPos = DirectX::SimpleMath::Vector4(0.0f, 0.0f, 0.0f, 1.0f);
 
             graphicsSystem->WriteBuffer(perObjectPixelCBuffer, &pcv, sizeof pcv);
             graphicsSystem->BindPixelConstantBuffer(perObjectPixelCBuffer);
@@ -857,4 +1555,9 @@ namespace SolarSystem
             }
         }
     };
+
+    auto inline AddComponentBatch(RendererSystem& system, Entity const* const entities, OrbitLine const* const lines, size_t const count) -> void
+    {
+        system.AddOrbitLines(entities, lines, count);
+    }
 }
@@ -0,0 +1,312 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+namespace SolarSystem
+{
+    // Everything the simulation reads from outside of the ECS during one frame
+    struct ReplayFrame final
+    {
+        float deltaTime = 0.0f;
+        int32_t timeMultiplier = 0;
+
+        // State of each tracked key, see ReplayKey
+        std::vector<uint8_t> keys;
+
+        int32_t cursorX = 0;
+        int32_t cursorY = 0;
+        int32_t width = 0;
+        int32_t height = 0;
+        bool sizeChanged = false;
+    };
+
+    enum ReplayKey : uint8_t
+    {
+        REPLAY_KEY_IS_DOWN = 1,
+        REPLAY_KEY_WAS_PRESSED = 2,
+        REPLAY_KEY_WAS_HOLD = 4,
+        REPLAY_KEY_WAS_RELEASED = 8
+    };
+
+
+    namespace Detail
+    {
+        constexpr uint32_t REPLAY_FILE_MAGIC = 0x50525353; // "SSRP"
+        constexpr uint32_t REPLAY_FILE_VERSION = 1;
+
+        struct ReplayFileHeader final
+        {
+            uint32_t magic = REPLAY_FILE_MAGIC;
+            uint32_t version = REPLAY_FILE_VERSION;
+            uint32_t keyCount = 0;
+            uint32_t reserved = 0;
+        };
+
+        struct ReplayFileFooter final
+        {
+            uint64_t frameCount = 0;
+            uint64_t checksum = 0;
+        };
+
+        // Leading byte of every frame, fields that did not change since the previous frame are left out
+        enum ReplayFrameFlags : uint8_t
+        {
+            REPLAY_FRAME_TIME_MULTIPLIER = 1,
+            REPLAY_FRAME_CURSOR = 2,
+            REPLAY_FRAME_SIZE = 4,
+            REPLAY_FRAME_SIZE_CHANGED = 8,
+            REPLAY_FRAME_END = 0x80
+        };
+    }
+
+
+    //
+    // Writes frames to a log as they happen. A frame is the time step, the time multiplier and
+    // the input the window system received, key states take four bits per key and the rest is
+    // only written when it changes. Finish closes the log with a checksum of the final state.
+    //
+    class ReplayRecorder final
+    {
+    public:
+        ReplayRecorder(std::filesystem::path const& path, std::vector<uint8_t> const& virtualKeys)
+            : fout(path, std::ios::out | std::ios::binary | std::ios::trunc)
+        {
+            if(!fout)
+            {
+                throw std::exception("Failed to create replay log");
+            }
+
+            auto header = Detail::ReplayFileHeader();
+            header.keyCount = static_cast<uint32_t>(virtualKeys.size());
+            fout.write(reinterpret_cast<char const*>(&header), sizeof header);
+            fout.write(reinterpret_cast<char const*>(virtualKeys.data()), virtualKeys.size());
+
+            frame.keys.resize(virtualKeys.size());
+            encoded.reserve(64);
+        }
+
+        auto BeginFrame(float const deltaTime, int32_t const timeMultiplier) -> void
+        {
+            frame.deltaTime = deltaTime;
+            frame.timeMultiplier = timeMultiplier;
+        }
+
+        // The window system fills in the input of the current frame during its update
+        auto GetFrame() -> ReplayFrame&
+        {
+            return frame;
+        }
+
+        auto EndFrame() -> void
+        {
+            uint8_t flags = 0;
+            flags |= frameCount == 0 || frame.timeMultiplier != previous.timeMultiplier ? Detail::REPLAY_FRAME_TIME_MULTIPLIER : 0;
+            flags |= frameCount == 0 || frame.cursorX != previous.cursorX || frame.cursorY != previous.cursorY ? Detail::REPLAY_FRAME_CURSOR : 0;
+            flags |= frameCount == 0 || frame.width != previous.width || frame.height != previous.height ? Detail::REPLAY_FRAME_SIZE : 0;
+            flags |= frame.sizeChanged ? Detail::REPLAY_FRAME_SIZE_CHANGED : 0;
+
+            encoded.clear();
+            Append(flags);
+            Append(frame.deltaTime);
+            if(flags & Detail::REPLAY_FRAME_TIME_MULTIPLIER)
+            {
+                Append(frame.timeMultiplier);
+            }
+            if(flags & Detail::REPLAY_FRAME_CURSOR)
+            {
+                Append(frame.cursorX);
+                Append(frame.cursorY);
+            }
+            if(flags & Detail::REPLAY_FRAME_SIZE)
+            {
+                Append(frame.width);
+                Append(frame.height);
+            }
+            for(size_t i = 0; i < frame.keys.size(); i += 2)
+            {
+                auto const high = i + 1 < frame.keys.size() ? frame.keys[i + 1] : 0;
+                Append(static_cast<uint8_t>(frame.keys[i] | high << 4));
+            }
+
+            fout.write(encoded.data(), encoded.size());
+            previous.timeMultiplier = frame.timeMultiplier;
+            previous.cursorX = frame.cursorX;
+            previous.cursorY = frame.cursorY;
+            previous.width = frame.width;
+            previous.height = frame.height;
+            frameCount++;
+        }
+
+        auto Finish(uint64_t const checksum) -> void
+        {
+            auto const end = static_cast<uint8_t>(Detail::REPLAY_FRAME_END);
+            auto const footer = Detail::ReplayFileFooter{ frameCount, checksum };
+            fout.write(reinterpret_cast<char const*>(&end), sizeof end);
+            fout.write(reinterpret_cast<char const*>(&footer), sizeof footer);
+            fout.close();
+
+            if(!fout)
+            {
+                throw std::exception("Failed to write replay log");
+            }
+        }
+
+        auto GetFrameCount() const -> uint64_t
+        {
+            return frameCount;
+        }
+
+    private:
+        template<typename T>
+        auto Append(T const& value) -> void
+        {
+            auto const offset = encoded.size();
+            encoded.resize(offset + sizeof value);
+            std::memcpy(encoded.data() + offset, &value, sizeof value);
+        }
+
+        std::ofstream fout;
+        std::vector<char> encoded;
+
+        ReplayFrame frame;
+        ReplayFrame previous;
+        uint64_t frameCount = 0;
+    };
+
+
+    // Reads a finished log into memory and decodes one frame per NextFrame call
+    class ReplayPlayer final
+    {
+    public:
+        explicit ReplayPlayer(std::filesystem::path const& path)
+        {
+            auto fin = std::ifstream(path, std::ios::in | std::ios::binary | std::ios::ate);
+            if(!fin)
+            {
+                throw std::exception("Failed to open replay log");
+            }
+
+            data.resize(static_cast<size_t>(fin.tellg()));
+            fin.seekg(0, std::ios::beg);
+            fin.read(data.data(), data.size());
+
+            Detail::ReplayFileHeader header;
+            Read(header);
+            if(header.magic != Detail::REPLAY_FILE_MAGIC || header.version != Detail::REPLAY_FILE_VERSION)
+            {
+                throw std::exception("Replay log has an unknown format");
+            }
+
+            virtualKeys.resize(header.keyCount);
+            ReadBytes(virtualKeys.data(), virtualKeys.size());
+            frame.keys.resize(header.keyCount);
+
+            // The footer only exists when recording finished
+            if(data.size() < cursor + 1 + sizeof footer || static_cast<uint8_t>(data[data.size() - sizeof footer - 1]) != Detail::REPLAY_FRAME_END)
+            {
+                throw std::exception("Replay log was not finished");
+            }
+            std::memcpy(&footer, data.data() + data.size() - sizeof footer, sizeof footer);
+        }
+
+        auto GetVirtualKeys() const -> std::vector<uint8_t> const&
+        {
+            return virtualKeys;
+        }
+
+        // Decodes the next frame, false once every frame was played
+        auto NextFrame() -> bool
+        {
+            uint8_t flags;
+            Read(flags);
+            if(flags & Detail::REPLAY_FRAME_END)
+            {
+                if(frameIndex != footer.frameCount)
+                {
+                    throw std::exception("Replay log frame count does not match");
+                }
+                return false;
+            }
+
+            Read(frame.deltaTime);
+            if(flags & Detail::REPLAY_FRAME_TIME_MULTIPLIER)
+            {
+                Read(frame.timeMultiplier);
+            }
+            if(flags & Detail::REPLAY_FRAME_CURSOR)
+            {
+                Read(frame.cursorX);
+                Read(frame.cursorY);
+            }
+            if(flags & Detail::REPLAY_FRAME_SIZE)
+            {
+                Read(frame.width);
+                Read(frame.height);
+            }
+            frame.sizeChanged = (flags & Detail::REPLAY_FRAME_SIZE_CHANGED) != 0;
+
+            for(size_t i = 0; i < frame.keys.size(); i += 2)
+            {
+                uint8_t packed;
+                Read(packed);
+                frame.keys[i] = packed & 0x0F;
+                if(i + 1 < frame.keys.size())
+                {
+                    frame.keys[i + 1] = packed >> 4;
+                }
+            }
+
+            frameIndex++;
+            return true;
+        }
+
+        auto GetFrame() const -> ReplayFrame const&
+        {
+            return frame;
+        }
+
+        auto GetFrameCount() const -> uint64_t
+        {
+            return footer.frameCount;
+        }
+
+        // Checksum of the final state written by ReplayRecorder::Finish
+        auto GetChecksum() const -> uint64_t
+        {
+            return footer.checksum;
+        }
+
+    private:
+        template<typename T>
+        auto Read(T& value) -> void
+        {
+            ReadBytes(&value, sizeof value);
+        }
+
+        auto ReadBytes(void* const bytes, size_t const size) -> void
+        {
+            if(data.size() - cursor < size)
+            {
+                throw std::exception("Replay log is truncated");
+            }
+            if(size > 0)
+            {
+                std::memcpy(bytes, data.data() + cursor, size);
+            }
+            cursor += size;
+        }
+
+        std::vector<char> data;
+        size_t cursor = 0;
+
+        std::vector<uint8_t> virtualKeys;
+        Detail::ReplayFileFooter footer;
+
+        ReplayFrame frame;
+        uint64_t frameIndex = 0;
+    };
+}
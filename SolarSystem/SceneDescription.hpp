@@ -0,0 +1,654 @@
+#pragma once
+#include "MemoryTracking.hpp"
+#include <SimpleMath.h>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace SolarSystem
+{
+    constexpr uint32_t SCENE_NONE = 0xFFFFFFFF;
+
+    // Shaders are compiled .cso paths, textures ending in .dds are loaded as DDS, anything else as a custom texture
+    struct SceneMaterial final
+    {
+        std::string name;
+        std::string vertexShader;
+        std::string pixelShader;
+        std::string textures[4];
+    };
+
+    //
+    // A body orbiting its parent. It expands to an orbit pivot, an orbit point and the body itself,
+    // plus an orbit line, an atmosphere shell and rings when those are enabled. Root bodies have
+    // no orbit and sit at an anchor entity that their children orbit around.
+    //
+    struct SceneBody final
+    {
+        std::string name;
+        // Index of the parent body, which has to come earlier in the scene
+        uint32_t parent = SCENE_NONE;
+        uint32_t material = SCENE_NONE;
+
+        float radius = 1.0f;
+        float spinPeriod = 1.0f;
+
+        // Semi-major axis of the orbit, which is a circle at zero eccentricity
+        float orbitRadius = 0.0f;
+        float orbitEccentricity = 0.0f;
+        float orbitPeriod = 1.0f;
+        // Starting position as a fraction of the orbit period
+        float orbitPhase = 0.0f;
+        // Rotation of the orbit plane and of the spin axis around the x axis, in degrees
+        float orbitInclination = 0.0f;
+        float axisTilt = 0.0f;
+
+        // The body is a camera target when maxDistance is above zero
+        float cameraMinDistance = 0.0f;
+        float cameraMaxDistance = 0.0f;
+
+        // The orbit line is drawn when its alpha is above zero
+        DirectX::SimpleMath::Color orbitLineColor = DirectX::SimpleMath::Color(0.0f, 0.0f, 0.0f, 0.0f);
+
+        uint32_t atmosphereMaterial = SCENE_NONE;
+        float atmosphereScale = 1.0f;
+
+        uint32_t ringMaterial = SCENE_NONE;
+        float ringScale = 1.0f;
+        float ringSpinPeriod = 1.0f;
+        float ringInnerRadius = 1.2f;
+        float ringOuterRadius = 2.5f;
+    };
+
+    // Field of small bodies orbiting a body, spawned from one prefab with randomized orbits and sizes
+    struct SceneBelt final
+    {
+        std::string name;
+        uint32_t parent = SCENE_NONE;
+        uint32_t material = SCENE_NONE;
+        uint32_t count = 0;
+        uint32_t seed = 0;
+
+        float innerRadius = 1.0f;
+        float outerRadius = 2.0f;
+        // Orbit period at the inner radius, farther bodies are slower following Kepler's third law
+        float period = 1.0f;
+        float minSize = 0.05f;
+        float maxSize = 0.1f;
+        // Largest orbit inclination in degrees
+        float thickness = 0.0f;
+    };
+
+    struct SceneDescription final
+    {
+        std::vector<SceneMaterial> materials;
+        std::vector<SceneBody> bodies;
+        std::vector<SceneBelt> belts;
+    };
+
+
+    //
+    // Text scene format for authoring, one material or body per line:
+    //
+    //   # comment
+    //   material <name> vs=<path> ps=<path> [t0=<path>] .. [t3=<path>]
+    //   body <name> [parent=<body>] [material=<material>] [radius=<r>] [spin=<period>] ...
+    //   belt <name> parent=<body> material=<material> count=<n> [inner=<r>] [outer=<r>] ...
+    //
+    // Materials and parents are referenced by name and have to be declared before use.
+    // Colors are written as r,g,b,a. ParseSceneText lists every body and belt key.
+    //
+    auto inline ParseSceneText(std::istream& input) -> SceneDescription
+    {
+        SceneDescription scene;
+        std::unordered_map<std::string, uint32_t> materialIndices;
+        std::unordered_map<std::string, uint32_t> bodyIndices;
+
+        auto lineNumber = 0;
+        auto const fail = [&](std::string const& message) {
+            auto const text = "Scene line " + std::to_string(lineNumber) + ": " + message;
+            throw std::exception(text.c_str());
+        };
+
+        auto const toFloat = [&](std::string const& value) {
+            try
+            {
+                size_t end = 0;
+                auto const result = std::stof(value, &end);
+                if(end == value.size())
+                {
+                    return result;
+                }
+            }
+            catch(std::exception const&)
+            {
+            }
+
+            fail("invalid number '" + value + "'");
+            return 0.0f;
+        };
+
+        auto const toUint = [&](std::string const& value) {
+            try
+            {
+                size_t end = 0;
+                auto const result = std::stoul(value, &end);
+                if(end == value.size() && result <= 0xFFFFFFFFul)
+                {
+                    return static_cast<uint32_t>(result);
+                }
+            }
+            catch(std::exception const&)
+            {
+            }
+
+            fail("invalid integer '" + value + "'");
+            return 0u;
+        };
+
+        auto const toColor = [&](std::string const& value) {
+            float components[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+            auto stream = std::istringstream(value);
+            auto component = std::string();
+            auto count = 0;
+            while(std::getline(stream, component, ','))
+            {
+                if(count == 4)
+                {
+                    fail("color has more than four components");
+                }
+                components[count++] = toFloat(component);
+            }
+
+            if(count < 3)
+            {
+                fail("color needs at least three components");
+            }
+
+            return DirectX::SimpleMath::Color(components[0], components[1], components[2], components[3]);
+        };
+
+        auto const find = [&](std::unordered_map<std::string, uint32_t> const& indices, std::string const& name, char const* const kind) {
+            auto const it = indices.find(name);
+            if(it == indices.end())
+            {
+                fail(std::string("unknown ") + kind + " '" + name + "'");
+            }
+            return it->second;
+        };
+
+        auto line = std::string();
+        while(std::getline(input, line))
+        {
+            lineNumber++;
+
+            auto const comment = line.find('#');
+            if(comment != std::string::npos)
+            {
+                line.erase(comment);
+            }
+
+            auto tokens = std::istringstream(line);
+            auto kind = std::string();
+            auto name = std::string();
+            if(!(tokens >> kind))
+            {
+                continue;
+            }
+
+            if(!(tokens >> name))
+            {
+                fail(kind + " without a name");
+            }
+
+            std::vector<std::pair<std::string, std::string>> properties;
+            auto token = std::string();
+            while(tokens >> token)
+            {
+                auto const equals = token.find('=');
+                if(equals == std::string::npos)
+                {
+                    fail("expected key=value, got '" + token + "'");
+                }
+                properties.emplace_back(token.substr(0, equals), token.substr(equals + 1));
+            }
+
+            if(kind == "material")
+            {
+                if(materialIndices.count(name) > 0)
+                {
+                    fail("material '" + name + "' declared twice");
+                }
+
+                auto& material = scene.materials.emplace_back();
+                material.name = name;
+
+                for(auto const& [key, value] : properties)
+                {
+                    if(key == "vs") material.vertexShader = value;
+                    else if(key == "ps") material.pixelShader = value;
+                    else if(key.size() == 2 && key[0] == 't' && key[1] >= '0' && key[1] <= '3') material.textures[key[1] - '0'] = value;
+                    else fail("unknown material key '" + key + "'");
+                }
+
+                materialIndices.emplace(name, static_cast<uint32_t>(scene.materials.size() - 1));
+            }
+            else if(kind == "body")
+            {
+                if(bodyIndices.count(name) > 0)
+                {
+                    fail("body '" + name + "' declared twice");
+                }
+
+                auto& body = scene.bodies.emplace_back();
+                body.name = name;
+
+                for(auto const& [key, value] : properties)
+                {
+                    if(key == "parent") body.parent = find(bodyIndices, value, "body");
+                    else if(key == "material") body.material = find(materialIndices, value, "material");
+                    else if(key == "radius") body.radius = toFloat(value);
+                    else if(key == "spin") body.spinPeriod = toFloat(value);
+                    else if(key == "orbit") body.orbitRadius = toFloat(value);
+                    else if(key == "eccentricity") body.orbitEccentricity = toFloat(value);
+                    else if(key == "period") body.orbitPeriod = toFloat(value);
+                    else if(key == "phase") body.orbitPhase = toFloat(value);
+                    else if(key == "inclination") body.orbitInclination = toFloat(value);
+                    else if(key == "tilt") body.axisTilt = toFloat(value);
+                    else if(key == "cameraMin") body.cameraMinDistance = toFloat(value);
+                    else if(key == "cameraMax") body.cameraMaxDistance = toFloat(value);
+                    else if(key == "line") body.orbitLineColor = toColor(value);
+                    else if(key == "atmosphere") body.atmosphereMaterial = find(materialIndices, value, "material");
+                    else if(key == "atmosphereScale") body.atmosphereScale = toFloat(value);
+                    else if(key == "rings") body.ringMaterial = find(materialIndices, value, "material");
+                    else if(key == "ringScale") body.ringScale = toFloat(value);
+                    else if(key == "ringSpin") body.ringSpinPeriod = toFloat(value);
+                    else if(key == "ringInner") body.ringInnerRadius = toFloat(value);
+                    else if(key == "ringOuter") body.ringOuterRadius = toFloat(value);
+                    else fail("unknown body key '" + key + "'");
+                }
+
+                if(!(body.orbitEccentricity >= 0.0f && body.orbitEccentricity < 1.0f))
+                {
+                    fail("body '" + name + "' needs an eccentricity from 0 to below 1");
+                }
+
+                bodyIndices.emplace(name, static_cast<uint32_t>(scene.bodies.size() - 1));
+            }
+            else if(kind == "belt")
+            {
+                auto& belt = scene.belts.emplace_back();
+                belt.name = name;
+
+                for(auto const& [key, value] : properties)
+                {
+                    if(key == "parent") belt.parent = find(bodyIndices, value, "body");
+                    else if(key == "material") belt.material = find(materialIndices, value, "material");
+                    else if(key == "count") belt.count = toUint(value);
+                    else if(key == "seed") belt.seed = toUint(value);
+                    else if(key == "inner") belt.innerRadius = toFloat(value);
+                    else if(key == "outer") belt.outerRadius = toFloat(value);
+                    else if(key == "period") belt.period = toFloat(value);
+                    else if(key == "minSize") belt.minSize = toFloat(value);
+                    else if(key == "maxSize") belt.maxSize = toFloat(value);
+                    else if(key == "thickness") belt.thickness = toFloat(value);
+                    else fail("unknown belt key '" + key + "'");
+                }
+
+                if(belt.parent == SCENE_NONE || belt.material == SCENE_NONE)
+                {
+                    fail("belt '" + name + "' needs a parent and a material");
+                }
+            }
+            else
+            {
+                fail("unknown declaration '" + kind + "'");
+            }
+        }
+
+        return scene;
+    }
+
+
+    //
+    // Binary scene format for production: a header, fixed size material, body and belt records and
+    // a string table the records point into. Loading is a single read and a pass over the records.
+    //
+    constexpr uint32_t SCENE_FILE_MAGIC = 0x43535353; // "SSSC"
+    constexpr uint32_t SCENE_FILE_VERSION = 3;
+
+    struct SceneFileHeader final
+    {
+        uint32_t magic = SCENE_FILE_MAGIC;
+        uint32_t version = SCENE_FILE_VERSION;
+        uint32_t materialCount = 0;
+        uint32_t bodyCount = 0;
+        uint32_t beltCount = 0;
+        uint32_t reserved = 0;
+        uint64_t stringTableSize = 0;
+    };
+
+    // Strings are offsets into the string table, each string is null terminated
+    struct SceneFileMaterial final
+    {
+        uint32_t name = 0;
+        uint32_t vertexShader = 0;
+        uint32_t pixelShader = 0;
+        uint32_t textures[4] = { };
+    };
+
+    struct SceneFileBody final
+    {
+        uint32_t name = 0;
+        uint32_t parent = SCENE_NONE;
+        uint32_t material = SCENE_NONE;
+        uint32_t atmosphereMaterial = SCENE_NONE;
+        uint32_t ringMaterial = SCENE_NONE;
+
+        float radius = 1.0f;
+        float spinPeriod = 1.0f;
+        float orbitRadius = 0.0f;
+        float orbitEccentricity = 0.0f;
+        float orbitPeriod = 1.0f;
+        float orbitPhase = 0.0f;
+        float orbitInclination = 0.0f;
+        float axisTilt = 0.0f;
+        float cameraMinDistance = 0.0f;
+        float cameraMaxDistance = 0.0f;
+        float orbitLineColor[4] = { };
+        float atmosphereScale = 1.0f;
+        float ringScale = 1.0f;
+        float ringSpinPeriod = 1.0f;
+        float ringInnerRadius = 1.2f;
+        float ringOuterRadius = 2.5f;
+    };
+
+    struct SceneFileBelt final
+    {
+        uint32_t name = 0;
+        uint32_t parent = SCENE_NONE;
+        uint32_t material = SCENE_NONE;
+        uint32_t count = 0;
+        uint32_t seed = 0;
+
+        float innerRadius = 1.0f;
+        float outerRadius = 2.0f;
+        float period = 1.0f;
+        float minSize = 0.05f;
+        float maxSize = 0.1f;
+        float thickness = 0.0f;
+    };
+
+
+    auto inline WriteSceneBinary(std::filesystem::path const& path, SceneDescription const& scene) -> void
+    {
+        std::vector<char> strings;
+        auto const addString = [&](std::string const& value) {
+            auto const offset = static_cast<uint32_t>(strings.size());
+            strings.insert(strings.end(), value.begin(), value.end());
+            strings.push_back('\0');
+            return offset;
+        };
+
+        std::vector<SceneFileMaterial> materials(scene.materials.size());
+        for(size_t i = 0; i < materials.size(); ++i)
+        {
+            auto const& source = scene.materials[i];
+            materials[i].name = addString(source.name);
+            materials[i].vertexShader = addString(source.vertexShader);
+            materials[i].pixelShader = addString(source.pixelShader);
+            for(auto j = 0; j < 4; ++j)
+            {
+                materials[i].textures[j] = addString(source.textures[j]);
+            }
+        }
+
+        std::vector<SceneFileBody> bodies(scene.bodies.size());
+        for(size_t i = 0; i < bodies.size(); ++i)
+        {
+            auto const& source = scene.bodies[i];
+            auto& body = bodies[i];
+            body.name = addString(source.name);
+            body.parent = source.parent;
+            body.material = source.material;
+            body.atmosphereMaterial = source.atmosphereMaterial;
+            body.ringMaterial = source.ringMaterial;
+            body.radius = source.radius;
+            body.spinPeriod = source.spinPeriod;
+            body.orbitRadius = source.orbitRadius;
+            body.orbitEccentricity = source.orbitEccentricity;
+            body.orbitPeriod = source.orbitPeriod;
+            body.orbitPhase = source.orbitPhase;
+            body.orbitInclination = source.orbitInclination;
+            body.axisTilt = source.axisTilt;
+            body.cameraMinDistance = source.cameraMinDistance;
+            body.cameraMaxDistance = source.cameraMaxDistance;
+            body.orbitLineColor[0] = source.orbitLineColor.x;
+            body.orbitLineColor[1] = source.orbitLineColor.y;
+            body.orbitLineColor[2] = source.orbitLineColor.z;
+            body.orbitLineColor[3] = source.orbitLineColor.w;
+            body.atmosphereScale = source.atmosphereScale;
+            body.ringScale = source.ringScale;
+            body.ringSpinPeriod = source.ringSpinPeriod;
+            body.ringInnerRadius = source.ringInnerRadius;
+            body.ringOuterRadius = source.ringOuterRadius;
+        }
+
+        std::vector<SceneFileBelt> belts(scene.belts.size());
+        for(size_t i = 0; i < belts.size(); ++i)
+        {
+            auto const& source = scene.belts[i];
+            auto& belt = belts[i];
+            belt.name = addString(source.name);
+            belt.parent = source.parent;
+            belt.material = source.material;
+            belt.count = source.count;
+            belt.seed = source.seed;
+            belt.innerRadius = source.innerRadius;
+            belt.outerRadius = source.outerRadius;
+            belt.period = source.period;
+            belt.minSize = source.minSize;
+            belt.maxSize = source.maxSize;
+            belt.thickness = source.thickness;
+        }
+
+        SceneFileHeader header;
+        header.materialCount = static_cast<uint32_t>(materials.size());
+        header.bodyCount = static_cast<uint32_t>(bodies.size());
+        header.beltCount = static_cast<uint32_t>(belts.size());
+        header.stringTableSize = strings.size();
+
+        auto fout = std::ofstream(path, std::ios::out | std::ios::binary | std::ios::trunc);
+        if(!fout)
+        {
+            throw std::exception("Failed to create scene file");
+        }
+
+        fout.write(reinterpret_cast<char const*>(&header), sizeof header);
+        fout.write(reinterpret_cast<char const*>(materials.data()), materials.size() * sizeof(SceneFileMaterial));
+        fout.write(reinterpret_cast<char const*>(bodies.data()), bodies.size() * sizeof(SceneFileBody));
+        fout.write(reinterpret_cast<char const*>(belts.data()), belts.size() * sizeof(SceneFileBelt));
+        fout.write(strings.data(), strings.size());
+
+        if(!fout)
+        {
+            throw std::exception("Failed to write scene file");
+        }
+    }
+
+    auto inline ParseSceneBinary(std::vector<char> const& data) -> SceneDescription
+    {
+        SceneFileHeader header;
+        if(data.size() < sizeof header)
+        {
+            throw std::exception("Scene file is truncated");
+        }
+        std::memcpy(&header, data.data(), sizeof header);
+
+        if(header.magic != SCENE_FILE_MAGIC)
+        {
+            throw std::exception("Not a binary scene file");
+        }
+
+        if(header.version != SCENE_FILE_VERSION)
+        {
+            throw std::exception("Unsupported scene file version");
+        }
+
+        auto const materialsOffset = sizeof header;
+        auto const bodiesOffset = materialsOffset + static_cast<uint64_t>(header.materialCount) * sizeof(SceneFileMaterial);
+        auto const beltsOffset = bodiesOffset + static_cast<uint64_t>(header.bodyCount) * sizeof(SceneFileBody);
+        auto const stringsOffset = beltsOffset + static_cast<uint64_t>(header.beltCount) * sizeof(SceneFileBelt);
+        if(stringsOffset + header.stringTableSize != data.size())
+        {
+            throw std::exception("Scene file size mismatch");
+        }
+
+        auto const strings = data.data() + stringsOffset;
+        auto const getString = [&](uint32_t const offset) {
+            if(offset >= header.stringTableSize)
+            {
+                throw std::exception("Scene string out of range");
+            }
+
+            auto const end = std::memchr(strings + offset, '\0', static_cast<size_t>(header.stringTableSize - offset));
+            if(end == nullptr)
+            {
+                throw std::exception("Scene string is not terminated");
+            }
+
+            return std::string(strings + offset, static_cast<char const*>(end));
+        };
+
+        auto const checkIndex = [](uint32_t const index, size_t const count) {
+            if(index != SCENE_NONE && index >= count)
+            {
+                throw std::exception("Scene index out of range");
+            }
+        };
+
+        SceneDescription scene;
+        scene.materials.resize(header.materialCount);
+        for(size_t i = 0; i < scene.materials.size(); ++i)
+        {
+            SceneFileMaterial source;
+            std::memcpy(&source, data.data() + materialsOffset + i * sizeof source, sizeof source);
+
+            auto& material = scene.materials[i];
+            material.name = getString(source.name);
+            material.vertexShader = getString(source.vertexShader);
+            material.pixelShader = getString(source.pixelShader);
+            for(auto j = 0; j < 4; ++j)
+            {
+                material.textures[j] = getString(source.textures[j]);
+            }
+        }
+
+        scene.bodies.resize(header.bodyCount);
+        for(size_t i = 0; i < scene.bodies.size(); ++i)
+        {
+            SceneFileBody source;
+            std::memcpy(&source, data.data() + bodiesOffset + i * sizeof source, sizeof source);
+
+            if(source.parent != SCENE_NONE && source.parent >= i)
+            {
+                throw std::exception("Scene body parent has to come before the body");
+            }
+            checkIndex(source.material, scene.materials.size());
+            checkIndex(source.atmosphereMaterial, scene.materials.size());
+            checkIndex(source.ringMaterial, scene.materials.size());
+            if(!(source.orbitEccentricity >= 0.0f && source.orbitEccentricity < 1.0f))
+            {
+                throw std::exception("Scene body eccentricity has to be from 0 to below 1");
+            }
+
+            auto& body = scene.bodies[i];
+            body.name = getString(source.name);
+            body.parent = source.parent;
+            body.material = source.material;
+            body.atmosphereMaterial = source.atmosphereMaterial;
+            body.ringMaterial = source.ringMaterial;
+            body.radius = source.radius;
+            body.spinPeriod = source.spinPeriod;
+            body.orbitRadius = source.orbitRadius;
+            body.orbitEccentricity = source.orbitEccentricity;
+            body.orbitPeriod = source.orbitPeriod;
+            body.orbitPhase = source.orbitPhase;
+            body.orbitInclination = source.orbitInclination;
+            body.axisTilt = source.axisTilt;
+            body.cameraMinDistance = source.cameraMinDistance;
+            body.cameraMaxDistance = source.cameraMaxDistance;
+            body.orbitLineColor = DirectX::SimpleMath::Color(source.orbitLineColor[0], source.orbitLineColor[1], source.orbitLineColor[2], source.orbitLineColor[3]);
+            body.atmosphereScale = source.atmosphereScale;
+            body.ringScale = source.ringScale;
+            body.ringSpinPeriod = source.ringSpinPeriod;
+            body.ringInnerRadius = source.ringInnerRadius;
+            body.ringOuterRadius = source.ringOuterRadius;
+        }
+
+        scene.belts.resize(header.beltCount);
+        for(size_t i = 0; i < scene.belts.size(); ++i)
+        {
+            SceneFileBelt source;
+            std::memcpy(&source, data.data() + beltsOffset + i * sizeof source, sizeof source);
+
+            if(source.parent == SCENE_NONE || source.material == SCENE_NONE)
+            {
+                throw std::exception("Scene belt needs a parent and a material");
+            }
+            checkIndex(source.parent, scene.bodies.size());
+            checkIndex(source.material, scene.materials.size());
+
+            auto& belt = scene.belts[i];
+            belt.name = getString(source.name);
+            belt.parent = source.parent;
+            belt.material = source.material;
+            belt.count = source.count;
+            belt.seed = source.seed;
+            belt.innerRadius = source.innerRadius;
+            belt.outerRadius = source.outerRadius;
+            belt.period = source.period;
+            belt.minSize = source.minSize;
+            belt.maxSize = source.maxSize;
+            belt.thickness = source.thickness;
+        }
+
+        return scene;
+    }
+
+
+    // Reads a scene in either form, binary files are recognized by their magic number
+    auto inline LoadSceneFile(std::filesystem::path const& path) -> SceneDescription
+    {
+        auto const memoryTag = MemoryTagScope(MemoryTag::Scene);
+
+        auto fin = std::ifstream(path, std::ios::in | std::ios::binary | std::ios::ate);
+        if(!fin)
+        {
+            throw std::exception("Failed to open scene file");
+        }
+
+        auto data = std::vector<char>(static_cast<size_t>(fin.tellg()));
+        fin.seekg(0, std::ios::beg);
+        fin.read(data.data(), data.size());
+
+        uint32_t magic = 0;
+        if(data.size() >= sizeof magic)
+        {
+            std::memcpy(&magic, data.data(), sizeof magic);
+        }
+
+        if(magic == SCENE_FILE_MAGIC)
+        {
+            return ParseSceneBinary(data);
+        }
+
+        auto text = std::istringstream(std::string(data.begin(), data.end()));
+        return ParseSceneText(text);
+    }
+}
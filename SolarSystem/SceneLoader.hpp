@@ -0,0 +1,508 @@
+#pragma once
+#include "SceneDescription.hpp"
+#include "ECS.hpp"
+#include "Transform.hpp"
+#include "Orbit.hpp"
+#include "Camera.hpp"
+#include "Graphics.hpp"
+#include "Renderer.hpp"
+#include "MeshFile.hpp"
+#include "Prefab.hpp"
+#include <cmath>
+#include <map>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace SolarSystem
+{
+    //
+    // Creates the entities of a scene description. Entity ids are allocated in one block and the
+    // components of each system are staged in body order, then inserted with one batched call per
+    // system, so loading is linear in the number of bodies. Belts are one prefab instantiation each.
+    // Shaders, textures and ring meshes are loaded once per path however many bodies use them.
+    //
+    class SceneLoader final
+    {
+    public:
+        SceneLoader(ECS& ecs, ResourceHandle<MeshLOD> const sphere)
+            :
+            ecs(ecs),
+            sphere(sphere),
+            graphicsSystem(ecs.GetSystem<GraphicsSystem>()),
+            rendererSystem(ecs.GetSystem<RendererSystem>()),
+            worldSystem(ecs.GetSystem<WorldSystem>()),
+            translationSystem(ecs.GetSystem<TranslationSystem>()),
+            rotationSystem(ecs.GetSystem<RotationSystem>()),
+            scalingSystem(ecs.GetSystem<ScalingSystem>()),
+            parentSystem(ecs.GetSystem<ParentSystem>()),
+            orbitSystem(ecs.GetSystem<OrbitSystem>()),
+            rotationalAxisSystem(ecs.GetSystem<RotationalAxisSystem>()),
+            cameraSystem(ecs.GetSystem<CameraSystem>())
+        { }
+
+
+        // Returns the entity children of each body attach to, in body order
+        // Allocations are charged to the scene unless a system or resource tags them more precisely
+        auto Instantiate(SceneDescription const& scene) -> std::vector<Entity>
+        {
+            auto const memoryTag = MemoryTagScope(MemoryTag::Scene);
+
+            std::vector<ResourceHandle<Material>> materials;
+            materials.reserve(scene.materials.size());
+            for(auto const& material : scene.materials)
+            {
+                materials.push_back(CreateMaterial(material));
+            }
+
+            auto const counts = CountComponents(scene);
+            Staging staging(counts);
+            staging.entities = ecs.CreateEntities(counts.entities);
+
+            rendererSystem->Reserve(
+                rendererSystem->GetComponentCount() + counts.renderer,
+                rendererSystem->GetOrbitLineCount() + counts.orbitLines,
+                ecs.GetEntityCount()
+            );
+
+            std::vector<Entity> anchors;
+            anchors.reserve(scene.bodies.size());
+            for(auto const& body : scene.bodies)
+            {
+                if(body.parent != SCENE_NONE && body.parent >= anchors.size())
+                {
+                    throw std::exception("Scene body parent has to come before the body");
+                }
+
+                anchors.push_back(body.parent == SCENE_NONE
+                    ? AddRootBody(staging, body, materials)
+                    : AddOrbitingBody(staging, body, anchors[body.parent], materials));
+            }
+            assert(staging.nextEntity == staging.entities.size());
+
+            staging.world.AddTo(*worldSystem);
+            staging.translation.AddTo(*translationSystem);
+            staging.rotation.AddTo(*rotationSystem);
+            staging.scaling.AddTo(*scalingSystem);
+            staging.parent.AddTo(*parentSystem);
+            staging.orbit.AddTo(*orbitSystem);
+            staging.rotationalAxis.AddTo(*rotationalAxisSystem);
+            staging.camera.AddTo(*cameraSystem);
+
+            for(auto const& belt : scene.belts)
+            {
+                if(belt.parent >= anchors.size())
+                {
+                    throw std::exception("Scene belt parent out of range");
+                }
+                AddBelt(belt, anchors[belt.parent], materials[belt.material]);
+            }
+
+            return anchors;
+        }
+
+    private:
+        struct ComponentCounts final
+        {
+            size_t entities = 0;
+            size_t world = 0;
+            size_t translation = 0;
+            size_t rotation = 0;
+            size_t scaling = 0;
+            size_t parent = 0;
+            size_t orbit = 0;
+            size_t rotationalAxis = 0;
+            size_t camera = 0;
+            size_t renderer = 0;
+            size_t orbitLines = 0;
+        };
+
+        // Components of one system waiting to be inserted, in the order they were created
+        template<typename Component>
+        struct ComponentBatch final
+        {
+            std::vector<Entity> entities;
+            std::vector<Component> components;
+
+            explicit ComponentBatch(size_t const count)
+            {
+                entities.reserve(count);
+                components.reserve(count);
+            }
+
+            auto Add(Entity const entity, Component const& component = Component()) -> void
+            {
+                entities.push_back(entity);
+                components.push_back(component);
+            }
+
+            template<typename System>
+            auto AddTo(System& system) const -> void
+            {
+                system.AddComponents(entities.data(), components.data(), entities.size());
+            }
+        };
+
+        struct Staging final
+        {
+            std::vector<Entity> entities;
+            size_t nextEntity = 0;
+
+            ComponentBatch<WorldMatrixComponent> world;
+            ComponentBatch<TranslationComponent> translation;
+            ComponentBatch<RotationComponent> rotation;
+            ComponentBatch<ScalingComponent> scaling;
+            ComponentBatch<ParentComponent> parent;
+            ComponentBatch<OrbitComponent> orbit;
+            ComponentBatch<RotationalAxisComponent> rotationalAxis;
+            ComponentBatch<CameraTargetComponent> camera;
+
+            explicit Staging(ComponentCounts const& counts)
+                :
+                world(counts.world),
+                translation(counts.translation),
+                rotation(counts.rotation),
+                scaling(counts.scaling),
+                parent(counts.parent),
+                orbit(counts.orbit),
+                rotationalAxis(counts.rotationalAxis),
+                camera(counts.camera)
+            { }
+
+            auto CreateEntity() -> Entity
+            {
+                return entities[nextEntity++];
+            }
+        };
+
+        // Mirrors the entities AddRootBody and AddOrbitingBody create
+        static auto CountComponents(SceneDescription const& scene) -> ComponentCounts
+        {
+            ComponentCounts counts;
+            for(auto const& body : scene.bodies)
+            {
+                auto const isRoot = body.parent == SCENE_NONE;
+
+                // Anchor or orbit pivot and orbit point
+                counts.entities += isRoot ? 1 : 2;
+                counts.world += isRoot ? 1 : 2;
+                counts.rotation += isRoot ? 0 : 2;
+                counts.parent += isRoot ? 0 : 2;
+                counts.translation += isRoot ? 0 : 1;
+                counts.orbit += isRoot ? 0 : 1;
+
+                // Body
+                counts.entities++;
+                counts.world++;
+                counts.translation += isRoot ? 0 : 1;
+                counts.scaling++;
+                counts.rotation++;
+                counts.rotationalAxis++;
+                counts.parent++;
+                counts.camera += body.cameraMaxDistance > 0.0f ? 1 : 0;
+                counts.renderer += body.material != SCENE_NONE ? 1 : 0;
+
+                if(!isRoot && body.orbitLineColor.w > 0.0f)
+                {
+                    counts.entities++;
+                    counts.world++;
+                    counts.parent++;
+                    counts.orbitLines++;
+                }
+
+                if(body.atmosphereMaterial != SCENE_NONE)
+                {
+                    counts.entities++;
+                    counts.world++;
+                    counts.scaling++;
+                    counts.parent++;
+                    counts.renderer++;
+                }
+
+                if(body.ringMaterial != SCENE_NONE)
+                {
+                    counts.entities++;
+                    counts.world++;
+                    counts.scaling++;
+                    counts.rotation++;
+                    counts.rotationalAxis++;
+                    counts.parent++;
+                    counts.renderer++;
+                }
+            }
+
+            return counts;
+        }
+
+
+        auto AddRootBody(Staging& staging, SceneBody const& body, std::vector<ResourceHandle<Material>> const& materials) -> Entity
+        {
+            auto const anchor = staging.CreateEntity();
+            staging.world.Add(anchor);
+
+            auto const entity = AddBodyEntity(staging, body, anchor, materials, false);
+            AddDecorations(staging, body, anchor, entity, materials);
+
+            return anchor;
+        }
+
+        auto AddOrbitingBody(
+            Staging& staging,
+            SceneBody const& body,
+            Entity const parent,
+            std::vector<ResourceHandle<Material>> const& materials
+        ) -> Entity
+        {
+            auto const pivot = staging.CreateEntity();
+            staging.world.Add(pivot);
+            staging.rotation.Add(pivot, { RotationAboutRight(body.orbitInclination) });
+            staging.parent.Add(pivot, { parent });
+
+            auto const orbitPoint = staging.CreateEntity();
+            auto orbit = OrbitComponent(body.orbitRadius, -body.orbitPeriod, body.orbitEccentricity);
+            orbit.t = body.orbitPhase * body.orbitPeriod;
+            staging.world.Add(orbitPoint);
+            staging.translation.Add(orbitPoint);
+            staging.rotation.Add(orbitPoint, { RotationAboutRight(body.axisTilt) });
+            staging.orbit.Add(orbitPoint, orbit);
+            staging.parent.Add(orbitPoint, { pivot });
+
+            auto const entity = AddBodyEntity(staging, body, orbitPoint, materials, true);
+
+            if(body.orbitLineColor.w > 0.0f)
+            {
+                auto const line = staging.CreateEntity();
+                staging.world.Add(line);
+                staging.parent.Add(line, { pivot });
+
+                OrbitLine orbitLine;
+                orbitLine.color = body.orbitLineColor;
+                orbitLine.semiMajorAxis = body.orbitRadius;
+                orbitLine.eccentricity = body.orbitEccentricity;
+                orbitLine.body = orbitPoint;
+                rendererSystem->AddOrbitLine(line, orbitLine);
+            }
+
+            AddDecorations(staging, body, orbitPoint, entity, materials);
+
+            return orbitPoint;
+        }
+
+        auto AddBodyEntity(
+            Staging& staging,
+            SceneBody const& body,
+            Entity const parent,
+            std::vector<ResourceHandle<Material>> const& materials,
+            bool const translated
+        ) -> Entity
+        {
+            auto const entity = staging.CreateEntity();
+            staging.world.Add(entity);
+            if(translated)
+            {
+                staging.translation.Add(entity);
+            }
+            staging.scaling.Add(entity, { DirectX::SimpleMath::Vector3(body.radius, body.radius, body.radius) });
+            staging.rotation.Add(entity);
+            staging.rotationalAxis.Add(entity, { -body.spinPeriod });
+            if(body.cameraMaxDistance > 0.0f)
+            {
+                staging.camera.Add(entity, { body.cameraMinDistance, body.cameraMaxDistance });
+            }
+            staging.parent.Add(entity, { parent });
+            if(body.material != SCENE_NONE)
+            {
+                rendererSystem->AddComponent(entity, sphere, materials[body.material]);
+            }
+
+            return entity;
+        }
+
+        // Atmosphere shells follow the body, rings follow the orbit point so they keep their own spin
+        auto AddDecorations(
+            Staging& staging,
+            SceneBody const& body,
+            Entity const anchor,
+            Entity const entity,
+            std::vector<ResourceHandle<Material>> const& materials
+        ) -> void
+        {
+            if(body.atmosphereMaterial != SCENE_NONE)
+            {
+                auto const atmosphere = staging.CreateEntity();
+                staging.world.Add(atmosphere);
+                staging.scaling.Add(atmosphere, { DirectX::SimpleMath::Vector3(body.atmosphereScale, body.atmosphereScale, body.atmosphereScale) });
+                staging.parent.Add(atmosphere, { entity });
+                rendererSystem->AddComponent(atmosphere, sphere, materials[body.atmosphereMaterial], RendererSystem::BlendMode::Add);
+            }
+
+            if(body.ringMaterial != SCENE_NONE)
+            {
+                auto const rings = staging.CreateEntity();
+                staging.world.Add(rings);
+                staging.scaling.Add(rings, { DirectX::SimpleMath::Vector3(body.ringScale, body.ringScale, body.ringScale) });
+                staging.rotation.Add(rings);
+                staging.rotationalAxis.Add(rings, { -body.ringSpinPeriod });
+                staging.parent.Add(rings, { anchor });
+                rendererSystem->AddComponent(
+                    rings,
+                    GetRingMesh(body.ringInnerRadius, body.ringOuterRadius),
+                    materials[body.ringMaterial],
+                    RendererSystem::BlendMode::Alpha
+                );
+            }
+        }
+
+
+        // Every belt body is an inclined pivot, an orbit point and the body itself
+        auto AddBelt(SceneBelt const& belt, Entity const parent, ResourceHandle<Material> const material) -> void
+        {
+            Prefab prefab;
+
+            auto const pivot = prefab.CreateEntity();
+            prefab.AddComponent<WorldSystem>(pivot);
+            prefab.AddComponent<RotationSystem>(pivot);
+            prefab.AddComponent<ParentSystem>(pivot, { Prefab::PARENT });
+
+            auto const orbitPoint = prefab.CreateEntity();
+            prefab.AddComponent<WorldSystem>(orbitPoint);
+            prefab.AddComponent<TranslationSystem>(orbitPoint);
+            prefab.AddComponent<OrbitSystem>(orbitPoint);
+            prefab.AddComponent<ParentSystem>(orbitPoint, { pivot });
+
+            auto const body = prefab.CreateEntity();
+            prefab.AddComponent<WorldSystem>(body);
+            prefab.AddComponent<TranslationSystem>(body);
+            prefab.AddComponent<ScalingSystem>(body);
+            prefab.AddComponent<ParentSystem>(body, { orbitPoint });
+            prefab.AddComponent<RendererSystem>(body, { { }, sphere, material });
+
+            auto random = std::mt19937(belt.seed);
+            auto unit = std::uniform_real_distribution<float>(0.0f, 1.0f);
+            auto const parents = std::vector<Entity>(belt.count, parent);
+
+            prefab.Instantiate(ecs, belt.count, parents.data(), [&](Prefab::Instance const& instance) {
+                auto const radius = belt.innerRadius + (belt.outerRadius - belt.innerRadius) * unit(random);
+                auto const period = belt.period * std::pow(radius / belt.innerRadius, 1.5f);
+                auto const phase = unit(random);
+                auto const node = unit(random) * DirectX::XM_2PI;
+                auto const inclination = DirectX::XMConvertToRadians(belt.thickness * (unit(random) * 2.0f - 1.0f));
+                auto const size = belt.minSize + (belt.maxSize - belt.minSize) * unit(random);
+
+                instance.Get<RotationSystem>(pivot).rotation = DirectX::SimpleMath::Quaternion::CreateFromYawPitchRoll(node, inclination, 0.0f);
+
+                auto& orbit = instance.Get<OrbitSystem>(orbitPoint);
+                orbit = OrbitComponent(radius, -period);
+                orbit.t = phase * period;
+
+                instance.Get<ScalingSystem>(body).scaling = DirectX::SimpleMath::Vector3(size, size, size);
+            });
+        }
+
+
+        auto CreateMaterial(SceneMaterial const& source) -> ResourceHandle<Material>
+        {
+            Material material;
+            material.vertexShader = GetVertexShader(source.vertexShader);
+            material.pixelShader = GetPixelShader(source.pixelShader);
+            for(auto i = 0; i < 4; ++i)
+            {
+                material.pixelShaderResourceViews[i] = GetTexture(source.textures[i]);
+            }
+
+            return rendererSystem->CreateMaterial(material);
+        }
+
+        auto GetVertexShader(std::string const& path) -> ResourceHandle<VertexShader>
+        {
+            auto const it = vertexShaders.find(path);
+            if(it != vertexShaders.end())
+            {
+                return it->second;
+            }
+
+            return vertexShaders[path] = graphicsSystem->CreateVertexShader(LoadBytecode(path));
+        }
+
+        auto GetPixelShader(std::string const& path) -> ResourceHandle<PixelShader>
+        {
+            auto const it = pixelShaders.find(path);
+            if(it != pixelShaders.end())
+            {
+                return it->second;
+            }
+
+            return pixelShaders[path] = graphicsSystem->CreatePixelShader(LoadBytecode(path));
+        }
+
+        // Empty paths leave the slot unbound
+        auto GetTexture(std::string const& path) -> ResourceHandle<ShaderResouceView>
+        {
+            if(path.empty())
+            {
+                return { };
+            }
+
+            auto const it = textures.find(path);
+            if(it != textures.end())
+            {
+                return it->second;
+            }
+
+            auto const fileName = std::filesystem::path(path);
+            auto const isDDS = fileName.extension() == ".dds";
+            return textures[path] = isDDS
+                ? graphicsSystem->LoadTexture2D(fileName.wstring().c_str())
+                : graphicsSystem->LoadTextureCustom(fileName.wstring().c_str());
+        }
+
+        auto GetRingMesh(float const innerRadius, float const outerRadius) -> ResourceHandle<Mesh>
+        {
+            auto const key = std::make_pair(innerRadius, outerRadius);
+            auto const it = ringMeshes.find(key);
+            if(it != ringMeshes.end())
+            {
+                return it->second;
+            }
+
+            auto const fileName = L"Cache/ring_" + std::to_wstring(RING_SIDES)
+                + L"_" + std::to_wstring(std::lround(innerRadius * 1000.0f))
+                + L"_" + std::to_wstring(std::lround(outerRadius * 1000.0f)) + L".mesh";
+
+            return ringMeshes[key] = rendererSystem->CreateMesh(LoadOrCreateMesh(fileName.c_str(), [&] {
+                return Procedural::CreateRing(RING_SIDES, innerRadius, outerRadius);
+            }), MeshRetention::Drop);
+        }
+
+        static auto RotationAboutRight(float const degrees) -> DirectX::SimpleMath::Quaternion
+        {
+            return DirectX::SimpleMath::Quaternion::CreateFromAxisAngle(
+                DirectX::SimpleMath::Vector3::Right,
+                DirectX::XMConvertToRadians(degrees)
+            );
+        }
+
+
+        static constexpr int RING_SIDES = 128;
+
+        ECS& ecs;
+        ResourceHandle<MeshLOD> sphere;
+
+        GraphicsSystem* graphicsSystem;
+        RendererSystem* rendererSystem;
+        WorldSystem* worldSystem;
+        TranslationSystem* translationSystem;
+        RotationSystem* rotationSystem;
+        ScalingSystem* scalingSystem;
+        ParentSystem* parentSystem;
+        OrbitSystem* orbitSystem;
+        RotationalAxisSystem* rotationalAxisSystem;
+        CameraSystem* cameraSystem;
+
+        std::unordered_map<std::string, ResourceHandle<VertexShader>> vertexShaders;
+        std::unordered_map<std::string, ResourceHandle<PixelShader>> pixelShaders;
+        std::unordered_map<std::string, ResourceHandle<ShaderResouceView>> textures;
+        std::map<std::pair<float, float>, ResourceHandle<Mesh>> ringMeshes;
+    };
+}
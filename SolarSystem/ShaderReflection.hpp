@@ -19,6 +19,7 @@ namespace SolarSystem
         struct SignatureParameter final
         {
             std::string semanticName;
+            int semanticIndex = 0;
             DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
             int registerIndex = 0;
             std::bitset<8> registerMask = 0;
@@ -77,6 +78,7 @@ namespace SolarSystem
             parameter.registerIndex = desc.Register;
             parameter.registerMask = desc.Mask;
             parameter.semanticName = desc.SemanticName;
+            parameter.semanticIndex = static_cast<int>(desc.SemanticIndex);
             
             if(desc.ComponentType == D3D_REGISTER_COMPONENT_FLOAT32)
             {
@@ -79,4 +79,13 @@ half4 UpsampleTent(texture2D<half4> tex, SamplerState texSampler, float2 uv, flo
 	s += tex.Sample(texSampler, uv + d.xy);
 
 	return s * (1.0 / 16.0);
+}
+
+// Inverse of VertexPacking::EncodeOctahedral
+float3 OctahedralDecode(float2 e)
+{
+	float3 n = float3(e.x, e.y, 1.0f - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0f);
+	n.xy += n.xy >= 0.0f ? -t : t;
+	return normalize(n);
 }
\ No newline at end of file
@@ -0,0 +1,48 @@
+struct Input
+{
+	float anomaly : ANOMALY;
+	float fade : FADE;
+
+	// Per instance
+	float4 world0 : INSTANCE_WORLD0;
+	float4 world1 : INSTANCE_WORLD1;
+	float4 world2 : INSTANCE_WORLD2;
+	float4 world3 : INSTANCE_WORLD3;
+	float4 color : COLOR;
+	// Semi-major axis, eccentricity, fade power, true anomaly of the body
+	float4 orbit : ORBIT;
+};
+
+struct Output
+{
+	float4 screenPosition : SV_POSITION;
+	float3 worldPosition : POSITION;
+	float4 color : COLOR;
+};
+
+
+cbuffer PerObject : register(b0)
+{
+	float4x4 WVP;
+	float4x4 WORLD;
+}
+
+Output main(Input i)
+{
+	// The mesh's anomalies and fade ramp are relative to the body, so the trail follows it along the path.
+	// Ellipse from the true anomaly with the focus at the origin and periapsis along +z,
+	// uniform steps in true anomaly place the vertices densest around periapsis
+	float a = i.orbit.x;
+	float e = i.orbit.y;
+	float anomaly = i.anomaly + i.orbit.w;
+	float r = a * (1.0f - e * e) / (1.0f + e * cos(anomaly));
+	float3 local = float3(sin(anomaly) * r, 0.0f, cos(anomaly) * r);
+
+	float3 world = local.x * i.world0.xyz + local.y * i.world1.xyz + local.z * i.world2.xyz + i.world3.xyz;
+
+	Output o;
+	o.screenPosition = mul(WVP, float4(world, 1.0f));
+	o.worldPosition = world;
+	o.color = float4(i.color.rgb, i.color.a * pow(i.fade, i.orbit.z));
+	return o;
+}
\ No newline at end of file
@@ -0,0 +1,126 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <type_traits>
+#include <vector>
+
+namespace SolarSystem
+{
+    // Serialized ECS state, see ECS::SaveSnapshot
+    struct Snapshot final
+    {
+        std::vector<char> data;
+    };
+
+
+    class SnapshotWriter final
+    {
+    public:
+        explicit SnapshotWriter(std::vector<char>& data): data(data)
+        { }
+
+        auto Write(void const* const bytes, size_t const size) -> void
+        {
+            auto const offset = data.size();
+            data.resize(offset + size);
+            if(size > 0)
+            {
+                std::memcpy(data.data() + offset, bytes, size);
+            }
+        }
+
+        template<typename T>
+        auto WriteValue(T const& value) -> void
+        {
+            static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable values are written as bytes");
+            Write(&value, sizeof value);
+        }
+
+        // Position to patch a value written later with WriteValueAt
+        auto GetSize() const -> size_t
+        {
+            return data.size();
+        }
+
+        template<typename T>
+        auto WriteValueAt(size_t const offset, T const& value) -> void
+        {
+            static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable values are written as bytes");
+            std::memcpy(data.data() + offset, &value, sizeof value);
+        }
+
+    private:
+        std::vector<char>& data;
+    };
+
+
+    class SnapshotReader final
+    {
+    public:
+        SnapshotReader(char const* const begin, char const* const end): cursor(begin), end(end)
+        { }
+
+        auto Read(void* const bytes, size_t const size) -> void
+        {
+            if(static_cast<size_t>(end - cursor) < size)
+            {
+                throw std::exception("Snapshot is truncated");
+            }
+
+            if(size > 0)
+            {
+                std::memcpy(bytes, cursor, size);
+            }
+            cursor += size;
+        }
+
+        template<typename T>
+        auto ReadValue() -> T
+        {
+            static_assert(std::is_trivially_copyable_v<T>, "Only trivially copyable values are read as bytes");
+            T value;
+            Read(&value, sizeof value);
+            return value;
+        }
+
+        auto Skip(size_t const size) -> void
+        {
+            if(static_cast<size_t>(end - cursor) < size)
+            {
+                throw std::exception("Snapshot is truncated");
+            }
+            cursor += size;
+        }
+
+        auto GetCursor() const -> char const*
+        {
+            return cursor;
+        }
+
+        auto IsAtEnd() const -> bool
+        {
+            return cursor == end;
+        }
+
+    private:
+        char const* cursor;
+        char const* end;
+    };
+
+
+    // Components that are not trivially copyable overload these two, the rest are copied as bytes
+    template<typename Component>
+    auto SerializeComponent(SnapshotWriter& writer, Component const& component) -> void
+    {
+        static_assert(std::is_trivially_copyable_v<Component>, "Component needs SerializeComponent and DeserializeComponent overloads");
+        writer.WriteValue(component);
+    }
+
+    template<typename Component>
+    auto DeserializeComponent(SnapshotReader& reader, Component& component) -> void
+    {
+        static_assert(std::is_trivially_copyable_v<Component>, "Component needs SerializeComponent and DeserializeComponent overloads");
+        component = reader.ReadValue<Component>();
+    }
+}
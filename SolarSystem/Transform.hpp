@@ -1,8 +1,10 @@
 #pragma once
 #include "ECS.hpp"
+#include "Vector3d.hpp"
 
 #include <d3d11.h>
 #include <SimpleMath.h>
+#include <utility>
 
 namespace SolarSystem
 {
@@ -112,6 +114,17 @@ namespace SolarSystem
     struct WorldMatrixComponent final
     {
         DirectX::SimpleMath::Matrix world;
+
+        // Translation of world in double precision, world only holds it rounded to float
+        Vector3d position;
+
+        // World matrix with the translation taken relative to origin, keeps float precision near the camera
+        auto GetRelativeWorld(Vector3d const& origin) const -> DirectX::SimpleMath::Matrix
+        {
+            auto relative = world;
+            relative.Translation((position - origin).ToVector3());
+            return relative;
+        }
     };
 
     class WorldMatrixFromTranslationRotationScalingSystem final : public ECSSystem<WorldMatrixFromTranslationRotationScalingSystem, WorldMatrixComponent>
@@ -144,18 +157,20 @@ namespace SolarSystem
 
     class WorldSystem final : public ECSSystem<WorldSystem, WorldMatrixComponent>
     {
+    public:
         auto Update(float, float) -> void override
         {
             components.Each([this](Entity const entity, WorldMatrixComponent& worldComponent) {
 
                 worldComponent.world = DirectX::SimpleMath::Matrix::Identity;
+                worldComponent.position = { };
             });
         }
     };
 
     struct TranslationComponent final
     {
-        DirectX::SimpleMath::Vector3 translation;
+        Vector3d translation;
     };
 
     class TranslationSystem final : public ECSSystem<TranslationSystem, TranslationComponent>
@@ -170,10 +185,11 @@ namespace SolarSystem
 
         auto Update(float, float) -> void override
         {
-            components.Each([this](Entity const entity, TranslationComponent& translationComponent) {
+            std::as_const(components).Each([this](Entity const entity, TranslationComponent const& translationComponent) {
                 
-                auto& worldMatrix = worldMatrixSystem->GetComponent(entity).world;
-                worldMatrix *= DirectX::SimpleMath::Matrix::CreateTranslation(translationComponent.translation);
+                auto& worldMatrix = worldMatrixSystem->GetComponent(entity);
+                worldMatrix.position += translationComponent.translation;
+                worldMatrix.world.Translation(worldMatrix.position.ToVector3());
             });
         }
     };
@@ -195,11 +211,14 @@ namespace SolarSystem
 
         auto Update(float, float) -> void override
         {
-            components.Each([this](Entity const entity, RotationComponent& rotationComponent) {
+            std::as_const(components).Each([this](Entity const entity, RotationComponent const& rotationComponent) {
 
-                auto& worldMatrix = worldMatrixSystem->GetComponent(entity).world;
+                auto& worldMatrix = worldMatrixSystem->GetComponent(entity);
+                auto const rotation = DirectX::SimpleMath::Matrix::CreateFromQuaternion(rotationComponent.rotation);
 
-                worldMatrix *= DirectX::SimpleMath::Matrix::CreateFromQuaternion(rotationComponent.rotation);
+                worldMatrix.world *= rotation;
+                worldMatrix.position = Vector3d::TransformNormal(worldMatrix.position, rotation);
+                worldMatrix.world.Translation(worldMatrix.position.ToVector3());
             });
         }
     };
@@ -221,10 +240,14 @@ namespace SolarSystem
 
         auto Update(float, float) -> void override
         {
-            components.Each([this](Entity const entity, ScalingComponent& scalingComponent) {
+            std::as_const(components).Each([this](Entity const entity, ScalingComponent const& scalingComponent) {
+
+                auto& worldMatrix = worldMatrixSystem->GetComponent(entity);
+                auto const scaling = DirectX::SimpleMath::Matrix::CreateScale(scalingComponent.scaling);
 
-                auto& worldMatrix = worldMatrixSystem->GetComponent(entity).world;
-                worldMatrix *= DirectX::SimpleMath::Matrix::CreateScale(scalingComponent.scaling);
+                worldMatrix.world *= scaling;
+                worldMatrix.position = Vector3d::TransformNormal(worldMatrix.position, scaling);
+                worldMatrix.world.Translation(worldMatrix.position.ToVector3());
                 });
         }
     };
@@ -235,6 +258,12 @@ namespace SolarSystem
         Entity parent;
     };
 
+    template <typename Remap>
+    auto RemapEntityReferences(ParentComponent& component, Remap const& remap) -> void
+    {
+        component.parent = remap(component.parent);
+    }
+
     class ParentSystem final : public ECSSystem<ParentSystem, ParentComponent>
     {
         WorldSystem* worldSystem = nullptr;
@@ -247,11 +276,13 @@ namespace SolarSystem
 
         auto Update(float, float) -> void override
         {
-            components.Each([this](Entity const entity, ParentComponent const& component) {
+            std::as_const(components).Each([this](Entity const entity, ParentComponent const& component) {
                 auto& parent = worldSystem->GetComponent(component.parent);
                 auto& child = worldSystem->GetComponent(entity);
 
                 child.world = child.world * parent.world;
+                child.position = Vector3d::TransformNormal(child.position, parent.world) + parent.position;
+                child.world.Translation(child.position.ToVector3());
             });
         }
     };
@@ -0,0 +1,78 @@
+#pragma once
+#include <SimpleMath.h>
+#include <cmath>
+
+namespace SolarSystem
+{
+    // Double precision position for the simulation, converted to float only relative to the camera
+    struct Vector3d final
+    {
+        double x = 0.0;
+        double y = 0.0;
+        double z = 0.0;
+
+        Vector3d() = default;
+
+        Vector3d(double const x, double const y, double const z): x(x), y(y), z(z)
+        { }
+
+        explicit Vector3d(DirectX::SimpleMath::Vector3 const& v): x(v.x), y(v.y), z(v.z)
+        { }
+
+        auto ToVector3() const -> DirectX::SimpleMath::Vector3
+        {
+            return { static_cast<float>(x), static_cast<float>(y), static_cast<float>(z) };
+        }
+
+        auto LengthSquared() const -> double
+        {
+            return x * x + y * y + z * z;
+        }
+
+        auto Length() const -> double
+        {
+            return std::sqrt(LengthSquared());
+        }
+
+        auto operator+=(Vector3d const& other) -> Vector3d&
+        {
+            x += other.x;
+            y += other.y;
+            z += other.z;
+            return *this;
+        }
+
+        auto operator-=(Vector3d const& other) -> Vector3d&
+        {
+            x -= other.x;
+            y -= other.y;
+            z -= other.z;
+            return *this;
+        }
+
+        // Multiplies by the upper 3x3 of a row vector matrix, translation is ignored
+        static auto TransformNormal(Vector3d const& v, DirectX::SimpleMath::Matrix const& m) -> Vector3d
+        {
+            return {
+                v.x * m._11 + v.y * m._21 + v.z * m._31,
+                v.x * m._12 + v.y * m._22 + v.z * m._32,
+                v.x * m._13 + v.y * m._23 + v.z * m._33
+            };
+        }
+    };
+
+    auto inline operator+(Vector3d const& a, Vector3d const& b) -> Vector3d
+    {
+        return { a.x + b.x, a.y + b.y, a.z + b.z };
+    }
+
+    auto inline operator-(Vector3d const& a, Vector3d const& b) -> Vector3d
+    {
+        return { a.x - b.x, a.y - b.y, a.z - b.z };
+    }
+
+    auto inline operator*(Vector3d const& v, double const s) -> Vector3d
+    {
+        return { v.x * s, v.y * s, v.z * s };
+    }
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include <SimpleMath.h>
+#include <DirectXPackedVector.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace SolarSystem
+{
+    namespace VertexPacking
+    {
+        // Same conversions the input assembler applies to SNORM formats
+        auto inline PackSnorm16(float const value) -> int16_t
+        {
+            return static_cast<int16_t>(std::lround(std::clamp(value, -1.0f, 1.0f) * 32767.0f));
+        }
+
+        auto inline UnpackSnorm16(int16_t const value) -> float
+        {
+            return (std::max)(value / 32767.0f, -1.0f);
+        }
+
+        auto inline PackSnorm8(float const value) -> int8_t
+        {
+            return static_cast<int8_t>(std::lround(std::clamp(value, -1.0f, 1.0f) * 127.0f));
+        }
+
+        auto inline UnpackSnorm8(int8_t const value) -> float
+        {
+            return (std::max)(value / 127.0f, -1.0f);
+        }
+
+        auto inline PackHalf(float const value) -> uint16_t
+        {
+            return DirectX::PackedVector::XMConvertFloatToHalf(value);
+        }
+
+        auto inline UnpackHalf(uint16_t const value) -> float
+        {
+            return DirectX::PackedVector::XMConvertHalfToFloat(value);
+        }
+
+
+        //
+        // Octahedral normal encoding: the unit sphere is projected onto an octahedron and the lower half
+        // is folded over the upper one, giving two coordinates in [-1, 1] with nearly uniform precision.
+        // The shader side is OctahedralDecode in Common.hlsli.
+        //
+        auto inline EncodeOctahedral(DirectX::SimpleMath::Vector3 const& normal) -> DirectX::SimpleMath::Vector2
+        {
+            auto const l1 = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+            if(l1 == 0.0f)
+            {
+                return { 0.0f, 0.0f };
+            }
+
+            auto x = normal.x / l1;
+            auto y = normal.y / l1;
+
+            if(normal.z < 0.0f)
+            {
+                auto const foldedX = (1.0f - std::abs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+                auto const foldedY = (1.0f - std::abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+                x = foldedX;
+                y = foldedY;
+            }
+
+            return { x, y };
+        }
+
+        auto inline DecodeOctahedral(DirectX::SimpleMath::Vector2 const& encoded) -> DirectX::SimpleMath::Vector3
+        {
+            auto normal = DirectX::SimpleMath::Vector3(encoded.x, encoded.y, 1.0f - std::abs(encoded.x) - std::abs(encoded.y));
+
+            auto const t = (std::max)(-normal.z, 0.0f);
+            normal.x += normal.x >= 0.0f ? -t : t;
+            normal.y += normal.y >= 0.0f ? -t : t;
+            normal.Normalize();
+
+            return normal;
+        }
+    }
+}
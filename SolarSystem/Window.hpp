@@ -1,5 +1,7 @@
 #pragma once
 #include "ECS.hpp"
+#include "Replay.hpp"
+#include <algorithm>
 #include <array>
 
 #define WIN32_LEAN_AND_MEAN
@@ -23,8 +25,11 @@ namespace SolarSystem
         E = 0x45,
         Z = 0x5A,
         X = 0x58,
+        F5 = VK_F5,
+        F9 = VK_F9,
         LShift = VK_SHIFT,
-        LCtrl = VK_CONTROL
+        LCtrl = VK_CONTROL,
+        LeftMouse = VK_LBUTTON
     };
     class WindowSystem final : public ECSSystem<WindowSystem>
     {
@@ -47,15 +52,28 @@ namespace SolarSystem
         {
             sizeChanged = false;
 
-            MSG msg;
-            while(PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE))
+            if(replayPlayer != nullptr)
             {
-                TranslateMessage(&msg);
-                DispatchMessage(&msg);
+                ReadReplayInput(replayPlayer->GetFrame());
+            }
+            else
+            {
+                MSG msg;
+                while(PeekMessage(&msg, nullptr, 0, 0, PM_REMOVE))
+                {
+                    TranslateMessage(&msg);
+                    DispatchMessage(&msg);
+                }
+
+                UpdateKeys();
             }
 
-            UpdateKeys();
             UpdateAxes(deltaTime);
+
+            if(replayRecorder != nullptr)
+            {
+                WriteReplayInput(replayRecorder->GetFrame());
+            }
         }
 
 
@@ -108,6 +126,33 @@ namespace SolarSystem
         }
 
 
+        // Keys in the order their state is stored in replay frames
+        auto GetTrackedKeys() const -> std::vector<uint8_t>
+        {
+            auto trackedKeys = std::vector<uint8_t>(keysData.size());
+            std::transform(keysData.begin(), keysData.end(), trackedKeys.begin(), [](KeyData const& keyData) {
+                return static_cast<uint8_t>(keyData.virtualKey);
+            });
+            return trackedKeys;
+        }
+
+        // Input is written to the recorder's current frame after every update
+        auto SetReplayRecorder(ReplayRecorder* const recorder) -> void
+        {
+            replayRecorder = recorder;
+        }
+
+        // Input comes from the player's current frame instead of window messages while it is set
+        auto SetReplayPlayer(ReplayPlayer* const player) -> void
+        {
+            if(player != nullptr && player->GetVirtualKeys() != GetTrackedKeys())
+            {
+                throw std::exception("Replay log was recorded with different keys");
+            }
+            replayPlayer = player;
+        }
+
+
         auto GetKey(VirtualKey const virtualKey) -> bool
         {
 
@@ -163,6 +208,17 @@ namespace SolarSystem
             return sizeChanged;
         }
 
+        // Last cursor position over the client area in pixels
+        auto GetCursorX() const -> int
+        {
+            return cursorX;
+        }
+
+        auto GetCursorY() const -> int
+        {
+            return cursorY;
+        }
+
     private:
         auto RegisterWindowClass() const -> void
         {
@@ -241,6 +297,42 @@ namespace SolarSystem
             }
         }
 
+        auto WriteReplayInput(ReplayFrame& frame) const -> void
+        {
+            for(size_t i = 0; i < keysData.size(); ++i)
+            {
+                auto const& keyData = keysData[i];
+                frame.keys[i] = (keyData.isDown ? REPLAY_KEY_IS_DOWN : 0)
+                    | (keyData.wasPressed ? REPLAY_KEY_WAS_PRESSED : 0)
+                    | (keyData.wasHold ? REPLAY_KEY_WAS_HOLD : 0)
+                    | (keyData.wasReleased ? REPLAY_KEY_WAS_RELEASED : 0);
+            }
+
+            frame.cursorX = cursorX;
+            frame.cursorY = cursorY;
+            frame.width = width;
+            frame.height = height;
+            frame.sizeChanged = sizeChanged;
+        }
+
+        auto ReadReplayInput(ReplayFrame const& frame) -> void
+        {
+            for(size_t i = 0; i < keysData.size(); ++i)
+            {
+                auto& keyData = keysData[i];
+                keyData.isDown = (frame.keys[i] & REPLAY_KEY_IS_DOWN) != 0;
+                keyData.wasPressed = (frame.keys[i] & REPLAY_KEY_WAS_PRESSED) != 0;
+                keyData.wasHold = (frame.keys[i] & REPLAY_KEY_WAS_HOLD) != 0;
+                keyData.wasReleased = (frame.keys[i] & REPLAY_KEY_WAS_RELEASED) != 0;
+            }
+
+            cursorX = frame.cursorX;
+            cursorY = frame.cursorY;
+            width = frame.width;
+            height = frame.height;
+            sizeChanged = frame.sizeChanged;
+        }
+
         auto UpdateAxes(float const deltaTime) -> void
         {
             for(auto& axisData : axes)
@@ -356,6 +448,26 @@ namespace SolarSystem
                     keysReceivedMessages[wParam].isDown = false;
                     return 0;
                 }
+            case WM_LBUTTONDOWN:
+                {
+                    cursorX = static_cast<short>(LOWORD(lParam));
+                    cursorY = static_cast<short>(HIWORD(lParam));
+                    keysReceivedMessages[VK_LBUTTON].wasDown = true;
+                    keysReceivedMessages[VK_LBUTTON].isDown = true;
+                    return 0;
+                }
+            case WM_LBUTTONUP:
+                {
+                    keysReceivedMessages[VK_LBUTTON].wasUp = true;
+                    keysReceivedMessages[VK_LBUTTON].isDown = false;
+                    return 0;
+                }
+            case WM_MOUSEMOVE:
+                {
+                    cursorX = static_cast<short>(LOWORD(lParam));
+                    cursorY = static_cast<short>(HIWORD(lParam));
+                    return 0;
+                }
             case WM_SIZE:
                 { 
                     auto const newWidth = LOWORD(lParam);
@@ -394,6 +506,9 @@ namespace SolarSystem
         int height = 0;
         bool sizeChanged = false;
 
+        int cursorX = 0;
+        int cursorY = 0;
+
         HWND hWnd = nullptr;
         bool isOpen = false;
 
@@ -413,5 +528,8 @@ namespace SolarSystem
         std::array<size_t, 255> keysDataMapping{};
         static constexpr size_t NO_KEY_MAPPING = (std::numeric_limits<size_t>::max)();
         std::vector<KeyData> keysData;
+
+        ReplayRecorder* replayRecorder = nullptr;
+        ReplayPlayer* replayPlayer = nullptr;
     };
 }
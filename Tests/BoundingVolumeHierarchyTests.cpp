@@ -0,0 +1,357 @@
+#include "Check.hpp"
+#include "SolarSystem/BoundingVolumeHierarchy.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace SolarSystem;
+
+namespace
+{
+    auto RandomSpheres(size_t const count, float const extent, float const maxRadius, unsigned const seed) -> std::vector<BVHSphere>
+    {
+        auto random = std::mt19937(seed);
+        auto position = std::uniform_real_distribution<float>(-extent, extent);
+        auto radius = std::uniform_real_distribution<float>(maxRadius * 0.01f, maxRadius);
+
+        auto spheres = std::vector<BVHSphere>(count);
+        for(auto& sphere : spheres)
+        {
+            sphere = { position(random), position(random), position(random), radius(random) };
+        }
+        return spheres;
+    }
+
+    auto BuildHierarchy(std::vector<BVHSphere> const& spheres) -> BoundingVolumeHierarchy
+    {
+        BoundingVolumeHierarchy bvh;
+        bvh.Resize(spheres.size());
+        for(size_t i = 0; i < spheres.size(); ++i)
+        {
+            bvh.SetSphere(i, spheres[i]);
+        }
+        bvh.Update();
+        return bvh;
+    }
+
+    auto RandomRay(std::mt19937& random, float const extent) -> BVHRay
+    {
+        auto position = std::uniform_real_distribution<float>(-extent, extent);
+        auto direction = std::normal_distribution<float>();
+
+        BVHRay ray;
+        auto length = 0.0f;
+        for(auto i = 0; i < 3; ++i)
+        {
+            ray.origin[i] = position(random);
+            ray.direction[i] = direction(random);
+            length += ray.direction[i] * ray.direction[i];
+        }
+        for(auto& d : ray.direction)
+        {
+            d /= std::sqrt(length);
+        }
+        return ray;
+    }
+
+    auto RaySphereDistance(BVHRay const& ray, BVHSphere const& sphere) -> float
+    {
+        auto const ox = ray.origin[0] - sphere.x;
+        auto const oy = ray.origin[1] - sphere.y;
+        auto const oz = ray.origin[2] - sphere.z;
+        auto const b = ox * ray.direction[0] + oy * ray.direction[1] + oz * ray.direction[2];
+        auto const c = ox * ox + oy * oy + oz * oz - sphere.radius * sphere.radius;
+
+        if(c <= 0.0f)
+        {
+            return 0.0f;
+        }
+        if(b > 0.0f || b * b - c < 0.0f)
+        {
+            return FLT_MAX;
+        }
+        return -b - std::sqrt(b * b - c);
+    }
+
+    // Axis aligned box [min, max] as six inward facing planes
+    auto BoxPlanes(float const min, float const max, BVHPlane (&planes)[6]) -> void
+    {
+        planes[0] = { 1.0f, 0.0f, 0.0f, -min };
+        planes[1] = { -1.0f, 0.0f, 0.0f, max };
+        planes[2] = { 0.0f, 1.0f, 0.0f, -min };
+        planes[3] = { 0.0f, -1.0f, 0.0f, max };
+        planes[4] = { 0.0f, 0.0f, 1.0f, -min };
+        planes[5] = { 0.0f, 0.0f, -1.0f, max };
+    }
+
+    auto SurfaceDistance(BVHSphere const& sphere, float const x, float const y, float const z) -> float
+    {
+        auto const dx = sphere.x - x;
+        auto const dy = sphere.y - y;
+        auto const dz = sphere.z - z;
+        return (std::max)(std::sqrt(dx * dx + dy * dy + dz * dz) - sphere.radius, 0.0f);
+    }
+}
+
+
+TEST_CASE(RaycastMatchesLinearScan)
+{
+    auto const spheres = RandomSpheres(4000, 100.0f, 2.0f, 1);
+    auto const bvh = BuildHierarchy(spheres);
+
+    auto random = std::mt19937(2);
+    for(auto r = 0; r < 500; ++r)
+    {
+        auto const ray = RandomRay(random, 120.0f);
+
+        auto nearest = FLT_MAX;
+        for(auto const& sphere : spheres)
+        {
+            nearest = (std::min)(nearest, RaySphereDistance(ray, sphere));
+        }
+
+        auto const hit = bvh.Raycast(ray);
+        CHECK(hit.IsHit() == (nearest != FLT_MAX));
+        if(hit.IsHit())
+        {
+            CHECK(std::abs(hit.distance - nearest) <= 1e-4f * (std::max)(1.0f, nearest));
+            CHECK(RaySphereDistance(ray, spheres[hit.index]) == hit.distance);
+        }
+    }
+}
+
+TEST_CASE(RaycastRespectsMaxDistance)
+{
+    auto const bvh = BuildHierarchy({ { 0.0f, 0.0f, 10.0f, 1.0f } });
+
+    BVHRay ray;
+    CHECK(bvh.Raycast(ray).IsHit());
+    CHECK(bvh.Raycast(ray).distance == 9.0f);
+    CHECK(!bvh.Raycast(ray, 8.0f).IsHit());
+}
+
+TEST_CASE(RefinedRaycastMatchesLinearScan)
+{
+    // Each shape is a smaller sphere somewhere inside its bounding sphere
+    auto const bounds = RandomSpheres(4000, 100.0f, 2.0f, 12);
+    auto shapes = bounds;
+    auto random = std::mt19937(13);
+    auto fraction = std::uniform_real_distribution<float>(0.0f, 0.5f);
+    for(auto& shape : shapes)
+    {
+        shape.x += shape.radius * fraction(random);
+        shape.y -= shape.radius * fraction(random);
+        shape.radius *= fraction(random);
+    }
+    auto const bvh = BuildHierarchy(bounds);
+
+    for(auto r = 0; r < 500; ++r)
+    {
+        auto const ray = RandomRay(random, 120.0f);
+
+        auto nearest = FLT_MAX;
+        for(auto const& shape : shapes)
+        {
+            nearest = (std::min)(nearest, RaySphereDistance(ray, shape));
+        }
+
+        auto const hit = bvh.Raycast(ray, [&](uint32_t const index, float) {
+            return BoundingVolumeHierarchy::IntersectRaySphere(ray, shapes[index]);
+        });
+        CHECK(hit.IsHit() == (nearest != FLT_MAX));
+        if(hit.IsHit())
+        {
+            CHECK(std::abs(hit.distance - nearest) <= 1e-4f * (std::max)(1.0f, nearest));
+            CHECK(RaySphereDistance(ray, shapes[hit.index]) == hit.distance);
+        }
+    }
+}
+
+TEST_CASE(FrustumQueryMatchesLinearScan)
+{
+    auto const spheres = RandomSpheres(4000, 100.0f, 2.0f, 3);
+    auto const bvh = BuildHierarchy(spheres);
+
+    BVHPlane planes[6];
+    BoxPlanes(-30.0f, 45.0f, planes);
+
+    auto expected = std::vector<uint32_t>();
+    for(size_t i = 0; i < spheres.size(); ++i)
+    {
+        auto const& s = spheres[i];
+        auto const inside = std::all_of(std::begin(planes), std::end(planes), [&](BVHPlane const& p) {
+            return p.x * s.x + p.y * s.y + p.z * s.z + p.d >= -s.radius;
+        });
+        if(inside)
+        {
+            expected.push_back(static_cast<uint32_t>(i));
+        }
+    }
+
+    auto result = std::vector<uint32_t>();
+    bvh.QueryFrustum(planes, result);
+    std::sort(result.begin(), result.end());
+    CHECK(!expected.empty());
+    CHECK(result == expected);
+}
+
+TEST_CASE(SphereQueryMatchesLinearScan)
+{
+    auto const spheres = RandomSpheres(4000, 100.0f, 2.0f, 4);
+    auto const bvh = BuildHierarchy(spheres);
+    auto const query = BVHSphere{ 10.0f, -20.0f, 5.0f, 25.0f };
+
+    auto expected = std::vector<uint32_t>();
+    for(size_t i = 0; i < spheres.size(); ++i)
+    {
+        auto const& s = spheres[i];
+        auto const dx = s.x - query.x;
+        auto const dy = s.y - query.y;
+        auto const dz = s.z - query.z;
+        if(dx * dx + dy * dy + dz * dz <= (s.radius + query.radius) * (s.radius + query.radius))
+        {
+            expected.push_back(static_cast<uint32_t>(i));
+        }
+    }
+
+    auto result = std::vector<uint32_t>();
+    bvh.QuerySphere(query, result);
+    std::sort(result.begin(), result.end());
+    CHECK(!expected.empty());
+    CHECK(result == expected);
+}
+
+TEST_CASE(NearestQueryMatchesLinearScan)
+{
+    auto const spheres = RandomSpheres(4000, 100.0f, 2.0f, 5);
+    auto const bvh = BuildHierarchy(spheres);
+    auto constexpr k = 16;
+
+    auto distances = std::vector<float>();
+    for(auto const& sphere : spheres)
+    {
+        distances.push_back(SurfaceDistance(sphere, 3.0f, 4.0f, -5.0f));
+    }
+    std::sort(distances.begin(), distances.end());
+
+    auto result = std::vector<BVHHit>();
+    bvh.QueryNearest(3.0f, 4.0f, -5.0f, k, result);
+    CHECK(result.size() == k);
+    for(size_t i = 0; i < result.size(); ++i)
+    {
+        CHECK(result[i].distance == distances[i]);
+        CHECK(SurfaceDistance(spheres[result[i].index], 3.0f, 4.0f, -5.0f) == result[i].distance);
+    }
+}
+
+TEST_CASE(RefitTracksMovedSpheres)
+{
+    auto spheres = RandomSpheres(2000, 100.0f, 2.0f, 6);
+    auto bvh = BuildHierarchy(spheres);
+    auto const rebuilds = bvh.GetStatistics().rebuilds;
+
+    // Small moves are refitted, the hierarchy stays valid without a rebuild
+    auto random = std::mt19937(7);
+    auto offset = std::uniform_real_distribution<float>(-0.5f, 0.5f);
+    for(size_t i = 0; i < spheres.size(); ++i)
+    {
+        spheres[i].x += offset(random);
+        spheres[i].y += offset(random);
+        bvh.SetSphere(i, spheres[i]);
+    }
+    bvh.Update();
+    CHECK(bvh.GetStatistics().rebuilds == rebuilds);
+    CHECK(bvh.GetStatistics().refits > 0);
+
+    auto result = std::vector<uint32_t>();
+    for(size_t i = 0; i < spheres.size(); i += 97)
+    {
+        bvh.QuerySphere({ spheres[i].x, spheres[i].y, spheres[i].z, 0.0f }, result);
+        CHECK(std::find(result.begin(), result.end(), static_cast<uint32_t>(i)) != result.end());
+    }
+}
+
+TEST_CASE(ScatteringSpheresTriggersRebuild)
+{
+    auto spheres = RandomSpheres(2000, 10.0f, 0.5f, 8);
+    auto bvh = BuildHierarchy(spheres);
+    auto const rebuilds = bvh.GetStatistics().rebuilds;
+
+    // Shuffling positions across the whole volume makes the refitted tree much worse than a fresh build
+    auto scattered = RandomSpheres(spheres.size(), 1000.0f, 0.5f, 9);
+    for(size_t i = 0; i < spheres.size(); ++i)
+    {
+        bvh.SetSphere(i, scattered[i]);
+    }
+    bvh.Update();
+    CHECK(bvh.GetStatistics().rebuilds == rebuilds + 1);
+    CHECK(bvh.GetStatistics().cost <= bvh.GetStatistics().builtCost);
+}
+
+TEST_CASE(EmptyHierarchyReturnsNothing)
+{
+    BoundingVolumeHierarchy bvh;
+    bvh.Update();
+
+    auto indices = std::vector<uint32_t>{ 1 };
+    auto hits = std::vector<BVHHit>{ { } };
+    BVHPlane planes[6];
+    BoxPlanes(-1.0f, 1.0f, planes);
+
+    CHECK(!bvh.Raycast({ }).IsHit());
+    bvh.QueryFrustum(planes, indices);
+    CHECK(indices.empty());
+    bvh.QueryNearest(0.0f, 0.0f, 0.0f, 4, hits);
+    CHECK(hits.empty());
+}
+
+
+BENCHMARK_CASE(MillionSphereQueries)
+{
+    auto constexpr count = size_t(1000000);
+    auto const spheres = RandomSpheres(count, 10000.0f, 5.0f, 10);
+
+    BoundingVolumeHierarchy bvh;
+    bvh.Resize(count);
+    for(size_t i = 0; i < count; ++i)
+    {
+        bvh.SetSphere(i, spheres[i]);
+    }
+
+    auto const build = Tests::MeasureMilliseconds(1, [&] { bvh.Update(); });
+    auto const refit = Tests::MeasureMilliseconds(5, [&] { bvh.Update(); });
+
+    auto random = std::mt19937(11);
+    auto rays = std::vector<BVHRay>(10000);
+    for(auto& ray : rays)
+    {
+        ray = RandomRay(random, 10000.0f);
+    }
+    auto hitCount = size_t(0);
+    auto const raycast = Tests::MeasureMilliseconds(1, [&] {
+        for(auto const& ray : rays)
+        {
+            hitCount += bvh.Raycast(ray).IsHit() ? 1 : 0;
+        }
+    }) / rays.size();
+
+    BVHPlane planes[6];
+    BoxPlanes(-1000.0f, 1000.0f, planes);
+    auto indices = std::vector<uint32_t>();
+    auto const frustum = Tests::MeasureMilliseconds(100, [&] { bvh.QueryFrustum(planes, indices); });
+    auto const frustumCount = indices.size();
+
+    auto const sphere = Tests::MeasureMilliseconds(1000, [&] { bvh.QuerySphere({ 0.0f, 0.0f, 0.0f, 500.0f }, indices); });
+    auto const sphereCount = indices.size();
+
+    auto hits = std::vector<BVHHit>();
+    auto const nearest = Tests::MeasureMilliseconds(1000, [&] { bvh.QueryNearest(0.0f, 0.0f, 0.0f, 16, hits); });
+
+    std::printf("  %zu spheres, %zu nodes\n", count, bvh.GetStatistics().nodeCount);
+    std::printf("  build %.1f ms, refit %.1f ms\n", build, refit);
+    std::printf("  raycast %.4f ms (%zu of %zu rays hit)\n", raycast, hitCount, rays.size());
+    std::printf("  frustum %.3f ms (%zu spheres), sphere %.4f ms (%zu spheres), 16 nearest %.4f ms\n",
+        frustum, frustumCount, sphere, sphereCount, nearest);
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+//
+// Minimal test harness. Tests and benchmarks register themselves, TestMain.cpp runs the tests,
+// or the benchmarks when started with --benchmark. A failed CHECK is reported and the test goes on.
+//
+namespace Tests
+{
+    struct TestCase final
+    {
+        char const* name;
+        void (*function)();
+        bool isBenchmark;
+    };
+
+    auto inline GetTestCases() -> std::vector<TestCase>&
+    {
+        static std::vector<TestCase> testCases;
+        return testCases;
+    }
+
+    inline int failureCount = 0;
+
+    struct TestRegistrar final
+    {
+        TestRegistrar(char const* const name, void (*function)(), bool const isBenchmark)
+        {
+            GetTestCases().push_back({ name, function, isBenchmark });
+        }
+    };
+
+    auto inline ReportFailure(char const* const file, int const line, char const* const expression) -> void
+    {
+        std::printf("%s(%d): CHECK(%s) failed\n", file, line, expression);
+        failureCount++;
+    }
+
+    // Average milliseconds per call over iterations calls
+    template<typename Function>
+    auto MeasureMilliseconds(int const iterations, Function const& function) -> double
+    {
+        auto const start = std::chrono::steady_clock::now();
+        for(auto i = 0; i < iterations; ++i)
+        {
+            function();
+        }
+        auto const elapsed = std::chrono::steady_clock::now() - start;
+        return std::chrono::duration<double, std::milli>(elapsed).count() / iterations;
+    }
+}
+
+#define TEST_CASE(name) \
+    static auto name() -> void; \
+    static Tests::TestRegistrar const name##Registrar(#name, name, false); \
+    static auto name() -> void
+
+#define BENCHMARK_CASE(name) \
+    static auto name() -> void; \
+    static Tests::TestRegistrar const name##Registrar(#name, name, true); \
+    static auto name() -> void
+
+#define CHECK(expression) \
+    ((expression) ? static_cast<void>(0) : Tests::ReportFailure(__FILE__, __LINE__, #expression))
@@ -0,0 +1,97 @@
+#include "Check.hpp"
+#include "SolarSystem/Camera.hpp"
+
+#include <cmath>
+
+using namespace SolarSystem;
+
+namespace
+{
+    auto constexpr FOV = DirectX::XM_PI / 3.0f;
+    auto constexpr ASPECT_RATIO = 16.0f / 9.0f;
+    auto constexpr NEAR_Z = 0.1f;
+
+    auto StandardProjection(float const farZ) -> DirectX::SimpleMath::Matrix
+    {
+        return DirectX::SimpleMath::Matrix(DirectX::XMMatrixPerspectiveFovLH(FOV, ASPECT_RATIO, NEAR_Z, farZ));
+    }
+
+    auto Depth(DirectX::SimpleMath::Matrix const& projection, float const viewDepth) -> float
+    {
+        return projection._33 + projection._43 / viewDepth;
+    }
+}
+
+
+TEST_CASE(ReverseZMapsNearToOneAndInfinityToZero)
+{
+    auto const projection = CreateReverseZInfinitePerspective(FOV, ASPECT_RATIO, NEAR_Z);
+
+    CHECK(Depth(projection, NEAR_Z) == 1.0f);
+    CHECK(Depth(projection, 1e30f) > 0.0f);
+    CHECK(Depth(projection, 1e30f) < 1e-30f);
+
+    // Farther is always smaller, the depth test is greater equal
+    auto previous = 2.0f;
+    for(auto z = NEAR_Z; z < 1e30f; z *= 10.0f)
+    {
+        auto const depth = Depth(projection, z);
+        CHECK(depth < previous);
+        previous = depth;
+    }
+}
+
+// Float depth in reverse-Z has about the same relative precision at every distance
+TEST_CASE(ReverseZResolutionIsRelativeToDistance)
+{
+    auto const projection = CreateReverseZInfinitePerspective(FOV, ASPECT_RATIO, NEAR_Z);
+
+    for(auto z = 1.0f; z <= 1e12f; z *= 10.0f)
+    {
+        CHECK(DepthResolution(projection, z) / z < 1e-6f);
+    }
+}
+
+TEST_CASE(StandardResolutionDegradesWithDistance)
+{
+    auto const standard = StandardProjection(1000.0f);
+    auto const reverse = CreateReverseZInfinitePerspective(FOV, ASPECT_RATIO, NEAR_Z);
+
+    // Close to the camera both are fine, toward the far plane standard depth is orders of magnitude coarser
+    CHECK(DepthResolution(standard, 1.0f) / 1.0f < 1e-5f);
+    CHECK(DepthResolution(standard, 900.0f) > 100.0f * DepthResolution(reverse, 900.0f));
+    CHECK(DepthResolution(standard, 900.0f) / 900.0f > 1e-4f);
+}
+
+// A moon in front of its planet seen from far away, at distances beyond any finite far plane of the standard projection
+TEST_CASE(MoonAndPlanetGetDistinctDepths)
+{
+    auto const projection = CreateReverseZInfinitePerspective(FOV, ASPECT_RATIO, NEAR_Z);
+
+    for(auto distance = 1e3f; distance <= 1e9f; distance *= 10.0f)
+    {
+        // Separation as a small fraction of the distance, such as the Moon against the Earth seen from the outer planets
+        auto const moon = distance;
+        auto const planet = distance * (1.0f + 1e-5f);
+        CHECK(Depth(projection, moon) > Depth(projection, planet));
+    }
+}
+
+TEST_CASE(PrintDepthResolution)
+{
+    auto const standard = StandardProjection(1000.0f);
+    auto const reverse = CreateReverseZInfinitePerspective(FOV, ASPECT_RATIO, NEAR_Z);
+
+    std::printf("  %12s %18s %18s\n", "distance", "standard 0.1-1000", "reverse-Z infinite");
+    for(auto z = 1.0f; z <= 1e9f; z *= 10.0f)
+    {
+        if(z < 1000.0f)
+        {
+            std::printf("  %12g %18g %18g\n", z, DepthResolution(standard, z), DepthResolution(reverse, z));
+        }
+        else
+        {
+            std::printf("  %12g %18s %18g\n", z, "clipped", DepthResolution(reverse, z));
+        }
+    }
+}
@@ -0,0 +1,210 @@
+#include "Check.hpp"
+#include "SolarSystem/FrameAllocator.hpp"
+
+#include <cstring>
+#include <new>
+
+using namespace SolarSystem;
+
+// Counted like main.cpp does, so the tests can see every heap allocation including the arenas' upstream
+auto operator new(size_t const size) -> void*
+{
+    if(auto const pointer = TrackedAllocate(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__, GetCurrentMemoryTag()))
+    {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+auto operator new(size_t const size, std::align_val_t const alignment) -> void*
+{
+    if(auto const pointer = TrackedAllocate(size, static_cast<size_t>(alignment), GetCurrentMemoryTag()))
+    {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+auto operator delete(void* const pointer) noexcept -> void
+{
+    TrackedDeallocate(pointer);
+}
+
+auto operator delete(void* const pointer, size_t) noexcept -> void
+{
+    TrackedDeallocate(pointer);
+}
+
+auto operator delete(void* const pointer, std::align_val_t) noexcept -> void
+{
+    TrackedDeallocate(pointer);
+}
+
+auto operator delete(void* const pointer, size_t, std::align_val_t) noexcept -> void
+{
+    TrackedDeallocate(pointer);
+}
+
+namespace
+{
+    auto GetAllocationCount() -> size_t
+    {
+        auto count = size_t(0);
+        for(auto tag = size_t(0); tag < static_cast<size_t>(MemoryTag::Count); ++tag)
+        {
+            count += GetMemoryStatistics(static_cast<MemoryTag>(tag)).allocationCount;
+        }
+        return count;
+    }
+
+    struct DrawItem final
+    {
+        float world[16];
+        uint32_t mesh;
+        uint32_t material;
+    };
+
+    // The per frame work the renderer does: queues grown without reserving and raw scratch arrays
+    auto SimulateFrame(FrameAllocator& allocator, size_t const itemCount) -> size_t
+    {
+        allocator.BeginFrame();
+
+        auto queue = std::pmr::vector<DrawItem>(allocator.GetResource());
+        auto visible = std::pmr::vector<uint32_t>(allocator.GetResource());
+        for(size_t i = 0; i < itemCount; ++i)
+        {
+            queue.push_back({ { }, static_cast<uint32_t>(i), static_cast<uint32_t>(i % 7) });
+            if(i % 3 != 0)
+            {
+                visible.push_back(static_cast<uint32_t>(i));
+            }
+        }
+
+        auto const keys = allocator.Allocate<uint64_t>(queue.size());
+        auto sum = size_t(0);
+        for(size_t i = 0; i < queue.size(); ++i)
+        {
+            keys[i] = static_cast<uint64_t>(queue[i].material) << 32 | queue[i].mesh;
+            sum += static_cast<size_t>(keys[i]);
+        }
+        return sum + visible.size();
+    }
+}
+
+
+TEST_CASE(SteadyStateFramesDoNotAllocate)
+{
+    FrameAllocator allocator(4 * 1024);
+
+    // The first frames outgrow the arenas and size them
+    for(auto frame = 0; frame < 8; ++frame)
+    {
+        SimulateFrame(allocator, 2000);
+    }
+    auto const warm = allocator.GetStatistics();
+
+    auto const before = GetAllocationCount();
+    for(auto frame = 0; frame < 1000; ++frame)
+    {
+        SimulateFrame(allocator, 2000);
+    }
+    auto const after = GetAllocationCount();
+
+    CHECK(after - before == 0);
+    CHECK(allocator.GetStatistics().overflowCount == warm.overflowCount);
+    CHECK(allocator.GetStatistics().growCount == warm.growCount);
+}
+
+TEST_CASE(CountingSeesHeapAllocations)
+{
+    auto const before = GetAllocationCount();
+    auto const values = std::vector<int>(100);
+    CHECK(GetAllocationCount() - before == 1);
+    CHECK(values.size() == 100);
+}
+
+TEST_CASE(OverflowGrowsArenaOnReset)
+{
+    FrameAllocator allocator(1024);
+    allocator.BeginFrame();
+
+    allocator.Allocate<char>(512);
+    CHECK(allocator.GetStatistics().overflowCount == 0);
+    allocator.Allocate<char>(4096);
+    CHECK(allocator.GetStatistics().overflowCount == 1);
+    CHECK(allocator.GetStatistics().overflowBytes == 4096);
+
+    // The overflowed arena is reset two frames later and sized to what it had to hold
+    allocator.BeginFrame();
+    CHECK(allocator.GetStatistics().growCount == 0);
+    allocator.BeginFrame();
+    CHECK(allocator.GetStatistics().growCount == 1);
+
+    allocator.Allocate<char>(512);
+    allocator.Allocate<char>(4096);
+    CHECK(allocator.GetStatistics().overflowCount == 1);
+    CHECK(allocator.GetStatistics().used >= 512 + 4096);
+}
+
+TEST_CASE(PreviousFrameStaysValid)
+{
+    FrameAllocator allocator(1024);
+    allocator.BeginFrame();
+    auto const previous = allocator.Allocate<uint8_t>(256);
+    std::memset(previous, 0xAB, 256);
+
+    allocator.BeginFrame();
+    auto const current = allocator.Allocate<uint8_t>(256);
+    std::memset(current, 0xCD, 256);
+
+    for(auto i = 0; i < 256; ++i)
+    {
+        CHECK(previous[i] == 0xAB);
+    }
+}
+
+TEST_CASE(AllocationsAreAligned)
+{
+    struct alignas(64) CacheLine final
+    {
+        uint8_t bytes[64];
+    };
+
+    FrameAllocator allocator(4096);
+    allocator.BeginFrame();
+    allocator.Allocate<char>(1);
+    CHECK(reinterpret_cast<uintptr_t>(allocator.Allocate<CacheLine>(2)) % 64 == 0);
+    allocator.Allocate<char>(3);
+    CHECK(reinterpret_cast<uintptr_t>(allocator.Allocate<double>(1)) % alignof(double) == 0);
+
+    // Overflow allocations keep their alignment as well
+    CHECK(reinterpret_cast<uintptr_t>(allocator.Allocate<CacheLine>(128)) % 64 == 0);
+}
+
+
+BENCHMARK_CASE(FrameQueues)
+{
+    auto constexpr frames = 200;
+    for(auto const itemCount : { size_t(1000), size_t(10000), size_t(100000) })
+    {
+        FrameAllocator allocator;
+        auto const frame = Tests::MeasureMilliseconds(frames, [&] { SimulateFrame(allocator, itemCount); });
+
+        auto const heap = Tests::MeasureMilliseconds(frames, [&] {
+            auto queue = std::vector<DrawItem>();
+            auto visible = std::vector<uint32_t>();
+            for(size_t i = 0; i < itemCount; ++i)
+            {
+                queue.push_back({ { }, static_cast<uint32_t>(i), static_cast<uint32_t>(i % 7) });
+                if(i % 3 != 0)
+                {
+                    visible.push_back(static_cast<uint32_t>(i));
+                }
+            }
+            auto const keys = std::vector<uint64_t>(queue.size());
+        });
+
+        std::printf("  %7zu items: frame allocator %.3f ms, heap %.3f ms, arena %zu KB after %zu grows\n", itemCount, frame, heap,
+            allocator.GetStatistics().capacity / 1024, allocator.GetStatistics().growCount);
+    }
+}
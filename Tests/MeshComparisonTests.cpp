@@ -0,0 +1,123 @@
+#include "Check.hpp"
+#include "SolarSystem/Mesh.hpp"
+
+using namespace SolarSystem;
+
+namespace
+{
+    // A mesh that OptimizeMesh reorders
+    auto CreateSourceMesh() -> Mesh
+    {
+        auto mesh = Procedural::CreateSphere(32, 16);
+        mesh.optimized = false;
+
+        // Reverse the triangle order so the optimizer has work to do
+        auto indices = ReadIndices(mesh.indexBuffer);
+        for(size_t i = 0, j = indices.size() - 3; i < j; i += 3, j -= 3)
+        {
+            std::swap_ranges(indices.begin() + i, indices.begin() + i + 3, indices.begin() + j);
+        }
+        mesh.indexBuffer = CreateIndexBuffer(indices, mesh.vertexBuffers[0].vertexCount);
+        return mesh;
+    }
+
+    auto Optimize(Mesh mesh, std::vector<uint32_t>& vertexRemap) -> Mesh
+    {
+        OptimizeMesh(mesh, &vertexRemap);
+        CompactIndexBuffer(mesh.indexBuffer, mesh.vertexBuffers[0].vertexCount);
+        return mesh;
+    }
+}
+
+
+TEST_CASE(DuplicateIsRecognizedWithoutOptimizingIt)
+{
+    auto const source = CreateSourceMesh();
+    auto vertexRemap = std::vector<uint32_t>();
+    auto const optimized = Optimize(source, vertexRemap);
+
+    CHECK(!vertexRemap.empty());
+    CHECK(!IsSameMesh(source, optimized));
+    CHECK(IsSameOptimizedMesh(source, optimized, vertexRemap));
+}
+
+TEST_CASE(ChangedVertexOrTriangleIsNotADuplicate)
+{
+    auto const source = CreateSourceMesh();
+    auto vertexRemap = std::vector<uint32_t>();
+    auto const optimized = Optimize(source, vertexRemap);
+
+    auto movedVertex = source;
+    movedVertex.vertexBuffers[0].data.data()[0] ^= 1;
+    CHECK(!IsSameOptimizedMesh(movedVertex, optimized, vertexRemap));
+
+    // Same indices with one triangle's winding flipped
+    auto flippedTriangle = source;
+    auto indices = ReadIndices(flippedTriangle.indexBuffer);
+    std::swap(indices[0], indices[1]);
+    flippedTriangle.indexBuffer = CreateIndexBuffer(indices, flippedTriangle.vertexBuffers[0].vertexCount);
+    CHECK(!IsSameOptimizedMesh(flippedTriangle, optimized, vertexRemap));
+}
+
+TEST_CASE(MeshesThatAreNotReorderedCompareDirectly)
+{
+    auto const source = Procedural::FullscreenQuad();
+    auto vertexRemap = std::vector<uint32_t>();
+    auto const optimized = Optimize(source, vertexRemap);
+
+    CHECK(IsSameOptimizedMesh(source, optimized, vertexRemap));
+}
+
+TEST_CASE(DigestsMatchOnlyForIdenticalContent)
+{
+    auto const source = CreateSourceMesh();
+    auto const digest = DigestMesh(source);
+    CHECK(DigestMesh(Mesh(source)) == digest);
+    CHECK(digest.hash == HashMesh(source));
+
+    auto movedVertex = source;
+    movedVertex.vertexBuffers[0].data.data()[0] ^= 1;
+    CHECK(!(DigestMesh(movedVertex) == digest));
+
+    // Same bytes read through a different layout
+    auto relabeled = source;
+    relabeled.vertexBuffers[0].vertexElements[0].semanticIndex = 1;
+    CHECK(!(DigestMesh(relabeled) == digest));
+
+    auto fewerTriangles = source;
+    auto indices = ReadIndices(fewerTriangles.indexBuffer);
+    indices.resize(indices.size() - 3);
+    fewerTriangles.indexBuffer = CreateIndexBuffer(indices, fewerTriangles.vertexBuffers[0].vertexCount);
+    CHECK(!(DigestMesh(fewerTriangles) == digest));
+}
+
+TEST_CASE(MixBytesCoversLengthAndSeed)
+{
+    // Trailing zero bytes still change the hash, the length is part of it
+    char const bytes[9] = { 1, 2, 3, 4, 5, 6, 7, 8, 0 };
+    CHECK(MixBytes(bytes, 8) != MixBytes(bytes, 9));
+    CHECK(MixBytes(bytes, 8) == MixBytes(bytes, 8));
+    CHECK(MixBytes(bytes, 8, 1) != MixBytes(bytes, 8, 2));
+}
+
+TEST_CASE(InstanceBuffersKeepTheirOrder)
+{
+    auto source = CreateSourceMesh();
+    auto& instances = source.vertexBuffers.emplace_back();
+    instances.instanceStepRate = 1;
+    instances.vertexByteSize = 4;
+    instances.vertexCount = 3;
+    instances.vertexElements.push_back({ "INSTANCE_ID", DXGI_FORMAT_R32_UINT, 0 });
+    instances.data.resize(12);
+    for(auto i = 0; i < 12; ++i)
+    {
+        instances.data.data()[i] = static_cast<char>(i);
+    }
+
+    auto vertexRemap = std::vector<uint32_t>();
+    auto const optimized = Optimize(source, vertexRemap);
+
+    CHECK(!vertexRemap.empty());
+    CHECK(optimized.vertexBuffers[1].data == source.vertexBuffers[1].data);
+    CHECK(IsSameOptimizedMesh(source, optimized, vertexRemap));
+}
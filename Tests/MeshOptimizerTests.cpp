@@ -0,0 +1,210 @@
+#include "Check.hpp"
+#include "SolarSystem/MeshOptimizer.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace SolarSystem;
+
+namespace
+{
+    struct TestMesh final
+    {
+        std::vector<float> positions;
+        std::vector<uint32_t> indices;
+
+        auto GetVertexCount() const -> size_t
+        {
+            return positions.size() / 3;
+        }
+    };
+
+    // Latitude-longitude sphere, rows of quads in the order a naive generator emits them
+    auto CreateSphere(int const longitudeSides, int const latitudeSides) -> TestMesh
+    {
+        auto constexpr pi = 3.14159265358979f;
+
+        TestMesh mesh;
+        for(auto y = 0; y <= latitudeSides; ++y)
+        {
+            auto const theta = pi * y / latitudeSides;
+            for(auto x = 0; x <= longitudeSides; ++x)
+            {
+                auto const phi = 2.0f * pi * x / longitudeSides;
+                mesh.positions.insert(mesh.positions.end(), {
+                    std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi)
+                });
+            }
+        }
+
+        auto const row = static_cast<uint32_t>(longitudeSides + 1);
+        for(uint32_t y = 0; y < static_cast<uint32_t>(latitudeSides); ++y)
+        {
+            for(uint32_t x = 0; x < static_cast<uint32_t>(longitudeSides); ++x)
+            {
+                auto const i = y * row + x;
+                mesh.indices.insert(mesh.indices.end(), { i, i + row, i + 1, i + 1, i + row, i + row + 1 });
+            }
+        }
+
+        return mesh;
+    }
+
+    auto ShuffleTriangles(std::vector<uint32_t>& indices, unsigned const seed) -> void
+    {
+        std::vector<std::array<uint32_t, 3>> triangles(indices.size() / 3);
+        std::memcpy(triangles.data(), indices.data(), indices.size() * sizeof(uint32_t));
+        std::shuffle(triangles.begin(), triangles.end(), std::mt19937(seed));
+        std::memcpy(indices.data(), triangles.data(), indices.size() * sizeof(uint32_t));
+    }
+
+    // Triangles as a sorted list with each one rotated to start at its smallest index, so winding is kept
+    auto CanonicalTriangles(std::vector<uint32_t> const& indices) -> std::vector<std::array<uint32_t, 3>>
+    {
+        std::vector<std::array<uint32_t, 3>> triangles;
+        for(size_t i = 0; i < indices.size(); i += 3)
+        {
+            std::array<uint32_t, 3> triangle = { indices[i], indices[i + 1], indices[i + 2] };
+            std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+            triangles.push_back(triangle);
+        }
+        std::sort(triangles.begin(), triangles.end());
+        return triangles;
+    }
+
+    auto Analyze(TestMesh const& mesh) -> MeshOptimizer::VertexCacheStatistics
+    {
+        return MeshOptimizer::AnalyzeVertexCache(mesh.indices, mesh.GetVertexCount());
+    }
+}
+
+
+TEST_CASE(AnalyzeVertexCacheCountsMisses)
+{
+    // Two triangles sharing an edge transform four vertices
+    auto const statistics = MeshOptimizer::AnalyzeVertexCache({ 0, 1, 2, 2, 1, 3 }, 4);
+    CHECK(statistics.transformedVertices == 4);
+    CHECK(statistics.acmr == 2.0f);
+    CHECK(statistics.atvr == 1.0f);
+
+    // A cache of one entry only keeps the last vertex
+    CHECK(MeshOptimizer::AnalyzeVertexCache({ 0, 1, 2, 2, 1, 3 }, 4, 1).transformedVertices == 5);
+    CHECK(MeshOptimizer::AnalyzeVertexCache({ }, 0).acmr == 0.0f);
+}
+
+TEST_CASE(VertexCacheOptimizationKeepsTrianglesAndLowersACMR)
+{
+    auto mesh = CreateSphere(64, 32);
+    ShuffleTriangles(mesh.indices, 1);
+    auto const triangles = CanonicalTriangles(mesh.indices);
+    auto const before = Analyze(mesh);
+
+    MeshOptimizer::OptimizeVertexCache(mesh.indices, mesh.GetVertexCount());
+    auto const after = Analyze(mesh);
+
+    CHECK(CanonicalTriangles(mesh.indices) == triangles);
+    CHECK(before.acmr > 2.0f);
+    CHECK(after.acmr < 0.8f);
+    CHECK(after.atvr < 1.5f);
+}
+
+TEST_CASE(OverdrawOptimizationKeepsTrianglesAndCacheLocality)
+{
+    auto mesh = CreateSphere(64, 32);
+    MeshOptimizer::OptimizeVertexCache(mesh.indices, mesh.GetVertexCount());
+    auto const triangles = CanonicalTriangles(mesh.indices);
+    auto const cacheOptimized = Analyze(mesh);
+
+    auto const threshold = 1.05f;
+    MeshOptimizer::OptimizeOverdraw(mesh.indices, mesh.positions.data(), 3 * sizeof(float), mesh.GetVertexCount(), threshold);
+
+    CHECK(CanonicalTriangles(mesh.indices) == triangles);
+    // Clusters are only cut where the miss ratio stays within threshold, reordering them costs at most a cache flush each
+    CHECK(Analyze(mesh).acmr < cacheOptimized.acmr * 1.25f);
+}
+
+TEST_CASE(VertexFetchOptimizationNumbersVerticesByFirstUse)
+{
+    auto mesh = CreateSphere(32, 16);
+    ShuffleTriangles(mesh.indices, 2);
+    MeshOptimizer::OptimizeVertexCache(mesh.indices, mesh.GetVertexCount());
+
+    auto const original = mesh;
+    auto const remap = MeshOptimizer::OptimizeVertexFetch(mesh.indices, mesh.GetVertexCount());
+
+    // Vertex data is moved as raw bytes, the way vertex buffers hold it
+    auto bytes = std::vector<char>(mesh.positions.size() * sizeof(float));
+    std::memcpy(bytes.data(), mesh.positions.data(), bytes.size());
+    MeshOptimizer::RemapVertices(bytes, 3 * sizeof(float), remap);
+    std::memcpy(mesh.positions.data(), bytes.data(), bytes.size());
+
+    // The remap is a permutation
+    auto sorted = remap;
+    std::sort(sorted.begin(), sorted.end());
+    for(uint32_t i = 0; i < sorted.size(); ++i)
+    {
+        CHECK(sorted[i] == i);
+    }
+
+    // Every index is at most one past the largest seen so far
+    auto next = uint32_t(0);
+    for(auto const index : mesh.indices)
+    {
+        CHECK(index <= next);
+        next = (std::max)(next, index + 1);
+    }
+
+    // Triangles still reference the same positions
+    for(size_t i = 0; i < mesh.indices.size(); ++i)
+    {
+        for(auto c = 0; c < 3; ++c)
+        {
+            CHECK(mesh.positions[mesh.indices[i] * 3 + c] == original.positions[original.indices[i] * 3 + c]);
+        }
+    }
+
+    // Ordering itself is unchanged, only the names of the vertices
+    CHECK(Analyze(mesh).transformedVertices == Analyze(original).transformedVertices);
+}
+
+TEST_CASE(UnreferencedVerticesMoveToTheEnd)
+{
+    std::vector<uint32_t> indices = { 3, 1, 4 };
+    auto const remap = MeshOptimizer::OptimizeVertexFetch(indices, 5);
+
+    CHECK((indices == std::vector<uint32_t>{ 0, 1, 2 }));
+    CHECK((remap == std::vector<uint32_t>{ 3, 1, 4, 0, 2 }));
+}
+
+
+BENCHMARK_CASE(OptimizeMillionTriangleMesh)
+{
+    auto mesh = CreateSphere(1024, 512);
+    ShuffleTriangles(mesh.indices, 3);
+    auto const before = Analyze(mesh);
+
+    auto const vertexCache = Tests::MeasureMilliseconds(1, [&] { MeshOptimizer::OptimizeVertexCache(mesh.indices, mesh.GetVertexCount()); });
+    auto const afterVertexCache = Analyze(mesh);
+
+    auto const overdraw = Tests::MeasureMilliseconds(1, [&] {
+        MeshOptimizer::OptimizeOverdraw(mesh.indices, mesh.positions.data(), 3 * sizeof(float), mesh.GetVertexCount());
+    });
+    auto const afterOverdraw = Analyze(mesh);
+
+    auto bytes = std::vector<char>(mesh.positions.size() * sizeof(float));
+    std::memcpy(bytes.data(), mesh.positions.data(), bytes.size());
+    auto const vertexFetch = Tests::MeasureMilliseconds(1, [&] {
+        auto const remap = MeshOptimizer::OptimizeVertexFetch(mesh.indices, mesh.GetVertexCount());
+        MeshOptimizer::RemapVertices(bytes, 3 * sizeof(float), remap);
+    });
+
+    std::printf("  %zu triangles, %zu vertices\n", mesh.indices.size() / 3, mesh.GetVertexCount());
+    std::printf("  shuffled        ACMR %.3f ATVR %.3f\n", before.acmr, before.atvr);
+    std::printf("  vertex cache    ACMR %.3f ATVR %.3f  %.1f ms\n", afterVertexCache.acmr, afterVertexCache.atvr, vertexCache);
+    std::printf("  overdraw        ACMR %.3f ATVR %.3f  %.1f ms\n", afterOverdraw.acmr, afterOverdraw.atvr, overdraw);
+    std::printf("  vertex fetch    %.1f ms\n", vertexFetch);
+}
@@ -0,0 +1,225 @@
+#include "Check.hpp"
+#include "SolarSystem/OrbitTessellation.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+using namespace SolarSystem;
+
+namespace
+{
+    // Projection of a 60 degree vertical field of view on a 1080 pixel viewport
+    auto const PROJECTION_SCALE = 1.0f / std::tan(OrbitTessellation::TWO_PI / 12.0f);
+    auto constexpr VIEWPORT_HEIGHT = 1080.0f;
+
+    struct Point final
+    {
+        double x = 0.0;
+        double y = 0.0;
+        double z = 0.0;
+    };
+
+    auto Distance(Point const& a, Point const& b) -> double
+    {
+        return std::sqrt((a.x - b.x) * (a.x - b.x) + (a.y - b.y) * (a.y - b.y) + (a.z - b.z) * (a.z - b.z));
+    }
+
+    // Focus at the origin and periapsis along +z, as Orbit_vs.hlsl places the path
+    auto OrbitPoint(double const a, double const e, double const trueAnomaly) -> Point
+    {
+        auto const r = a * (1.0 - e * e) / (1.0 + e * std::cos(trueAnomaly));
+        return { std::sin(trueAnomaly) * r, 0.0, std::cos(trueAnomaly) * r };
+    }
+
+    auto DistanceToChord(Point const& p, Point const& a, Point const& b) -> double
+    {
+        auto const abx = b.x - a.x;
+        auto const abz = b.z - a.z;
+        auto const t = std::clamp(((p.x - a.x) * abx + (p.z - a.z) * abz) / (abx * abx + abz * abz), 0.0, 1.0);
+        return Distance(p, { a.x + abx * t, 0.0, a.z + abz * t });
+    }
+
+    //
+    // Walks every segment of a uniform true anomaly sampling starting at phase and calls visit with
+    // each densely sampled point of the path and its distance to the segment's chord
+    //
+    template<typename Visit>
+    auto SampleChordError(double const a, double const e, int const segments, double const phase, Visit const& visit) -> void
+    {
+        auto constexpr samplesPerSegment = 32;
+        auto const step = static_cast<double>(OrbitTessellation::TWO_PI) / segments;
+
+        for(auto s = 0; s < segments; ++s)
+        {
+            auto const start = phase + s * step;
+            auto const chordStart = OrbitPoint(a, e, start);
+            auto const chordEnd = OrbitPoint(a, e, start + step);
+
+            for(auto k = 1; k < samplesPerSegment; ++k)
+            {
+                auto const point = OrbitPoint(a, e, start + step * k / samplesPerSegment);
+                visit(point, DistanceToChord(point, chordStart, chordEnd));
+            }
+        }
+    }
+}
+
+
+TEST_CASE(ChordErrorBoundCoversSampledError)
+{
+    for(auto const e : { 0.0f, 0.2f, 0.6f, 0.9f })
+    {
+        for(auto segments = 16; segments <= 1024; segments *= 4)
+        {
+            auto const bound = OrbitTessellation::ChordErrorBound(5.0f, e, OrbitTessellation::TWO_PI / segments);
+
+            auto maxError = 0.0;
+            for(auto phase = 0.0; phase < 1.0; phase += 0.125)
+            {
+                SampleChordError(5.0, e, segments, phase * OrbitTessellation::TWO_PI / segments, [&](Point const&, double const error) {
+                    maxError = (std::max)(maxError, error);
+                });
+            }
+
+            CHECK(maxError <= bound * 1.001 + 1e-6);
+            // And it is tight, not a loose overestimate
+            CHECK(maxError >= bound * 0.9);
+        }
+    }
+}
+
+TEST_CASE(NearestDistanceIsABound)
+{
+    auto random = std::mt19937(1);
+    auto coordinate = std::uniform_real_distribution<double>(-12.0, 12.0);
+
+    for(auto const e : { 0.0f, 0.5f, 0.8f })
+    {
+        for(auto c = 0; c < 200; ++c)
+        {
+            auto const camera = Point{ coordinate(random), coordinate(random) * 0.25, coordinate(random) };
+            auto const focusDistance = static_cast<float>(Distance(camera, { }));
+
+            // With a projection scale of 2 on a 1 pixel viewport PixelsPerUnit is the reciprocal distance
+            auto const bound = 1.0f / OrbitTessellation::PixelsPerUnit(focusDistance, 5.0f, e, 2.0f, 1.0f);
+
+            auto nearest = 1e30;
+            for(auto t = 0.0; t < OrbitTessellation::TWO_PI; t += 1e-3)
+            {
+                nearest = (std::min)(nearest, Distance(camera, OrbitPoint(5.0, e, t)));
+            }
+
+            CHECK(bound <= nearest * 1.0001 + 1e-3);
+        }
+    }
+}
+
+// A camera inside the orbit is still at least periapsis - focusDistance away from every point of it
+TEST_CASE(CameraInsideOrbitDoesNotForceMaxSegments)
+{
+    auto const pixelsPerUnit = OrbitTessellation::PixelsPerUnit(1.0f, 3.0f, 0.0f, PROJECTION_SCALE, VIEWPORT_HEIGHT);
+    CHECK(std::abs(pixelsPerUnit - PROJECTION_SCALE * VIEWPORT_HEIGHT * 0.25f) < 1e-3f);
+    CHECK(OrbitTessellation::RequiredSegments(3.0f, 0.0f, pixelsPerUnit) == 128);
+
+    // At the focus the nearest point is periapsis
+    auto const atFocus = OrbitTessellation::PixelsPerUnit(0.0f, 4.0f, 0.5f, 2.0f, 1.0f);
+    CHECK(std::abs(1.0f / atFocus - 2.0f) < 1e-5f);
+
+    // Only a camera on the path itself falls back to the minimum distance
+    CHECK(OrbitTessellation::RequiredSegments(3.0f, 0.0f, OrbitTessellation::PixelsPerUnit(3.0f, 3.0f, 0.0f, PROJECTION_SCALE, VIEWPORT_HEIGHT)) == 4096);
+}
+
+TEST_CASE(SegmentCountGrowsWithProjectedSize)
+{
+    auto previous = 0;
+    for(auto distance = 1e5f; distance >= 10.0f; distance *= 0.5f)
+    {
+        auto const pixelsPerUnit = OrbitTessellation::PixelsPerUnit(distance, 5.0f, 0.3f, PROJECTION_SCALE, VIEWPORT_HEIGHT);
+        auto const segments = OrbitTessellation::RequiredSegments(5.0f, 0.3f, pixelsPerUnit);
+
+        CHECK(segments >= previous);
+        CHECK(segments >= 16 && segments <= 4096);
+        CHECK((segments & (segments - 1)) == 0);
+        previous = segments;
+    }
+    CHECK(previous > 16);
+}
+
+// Headless check of the whole chain: the chord error of the chosen tessellation projects below the pixel budget
+TEST_CASE(ProjectedChordErrorStaysWithinBudget)
+{
+    auto const settings = OrbitTessellation::Settings();
+    auto random = std::mt19937(2);
+    auto coordinate = std::uniform_real_distribution<double>(-40.0, 40.0);
+
+    auto checkedCount = 0;
+    for(auto const e : { 0.0f, 0.4f, 0.8f })
+    {
+        for(auto c = 0; c < 100; ++c)
+        {
+            auto const camera = Point{ coordinate(random), coordinate(random), coordinate(random) };
+            auto const pixelsPerUnit = OrbitTessellation::PixelsPerUnit(
+                static_cast<float>(Distance(camera, { })), 5.0f, e, PROJECTION_SCALE, VIEWPORT_HEIGHT);
+            auto const segments = OrbitTessellation::RequiredSegments(5.0f, e, pixelsPerUnit, settings);
+            if(segments == settings.maxSegments)
+            {
+                continue;
+            }
+
+            // Error seen perpendicular to the view at the distance of each sampled point, the worst case
+            auto maxPixels = 0.0;
+            SampleChordError(5.0, e, segments, 0.3, [&](Point const& point, double const error) {
+                maxPixels = (std::max)(maxPixels, error * PROJECTION_SCALE * VIEWPORT_HEIGHT * 0.5 / Distance(camera, point));
+            });
+
+            CHECK(maxPixels <= settings.maxErrorPixels * 1.001);
+            checkedCount++;
+        }
+    }
+    CHECK(checkedCount > 250);
+}
+
+
+BENCHMARK_CASE(TessellateMillionOrbits)
+{
+    auto constexpr count = 1000000;
+    auto random = std::mt19937(3);
+    auto distance = std::uniform_real_distribution<float>(0.0f, 1e4f);
+    auto axis = std::uniform_real_distribution<float>(0.1f, 100.0f);
+    auto eccentricity = std::uniform_real_distribution<float>(0.0f, 0.9f);
+
+    struct Orbit final
+    {
+        float focusDistance;
+        float a;
+        float e;
+    };
+    auto orbits = std::vector<Orbit>(count);
+    for(auto& orbit : orbits)
+    {
+        orbit = { distance(random), axis(random), eccentricity(random) };
+    }
+
+    size_t histogram[9] = { };
+    auto const time = Tests::MeasureMilliseconds(1, [&] {
+        for(auto const& orbit : orbits)
+        {
+            auto const pixelsPerUnit = OrbitTessellation::PixelsPerUnit(orbit.focusDistance, orbit.a, orbit.e, PROJECTION_SCALE, VIEWPORT_HEIGHT);
+            auto const segments = OrbitTessellation::RequiredSegments(orbit.a, orbit.e, pixelsPerUnit);
+
+            auto level = 0;
+            while((16 << level) < segments)
+            {
+                level++;
+            }
+            histogram[level]++;
+        }
+    });
+
+    std::printf("  %d orbits in %.1f ms\n", count, time);
+    for(auto level = 0; level < 9; ++level)
+    {
+        std::printf("  %5d segments: %zu\n", 16 << level, histogram[level]);
+    }
+}
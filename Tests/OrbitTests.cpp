@@ -0,0 +1,85 @@
+#include "Check.hpp"
+#include "SolarSystem/Orbit.hpp"
+
+#include <cmath>
+#include <memory>
+
+using namespace SolarSystem;
+
+namespace
+{
+    auto constexpr TWO_PI = 6.283185307179586476925;
+
+    // Eccentric anomaly back from the true anomaly, so Kepler's equation can be checked directly
+    auto MeanAnomalyOf(double const trueAnomaly, double const e) -> double
+    {
+        auto const eccentricAnomaly = 2.0 * std::atan2(std::sqrt(1.0 - e) * std::sin(trueAnomaly / 2.0), std::sqrt(1.0 + e) * std::cos(trueAnomaly / 2.0));
+        return eccentricAnomaly - e * std::sin(eccentricAnomaly);
+    }
+
+    struct Orbits final
+    {
+        std::unique_ptr<ECS> ecs = std::make_unique<ECS>();
+        WorldSystem* world = ecs->AddSystem<WorldSystem>();
+        TranslationSystem* translation = ecs->AddSystem<TranslationSystem>();
+        OrbitSystem* orbit = ecs->AddSystem<OrbitSystem>();
+
+        Orbits()
+        {
+            ecs->Initialize();
+        }
+    };
+}
+
+
+TEST_CASE(TrueAnomalySolvesKeplersEquation)
+{
+    for(auto const e : { 0.0, 0.1, 0.5, 0.9, 0.99 })
+    {
+        for(auto m = -TWO_PI / 2.0; m <= TWO_PI / 2.0; m += 0.05)
+        {
+            auto const trueAnomaly = OrbitSystem::TrueAnomaly(m, e);
+            CHECK(std::abs(std::remainder(MeanAnomalyOf(trueAnomaly, e) - m, TWO_PI)) < 1e-9);
+        }
+    }
+
+    // Circles move uniformly, mean anomalies beyond a turn wrap
+    CHECK(std::abs(OrbitSystem::TrueAnomaly(1.0, 0.0) - 1.0) < 1e-12);
+    CHECK(std::abs(OrbitSystem::TrueAnomaly(1.0 + 3.0 * TWO_PI, 0.3) - OrbitSystem::TrueAnomaly(1.0, 0.3)) < 1e-9);
+}
+
+TEST_CASE(EllipticalOrbitsGoThroughPeriapsisAndApoapsis)
+{
+    Orbits orbits;
+    auto const body = orbits.ecs->CreateEntity();
+    orbits.translation->AddComponent(body);
+    orbits.orbit->AddComponent(body, OrbitComponent(10.0, 100.0, 0.5));
+
+    // Periapsis along +z at the start
+    orbits.orbit->Update(0.0f, 50.0f);
+    auto const& periapsis = orbits.translation->GetComponent(body).translation;
+    CHECK(std::abs(periapsis.z - 5.0) < 1e-9 && std::abs(periapsis.x) < 1e-9);
+    CHECK(orbits.orbit->GetComponent(body).anomaly == 0.0);
+
+    // Half a period later the body is at apoapsis
+    orbits.orbit->Update(0.0f, 0.0f);
+    auto const& apoapsis = orbits.translation->GetComponent(body).translation;
+    CHECK(std::abs(apoapsis.z + 15.0) < 1e-9);
+    CHECK(std::abs(std::abs(orbits.orbit->GetComponent(body).anomaly) - TWO_PI / 2.0) < 1e-9);
+}
+
+TEST_CASE(CircularOrbitsKeepTheirPath)
+{
+    Orbits orbits;
+    auto const body = orbits.ecs->CreateEntity();
+    orbits.translation->AddComponent(body);
+    auto& orbit = orbits.orbit->AddComponent(body, OrbitComponent(4.0, -8.0));
+    orbit.t = 3.0;
+
+    orbits.orbit->Update(0.0f, 1.0f);
+    auto const angle = 3.0 * TWO_PI / -8.0;
+    auto const& position = orbits.translation->GetComponent(body).translation;
+    CHECK(std::abs(position.x - std::sin(angle) * 4.0) < 1e-9);
+    CHECK(std::abs(position.z - std::cos(angle) * 4.0) < 1e-9);
+    CHECK(std::abs(orbits.orbit->GetComponent(body).anomaly - angle) < 1e-12);
+}
@@ -0,0 +1,226 @@
+#include "Check.hpp"
+#include "SolarSystem/Picking.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace SolarSystem;
+
+namespace
+{
+    auto constexpr WIDTH = 1280.0f;
+    auto constexpr HEIGHT = 720.0f;
+
+    auto CreateView(DirectX::SimpleMath::Vector3 const& eye, DirectX::SimpleMath::Vector3 const& target) -> DirectX::SimpleMath::Matrix
+    {
+        return DirectX::SimpleMath::Matrix(DirectX::XMMatrixLookAtLH(eye, target, DirectX::SimpleMath::Vector3::Up));
+    }
+
+    auto CreateProjection() -> DirectX::SimpleMath::Matrix
+    {
+        return DirectX::SimpleMath::Matrix(DirectX::XMMatrixPerspectiveFovLH(DirectX::XM_PI / 3.0f, WIDTH / HEIGHT, 0.1f, 1000.0f));
+    }
+
+    auto IsNear(float const a, float const b) -> bool
+    {
+        return std::abs(a - b) < 1e-4f;
+    }
+
+    // Bodies on circular orbits around the origin, sampled at the current time like CameraSystem samples its targets
+    struct OrbitingBodies final
+    {
+        std::vector<BVHSphere> orbits;
+        std::vector<float> speeds;
+        float time = 0.0f;
+
+        OrbitingBodies(size_t const count, float const extent, float const maxSpeed, unsigned const seed)
+            : orbits(count), speeds(count)
+        {
+            auto random = std::mt19937(seed);
+            auto position = std::uniform_real_distribution<float>(-extent, extent);
+            auto radius = std::uniform_real_distribution<float>(0.1f, 5.0f);
+            auto speed = std::uniform_real_distribution<float>(-maxSpeed, maxSpeed);
+
+            for(size_t i = 0; i < count; ++i)
+            {
+                orbits[i] = { position(random), position(random), position(random), radius(random) };
+                speeds[i] = speed(random);
+            }
+        }
+
+        auto operator()(size_t const index, Entity& entity, BVHSphere& sphere) const -> void
+        {
+            auto const& orbit = orbits[index];
+            auto const angle = speeds[index] * time;
+            entity = Entity{ index };
+            sphere = {
+                orbit.x * std::cos(angle) - orbit.z * std::sin(angle),
+                orbit.y,
+                orbit.x * std::sin(angle) + orbit.z * std::cos(angle),
+                orbit.radius
+            };
+        }
+
+        auto PickLinear(BVHRay const& ray) const -> std::optional<size_t>
+        {
+            auto nearest = FLT_MAX;
+            auto picked = std::optional<size_t>();
+            for(size_t i = 0; i < orbits.size(); ++i)
+            {
+                auto entity = Entity();
+                auto sphere = BVHSphere();
+                (*this)(i, entity, sphere);
+
+                auto const distance = BoundingVolumeHierarchy::IntersectRaySphere(ray, sphere);
+                if(distance < nearest)
+                {
+                    nearest = distance;
+                    picked = i;
+                }
+            }
+            return picked;
+        }
+    };
+}
+
+
+TEST_CASE(CenterRayFollowsViewDirection)
+{
+    auto const ray = ScreenPointToRay(WIDTH * 0.5f, HEIGHT * 0.5f, WIDTH, HEIGHT,
+        CreateView({ 0.0f, 0.0f, -10.0f }, { 0.0f, 0.0f, 0.0f }), CreateProjection());
+
+    CHECK(IsNear(ray.origin[0], 0.0f) && IsNear(ray.origin[1], 0.0f) && IsNear(ray.origin[2], -10.0f));
+    CHECK(IsNear(ray.direction[0], 0.0f) && IsNear(ray.direction[1], 0.0f) && IsNear(ray.direction[2], 1.0f));
+}
+
+TEST_CASE(CornerRaysSpanFieldOfView)
+{
+    auto const view = CreateView({ 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 1.0f });
+    auto const top = ScreenPointToRay(WIDTH * 0.5f, 0.0f, WIDTH, HEIGHT, view, CreateProjection());
+    auto const right = ScreenPointToRay(WIDTH, HEIGHT * 0.5f, WIDTH, HEIGHT, view, CreateProjection());
+
+    // Half the vertical field of view above the center, screen y grows downwards
+    CHECK(IsNear(std::atan2(top.direction[1], top.direction[2]), DirectX::XM_PI / 6.0f));
+    CHECK(IsNear(std::tan(std::atan2(right.direction[0], right.direction[2])), std::tan(DirectX::XM_PI / 6.0f) * WIDTH / HEIGHT));
+}
+
+TEST_CASE(PickReturnsNearestBodyUnderCursor)
+{
+    PickingModule picking;
+    picking.Resize(3);
+    picking.SetBody(0, Entity{ 10 }, { 0.0f, 0.0f, 20.0f }, 3.0f);
+    picking.SetBody(1, Entity{ 11 }, { 0.0f, 0.0f, 8.0f }, 1.0f);
+    picking.SetBody(2, Entity{ 12 }, { 50.0f, 0.0f, 8.0f }, 1.0f);
+    picking.Update();
+
+    auto const view = CreateView({ 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 1.0f });
+    auto const center = picking.Pick(ScreenPointToRay(WIDTH * 0.5f, HEIGHT * 0.5f, WIDTH, HEIGHT, view, CreateProjection()));
+    CHECK(center && picking.GetEntity(*center).id == 11);
+
+    auto const corner = picking.Pick(ScreenPointToRay(0.0f, 0.0f, WIDTH, HEIGHT, view, CreateProjection()));
+    CHECK(!corner);
+}
+
+
+TEST_CASE(MovingPicksMatchLinearScan)
+{
+    auto bodies = OrbitingBodies(2000, 100.0f, 1.0f, 2);
+    auto const view = CreateView({ 0.0f, 0.0f, -150.0f }, { 0.0f, 0.0f, 0.0f });
+    auto const projection = CreateProjection();
+    auto random = std::mt19937(3);
+    auto screen = std::uniform_real_distribution<float>(0.0f, 1.0f);
+
+    PickingModule picking;
+    auto hitCount = 0;
+    for(auto frame = size_t(0); frame < 4 * PickingModule::REFRESH_FRAMES; ++frame)
+    {
+        bodies.time = static_cast<float>(frame) * 0.05f;
+        picking.Refresh(bodies.orbits.size(), bodies);
+
+        // Until two sweeps have measured the motion a pick gathers the bodies first
+        CHECK(picking.HasMotionBounds() == (frame >= 2 * PickingModule::REFRESH_FRAMES));
+        if(!picking.HasMotionBounds())
+        {
+            picking.Gather(bodies.orbits.size(), bodies);
+        }
+
+        for(auto r = 0; r < 20; ++r)
+        {
+            auto const ray = ScreenPointToRay(screen(random) * WIDTH, screen(random) * HEIGHT, WIDTH, HEIGHT, view, projection);
+            auto const picked = picking.Pick(ray, bodies);
+            CHECK(picked == bodies.PickLinear(ray));
+            hitCount += picked ? 1 : 0;
+        }
+    }
+    CHECK(hitCount > 0);
+}
+
+TEST_CASE(ChangedBodyCountGathersAgain)
+{
+    auto bodies = OrbitingBodies(100, 50.0f, 1.0f, 4);
+    PickingModule picking;
+    for(auto frame = size_t(0); frame <= 2 * PickingModule::REFRESH_FRAMES; ++frame)
+    {
+        picking.Refresh(bodies.orbits.size(), bodies);
+    }
+    CHECK(picking.HasMotionBounds());
+
+    bodies.orbits.resize(60);
+    bodies.speeds.resize(60);
+    picking.Refresh(bodies.orbits.size(), bodies);
+    CHECK(!picking.HasMotionBounds());
+    CHECK(picking.GetEntity(59).id == 59);
+
+    picking.Invalidate();
+    CHECK(!picking.HasMotionBounds());
+}
+
+
+//
+// What a user sees with a million moving bodies: the refresh CameraSystem runs every frame, including the frames
+// that refit, and the cost of a click once the hierarchy is warm against gathering every body on the click as a
+// pick right after loading does. Bodies move a few times their radius during a sweep at 60 frames a second.
+//
+BENCHMARK_CASE(MillionBodyPicks)
+{
+    auto constexpr count = size_t(1000000);
+    auto bodies = OrbitingBodies(count, 5000.0f, 0.001f, 1);
+    auto random = std::mt19937(5);
+    auto screen = std::uniform_real_distribution<float>(0.0f, 1.0f);
+    auto const view = CreateView({ 0.0f, 0.0f, -6000.0f }, { 0.0f, 0.0f, 0.0f });
+    auto const projection = CreateProjection();
+
+    PickingModule picking;
+    auto const gather = Tests::MeasureMilliseconds(1, [&] { picking.Gather(count, bodies); });
+
+    auto constexpr frames = 4 * PickingModule::REFRESH_FRAMES;
+    auto refresh = 0.0;
+    auto slowestRefresh = 0.0;
+    for(size_t frame = 0; frame < frames; ++frame)
+    {
+        auto const milliseconds = Tests::MeasureMilliseconds(1, [&] {
+            bodies.time += 1.0f / 60.0f;
+            picking.Refresh(count, bodies);
+        });
+        refresh += milliseconds / frames;
+        slowestRefresh = (std::max)(slowestRefresh, milliseconds);
+    }
+
+    auto hitCount = 0;
+    auto constexpr pickCount = 10000;
+    auto const pick = Tests::MeasureMilliseconds(pickCount, [&] {
+        auto const ray = ScreenPointToRay(screen(random) * WIDTH, screen(random) * HEIGHT, WIDTH, HEIGHT, view, projection);
+        hitCount += picking.Pick(ray, bodies) ? 1 : 0;
+    });
+
+    auto const coldPick = Tests::MeasureMilliseconds(5, [&] {
+        auto const ray = ScreenPointToRay(screen(random) * WIDTH, screen(random) * HEIGHT, WIDTH, HEIGHT, view, projection);
+        picking.Gather(count, bodies);
+        picking.Pick(ray, bodies);
+    });
+
+    std::printf("  %zu moving bodies: first gather %.1f ms, refresh %.3f ms a frame, %.3f ms at most\n", count, gather, refresh, slowestRefresh);
+    std::printf("  click %.4f ms once warm (%d of %d picks hit), %.1f ms gathering on the click\n", pick, hitCount, pickCount, coldPick);
+}
@@ -0,0 +1,317 @@
+#include "Check.hpp"
+#include "SolarSystem/Transform.hpp"
+
+#include <memory>
+
+using namespace SolarSystem;
+
+namespace
+{
+    // The systems the scene loader fills for every body
+    struct Scene final
+    {
+        std::unique_ptr<ECS> ecs = std::make_unique<ECS>();
+        WorldSystem* world = ecs->AddSystem<WorldSystem>();
+        TranslationSystem* translation = ecs->AddSystem<TranslationSystem>();
+        RotationSystem* rotation = ecs->AddSystem<RotationSystem>();
+        ScalingSystem* scaling = ecs->AddSystem<ScalingSystem>();
+        ParentSystem* parent = ecs->AddSystem<ParentSystem>();
+    };
+
+    // Every entity but the first is parented to the one before it, like a chain of orbit pivots
+    auto ParentOf(Entity const entity) -> Entity
+    {
+        return Entity{ entity.id > 0 ? entity.id - 1 : 0 };
+    }
+
+    auto ScalingOf(Entity const entity) -> ScalingComponent
+    {
+        auto const s = static_cast<float>(entity.id % 100 + 1);
+        return { DirectX::SimpleMath::Vector3(s, s, s) };
+    }
+
+    auto BuildPerEntity(Scene& scene, size_t const count) -> void
+    {
+        for(size_t i = 0; i < count; ++i)
+        {
+            auto const entity = scene.ecs->CreateEntity();
+            scene.world->AddComponent(entity);
+            scene.translation->AddComponent(entity);
+            scene.rotation->AddComponent(entity);
+            scene.scaling->AddComponent(entity, ScalingOf(entity));
+            if(entity.id > 0)
+            {
+                scene.parent->AddComponent(entity, ParentComponent{ ParentOf(entity) });
+            }
+        }
+    }
+
+    // Staged per system in entity order, then inserted with one call per system as SceneLoader does
+    auto BuildBatched(Scene& scene, size_t const count) -> void
+    {
+        auto const entities = scene.ecs->CreateEntities(count);
+
+        auto scalings = std::vector<ScalingComponent>(count);
+        auto parents = std::vector<ParentComponent>();
+        parents.reserve(count);
+        for(size_t i = 0; i < count; ++i)
+        {
+            scalings[i] = ScalingOf(entities[i]);
+            if(entities[i].id > 0)
+            {
+                parents.push_back({ ParentOf(entities[i]) });
+            }
+        }
+
+        scene.world->AddComponents(entities.data(), count);
+        scene.translation->AddComponents(entities.data(), count);
+        scene.rotation->AddComponents(entities.data(), count);
+        scene.scaling->AddComponents(entities.data(), scalings.data(), count);
+        scene.parent->AddComponents(entities.data() + 1, parents.data(), parents.size());
+    }
+
+    // Many small batches, the way command buffer playback and prefab spawns insert
+    auto BuildInSmallBatches(Scene& scene, size_t const count, size_t const batchSize) -> void
+    {
+        auto const entities = scene.ecs->CreateEntities(count);
+        auto const scalings = std::vector<ScalingComponent>(batchSize, ScalingComponent{ DirectX::SimpleMath::Vector3(2.0f, 2.0f, 2.0f) });
+
+        for(size_t first = 0; first < count; first += batchSize)
+        {
+            auto const batch = (std::min)(batchSize, count - first);
+            scene.world->AddComponents(entities.data() + first, batch);
+            scene.translation->AddComponents(entities.data() + first, batch);
+            scene.rotation->AddComponents(entities.data() + first, batch);
+            scene.scaling->AddComponents(entities.data() + first, scalings.data(), batch);
+        }
+    }
+
+    // Entities recorded one at a time with all their components, the way systems record spawns
+    auto RecordPerEntity(CommandBuffer& commandBuffer, size_t const count) -> void
+    {
+        auto previous = Entity{ 0 };
+        for(size_t i = 0; i < count; ++i)
+        {
+            auto const entity = commandBuffer.CreateEntity();
+            commandBuffer.AddComponent<WorldSystem>(entity);
+            commandBuffer.AddComponent<TranslationSystem>(entity);
+            commandBuffer.AddComponent<ScalingSystem>(entity, ScalingOf(Entity{ i }));
+            commandBuffer.AddComponent<ParentSystem>(entity, ParentComponent{ previous });
+            previous = entity;
+        }
+    }
+
+    // Dense order and values of the components, which also pins the entity to component mapping
+    template<typename System, typename Value>
+    auto Contents(System& system, Value const& value) -> std::vector<std::pair<size_t, float>>
+    {
+        auto contents = std::vector<std::pair<size_t, float>>();
+        system.Each([&](Entity const entity, typename System::component_type const& component) {
+            contents.emplace_back(entity.id, value(component));
+        });
+        return contents;
+    }
+
+    auto SceneContents(Scene& scene) -> std::vector<std::vector<std::pair<size_t, float>>>
+    {
+        return {
+            Contents(*scene.world, [](WorldMatrixComponent const&) { return 0.0f; }),
+            Contents(*scene.translation, [](TranslationComponent const&) { return 0.0f; }),
+            Contents(*scene.scaling, [](ScalingComponent const& component) { return component.scaling.x; }),
+            Contents(*scene.parent, [](ParentComponent const& component) { return static_cast<float>(component.parent.id); })
+        };
+    }
+}
+
+
+TEST_CASE(CreatedEntitiesAreConsecutive)
+{
+    ECS ecs;
+    auto const first = ecs.CreateEntity();
+    auto const block = ecs.CreateEntities(100);
+    auto const last = ecs.CreateEntity();
+
+    CHECK(block.size() == 100);
+    for(size_t i = 0; i < block.size(); ++i)
+    {
+        CHECK(block[i].id == first.id + 1 + i);
+    }
+    CHECK(last.id == first.id + 101);
+    CHECK(ecs.GetEntityCount() == 102);
+}
+
+TEST_CASE(BatchedBuildMatchesPerEntityBuild)
+{
+    auto constexpr count = size_t(5000);
+    Scene perEntity;
+    Scene batched;
+    BuildPerEntity(perEntity, count);
+    BuildBatched(batched, count);
+
+    CHECK(batched.world->GetComponentCount() == perEntity.world->GetComponentCount());
+    CHECK(batched.parent->GetComponentCount() == count - 1);
+
+    for(size_t i = 0; i < count; ++i)
+    {
+        auto const entity = Entity{ i };
+        CHECK(batched.world->HasComponent(entity) && batched.translation->HasComponent(entity) && batched.rotation->HasComponent(entity));
+        CHECK(batched.scaling->GetComponent(entity).scaling == perEntity.scaling->GetComponent(entity).scaling);
+        CHECK(batched.parent->HasComponent(entity) == perEntity.parent->HasComponent(entity));
+        if(i > 0)
+        {
+            CHECK(batched.parent->GetComponent(entity).parent.id == i - 1);
+        }
+    }
+}
+
+// ParentSystem walks its components in order and needs parents before children
+TEST_CASE(BatchesKeepInsertionOrder)
+{
+    Scene scene;
+    BuildBatched(scene, 10);
+
+    auto previous = size_t(0);
+    scene.parent->Each([&](Entity const entity, ParentComponent const& component) {
+        CHECK(component.parent.id == previous);
+        CHECK(entity.id == previous + 1);
+        previous = entity.id;
+    });
+    CHECK(previous == 9);
+}
+
+TEST_CASE(BatchesAppendToExistingComponents)
+{
+    Scene scene;
+    BuildPerEntity(scene, 3);
+
+    auto const more = scene.ecs->CreateEntities(4);
+    scene.scaling->AddComponents(more.data(), more.size(), ScalingComponent{ DirectX::SimpleMath::Vector3(7.0f, 7.0f, 7.0f) });
+
+    CHECK(scene.scaling->GetComponentCount() == 7);
+    CHECK(scene.scaling->GetComponent(Entity{ 2 }).scaling.x == 3.0f);
+    for(auto const& entity : more)
+    {
+        CHECK(scene.scaling->GetComponent(entity).scaling.x == 7.0f);
+    }
+}
+
+TEST_CASE(SmallBatchesMatchOneBatch)
+{
+    auto constexpr count = size_t(1000);
+    Scene small;
+    Scene whole;
+    BuildInSmallBatches(small, count, 7);
+    BuildInSmallBatches(whole, count, count);
+
+    CHECK(small.scaling->GetComponentCount() == count);
+    for(size_t i = 0; i < count; ++i)
+    {
+        auto const entity = Entity{ i };
+        CHECK(small.world->HasComponent(entity) && small.translation->HasComponent(entity) && small.rotation->HasComponent(entity));
+        CHECK(small.scaling->GetComponent(entity).scaling == whole.scaling->GetComponent(entity).scaling);
+    }
+
+    auto next = size_t(0);
+    small.scaling->Each([&](Entity const entity, ScalingComponent const&) {
+        CHECK(entity.id == next++);
+    });
+}
+
+TEST_CASE(CommandBufferPlaybackIsRepeatable)
+{
+    auto const record = [](Scene& scene, CommandBuffer& commandBuffer) {
+        // Existing entities so recorded commands also touch components that are already there
+        BuildPerEntity(scene, 10);
+        RecordPerEntity(commandBuffer, 500);
+        commandBuffer.RemoveComponent<ScalingSystem>(Entity{ 3 });
+        commandBuffer.DestroyEntity(Entity{ 4 });
+        RecordPerEntity(commandBuffer, 200);
+        commandBuffer.AddComponent<ScalingSystem>(Entity{ 3 }, ScalingComponent{ DirectX::SimpleMath::Vector3(9.0f, 9.0f, 9.0f) });
+    };
+
+    Scene first;
+    CommandBuffer firstBuffer;
+    record(first, firstBuffer);
+    firstBuffer.Playback(*first.ecs);
+
+    Scene second;
+    CommandBuffer secondBuffer;
+    record(second, secondBuffer);
+    secondBuffer.Playback(*second.ecs);
+
+    // The same buffer recorded again after a playback reuses its scratch and gives the same result
+    Scene third;
+    record(third, firstBuffer);
+    firstBuffer.Playback(*third.ecs);
+
+    auto const contents = SceneContents(first);
+    CHECK(contents == SceneContents(second));
+    CHECK(contents == SceneContents(third));
+
+    CHECK(first.ecs->GetEntityCount() == 710);
+    CHECK(contents[0].size() == 709);
+    CHECK(contents[2].size() == 709);
+    CHECK(!first.world->HasComponent(Entity{ 4 }));
+    CHECK(first.scaling->GetComponent(Entity{ 3 }).scaling.x == 9.0f);
+    CHECK(contents[2].back().first == 3);
+
+    // Each system got its components in recording order with placeholders resolved
+    for(size_t i = 0; i < 500; ++i)
+    {
+        CHECK(contents[1][9 + i].first == 10 + i);
+        CHECK(first.parent->GetComponent(Entity{ 10 + i }).parent.id == (i == 0 ? 0 : 9 + i));
+    }
+}
+
+
+BENCHMARK_CASE(SceneBuild)
+{
+    for(auto const count : { size_t(10000), size_t(100000), size_t(1000000) })
+    {
+        auto const iterations = count >= 1000000 ? 3 : 10;
+
+        auto const perEntity = Tests::MeasureMilliseconds(iterations, [&] {
+            Scene scene;
+            BuildPerEntity(scene, count);
+        });
+        auto const batched = Tests::MeasureMilliseconds(iterations, [&] {
+            Scene scene;
+            BuildBatched(scene, count);
+        });
+
+        std::printf("  %8zu entities: per entity %8.2f ms, batched %8.2f ms, %.2fx\n", count, perEntity, batched, perEntity / batched);
+    }
+}
+
+// Total time has to stay linear in the entity count however small the batches are
+BENCHMARK_CASE(SceneBuildInSmallBatches)
+{
+    for(auto const count : { size_t(10000), size_t(100000), size_t(1000000) })
+    {
+        auto const iterations = count >= 1000000 ? 3 : 10;
+        for(auto const batchSize : { size_t(1), size_t(16), size_t(256) })
+        {
+            auto const time = Tests::MeasureMilliseconds(iterations, [&] {
+                Scene scene;
+                BuildInSmallBatches(scene, count, batchSize);
+            });
+            std::printf("  %8zu entities in batches of %3zu: %8.2f ms\n", count, batchSize, time);
+        }
+    }
+}
+
+BENCHMARK_CASE(CommandBufferPlayback)
+{
+    for(auto const count : { size_t(10000), size_t(100000), size_t(1000000) })
+    {
+        CommandBuffer commandBuffer;
+        auto const iterations = count >= 1000000 ? 3 : 10;
+
+        auto const time = Tests::MeasureMilliseconds(iterations, [&] {
+            Scene scene;
+            RecordPerEntity(commandBuffer, count);
+            commandBuffer.Playback(*scene.ecs);
+        });
+        std::printf("  %8zu entities recorded per entity and played back: %8.2f ms\n", count, time);
+    }
+}
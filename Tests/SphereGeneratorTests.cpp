@@ -0,0 +1,193 @@
+#include "Check.hpp"
+#include "SolarSystem/Mesh.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace SolarSystem;
+
+namespace
+{
+    struct SphereMeasurement final
+    {
+        size_t triangles = 0;
+        size_t vertices = 0;
+        // Largest distance between an edge midpoint and the unit sphere, the silhouette error of the mesh
+        float maxSagitta = 0.0f;
+        float maxRadiusError = 0.0f;
+        float acmr = 0.0f;
+        bool is16Bit = false;
+    };
+
+    auto MeasureSphere(Mesh const& mesh) -> SphereMeasurement
+    {
+        auto const& vertexBuffer = mesh.vertexBuffers[0];
+        auto const indices = ReadIndices(mesh.indexBuffer);
+
+        auto const position = [&](uint32_t const vertex) {
+            auto const p = ReadVertexElement(vertexBuffer, vertexBuffer.vertexElements[0], static_cast<int>(vertex));
+            return DirectX::SimpleMath::Vector3(p.x, p.y, p.z);
+        };
+
+        SphereMeasurement measurement;
+        measurement.triangles = indices.size() / 3;
+        measurement.vertices = static_cast<size_t>(vertexBuffer.vertexCount);
+        measurement.acmr = MeshOptimizer::AnalyzeVertexCache(indices, measurement.vertices).acmr;
+        measurement.is16Bit = mesh.indexBuffer.format == DXGI_FORMAT_R16_UINT;
+
+        for(size_t i = 0; i < indices.size(); i += 3)
+        {
+            for(auto e = 0; e < 3; ++e)
+            {
+                auto const a = position(indices[i + e]);
+                auto const b = position(indices[i + (e + 1) % 3]);
+                measurement.maxSagitta = (std::max)(measurement.maxSagitta, 1.0f - ((a + b) * 0.5f).Length());
+                measurement.maxRadiusError = (std::max)(measurement.maxRadiusError, std::abs(a.Length() - 1.0f));
+            }
+        }
+
+        return measurement;
+    }
+
+    // Finest mesh of the family whose silhouette error does not exceed maxSagitta
+    template<typename Generator>
+    auto FindEqualError(float const maxSagitta, int parameter, Generator const& generator) -> std::pair<int, SphereMeasurement>
+    {
+        while(true)
+        {
+            auto const measurement = MeasureSphere(generator(parameter));
+            if(measurement.maxSagitta <= maxSagitta)
+            {
+                return { parameter, measurement };
+            }
+            parameter++;
+        }
+    }
+
+    auto IsSameBytes(Mesh const& l, Mesh const& r) -> bool
+    {
+        if(l.vertexBuffers.size() != r.vertexBuffers.size() || l.indexBuffer.data != r.indexBuffer.data)
+        {
+            return false;
+        }
+        for(size_t i = 0; i < l.vertexBuffers.size(); ++i)
+        {
+            if(l.vertexBuffers[i].data != r.vertexBuffers[i].data)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+
+TEST_CASE(GeneratedSpheresShareVertices)
+{
+    for(auto const& mesh : { Procedural::CreateIcosphere(4), Procedural::CreateCubeSphere(24) })
+    {
+        auto const measurement = MeasureSphere(mesh);
+        CHECK(measurement.maxRadiusError < 1e-5f);
+
+        // A closed triangle mesh has about half as many vertices as triangles, seams add a few
+        CHECK(measurement.vertices < measurement.triangles * 0.55f);
+    }
+
+    // 10 * 4^n + 2 unique positions
+    auto const icosphere = MeasureSphere(Procedural::CreateIcosphere(3));
+    CHECK(icosphere.triangles == 20 * 64);
+    CHECK(icosphere.vertices >= 642);
+}
+
+TEST_CASE(GeneratedSpheresAreCacheOptimized)
+{
+    auto const uvSphere = MeasureSphere(Procedural::CreateSphere(128, 64));
+    auto const icosphere = MeasureSphere(Procedural::CreateIcosphere(5));
+    auto const cubeSphere = MeasureSphere(Procedural::CreateCubeSphere(32));
+
+    CHECK(icosphere.acmr < 0.8f);
+    CHECK(cubeSphere.acmr < 0.8f);
+    CHECK(icosphere.acmr < uvSphere.acmr);
+    CHECK(cubeSphere.acmr < uvSphere.acmr);
+}
+
+TEST_CASE(GeneratedSpheresUse16BitIndicesWhenTheyFit)
+{
+    CHECK(MeasureSphere(Procedural::CreateIcosphere(5)).is16Bit);
+    CHECK(MeasureSphere(Procedural::CreateCubeSphere(64)).is16Bit);
+    CHECK(!MeasureSphere(Procedural::CreateIcosphere(7)).is16Bit);
+}
+
+// At the silhouette error of CreateSphere(128, 64) the cube sphere needs fewer triangles and vertex shader invocations
+TEST_CASE(CubeSphereIsCheaperAtEqualSilhouetteError)
+{
+    auto uvSphereMesh = Procedural::CreateSphere(128, 64);
+    OptimizeMesh(uvSphereMesh);
+    auto const uvSphere = MeasureSphere(uvSphereMesh);
+
+    auto const cubeSphere = FindEqualError(uvSphere.maxSagitta, 8, Procedural::CreateCubeSphere).second;
+    CHECK(cubeSphere.triangles < uvSphere.triangles);
+    CHECK(cubeSphere.acmr * cubeSphere.triangles < uvSphere.acmr * uvSphere.triangles);
+}
+
+// Counts on both sides of the point where a generator starts splitting its work into several jobs
+TEST_CASE(ParallelGenerationMatchesSerial)
+{
+    JobSystem serial(0);
+    JobSystem parallel(3);
+    auto constexpr grain = static_cast<int>(Procedural::GENERATOR_GRAIN_SIZE);
+
+    // 64 vertices a row, so the middle rows are split into jobs beyond 64 of them
+    for(auto const latitudeSides : { 63, 64, 65, 66, 200 })
+    {
+        CHECK(IsSameBytes(Procedural::CreateSphere(63, latitudeSides, serial), Procedural::CreateSphere(63, latitudeSides, parallel)));
+    }
+
+    // Trig is split at GENERATOR_GRAIN_SIZE angles and the sides at a quarter of that, four vertices each
+    for(auto const sides : { grain / 4 - 1, grain / 4, grain / 4 + 1, grain - 2, grain - 1, grain, grain + 1 })
+    {
+        CHECK(IsSameBytes(Procedural::CreateRing(sides, 1.0f, 2.0f, serial), Procedural::CreateRing(sides, 1.0f, 2.0f, parallel)));
+    }
+
+    // Two vertices a segment
+    auto const color = DirectX::SimpleMath::Color(1.0f, 0.5f, 0.25f, 1.0f);
+    for(auto const segments : { grain - 4, grain - 2, grain, grain + 2 })
+    {
+        CHECK(IsSameBytes(Procedural::Circle(1.0f, segments, color, serial), Procedural::Circle(1.0f, segments, color, parallel)));
+    }
+
+    auto const serialChain = Procedural::CreateSphereLODChain(4, 16, 256, serial);
+    auto const parallelChain = Procedural::CreateSphereLODChain(4, 16, 256, parallel);
+    for(size_t i = 0; i < serialChain.size(); ++i)
+    {
+        CHECK(IsSameBytes(serialChain[i], parallelChain[i]));
+    }
+}
+
+
+BENCHMARK_CASE(SphereGeneratorsAtEqualSilhouetteError)
+{
+    auto const uvSphere = MeasureSphere(Procedural::CreateSphere(128, 64));
+    auto uvSphereOptimizedMesh = Procedural::CreateSphere(128, 64);
+    OptimizeMesh(uvSphereOptimizedMesh);
+    auto const uvSphereOptimized = MeasureSphere(uvSphereOptimizedMesh);
+
+    auto const icosphere = FindEqualError(uvSphere.maxSagitta, 1, Procedural::CreateIcosphere);
+    auto const cubeSphere = FindEqualError(uvSphere.maxSagitta, 8, Procedural::CreateCubeSphere);
+
+    auto const print = [](char const* const name, int const parameter, SphereMeasurement const& m) {
+        std::printf("  %-22s %3d %8zu tris %8zu verts  sagitta %.2e  ACMR %.3f  %8.0f transforms  %s\n",
+            name, parameter, m.triangles, m.vertices, m.maxSagitta, m.acmr, m.acmr * m.triangles, m.is16Bit ? "R16" : "R32");
+    };
+
+    print("CreateSphere(128, 64)", 0, uvSphere);
+    print("  after OptimizeMesh", 0, uvSphereOptimized);
+    print("CreateIcosphere", icosphere.first, icosphere.second);
+    print("CreateCubeSphere", cubeSphere.first, cubeSphere.second);
+
+    auto constexpr iterations = 10;
+    std::printf("  generation: CreateSphere(128, 64) %.2f ms, CreateIcosphere(%d) %.2f ms, CreateCubeSphere(%d) %.2f ms\n",
+        Tests::MeasureMilliseconds(iterations, [] { Procedural::CreateSphere(128, 64); }),
+        icosphere.first, Tests::MeasureMilliseconds(iterations, [&] { Procedural::CreateIcosphere(icosphere.first); }),
+        cubeSphere.first, Tests::MeasureMilliseconds(iterations, [&] { Procedural::CreateCubeSphere(cubeSphere.first); }));
+}
@@ -0,0 +1,24 @@
+#include "Check.hpp"
+#include <cstring>
+
+// Runs every test, or every benchmark with --benchmark, optionally only those whose name contains the next argument
+auto main(int argc, char const* argv[]) -> int
+{
+    auto const runBenchmarks = argc > 1 && std::strcmp(argv[1], "--benchmark") == 0;
+    auto const filter = argc > (runBenchmarks ? 2 : 1) ? argv[runBenchmarks ? 2 : 1] : "";
+
+    for(auto const& testCase : Tests::GetTestCases())
+    {
+        if(testCase.isBenchmark != runBenchmarks || std::strstr(testCase.name, filter) == nullptr)
+        {
+            continue;
+        }
+
+        auto const failuresBefore = Tests::failureCount;
+        std::printf("%s\n", testCase.name);
+        testCase.function();
+        std::printf("%s %s\n", Tests::failureCount == failuresBefore ? "  passed" : "  FAILED", testCase.name);
+    }
+
+    return Tests::failureCount > 0 ? 1 : 0;
+}
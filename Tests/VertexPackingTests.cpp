@@ -0,0 +1,157 @@
+#include "Check.hpp"
+#include "SolarSystem/Mesh.hpp"
+
+#include <cmath>
+#include <random>
+
+using namespace SolarSystem;
+
+namespace
+{
+    auto RandomNormals(size_t const count, unsigned const seed) -> std::vector<DirectX::SimpleMath::Vector3>
+    {
+        auto random = std::mt19937(seed);
+        auto component = std::normal_distribution<float>();
+
+        auto normals = std::vector<DirectX::SimpleMath::Vector3>(count);
+        for(auto& normal : normals)
+        {
+            normal = { component(random), component(random), component(random) };
+            normal.Normalize();
+        }
+        return normals;
+    }
+
+    auto AngleBetween(DirectX::SimpleMath::Vector3 const& a, DirectX::SimpleMath::Vector3 const& b) -> float
+    {
+        return std::atan2(a.Cross(b).Length(), a.Dot(b));
+    }
+
+    // Largest angular error of octahedral normals quantized with pack and unpack
+    template<typename Pack, typename Unpack>
+    auto MaxOctahedralError(std::vector<DirectX::SimpleMath::Vector3> const& normals, Pack const& pack, Unpack const& unpack) -> float
+    {
+        auto maxError = 0.0f;
+        for(auto const& normal : normals)
+        {
+            auto const encoded = VertexPacking::EncodeOctahedral(normal);
+            auto const decoded = VertexPacking::DecodeOctahedral({ unpack(pack(encoded.x)), unpack(pack(encoded.y)) });
+            maxError = (std::max)(maxError, AngleBetween(normal, decoded));
+        }
+        return maxError;
+    }
+}
+
+
+TEST_CASE(SnormRoundTripIsWithinHalfAStep)
+{
+    for(auto value = -1.0f; value <= 1.0f; value += 1.0f / 4096.0f)
+    {
+        CHECK(std::abs(VertexPacking::UnpackSnorm16(VertexPacking::PackSnorm16(value)) - value) <= 0.5f / 32767.0f + 1e-7f);
+        CHECK(std::abs(VertexPacking::UnpackSnorm8(VertexPacking::PackSnorm8(value)) - value) <= 0.5f / 127.0f + 1e-7f);
+    }
+
+    // Out of range values clamp, and both negative extremes decode to -1 like the input assembler does
+    CHECK(VertexPacking::PackSnorm16(2.0f) == 32767);
+    CHECK(VertexPacking::PackSnorm8(-2.0f) == -127);
+    CHECK(VertexPacking::UnpackSnorm16(-32768) == -1.0f);
+    CHECK(VertexPacking::UnpackSnorm8(-128) == -1.0f);
+}
+
+TEST_CASE(HalfRoundTripKeepsElevenBitsOfUV)
+{
+    for(auto value = 0.0f; value <= 1.0f; value += 1.0f / 1000.0f)
+    {
+        CHECK(std::abs(VertexPacking::UnpackHalf(VertexPacking::PackHalf(value)) - value) <= 1.0f / 4096.0f);
+    }
+    CHECK(VertexPacking::UnpackHalf(VertexPacking::PackHalf(1.0f)) == 1.0f);
+}
+
+TEST_CASE(OctahedralEncodingIsExactOnAxes)
+{
+    DirectX::SimpleMath::Vector3 const axes[] = {
+        { 1.0f, 0.0f, 0.0f }, { -1.0f, 0.0f, 0.0f },
+        { 0.0f, 1.0f, 0.0f }, { 0.0f, -1.0f, 0.0f },
+        { 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f, -1.0f }
+    };
+
+    for(auto const& axis : axes)
+    {
+        auto const encoded = VertexPacking::EncodeOctahedral(axis);
+        CHECK(std::abs(encoded.x) <= 1.0f && std::abs(encoded.y) <= 1.0f);
+        CHECK(VertexPacking::DecodeOctahedral(encoded) == axis);
+    }
+}
+
+TEST_CASE(OctahedralNormalsStayWithinAngularBounds)
+{
+    auto const normals = RandomNormals(100000, 1);
+
+    auto const unquantized = MaxOctahedralError(normals, [](float const v) { return v; }, [](float const v) { return v; });
+    auto const snorm16 = MaxOctahedralError(normals, VertexPacking::PackSnorm16, VertexPacking::UnpackSnorm16);
+    auto const snorm8 = MaxOctahedralError(normals, VertexPacking::PackSnorm8, VertexPacking::UnpackSnorm8);
+
+    CHECK(unquantized < 1e-5f);
+    // About 0.01 and 1.5 degrees
+    CHECK(snorm16 < 2e-4f);
+    CHECK(snorm8 < 0.025f);
+}
+
+TEST_CASE(PackedMeshIsSmallerAndKeepsIndices)
+{
+    auto const mesh = Procedural::CreateSphere(64, 32);
+    auto const packed = PackMesh(mesh);
+
+    CHECK(mesh.vertexBuffers[0].vertexByteSize == 32);
+    CHECK(packed.vertexBuffers[0].vertexByteSize == 16);
+    CHECK(packed.vertexBuffers[0].vertexCount == mesh.vertexBuffers[0].vertexCount);
+    CHECK(packed.indexBuffer.data == mesh.indexBuffer.data);
+
+    // Eight byte normals are padded back to a four byte stride
+    CHECK(PackMesh(mesh, NormalPacking::Snorm8).vertexBuffers[0].vertexByteSize == 16);
+}
+
+TEST_CASE(PackedMeshErrorIsWithinQuantizationBounds)
+{
+    // Off-center mesh so the position offset matters
+    auto mesh = Procedural::CreateSphere(64, 32);
+    auto& vertexBuffer = mesh.vertexBuffers[0];
+    for(auto i = 0; i < vertexBuffer.vertexCount; ++i)
+    {
+        auto const position = reinterpret_cast<float*>(vertexBuffer.data.data() + i * vertexBuffer.vertexByteSize);
+        position[0] = position[0] * 20.0f + 100.0f;
+        position[1] = position[1] * 20.0f - 50.0f;
+        position[2] = position[2] * 20.0f;
+    }
+
+    auto const packed = PackMesh(mesh);
+    auto const error = MeasurePackingError(mesh, packed);
+
+    // Half a snorm step on each of three axes of the bounds
+    CHECK(error.maxPositionError <= packed.positionScale * std::sqrt(3.0f) * 0.5f / 32767.0f * 1.01f);
+    CHECK(error.maxNormalError < 2e-4f);
+    CHECK(error.maxUVError <= 1.0f / 4096.0f);
+
+    CHECK(MeasurePackingError(mesh, PackMesh(mesh, NormalPacking::Snorm8)).maxNormalError < 0.025f);
+}
+
+
+BENCHMARK_CASE(PackSphereMeshes)
+{
+    for(auto const sides : { 128, 512, 1024 })
+    {
+        auto const mesh = Procedural::CreateSphere(sides * 2, sides);
+        auto packed = Mesh();
+        auto const time = Tests::MeasureMilliseconds(1, [&] { packed = PackMesh(mesh); });
+        auto const error = MeasurePackingError(mesh, packed);
+
+        std::printf("  CreateSphere(%d, %d): %zu -> %zu vertex bytes in %.1f ms, position %.2e, normal %.2e rad, uv %.2e\n",
+            sides * 2, sides, mesh.vertexBuffers[0].data.size(), packed.vertexBuffers[0].data.size(), time,
+            error.maxPositionError, error.maxNormalError, error.maxUVError);
+    }
+
+    auto const normals = RandomNormals(1000000, 2);
+    std::printf("  octahedral normals over %zu directions: snorm16 %.2e rad, snorm8 %.2e rad\n", normals.size(),
+        MaxOctahedralError(normals, VertexPacking::PackSnorm16, VertexPacking::UnpackSnorm16),
+        MaxOctahedralError(normals, VertexPacking::PackSnorm8, VertexPacking::UnpackSnorm8));
+}
@@ -1,12 +1,79 @@
 #include "App.hpp"
 
 
-int main(int const argc, char const* const argv[])
+// Every allocation goes through the memory tracker and is charged to the current memory tag
+auto operator new(size_t const size) -> void*
 {
+    if(auto const pointer = SolarSystem::TrackedAllocate(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__, SolarSystem::GetCurrentMemoryTag()))
+    {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+auto operator new(size_t const size, std::align_val_t const alignment) -> void*
+{
+    if(auto const pointer = SolarSystem::TrackedAllocate(size, static_cast<size_t>(alignment), SolarSystem::GetCurrentMemoryTag()))
+    {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+auto operator delete(void* const pointer) noexcept -> void
+{
+    SolarSystem::TrackedDeallocate(pointer);
+}
+
+auto operator delete(void* const pointer, size_t) noexcept -> void
+{
+    SolarSystem::TrackedDeallocate(pointer);
+}
+
+auto operator delete(void* const pointer, std::align_val_t) noexcept -> void
+{
+    SolarSystem::TrackedDeallocate(pointer);
+}
+
+auto operator delete(void* const pointer, size_t, std::align_val_t) noexcept -> void
+{
+    SolarSystem::TrackedDeallocate(pointer);
+}
+
+
+int main(int argc, char const* argv[])
+{
+    // Converts a text scene into the binary form for shipping: --compile-scene <input> <output>
+    if(argc == 4 && std::string(argv[1]) == "--compile-scene")
+    {
+        try
+        {
+            SolarSystem::WriteSceneBinary(argv[3], SolarSystem::LoadSceneFile(argv[2]));
+            return 0;
+        }
+        catch(std::exception const& e)
+        {
+            std::cout << e.what() << std::endl;
+            return 1;
+        }
+    }
+
+    // Records a replay log while running or plays one back: --record <log> or --replay <log>, followed by the usual arguments
+    auto replayOption = std::string();
+    auto replayLog = std::string();
+    if(argc >= 3 && (std::string(argv[1]) == "--record" || std::string(argv[1]) == "--replay"))
+    {
+        replayOption = argv[1];
+        replayLog = argv[2];
+        argc -= 2;
+        argv += 2;
+    }
+
     auto width = 1600;
     auto height = 900;
+    auto scene = std::string("Scenes/SolarSystem.scene");
 
-    if(argc == 3)
+    if(argc == 3 || argc == 4)
     {
         std::cout << argv[1] << std::endl;
         std::cout << argv[2] << std::endl;
@@ -20,10 +87,26 @@ int main(int const argc, char const* const argv[])
         }
     }
 
+    if(argc == 4)
+    {
+        scene = argv[3];
+    }
+
     try
     {
-        App app{ width, height };
-        app.Run();
+        App app{ width, height, scene };
+        if(replayOption == "--record")
+        {
+            app.Record(replayLog);
+        }
+        else if(replayOption == "--replay")
+        {
+            return app.Replay(replayLog) ? 0 : 1;
+        }
+        else
+        {
+            app.Run();
+        }
     }
     catch(std::exception const& e)
     {